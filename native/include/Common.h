@@ -1,6 +1,9 @@
 #ifndef _OSMAND_COMMON_H_
 #define _OSMAND_COMMON_H_
 
+#include <string>
+#include <vector>
+
 // Unordered containers
 #include <unordered_map>
 #include <unordered_set>
@@ -21,4 +24,8 @@
 
 typedef std::pair<std::string, std::string> tag_value;
 
+// Strings of one data block, shared by the objects read from it.
+typedef std::vector<std::string> StringTable_t;
+typedef SHARED_PTR<StringTable_t const> StringTable_pointer;
+
 #endif // _OSMAND_COMMON_H_
@@ -0,0 +1,161 @@
+/*
+ * AddressIndex.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "AddressIndex.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include "utf8/unchecked.h"
+
+namespace
+{
+
+struct Fold
+{
+	uint32_t from;
+	uint32_t to;
+	char base;
+};
+
+// Latin letters with accents, upper and lower case, to their base letter.
+Fold const LATIN[] = {
+	{ 0xC0, 0xC5, 'a' }, { 0xC7, 0xC7, 'c' }, { 0xC8, 0xCB, 'e' }, { 0xCC, 0xCF, 'i' },
+	{ 0xD1, 0xD1, 'n' }, { 0xD2, 0xD6, 'o' }, { 0xD8, 0xD8, 'o' }, { 0xD9, 0xDC, 'u' },
+	{ 0xDD, 0xDD, 'y' }, { 0xE0, 0xE5, 'a' }, { 0xE7, 0xE7, 'c' }, { 0xE8, 0xEB, 'e' },
+	{ 0xEC, 0xEF, 'i' }, { 0xF1, 0xF1, 'n' }, { 0xF2, 0xF6, 'o' }, { 0xF8, 0xF8, 'o' },
+	{ 0xF9, 0xFC, 'u' }, { 0xFD, 0xFD, 'y' }, { 0xFF, 0xFF, 'y' },
+	{ 0x100, 0x105, 'a' }, { 0x106, 0x10D, 'c' }, { 0x10E, 0x111, 'd' }, { 0x112, 0x11B, 'e' },
+	{ 0x11C, 0x123, 'g' }, { 0x124, 0x127, 'h' }, { 0x128, 0x131, 'i' }, { 0x134, 0x135, 'j' },
+	{ 0x136, 0x138, 'k' }, { 0x139, 0x142, 'l' }, { 0x143, 0x14B, 'n' }, { 0x14C, 0x151, 'o' },
+	{ 0x154, 0x159, 'r' }, { 0x15A, 0x161, 's' }, { 0x162, 0x167, 't' }, { 0x168, 0x173, 'u' },
+	{ 0x174, 0x175, 'w' }, { 0x176, 0x178, 'y' }, { 0x179, 0x17E, 'z' }, { 0x17F, 0x17F, 's' },
+};
+
+// 0 for separators
+uint32_t foldCodePoint(uint32_t cp)
+{
+	if (cp < 0x80) {
+		if (cp >= 'A' && cp <= 'Z')
+			return cp + ('a' - 'A');
+		if ((cp >= 'a' && cp <= 'z') || (cp >= '0' && cp <= '9'))
+			return cp;
+		return 0;
+	}
+	if (cp >= 0xC0 && cp <= 0x17F) {
+		for (size_t i = 0; i < sizeof(LATIN) / sizeof(LATIN[0]); i++)
+			if (cp >= LATIN[i].from && cp <= LATIN[i].to)
+				return LATIN[i].base;
+		if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7)
+			return cp + 0x20;
+		if (cp == 0x132 || cp == 0x152) // ligatures
+			return cp + 1;
+		return cp == 0xD7 || cp == 0xF7 ? 0 : cp;
+	}
+	if (cp < 0xC0)
+		return 0; // Latin-1 punctuation and spaces
+	// Cyrillic, with ё as е
+	if (cp >= 0x400 && cp <= 0x40F)
+		cp += 0x50;
+	else if (cp >= 0x410 && cp <= 0x42F)
+		cp += 0x20;
+	if (cp == 0x451)
+		return 0x435;
+	// Greek
+	if (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2)
+		return cp + 0x20;
+	if (cp == 0x2010 || cp == 0x2011 || cp == 0x2013 || cp == 0x2014 || cp == 0x2019)
+		return 0;
+	return cp;
+}
+
+bool isWordStart(std::string const & keys, size_t i)
+{
+	return keys[i] != ' ' && keys[i] != '\0' && (i == 0 || keys[i - 1] == ' ' || keys[i - 1] == '\0');
+}
+
+} // namespace
+
+std::string normalizeName(std::string const & name)
+{
+	std::string output;
+	output.reserve(name.size());
+	char const * it = name.c_str();
+	char const * end = it + name.size();
+	bool space = false;
+	while (it < end)
+	{
+		// Typed prefixes may be cut anywhere: bad bytes stand for U+FFFD
+		uint32_t cp;
+		if (utf8::internal::validate_next(it, end, cp) != utf8::internal::UTF8_OK) {
+			cp = 0xfffd;
+			it++;
+		}
+		cp = foldCodePoint(cp);
+		if (cp == 0) {
+			space = !output.empty();
+			continue;
+		}
+		if (space)
+			output.push_back(' ');
+		space = false;
+		utf8::unchecked::append(cp, std::back_inserter(output));
+	}
+	return output;
+}
+
+uint32_t AddressNames::addText(std::string const & s)
+{
+	uint32_t offset = texts.size();
+	texts.append(s.c_str(), s.size() + 1);
+	return offset;
+}
+
+void AddressNames::addName(std::string const & name, uint32_t object)
+{
+	std::string key = normalizeName(name);
+	if (key.empty())
+		return;
+	size_t start = keys.size();
+	keys.append(key.c_str(), key.size() + 1);
+	for (size_t i = start; i < keys.size(); i++) {
+		if (isWordStart(keys, i)) {
+			Entry e = { (uint32_t) i, object };
+			entries.push_back(e);
+		}
+	}
+}
+
+void AddressNames::build()
+{
+	char const * k = keys.c_str();
+	std::sort(entries.begin(), entries.end(), [k](Entry const & a, Entry const & b)
+			{
+		int c = strcmp(k + a.key, k + b.key);
+		return c < 0 || (c == 0 && a.object < b.object);
+			});
+	std::vector<AddressCity>(cities).swap(cities);
+	std::vector<AddressStreet>(streets).swap(streets);
+	std::vector<Entry>(entries).swap(entries);
+	std::string(texts).swap(texts);
+	std::string(keys).swap(keys);
+}
+
+void AddressNames::find(std::string const & prefix, size_t limit, std::vector<uint32_t> & objects) const
+{
+	char const * k = keys.c_str();
+	size_t n = prefix.size();
+	// Keys starting with prefix are together, from the first not below it.
+	std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), prefix,
+			[k](Entry const & e, std::string const & p) { return strcmp(k + e.key, p.c_str()) < 0; });
+	size_t first = objects.size();
+	for (; it != entries.end() && objects.size() - first < limit; it++) {
+		if (strncmp(k + it->key, prefix.c_str(), n) != 0)
+			break;
+		// A name with two words starting alike has two keys
+		if (std::find(objects.begin() + first, objects.end(), it->object) == objects.end())
+			objects.push_back(it->object);
+	}
+}
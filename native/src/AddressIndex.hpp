@@ -0,0 +1,212 @@
+/*
+ * AddressIndex.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef ADDRESSINDEX_HPP_
+#define ADDRESSINDEX_HPP_
+
+#include <vector>
+#include <string>
+#include <climits>
+#include <mutex>
+#include "Common.h"
+#include "Map.hpp"
+#include "BinaryIndex.hpp"
+
+#include <boost/function.hpp>
+
+// Lower case without accents, words separated by one space.
+// Names and typed text are compared in this form.
+std::string normalizeName(std::string const & name);
+
+// Names are offsets into AddressNames::texts.
+struct AddressCity {
+	uint64_t id;
+	uint32_t name;
+	uint32_t nameEn;
+	uint32_t x;
+	uint32_t y;
+	uint32_t blockOffset; // streets, 0 when none
+	uint8_t cityType;     // CityIndex city_type
+	uint8_t blockType;    // CitiesIndex type: cities, postcodes or villages
+};
+
+struct AddressStreet {
+	uint64_t id;
+	uint32_t name;
+	uint32_t nameEn;
+	uint32_t x;
+	uint32_t y;
+	uint32_t offset; // of the street message, to read its buildings
+	uint32_t city;   // in AddressNames::cities
+};
+
+struct AddressBuilding {
+	uint64_t id;
+	std::string name;
+	std::string name2; // last number of an interpolation
+	std::string postcode;
+	uint32_t x;
+	uint32_t y;
+	uint32_t x2;
+	uint32_t y2;
+	int32_t interpolation;
+
+	AddressBuilding() : id(0), x(0), y(0), x2(0), y2(0), interpolation(0) {}
+};
+
+// Every city and street of an address index with a prefix index over
+// their normalized names. Each word start of a name is a key, so typing
+// the start of any word finds the name, and the following words narrow it.
+// Built once per file on the first search, then only read.
+struct AddressNames {
+	std::vector<AddressCity> cities;
+	std::vector<AddressStreet> streets;
+	// Original names, '\0' terminated
+	std::string texts;
+
+	// Object is a city below cities.size(), a street after.
+	struct Entry {
+		uint32_t key; // in keys
+		uint32_t object;
+	};
+	// Normalized names, '\0' terminated. Keys are their word suffixes.
+	std::string keys;
+	std::vector<Entry> entries;
+
+	char const * text(uint32_t offset) const {
+		return texts.c_str() + offset;
+	}
+	uint32_t addText(std::string const & s);
+	// Adds the keys of a name of object
+	void addName(std::string const & name, uint32_t object);
+	// Sorts entries. After this only find.
+	void build();
+
+	// Distinct objects with a key starting with prefix (normalized), in key order.
+	void find(std::string const & prefix, size_t limit, std::vector<uint32_t> & objects) const;
+
+	size_t memorySize() const {
+		return sizeof(AddressNames) + cities.capacity() * sizeof(AddressCity)
+				+ streets.capacity() * sizeof(AddressStreet) + texts.capacity()
+				+ keys.capacity() + entries.capacity() * sizeof(Entry);
+	}
+};
+typedef SHARED_PTR<AddressNames const> AddressNames_pointer;
+
+struct AddressIndex : BinaryPartIndex {
+	std::string nameEn;
+
+	struct CitiesBlock {
+		uint32_t type;
+		uint32_t filePointer;
+		uint32_t length;
+	};
+	std::vector<CitiesBlock> citiesBlocks;
+
+	typedef boost::function<void(AddressNames &)> NamesReader_t;
+	typedef boost::function<void(AddressStreet const &, std::vector<AddressBuilding> &)> BuildingsReader_t;
+
+	AddressIndex()
+	: BinaryPartIndex(ADDRESS_INDEX),
+	  box(point_t(INT_MAX, INT_MAX), point_t(-1, -1))
+	{}
+
+	// Read the first time. Several threads can ask at the same time,
+	// one reads and the others wait for it.
+	AddressNames_pointer names() const
+	{
+		std::lock_guard<std::mutex> lock(namesMutex);
+		if (!namesContent && namesReader) {
+			SHARED_PTR<AddressNames> n(new AddressNames);
+			namesReader(*n);
+			n->build();
+			namesContent = n;
+		}
+		return namesContent;
+	}
+
+	// Buildings of a street of names() whose number starts with prefix. Read every time.
+	void buildings(AddressStreet const & street, std::string const & prefix,
+			std::vector<AddressBuilding> & output) const
+	{
+		if (!buildingsReader)
+			return;
+		std::vector<AddressBuilding> all;
+		buildingsReader(street, all);
+		std::string p = normalizeName(prefix);
+		for (size_t i = 0; i < all.size(); i++) {
+			if (normalizeName(all[i].name).compare(0, p.size(), p) == 0)
+				output.push_back(std::move(all[i]));
+		}
+	}
+
+	void Readers(NamesReader_t n, BuildingsReader_t b)
+	{
+		namesReader = n;
+		buildingsReader = b;
+	}
+
+	// Be careful
+	void Box(bbox_t const & b)
+	{
+		box = b;
+	}
+	bbox_t const & Box() const
+	{
+		return box;
+	}
+
+private:
+	bbox_t box;
+
+	mutable std::mutex namesMutex;
+	mutable AddressNames_pointer namesContent;
+	NamesReader_t namesReader;
+	BuildingsReader_t buildingsReader;
+};
+
+// A city or street found by prefix.
+struct AddressMatch {
+	AddressIndex const * index;
+	AddressNames const * names;
+	AddressCity const * city;     // the street's city for streets
+	AddressStreet const * street; // NULL for cities
+};
+
+struct AddressPublisher {
+	std::vector<AddressMatch> result;
+	// Files the matches come from. Their names stay while the file is open.
+	std::vector< SHARED_PTR<void const> > pinned;
+
+	void pin(SHARED_PTR<void const> const & p) {
+		pinned.push_back(p);
+	}
+	bool publish(AddressMatch const & m) {
+		result.push_back(m);
+		return true;
+	}
+	virtual bool isCancelled() const {
+		return false;
+	}
+	virtual ~AddressPublisher() {
+	}
+};
+
+struct AddressQuery {
+	std::string prefix; // as typed
+	size_t limit;
+	AddressPublisher* publisher;
+
+	AddressQuery(std::string const & p, size_t l, AddressPublisher* publisher)
+	: prefix(p), limit(l), publisher(publisher)
+	{}
+
+	bool cancelled() const {
+		return publisher != NULL && publisher->isCancelled();
+	}
+};
+
+#endif /* ADDRESSINDEX_HPP_ */
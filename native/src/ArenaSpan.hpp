@@ -0,0 +1,102 @@
+/*
+ * ArenaSpan.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef ARENASPAN_HPP_
+#define ARENASPAN_HPP_
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+// Read only sequence over memory owned by someone else (an arena).
+// It looks like a const std::vector so readers do not care where data lives.
+// A copy owns its elements: it can outlive the arena and can be edited,
+// which is what routing does with projected roads.
+template <typename T>
+class ArenaSpan
+{
+public:
+	typedef T value_type;
+	typedef T const * const_iterator;
+	typedef const_iterator iterator;
+
+	ArenaSpan() : first(NULL), count(0) {}
+	// View over an arena. Caller keeps memory alive.
+	ArenaSpan(T const * data, size_t size) : first(data), count(size) {}
+
+	ArenaSpan(ArenaSpan const & o) : first(NULL), count(0)
+	{
+		assign(o.begin(), o.end());
+	}
+	ArenaSpan & operator=(ArenaSpan const & o)
+	{
+		if (this != &o)
+			assign(o.begin(), o.end());
+		return *this;
+	}
+	// noexcept, or vectors of spans copy them when they grow
+	ArenaSpan(ArenaSpan && o) noexcept : first(o.first), count(o.count), owned(std::move(o.owned))
+	{
+		o.first = NULL;
+		o.count = 0;
+	}
+	ArenaSpan & operator=(ArenaSpan && o) noexcept
+	{
+		if (this == &o)
+			return *this;
+		first = o.first;
+		count = o.count;
+		owned = std::move(o.owned);
+		o.first = NULL;
+		o.count = 0;
+		return *this;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T const & operator[](size_t i) const { return first[i]; }
+	const_iterator begin() const { return first; }
+	const_iterator end() const { return first + count; }
+
+	// Editing makes a private copy first.
+	const_iterator insert(const_iterator pos, T const & value)
+	{
+		size_t at = pos - first;
+		detach();
+		owned->insert(owned->begin() + at, value);
+		reset();
+		return first + at;
+	}
+
+	// Only what is not in the arena.
+	size_t ownedMemorySize() const
+	{
+		return owned ? owned->capacity() * sizeof(T) : 0;
+	}
+
+private:
+	void assign(const_iterator b, const_iterator e)
+	{
+		owned.reset(b == e ? NULL : new std::vector<T>(b, e));
+		reset();
+	}
+	void detach()
+	{
+		if (!owned)
+			owned.reset(new std::vector<T>(begin(), end()));
+	}
+	void reset()
+	{
+		first = (owned && !owned->empty()) ? &(*owned)[0] : NULL;
+		count = owned ? owned->size() : 0;
+	}
+
+	T const * first;
+	size_t count;
+	std::unique_ptr<std::vector<T> > owned;
+};
+
+#endif /* ARENASPAN_HPP_ */
@@ -0,0 +1,618 @@
+/*
+ * ContractionHierarchy.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "ContractionHierarchy.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <climits>
+#include <limits>
+#include <set>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+
+#include "binaryRead.h"
+#include "common2.h"
+#include "Logging.h"
+
+void RoutingQuery(MapFilesSnapshot const & mapFiles, bbox_t & b, RouteDataObjects_t & output);
+
+namespace {
+
+typedef ContractionHierarchy::Edge Edge;
+uint32_t const NONE = ContractionHierarchy::NONE;
+float const NO_TIME = std::numeric_limits<float>::infinity();
+
+char const MAGIC[8] = { 'O', 's', 'm', 'A', 'n', 'd', 'C', 'H' };
+uint32_t const VERSION = 3;
+
+// Roads are read in tiles of 2^TILE units, about 20 km
+int const TILE = 20;
+// Witness searches give up after that many nodes: shortcuts are then
+// added that a longer search could have spared.
+size_t const WITNESS_SETTLED = 500;
+
+inline int64_t pointKey(uint32_t x31, uint32_t y31)
+{
+	return ((int64_t) x31 << 32) + y31;
+}
+
+// Accepted roads of the routing indexes, each once
+template <typename Visitor>
+size_t visitRoads(MapFilesSnapshot const & mapFiles, RoadAttributesCache & attributes, Visitor & visit)
+{
+	using boost::geometry::make;
+	std::vector<SpatialDirectory::Entry const *> entries;
+	mapFiles.directory.queryRouting(make<bbox_t>(0, 0, INT_MAX, INT_MAX), false, entries);
+	std::set<int64_t> tiles;
+	for (size_t i = 0; i < entries.size(); i++) {
+		RouteSubregion const * s = entries[i]->subregion;
+		for (uint32_t x = s->left >> TILE; x <= s->right >> TILE; x++) {
+			for (uint32_t y = s->top >> TILE; y <= s->bottom >> TILE; y++) {
+				tiles.insert(pointKey(x, y));
+			}
+		}
+	}
+	UNORDERED(set)<int64_t> seen;
+	RouteDataObjects_t objects;
+	for (std::set<int64_t>::const_iterator it = tiles.begin(); it != tiles.end(); it++) {
+		int64_t x = *it >> 32;
+		int64_t y = *it & UINT_MAX;
+		bbox_t b = make<bbox_t>(x << TILE, y << TILE,
+				std::min<int64_t>(((x + 1) << TILE) - 1, INT_MAX), std::min<int64_t>(((y + 1) << TILE) - 1, INT_MAX));
+		objects.clear();
+		RoutingQuery(mapFiles, b, objects);
+		for (size_t i = 0; i < objects.size(); i++) {
+			RouteDataObject_pointer const & o = objects[i];
+			if (o != nullptr && o->pointsX.size() > 1 && attributes.road(*o).accepted && seen.insert(o->id).second) {
+				visit(*o);
+			}
+		}
+	}
+	return seen.size();
+}
+
+// Points of the roads, road ends twice: junctions and ends are there more than once
+struct PointsCollector {
+	std::vector<int64_t> keys;
+	size_t restricted;
+
+	PointsCollector() : restricted(0) {}
+
+	void operator()(RouteDataObject const & road) {
+		size_t last = road.pointsX.size() - 1;
+		for (size_t p = 0; p <= last; p++) {
+			keys.push_back(pointKey(road.pointsX[p], road.pointsY[p]));
+		}
+		keys.push_back(pointKey(road.pointsX[0], road.pointsY[0]));
+		keys.push_back(pointKey(road.pointsX[last], road.pointsY[last]));
+		if (road.restrictions.size() > 0) {
+			restricted++;
+		}
+	}
+};
+
+// Graph being contracted, from the edges ch has. Arcs to contracted nodes
+// stay where they are and are skipped: in the end, they are the edges of
+// the hierarchy.
+class Contraction
+{
+public:
+	explicit Contraction(ContractionHierarchy & ch)
+	: ch(ch), out(ch.nodesCount()), in(ch.nodesCount()), contracted(ch.nodesCount(), false),
+	  neighbours(ch.nodesCount(), 0), distance(ch.nodesCount(), NO_TIME)
+	{
+		for (size_t e = 0; e < ch.edges.size(); e++) {
+			Arc a = { ch.edges[e].to, (uint32_t) e };
+			out[ch.edges[e].from].push_back(a);
+			a.node = ch.edges[e].from;
+			in[ch.edges[e].to].push_back(a);
+		}
+	}
+
+	// Parallel edges keep the quickest. Edges between nodes not contracted
+	// yet are not in any shortcut, the edge is replaced where it is.
+	void addEdge(uint32_t from, uint32_t to, float time, uint32_t first, uint32_t second) {
+		Edge e = { from, to, time, first, second };
+		std::vector<Arc> & arcs = out[from];
+		for (size_t i = 0; i < arcs.size(); i++) {
+			if (arcs[i].node == to) {
+				Edge & old = ch.edges[arcs[i].edge];
+				if (time < old.time) {
+					old = e;
+				}
+				return;
+			}
+		}
+		Arc a = { to, (uint32_t) ch.edges.size() };
+		arcs.push_back(a);
+		a.node = from;
+		in[to].push_back(a);
+		ch.edges.push_back(e);
+	}
+
+	// Least priority first: nodes that add few shortcuts for the edges
+	// they remove, among few contracted neighbours. Priorities are checked
+	// again when taken, neighbours changed them.
+	void run() {
+		typedef std::pair<int, uint32_t> Item;
+		std::priority_queue<Item, std::vector<Item>, std::greater<Item> > order;
+		for (uint32_t n = 0; n < ch.nodesCount(); n++) {
+			order.push(Item(priority(n), n));
+		}
+		ch.rank.assign(ch.nodesCount(), NONE);
+		uint32_t rank = 0;
+		while (!order.empty()) {
+			uint32_t n = order.top().second;
+			order.pop();
+			int p = priority(n);
+			if (!order.empty() && p > order.top().first) {
+				order.push(Item(p, n));
+				continue;
+			}
+			shortcuts(n, true);
+			contracted[n] = true;
+			ch.rank[n] = rank++;
+			for (size_t i = 0; i < out[n].size(); i++) {
+				neighbours[out[n][i].node]++;
+			}
+			for (size_t i = 0; i < in[n].size(); i++) {
+				neighbours[in[n][i].node]++;
+			}
+		}
+	}
+
+private:
+	struct Arc {
+		uint32_t node;
+		uint32_t edge;
+	};
+
+	int priority(uint32_t n) {
+		int removed = 0;
+		for (size_t i = 0; i < out[n].size(); i++) {
+			removed += contracted[out[n][i].node] ? 0 : 1;
+		}
+		for (size_t i = 0; i < in[n].size(); i++) {
+			removed += contracted[in[n][i].node] ? 0 : 1;
+		}
+		return 2 * (shortcuts(n, false) - removed) + neighbours[n];
+	}
+
+	// Shortcuts contracting n needs, added if add
+	int shortcuts(uint32_t n, bool add) {
+		int count = 0;
+		for (size_t i = 0; i < in[n].size(); i++) {
+			uint32_t u = in[n][i].node;
+			if (contracted[u])
+				continue;
+			float toN = ch.edges[in[n][i].edge].time;
+			float limit = -1;
+			for (size_t j = 0; j < out[n].size(); j++) {
+				uint32_t w = out[n][j].node;
+				if (!contracted[w] && w != u)
+					limit = std::max(limit, toN + ch.edges[out[n][j].edge].time);
+			}
+			if (limit < 0)
+				continue;
+			witness(u, n, limit);
+			for (size_t j = 0; j < out[n].size(); j++) {
+				uint32_t w = out[n][j].node;
+				float through = toN + ch.edges[out[n][j].edge].time;
+				if (contracted[w] || w == u || distance[w] <= through)
+					continue;
+				count++;
+				if (add)
+					addEdge(u, w, through, in[n][i].edge, out[n][j].edge);
+			}
+			for (size_t t = 0; t < touched.size(); t++) {
+				distance[touched[t]] = NO_TIME;
+			}
+			touched.clear();
+		}
+		return count;
+	}
+
+	// Distances from source up to limit, around skip
+	void witness(uint32_t source, uint32_t skip, float limit) {
+		typedef std::pair<float, uint32_t> Item;
+		std::priority_queue<Item, std::vector<Item>, std::greater<Item> > open;
+		distance[source] = 0;
+		touched.push_back(source);
+		open.push(Item(0, source));
+		size_t settled = 0;
+		while (!open.empty() && settled < WITNESS_SETTLED) {
+			Item it = open.top();
+			open.pop();
+			if (it.first > distance[it.second])
+				continue;
+			if (it.first > limit)
+				break;
+			settled++;
+			std::vector<Arc> const & arcs = out[it.second];
+			for (size_t i = 0; i < arcs.size(); i++) {
+				uint32_t next = arcs[i].node;
+				if (contracted[next] || next == skip)
+					continue;
+				float t = it.first + ch.edges[arcs[i].edge].time;
+				if (t < distance[next]) {
+					if (distance[next] == NO_TIME)
+						touched.push_back(next);
+					distance[next] = t;
+					open.push(Item(t, next));
+				}
+			}
+		}
+	}
+
+	ContractionHierarchy & ch;
+	std::vector<std::vector<Arc> > out;
+	std::vector<std::vector<Arc> > in;
+	std::vector<bool> contracted;
+	std::vector<int> neighbours;
+	std::vector<float> distance;
+	std::vector<uint32_t> touched;
+};
+
+// Edges between consecutive nodes of the roads, where they allow it
+struct EdgesCollector {
+	RoadAttributesCache & attributes;
+	GeneralRouter const & router;
+	ContractionHierarchy & ch;
+	Contraction & graph;
+	// Turns from a road of less penaltyTransition to one of more cost time
+	double minTransition;
+	double maxTransition;
+
+	void operator()(RouteDataObject const & road) {
+		RoadAttributes const a = attributes.road(road);
+		int oneway = a.oneway;
+		minTransition = std::min(minTransition, a.penaltyTransition);
+		maxTransition = std::max(maxTransition, a.penaltyTransition);
+		uint32_t last = 0;
+		uint32_t lastNode = ch.node(road.pointsX[0], road.pointsY[0]);
+		for (uint32_t p = 1; p < road.pointsX.size(); p++) {
+			uint32_t n = ch.node(road.pointsX[p], road.pointsY[p]);
+			if (n == NONE)
+				continue;
+			if (n != lastNode && oneway >= 0)
+				add(road, last, p, lastNode, n);
+			if (n != lastNode && oneway <= 0)
+				add(road, p, last, n, lastNode);
+			last = p;
+			lastNode = n;
+		}
+	}
+
+	void add(RouteDataObject const & road, uint32_t from, uint32_t to, uint32_t fromNode, uint32_t toNode) {
+		ContractionHierarchy::Piece piece = { road.id, from, to };
+		ch.pieces.push_back(piece);
+		graph.addEdge(fromNode, toNode, roadStretchTime(attributes, router, road, from, to), ch.pieces.size() - 1, NONE);
+	}
+};
+
+// What a file could hold that index(), unpack() and queries would go wrong on
+char const * checkHierarchy(ContractionHierarchy const & ch)
+{
+	uint32_t nodes = ch.nodesCount();
+	for (uint32_t n = 1; n < nodes; n++) {
+		if (ch.nodeX[n - 1] > ch.nodeX[n] || (ch.nodeX[n - 1] == ch.nodeX[n] && ch.nodeY[n - 1] >= ch.nodeY[n]))
+			return "nodes are not sorted";
+	}
+	std::vector<bool> ranked(nodes, false);
+	for (uint32_t n = 0; n < nodes; n++) {
+		if (ch.rank[n] >= nodes || ranked[ch.rank[n]])
+			return "ranks are not an order of the nodes";
+		ranked[ch.rank[n]] = true;
+	}
+	for (size_t e = 0; e < ch.edges.size(); e++) {
+		Edge const & edge = ch.edges[e];
+		if (edge.from >= nodes || edge.to >= nodes || !(edge.time >= 0) || std::isinf(edge.time))
+			return "an edge is out of the graph";
+		if (edge.second == NONE) {
+			if (edge.first >= ch.pieces.size())
+				return "an edge is out of the roads";
+			continue;
+		}
+		if (edge.first >= ch.edges.size() || edge.second >= ch.edges.size())
+			return "a shortcut is out of the edges";
+		// Unpacking goes down in rank, so it ends
+		Edge const & first = ch.edges[edge.first];
+		Edge const & second = ch.edges[edge.second];
+		if (first.from != edge.from || first.to != second.from || second.to != edge.to
+				|| ch.rank[first.to] >= ch.rank[edge.from] || ch.rank[first.to] >= ch.rank[edge.to])
+			return "a shortcut does not join its edges";
+	}
+	for (size_t p = 0; p < ch.pieces.size(); p++) {
+		if (ch.pieces[p].from == ch.pieces[p].to)
+			return "a road piece is empty";
+	}
+	if ((ch.turns & ~(ContractionHierarchy::TURN_RESTRICTIONS | ContractionHierarchy::TURN_COSTS)) != 0)
+		return "turns are unknown";
+	return NULL;
+}
+
+} // namespace
+
+uint32_t sortedNode(std::vector<uint32_t> const & nodeX, std::vector<uint32_t> const & nodeY, uint32_t x31, uint32_t y31)
+{
+	uint32_t low = 0;
+	uint32_t high = nodeX.size();
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (nodeX[middle] < x31 || (nodeX[middle] == x31 && nodeY[middle] < y31)) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low < nodeX.size() && nodeX[low] == x31 && nodeY[low] == y31 ? low : NONE;
+}
+
+void ContractionHierarchy::index()
+{
+	forwardBegin.assign(nodesCount() + 1, 0);
+	backwardBegin.assign(nodesCount() + 1, 0);
+	for (size_t e = 0; e < edges.size(); e++) {
+		if (rank[edges[e].from] < rank[edges[e].to]) {
+			forwardBegin[edges[e].from + 1]++;
+		} else {
+			backwardBegin[edges[e].to + 1]++;
+		}
+	}
+	for (uint32_t n = 0; n < nodesCount(); n++) {
+		forwardBegin[n + 1] += forwardBegin[n];
+		backwardBegin[n + 1] += backwardBegin[n];
+	}
+	forward.resize(forwardBegin.back());
+	backward.resize(backwardBegin.back());
+	std::vector<uint32_t> f(forwardBegin.begin(), forwardBegin.end() - 1);
+	std::vector<uint32_t> b(backwardBegin.begin(), backwardBegin.end() - 1);
+	for (size_t e = 0; e < edges.size(); e++) {
+		if (rank[edges[e].from] < rank[edges[e].to]) {
+			forward[f[edges[e].from]++] = e;
+		} else {
+			backward[b[edges[e].to]++] = e;
+		}
+	}
+}
+
+void ContractionHierarchy::unpack(uint32_t e, std::vector<uint32_t> & originals) const
+{
+	std::vector<uint32_t> stack(1, e);
+	while (!stack.empty()) {
+		Edge const & edge = edges[stack.back()];
+		if (edge.second == NONE) {
+			originals.push_back(stack.back());
+			stack.pop_back();
+		} else {
+			stack.back() = edge.second;
+			stack.push_back(edge.first);
+		}
+	}
+}
+
+bool ContractionHierarchy::write(std::string const & fileName) const
+{
+	FILE * f = fopen(fileName.c_str(), "wb");
+	if (f == NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be open to write : %s", fileName.c_str());
+		return false;
+	}
+	uint32_t counts[3] = { nodesCount(), (uint32_t) edges.size(), (uint32_t) pieces.size() };
+	bool ok = fwrite(MAGIC, 1, sizeof(MAGIC), f) == sizeof(MAGIC) && fwrite(&VERSION, sizeof(VERSION), 1, f) == 1
+			&& identity.write(f) && fwrite(&turns, sizeof(turns), 1, f) == 1 && fwrite(counts, sizeof(counts), 1, f) == 1
+			&& writeDataArray(f, nodeX) && writeDataArray(f, nodeY) && writeDataArray(f, rank)
+			&& writeDataArray(f, edges) && writeDataArray(f, pieces);
+	ok = fclose(f) == 0 && ok;
+	if (!ok) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be written : %s", fileName.c_str());
+	}
+	return ok;
+}
+
+bool ContractionHierarchy::read(std::string const & fileName)
+{
+	FILE * f = fopen(fileName.c_str(), "rb");
+	if (f == NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be open to read : %s", fileName.c_str());
+		return false;
+	}
+	char magic[sizeof(MAGIC)];
+	uint32_t version;
+	uint32_t counts[3];
+	bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+			&& fread(&version, sizeof(version), 1, f) == 1 && version == VERSION
+			&& identity.read(f) && fread(&turns, sizeof(turns), 1, f) == 1 && fread(counts, sizeof(counts), 1, f) == 1
+			// the arrays must fill the rest of the file, before anything is allocated
+			&& remainingDataBytes(f) == (uint64_t) counts[0] * 3 * sizeof(uint32_t)
+					+ (uint64_t) counts[1] * sizeof(Edge) + (uint64_t) counts[2] * sizeof(Piece)
+			&& readDataArray(f, nodeX, counts[0]) && readDataArray(f, nodeY, counts[0]) && readDataArray(f, rank, counts[0])
+			&& readDataArray(f, edges, counts[1]) && readDataArray(f, pieces, counts[2]);
+	fclose(f);
+	if (!ok) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File is not a contraction hierarchy : %s", fileName.c_str());
+		*this = ContractionHierarchy();
+		return false;
+	}
+	char const * error = checkHierarchy(*this);
+	if (error != NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Contraction hierarchy %s is broken: %s", fileName.c_str(), error);
+		*this = ContractionHierarchy();
+		return false;
+	}
+	index();
+	return true;
+}
+
+ContractionHierarchy_pointer loadContractionHierarchy(std::string const & fileName,
+		MapFilesSnapshot const & mapFiles, GeneralRouter const & router)
+{
+	ContractionHierarchy_pointer ch = loadRoutingData<ContractionHierarchy>(fileName, mapFiles, router);
+	if (ch && ch->turns != 0) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "%s was made of roads with turn %s the hierarchy ignores, the road search is used",
+				fileName.c_str(), (ch->turns & ContractionHierarchy::TURN_RESTRICTIONS) ? "restrictions" : "costs");
+		return ContractionHierarchy_pointer();
+	}
+	return ch;
+}
+
+double roadStretchTime(RoadAttributesCache & attributes, GeneralRouter const & router,
+		RouteDataObject const & road, uint32_t from, uint32_t to)
+{
+	RoadAttributes const a = attributes.road(road);
+	double speed = a.speed * a.priority;
+	if (speed == 0) {
+		speed = router.getMinDefaultSpeed() * a.priority;
+	}
+	int delta = from < to ? 1 : -1;
+	double distance = 0;
+	double obstacles = 0;
+	for (uint32_t p = from; p != to; p += delta) {
+		distance += distance31TileMetric(road.pointsX[p], road.pointsY[p],
+				road.pointsX[p + delta], road.pointsY[p + delta]);
+		double obstacle = attributes.routingObstacle(road, p + delta);
+		if (obstacle > 0) {
+			obstacles += obstacle;
+		}
+	}
+	return obstacles + distance / speed;
+}
+
+bool buildRoadGraph(MapFilesSnapshot const & mapFiles, GeneralRouter & router, ContractionHierarchy & graph)
+{
+	RoadAttributesCache attributes(router);
+	graph = ContractionHierarchy();
+	graph.identity = RoutingDataIdentity(mapFiles, router);
+
+	PointsCollector points;
+	size_t roads = visitRoads(mapFiles, attributes, points);
+	std::sort(points.keys.begin(), points.keys.end());
+	for (size_t i = 1; i < points.keys.size(); i++) {
+		if (points.keys[i] == points.keys[i - 1] && (graph.nodeX.empty()
+				|| pointKey(graph.nodeX.back(), graph.nodeY.back()) != points.keys[i])) {
+			graph.nodeX.push_back(points.keys[i] >> 32);
+			graph.nodeY.push_back(points.keys[i] & UINT_MAX);
+		}
+	}
+	std::vector<int64_t>().swap(points.keys);
+	if (roads == 0) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "No road to make a graph of");
+		return false;
+	}
+	if (points.restricted > 0 && router.restrictionsAware()) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "%d roads have turn restrictions, the road graph ignores them",
+				(int) points.restricted);
+		graph.turns |= ContractionHierarchy::TURN_RESTRICTIONS;
+	}
+
+	Contraction edges(graph);
+	EdgesCollector collector = { attributes, router, graph, edges, NO_TIME, -NO_TIME };
+	visitRoads(mapFiles, attributes, collector);
+	if (router.leftTurn > 0 || router.rightTurn > 0 || router.roundaboutTurn > 0
+			|| collector.maxTransition > collector.minTransition) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "The profile has turn costs, the road graph ignores them");
+		graph.turns |= ContractionHierarchy::TURN_COSTS;
+	}
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Graph of %d roads: %d nodes and %d edges",
+			(int) roads, (int) graph.nodesCount(), (int) graph.edges.size());
+	return true;
+}
+
+bool buildContractionHierarchy(MapFilesSnapshot const & mapFiles, GeneralRouter & router, ContractionHierarchy & ch)
+{
+	if (!buildRoadGraph(mapFiles, router, ch))
+		return false;
+	size_t originals = ch.edges.size();
+	Contraction graph(ch);
+	graph.run();
+	ch.index();
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Contraction hierarchy of %d nodes: %d shortcuts",
+			(int) ch.nodesCount(), (int) (ch.edges.size() - originals));
+	return true;
+}
+
+bool HierarchyPlanner::plan(std::vector<HierarchyAccess> const & sources, std::vector<HierarchyAccess> const & targets,
+		float limit, HierarchyPath & path)
+{
+	typedef std::pair<float, uint32_t> Item;
+	typedef std::priority_queue<Item, std::vector<Item>, std::greater<Item> > Queue_t;
+	Labels_t labels[2];
+	Queue_t open[2];
+	std::vector<HierarchyAccess> const * ends[2] = { &sources, &targets };
+	for (int side = 0; side < 2; side++) {
+		for (size_t i = 0; i < ends[side]->size(); i++) {
+			HierarchyAccess const & a = (*ends[side])[i];
+			Label l = { a.time, NONE };
+			std::pair<Labels_t::iterator, bool> r = labels[side].insert(std::make_pair(a.node, l));
+			if (!r.second && r.first->second.time <= a.time)
+				continue;
+			r.first->second = l;
+			open[side].push(Item(a.time, a.node));
+		}
+	}
+
+	// Up from both ends until neither side can make a shorter path
+	float best = limit;
+	uint32_t meet = NONE;
+	settled = 0;
+	for (;;) {
+		float top[2];
+		for (int side = 0; side < 2; side++) {
+			top[side] = open[side].empty() ? NO_TIME : open[side].top().first;
+		}
+		if (top[0] >= best && top[1] >= best)
+			break;
+		int side = top[0] <= top[1] ? 0 : 1;
+		uint32_t n = open[side].top().second;
+		open[side].pop();
+		if (top[side] > labels[side][n].time)
+			continue;
+		settled++;
+		Labels_t::const_iterator other = labels[1 - side].find(n);
+		if (other != labels[1 - side].end() && top[side] + other->second.time < best) {
+			best = top[side] + other->second.time;
+			meet = n;
+		}
+		std::vector<uint32_t> const & up = side == 0 ? ch.forward : ch.backward;
+		std::vector<uint32_t> const & begin = side == 0 ? ch.forwardBegin : ch.backwardBegin;
+		for (uint32_t i = begin[n]; i < begin[n + 1]; i++) {
+			ContractionHierarchy::Edge const & e = ch.edges[up[i]];
+			uint32_t next = side == 0 ? e.to : e.from;
+			Label l = { top[side] + e.time, up[i] };
+			std::pair<Labels_t::iterator, bool> r = labels[side].insert(std::make_pair(next, l));
+			if (!r.second && r.first->second.time <= l.time)
+				continue;
+			r.first->second = l;
+			open[side].push(Item(l.time, next));
+		}
+	}
+	if (meet == NONE)
+		return false;
+
+	// Shortcuts up to the meeting node and down from it
+	path.edges.clear();
+	std::vector<uint32_t> up;
+	uint32_t n = meet;
+	for (uint32_t e = labels[0][n].edge; e != NONE; e = labels[0][n].edge) {
+		up.push_back(e);
+		n = ch.edges[e].from;
+	}
+	path.source = n;
+	for (size_t i = up.size(); i > 0; i--) {
+		ch.unpack(up[i - 1], path.edges);
+	}
+	n = meet;
+	for (uint32_t e = labels[1][n].edge; e != NONE; e = labels[1][n].edge) {
+		ch.unpack(e, path.edges);
+		n = ch.edges[e].to;
+	}
+	path.target = n;
+	path.time = labels[0][meet].time + labels[1][meet].time;
+	return true;
+}
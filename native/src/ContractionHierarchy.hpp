@@ -0,0 +1,157 @@
+/*
+ * ContractionHierarchy.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef CONTRACTIONHIERARCHY_HPP_
+#define CONTRACTIONHIERARCHY_HPP_
+
+#include <vector>
+#include <string>
+#include <climits>
+#include "Common.h"
+#include "RoadAttributesCache.hpp"
+#include "RoutingDataFile.hpp"
+
+struct MapFilesSnapshot;
+
+// Node at x31, y31 of nodes sorted by x then y, UINT_MAX if none is there
+uint32_t sortedNode(std::vector<uint32_t> const & nodeX, std::vector<uint32_t> const & nodeY, uint32_t x31, uint32_t y31);
+
+// Roads of the open routing indexes as a graph of their junctions, for one
+// router profile. Nodes are points shared by roads and road ends; an edge
+// goes along one road from a node to the next one, where the road allows
+// it, taking as long as the A* search counts it. Nodes are contracted one
+// by one in rank order, and shortcuts join their remaining neighbours when
+// no other path is as short; a query then only goes up in rank from both
+// ends. Turn costs and restrictions are not in the graph: routes are the
+// A* ones for profiles without them, and hierarchies of roads that have
+// them are not loaded for searches (see turns).
+struct ContractionHierarchy {
+	static uint32_t const NONE = UINT_MAX;
+	// What the A* search counts and edges do not, bits of turns
+	static uint32_t const TURN_RESTRICTIONS = 1;
+	static uint32_t const TURN_COSTS = 2;
+
+	// Stretch of a road between two of its points, as the file has them
+	struct Piece {
+		int64_t road;
+		uint32_t from;
+		uint32_t to;
+	};
+	// Shortcuts are edge first then edge second, original edges a piece
+	struct Edge {
+		uint32_t from;
+		uint32_t to;
+		float time; // s
+		uint32_t first;  // edge, or piece of an original edge
+		uint32_t second; // edge, NONE for an original edge
+	};
+
+	// Sorted by x then y
+	std::vector<uint32_t> nodeX;
+	std::vector<uint32_t> nodeY;
+	std::vector<uint32_t> rank; // contraction order
+	std::vector<Edge> edges;
+	std::vector<Piece> pieces;
+	// Files and profile it was built for
+	RoutingDataIdentity identity;
+	// TURN_* the roads had for the profile, 0 if none
+	uint32_t turns;
+
+	// Made by index(). Edges to higher ranks, by their lower node: leaving
+	// it in forward[forwardBegin[n]] to forward[forwardBegin[n + 1]], and
+	// arriving at it in backward.
+	std::vector<uint32_t> forwardBegin;
+	std::vector<uint32_t> forward;
+	std::vector<uint32_t> backwardBegin;
+	std::vector<uint32_t> backward;
+
+	ContractionHierarchy() : turns(0) {}
+
+	uint32_t nodesCount() const {
+		return nodeX.size();
+	}
+	// NONE if no node is there
+	uint32_t node(uint32_t x31, uint32_t y31) const {
+		return sortedNode(nodeX, nodeY, x31, y31);
+	}
+	void index();
+	// Original edges of e, in order
+	void unpack(uint32_t e, std::vector<uint32_t> & originals) const;
+
+	// In the byte order of the machine, with its identity
+	bool write(std::string const & fileName) const;
+	// False unless every count and index read is in range, and shortcuts
+	// join edges through a node of lower rank than both ends
+	bool read(std::string const & fileName);
+
+	size_t memorySize() const {
+		return sizeof(ContractionHierarchy)
+				+ (nodeX.capacity() + nodeY.capacity() + rank.capacity()) * sizeof(uint32_t)
+				+ edges.capacity() * sizeof(Edge) + pieces.capacity() * sizeof(Piece)
+				+ (forwardBegin.capacity() + forward.capacity()) * sizeof(uint32_t)
+				+ (backwardBegin.capacity() + backward.capacity()) * sizeof(uint32_t);
+	}
+};
+typedef SHARED_PTR<ContractionHierarchy const> ContractionHierarchy_pointer;
+
+// Hierarchy of fileName if it was built from the routing files of mapFiles
+// and for the profile of router, NULL otherwise, see loadRoutingData. It is
+// NULL as well if the roads had turns, its routes could take forbidden turns
+// or miss turn costs.
+ContractionHierarchy_pointer loadContractionHierarchy(std::string const & fileName,
+		MapFilesSnapshot const & mapFiles, GeneralRouter const & router);
+
+// Time from point from to point to of road, as edges count it: length at
+// the routing speed and priority, and obstacles of the points after from.
+double roadStretchTime(RoadAttributesCache & attributes, GeneralRouter const & router,
+		RouteDataObject const & road, uint32_t from, uint32_t to);
+
+// Nodes and edges only, no rank. Reads the roads of the routing indexes
+// tile by tile, twice: to find the junctions, then to make the edges.
+bool buildRoadGraph(MapFilesSnapshot const & mapFiles, GeneralRouter & router, ContractionHierarchy & graph);
+// The graph is kept in memory while contracting it
+bool buildContractionHierarchy(MapFilesSnapshot const & mapFiles, GeneralRouter & router, ContractionHierarchy & ch);
+
+// A node reached from a route end, and the time between them
+struct HierarchyAccess {
+	uint32_t node;
+	float time;
+};
+
+struct HierarchyPath {
+	float time;
+	uint32_t source; // nodes
+	uint32_t target;
+	std::vector<uint32_t> edges; // original ones, in order
+};
+
+// Bidirectional Dijkstra up the hierarchy from sources and targets.
+// Labels are hashed, searches are small whatever the graph.
+class HierarchyPlanner
+{
+public:
+	explicit HierarchyPlanner(ContractionHierarchy const & ch) : ch(ch), settled(0) {}
+
+	// False if no path is shorter than limit
+	bool plan(std::vector<HierarchyAccess> const & sources, std::vector<HierarchyAccess> const & targets,
+			float limit, HierarchyPath & path);
+
+	size_t settledNodes() const {
+		return settled;
+	}
+
+private:
+	struct Label {
+		float time;
+		uint32_t edge; // reached by, NONE from an access
+	};
+	typedef UNORDERED(map)<uint32_t, Label> Labels_t;
+
+	ContractionHierarchy const & ch;
+	size_t settled;
+};
+
+#endif /* CONTRACTIONHIERARCHY_HPP_ */
@@ -0,0 +1,71 @@
+/*
+ * DeltaOverlay.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "DeltaOverlay.hpp"
+#include "binaryRead.h"
+
+static char const * const CHANGE_TAG = "osmand_change";
+static char const * const CHANGE_DELETE = "delete";
+
+bool isDeletionMarker(MapDataObject const & o)
+{
+	static uint32_t const deleteId = internTagValue(CHANGE_TAG, CHANGE_DELETE);
+	for (size_t i = 0; i < o.types.size(); i++) {
+		if (o.types.id(i) == deleteId) {
+			return true;
+		}
+	}
+	return o.containsAdditional(deleteId);
+}
+
+bool isDeletionMarker(RouteDataObject const & o)
+{
+	if (o.region == NULL) {
+		return false;
+	}
+	std::vector<tag_value> const & rules = o.region->decodingRules;
+	for (RouteTypes_t::const_iterator t = o.types.begin(); t != o.types.end(); t++) {
+		if (*t < rules.size() && rules[*t].first == CHANGE_TAG && rules[*t].second == CHANGE_DELETE) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void readDeltaIds(BinaryMapFile const & delta, SortedIdSet & mapIds, SortedIdSet & routeIds)
+{
+	std::vector<long long> ids;
+	std::vector<bool> fresh;
+	for (size_t m = 0; m < delta.mapIndexes.size(); m++) {
+		std::vector<MapRoot> const & levels = delta.mapIndexes[m]->levels;
+		for (size_t l = 0; l < levels.size(); l++) {
+			MapDataObjects_t objects;
+			levels[l].MapTreeBounds::query(levels[l].Box(), objects);
+			for (size_t i = 0; i < objects.size(); i++) {
+				ids.push_back(objects[i]->id);
+			}
+		}
+	}
+	mapIds.insert(ids, fresh);
+
+	ids.clear();
+	for (size_t r = 0; r < delta.routingIndexes.size(); r++) {
+		RoutingIndex const * index = delta.routingIndexes[r];
+		for (int base = 0; base < 2; base++) {
+			RoutingIndex::regions_t const & regions = base ? index->basesubregions : index->subregions;
+			for (size_t s = 0; s < regions.size(); s++) {
+				RouteDataObjects_t objects;
+				regions[s].query(regions[s].Box(), objects);
+				for (size_t i = 0; i < objects.size(); i++) {
+					if (objects[i] != nullptr) {
+						ids.push_back(objects[i]->id);
+					}
+				}
+			}
+		}
+	}
+	routeIds.insert(ids, fresh);
+}
@@ -0,0 +1,72 @@
+/*
+ * DeltaOverlay.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef DELTAOVERLAY_HPP_
+#define DELTAOVERLAY_HPP_
+
+#include <cstddef>
+
+#include "SortedIdSet.hpp"
+
+class MapDataObject;
+struct RouteDataObject;
+struct BinaryMapFile;
+
+// A delta file is a small OBF layered over a base file that stays open
+// unchanged. It has the added and modified objects of the region, and for
+// each deleted one an object with the same id tagged osmand_change=delete.
+// Queries hide the objects of the base, and of older deltas, whose id is in
+// a newer delta, and drop the deletion markers.
+
+// What queries hide in one file of a snapshot.
+struct FileOverlay
+{
+	SortedIdSet hiddenMap;
+	SortedIdSet hiddenRoute;
+	bool delta; // the file itself is a delta, it may have markers
+
+	FileOverlay() : delta(false) {}
+};
+
+bool isDeletionMarker(MapDataObject const & o);
+bool isDeletionMarker(RouteDataObject const & o);
+
+// Ids of every object of a delta file. Reads all of it, deltas are small.
+void readDeltaIds(BinaryMapFile const & delta, SortedIdSet & mapIds, SortedIdSet & routeIds);
+
+// Removes from objects[from, end) what overlay hides. NULL overlay hides nothing.
+template <typename Objects>
+void applyOverlay(FileOverlay const * overlay, SortedIdSet const & hidden, Objects & objects, size_t from = 0)
+{
+	if (overlay == NULL) {
+		return;
+	}
+	typename Objects::iterator out = objects.begin() + from;
+	for (typename Objects::iterator it = out; it != objects.end(); ++it) {
+		if (*it == nullptr || hidden.contains((*it)->id)
+				|| (overlay->delta && isDeletionMarker(**it))) {
+			continue;
+		}
+		*out++ = *it;
+	}
+	objects.erase(out, objects.end());
+}
+
+template <typename Objects>
+void applyMapOverlay(FileOverlay const * overlay, Objects & objects, size_t from = 0)
+{
+	if (overlay != NULL)
+		applyOverlay(overlay, overlay->hiddenMap, objects, from);
+}
+
+template <typename Objects>
+void applyRouteOverlay(FileOverlay const * overlay, Objects & objects, size_t from = 0)
+{
+	if (overlay != NULL)
+		applyOverlay(overlay, overlay->hiddenRoute, objects, from);
+}
+
+#endif /* DELTAOVERLAY_HPP_ */
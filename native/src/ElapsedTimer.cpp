@@ -1,7 +1,8 @@
 #include "ElapsedTimer.h"
 
 OsmAnd::ElapsedTimer::ElapsedTimer()
-    : isEnabled(true)
+    : elapsed(high_resolution_clock::duration::zero())
+    , isEnabled(true)
     , isRunning(false)
 {
 }
@@ -13,6 +13,10 @@
 #include "Map.hpp"
 #include "BinaryIndex.hpp"
 #include "SearchQuery.hpp"
+#include "NodeMutex.hpp"
+#include "NodeCache.hpp"
+#include "QuerySink.hpp"
+#include "DeltaOverlay.hpp"
 
 #include <boost/geometry/algorithms/intersects.hpp>
 #include <boost/range/algorithm/for_each.hpp>
@@ -27,8 +31,55 @@ typedef std::vector<MapDataObject_pointer> MapDataObjects_t;
 
 struct MapTreeBounds
 {
-	typedef boost::function<void(MapTreeBounds &)> Reader_t;
 	typedef std::vector<MapTreeBounds> Bounds_t;
+	// Could be an intermediate or leaf node depending on what data has.
+	struct Content
+	{
+		Bounds_t bounds;
+		// Owned. Query results keep the content alive (see ResultPublisher::pin).
+		MapDataObjects_t dataObjects;
+		// Names of dataObjects point here
+		StringTable_pointer stringTable;
+		size_t bytes;
+
+		Content() : bytes(0) {}
+		~Content()
+		{
+			nodeCacheReleased(bytes);
+			for (MapDataObjects_t::const_iterator it = dataObjects.begin(); it != dataObjects.end(); ++it)
+				delete *it;
+		}
+		size_t memorySize() const
+		{
+			size_t sz = sizeof(Content) + bounds.capacity() * sizeof(MapTreeBounds)
+					+ dataObjects.capacity() * sizeof(MapDataObject_pointer);
+			for (MapDataObjects_t::const_iterator it = dataObjects.begin(); it != dataObjects.end(); ++it)
+				if (*it != nullptr)
+					sz += (*it)->memorySize();
+			if (stringTable) {
+				sz += sizeof(StringTable_t) + stringTable->capacity() * sizeof(std::string);
+				for (StringTable_t::const_iterator s = stringTable->begin(); s != stringTable->end(); ++s)
+					sz += s->capacity();
+			}
+			return sz;
+		}
+	};
+	typedef SHARED_PTR<Content const> Content_pointer;
+	typedef boost::function<void(MapTreeBounds const &, Content &)> Reader_t;
+
+	// Rendering query: stops when the publisher is cancelled and keeps
+	// every content it takes objects from alive in the publisher.
+	struct QuerySink : CancellableSink<MapDataObject_pointer, SearchQuery>
+	{
+		QuerySink(SearchQuery const & q, MapDataObjects_t & result)
+				: CancellableSink<MapDataObject_pointer, SearchQuery>(result, q) {}
+
+		void node(Content_pointer const & content)
+		{
+			if (query.publisher != NULL && !content->dataObjects.empty())
+				query.publisher->pin(content);
+		}
+	};
 
 	uint32_t length;
 	uint32_t filePointer;
@@ -41,13 +92,14 @@ struct MapTreeBounds
 
 	MapTreeBounds()
 	: ocean(-1),
-	  box(point_t(INT_MAX, INT_MAX), point_t(-1, -1))
+	  box(point_t(INT_MAX, INT_MAX), point_t(-1, -1)),
+	  lastUsed(0)
 	{}
 
 	inline void query(SearchQuery & q, MapDataObjects_t & result) const
 	{
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug, "query");
-		if (q.publisher->isCancelled())
+		if (q.cancelled())
 		{
 			result.clear();
 			return;
@@ -73,67 +125,63 @@ struct MapTreeBounds
 //msg << " MTB query box? " << b << " in " << box << std::endl;
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug, msg.str().c_str());
 //}
-// Before using data
-		((MapTreeBounds *)this)->readContent();  // TODO cast????
-
-		// THINK: Maybe using boost::function to do only 1 call (one of them do nothing)
-		for_each(bounds,
-				[&b, &result](MapTreeBounds const & node){node.query(b, result);});
-		for_each(dataObjects,
+		// Before using data. Content is kept alive while we use it.
+		Content_pointer content = readContent();
+		if (!content)
+			return;
+		QuerySink sink(q, result);
+		sink.node(content);
+
+		for (Bounds_t::const_iterator node = content->bounds.begin(); node != content->bounds.end(); ++node)
+			if (!node->stream(b, sink))
+				return;
+		// Only objects of this level are filtered by rendering rules.
+		for_each(content->dataObjects,
 				[&q, &b, &result](MapDataObject_pointer const & obj)
 				{
 			if ((obj != nullptr) && intersects(b, obj->Box()) && q.acceptTypes(obj->types))
 				result.push_back(obj);
 				});
-// TODO add boxes to DataObject and propagate query to DataObjects.
-////	copy(dataObjects, std::back_inserter(result));
 	}
 
-	// TODO extract as algorithm and do a lazy implementation.
-	// Incrementally add results
-	void query(bbox_t const & b, MapDataObjects_t & result) const
+	// Objects in b, given to the sink as nodes are read (see QuerySink.hpp).
+	template <typename Sink>
+	bool stream(bbox_t const & b, Sink & sink) const
 	{
 		using boost::geometry::intersects;
-		using boost::range::for_each;
-		using boost::range::copy;
 
 		// I can't say anything
 		if (!intersects(b, box))
-			return;
-//{
-//std::ostringstream msg;
-//msg << " MTB query box? " << b << " in " << box << std::endl;
-//OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug, msg.str().c_str());
-//}
-		// Before using data
-		((MapTreeBounds *)this)->readContent();  // TODO cast????
-
-		// THINK: Maybe using boost::function to do only 1 call (one of them do nothing)
-		for_each(bounds,
-				 [&b, &result](MapTreeBounds const & node){node.query(b, result);});
-		for_each(dataObjects,
-				[&b, &result](MapDataObject_pointer const & obj)
-					{
-			if ((obj != nullptr) && intersects(b, obj->Box()))
-				result.push_back(obj);
-					});
-// TODO add boxes to DataObject and propagate query to DataObjects.
-////		copy(dataObjects, std::back_inserter(result));
+			return true;
+		// Nothing is read for an abandoned query.
+		if (sink.cancelled())
+			return false;
+		// Before using data. Content is kept alive while we use it.
+		Content_pointer content = readContent();
+		if (!content)
+			return true;
+		sink.node(content);
+
+		for (Bounds_t::const_iterator node = content->bounds.begin(); node != content->bounds.end(); ++node)
+			if (!node->stream(b, sink))
+				return false;
+		for (MapDataObjects_t::const_iterator obj = content->dataObjects.begin(); obj != content->dataObjects.end(); ++obj)
+			if ((*obj != nullptr) && intersects(b, (*obj)->Box()) && !sink(*obj))
+				return false;
+		return true;
 	}
 
-	void ContentReader(Reader_t r)
+	void query(bbox_t const & b, MapDataObjects_t & result) const
 	{
-		contentReader = r;
+		CollectSink<MapDataObject_pointer> sink(result);
+		stream(b, sink);
 	}
 
-	void Children(Bounds_t && nodes)
-	{
-		bounds = nodes;
-	}
-	void DataObjects(MapDataObjects_t && objs)
+	void ContentReader(Reader_t r)
 	{
-		dataObjects = objs;
+		contentReader = r;
 	}
+
 	// Be careful
 	void Box(bbox_t const & b)
 	{
@@ -144,26 +192,59 @@ struct MapTreeBounds
 		return box;
 	}
 
-private:
-	// Read if not yet
-	void readContent()
+	// What is already in memory, without reading anything.
+	Content_pointer loadedContent() const
+	{
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		return content;
+	}
+	uint32_t LastUsed() const
 	{
-		if (!hasContent())
-			if (contentReader)
-				contentReader(*this);
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		return lastUsed;
+	}
+	// Back to not read state. Current users keep their copy.
+	bool dropContent() const
+	{
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		if (!content || !contentReader)
+			return false;
+		content.reset();
+		return true;
 	}
 
-	// Both data structures empty
-	bool hasContent() const
+private:
+	// Read if not yet.
+	// Several threads can arrive here at the same time and decode it, but
+	// all of them get the result the first one published.
+	Content_pointer readContent() const
 	{
-		return !bounds.empty() || !dataObjects.empty();
+		{
+			std::lock_guard<std::mutex> lock(nodeMutex(this));
+			lastUsed = nodeCacheClock();
+			if (content || !contentReader)
+				return content;
+		}
+		// Decoded with no lock, nodes sharing the mutex do not wait for it
+		SHARED_PTR<Content> c(new Content);
+		contentReader(*this, *c);
+		size_t bytes = c->memorySize();
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		// The first one published is kept. Only it is counted, a dropped
+		// one releases no bytes.
+		if (!content)
+		{
+			c->bytes = bytes;
+			nodeCacheLoaded(bytes);
+			content = c;
+		}
+		return content;
 	}
 
 	bbox_t box;
 
-	// Could be an intermediate or leaf node depending on what data has.
- 	Bounds_t bounds;
-	MapDataObjects_t dataObjects;
+	mutable Content_pointer content;
+	mutable uint32_t lastUsed;
 
 	Reader_t contentReader;
 };
@@ -190,6 +271,8 @@ struct MapIndex : BinaryPartIndex {
 	std::vector<MapRoot> levels;
 
 	UNORDERED(map)<int, tag_value > decodingRules;
+	// Interned id (TagDictionary) of each rule. NO_TAG_VALUE where there is no rule.
+	std::vector<uint32_t> decodingIds;
 private:
 	// Mainly unused
 	int nameEncodingType;
@@ -226,6 +309,10 @@ public:
 	void initMapEncodingRule(uint32_t type, uint32_t id, std::string const & tag, std::string const & val) {
 		tag_value pair = tag_value(tag, val);
 		decodingRules[id] = pair;
+		if (decodingIds.size() <= id) {
+			decodingIds.resize(id + 1, (uint32_t) NO_TAG_VALUE);
+		}
+		decodingIds[id] = internTagValue(pair);
 
 		if ("name" == tag) {
 			nameEncodingType = id;
@@ -250,12 +337,13 @@ public:
 		}
 	}
 
-	void query(SearchQuery & q) const
+	// overlay: what deltas hide in this file (see DeltaOverlay.hpp), may be NULL
+	void query(SearchQuery & q, FileOverlay const * overlay = NULL) const
 	{
 		using boost::geometry::intersects;
 		using boost::range::for_each;
 
-		if (q.publisher->isCancelled())
+		if (q.cancelled())
 		{
 			return;
 		}
@@ -268,6 +356,7 @@ public:
 //std::cerr << " MIndex query box? " << b << " in " << box << std::endl;
 		MapDataObjects_t result;
 		for_each(levels, [&q, &result](MapRoot const & root) { root.query(q, result); });
+		applyMapOverlay(overlay, result);
 		q.publisher->publish(std::move(result));
 	}
 	// Be careful
@@ -280,8 +369,28 @@ public:
 		return box;
 	}
 
+	// Indexes opened from the cache read their encoding rules
+	// just before the first object is decoded.
+	void RulesReader(boost::function<void()> r)
+	{
+		rulesReader = r;
+	}
+	void loadRules() const
+	{
+		std::lock_guard<std::mutex> lock(rulesMutex);
+		if (rulesReader)
+		{
+			boost::function<void()> r;
+			r.swap(rulesReader);
+			r();
+		}
+	}
+
 private:
 	bbox_t box;
+
+	mutable std::mutex rulesMutex;
+	mutable boost::function<void()> rulesReader;
 };
 
 #endif /* MAPINDEX_HPP_ */
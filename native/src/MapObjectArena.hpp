@@ -0,0 +1,80 @@
+/*
+ * MapObjectArena.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef MAPOBJECTARENA_HPP_
+#define MAPOBJECTARENA_HPP_
+
+#include <vector>
+#include <new>
+#include <cstddef>
+
+#include "mapObjects.h"
+
+// Owns the objects a search makes itself: roads converted from route data,
+// coastline polygons, fill and "nothing found" objects.
+// Objects are placed in blocks, so a tile of thousands of roads is a few
+// allocations, and all of them go away in clear() or with the arena.
+// Objects read from map files are not here, tree contents own them.
+class MapObjectArena
+{
+public:
+	MapObjectArena() : used(BLOCK_SIZE) {}
+	~MapObjectArena()
+	{
+		clear();
+	}
+
+	MapDataObject* create()
+	{
+		if (used == BLOCK_SIZE) {
+			blocks.push_back(static_cast<MapDataObject*>(::operator new(BLOCK_SIZE * sizeof(MapDataObject))));
+			used = 0;
+		}
+		MapDataObject* o = new (blocks.back() + used) MapDataObject();
+		used++;
+		return o;
+	}
+
+	size_t size() const
+	{
+		return blocks.empty() ? 0 : (blocks.size() - 1) * BLOCK_SIZE + used;
+	}
+
+	void clear()
+	{
+		for (size_t b = 0; b < blocks.size(); b++) {
+			size_t n = b + 1 == blocks.size() ? used : (size_t) BLOCK_SIZE;
+			for (size_t i = 0; i < n; i++) {
+				blocks[b][i].~MapDataObject();
+			}
+			::operator delete(blocks[b]);
+		}
+		blocks.clear();
+		used = BLOCK_SIZE;
+	}
+
+	size_t memorySize() const
+	{
+		size_t s = blocks.size() * BLOCK_SIZE * sizeof(MapDataObject);
+		for (size_t b = 0; b < blocks.size(); b++) {
+			size_t n = b + 1 == blocks.size() ? used : (size_t) BLOCK_SIZE;
+			for (size_t i = 0; i < n; i++) {
+				s += blocks[b][i].memorySize() - sizeof(MapDataObject);
+			}
+		}
+		return s;
+	}
+
+private:
+	MapObjectArena(MapObjectArena const &);
+	MapObjectArena & operator=(MapObjectArena const &);
+
+	enum { BLOCK_SIZE = 256 };
+	std::vector<MapDataObject*> blocks;
+	size_t used;
+};
+
+#endif /* MAPOBJECTARENA_HPP_ */
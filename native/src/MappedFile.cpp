@@ -0,0 +1,73 @@
+/*
+ * MappedFile.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "MappedFile.hpp"
+
+#include <climits>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "Logging.h"
+
+bool MappedFile::map(int fd)
+{
+	unmap();
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Map file is empty or could not be stat");
+		return false;
+	}
+	if ((uint64_t) st.st_size > INT_MAX) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Map file too big to be read (%lld bytes)", (long long) st.st_size);
+		return false;
+	}
+#if defined(_WIN32)
+	HANDLE h = (HANDLE) _get_osfhandle(fd);
+	mapping = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "CreateFileMapping failed %d", (int) GetLastError());
+		return false;
+	}
+	void * p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (p == NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "MapViewOfFile failed %d", (int) GetLastError());
+		CloseHandle(mapping);
+		mapping = NULL;
+		return false;
+	}
+#else
+	void * p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "mmap failed for %lld bytes", (long long) st.st_size);
+		return false;
+	}
+#endif
+	data = static_cast<uint8_t const *>(p);
+	size = st.st_size;
+	return true;
+}
+
+void MappedFile::unmap()
+{
+	if (data == NULL) {
+		return;
+	}
+#if defined(_WIN32)
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	mapping = NULL;
+#else
+	munmap(const_cast<uint8_t *>(data), size);
+#endif
+	data = NULL;
+	size = 0;
+}
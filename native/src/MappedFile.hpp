@@ -0,0 +1,48 @@
+/*
+ * MappedFile.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef MAPPEDFILE_HPP_
+#define MAPPEDFILE_HPP_
+
+#include <stdint.h>
+#include <cstddef>
+
+// Read only view of a whole map file.
+// Lazy readers build their CodedInputStream directly over these bytes so
+// loading a tree node costs no syscall and no copy; pages come from the
+// OS page cache and are shared by every process mapping the same file.
+class MappedFile
+{
+public:
+	MappedFile() : data(NULL), size(0)
+#if defined(_WIN32)
+		, mapping(NULL)
+#endif
+	{}
+	~MappedFile() { unmap(); }
+
+	// Maps the whole file behind fd. fd may be closed afterwards.
+	bool map(int fd);
+	void unmap();
+
+	bool isMapped() const { return data != NULL; }
+	uint8_t const * Data() const { return data; }
+	size_t Size() const { return size; }
+	// protobuf streams are int sized
+	int StreamSize() const { return static_cast<int>(size); }
+
+private:
+	MappedFile(MappedFile const &);
+	MappedFile & operator=(MappedFile const &);
+
+	uint8_t const * data;
+	size_t size;
+#if defined(_WIN32)
+	void * mapping;
+#endif
+};
+
+#endif /* MAPPEDFILE_HPP_ */
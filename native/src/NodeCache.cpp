@@ -0,0 +1,74 @@
+/*
+ * NodeCache.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "NodeCache.hpp"
+
+#include <atomic>
+#include <mutex>
+
+#include "Logging.h"
+
+static std::mutex limitLock;
+static bool limitSet = false;
+static std::atomic<size_t> limitBytes(0);
+static std::atomic<size_t> usedBytes(0);
+static std::atomic<uint32_t> clockTicks(1);
+
+void setNodeCacheLimit(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(limitLock);
+	limitSet = true;
+	limitBytes = bytes;
+}
+
+void setDefaultNodeCacheLimit(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(limitLock);
+	if (!limitSet)
+	{
+		limitSet = true;
+		limitBytes = bytes;
+	}
+}
+
+size_t nodeCacheLimit()
+{
+	return limitBytes;
+}
+
+size_t nodeCacheUsed()
+{
+	return usedBytes;
+}
+
+void nodeCacheLoaded(size_t bytes)
+{
+	usedBytes += bytes;
+}
+
+void nodeCacheReleased(size_t bytes)
+{
+	// A release without its load would wrap the counter, and the cache
+	// would be over any limit from then on: it stops at 0 instead.
+	size_t used = usedBytes;
+	while (!usedBytes.compare_exchange_weak(used, used >= bytes ? used - bytes : 0))
+		;
+	if (used < bytes)
+	{
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Node cache released %d bytes more than it had",
+				(int) (bytes - used));
+	}
+}
+
+uint32_t nodeCacheClock()
+{
+	return clockTicks;
+}
+
+void nodeCacheTick()
+{
+	++clockTicks;
+}
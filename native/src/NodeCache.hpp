@@ -0,0 +1,47 @@
+/*
+ * NodeCache.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef NODECACHE_HPP_
+#define NODECACHE_HPP_
+
+#include <stdint.h>
+#include <cstddef>
+
+// Memory accounting of lazily decoded tree nodes (MapTreeBounds, RouteSubregion and PoiTreeBounds).
+// Decoded contents report their size here. When the limit is exceeded
+// trimNodeCache() drops the least recently used ones, which will be
+// read again from file if needed.
+
+// One limit for the whole process, set once at start (see java_wrap.cpp):
+// the queries of one kind do not change it for the others. 0 means no limit.
+void setNodeCacheLimit(size_t bytes);
+// Limit taken when none was set yet, as the nativeMemoryLimitInMB of the
+// first route search. Later calls do nothing.
+void setDefaultNodeCacheLimit(size_t bytes);
+size_t nodeCacheLimit();
+size_t nodeCacheUsed();
+inline bool nodeCacheOverLimit()
+{
+	size_t limit = nodeCacheLimit();
+	return limit != 0 && nodeCacheUsed() > limit;
+}
+
+// Each release must follow the load of the same bytes. One that does not
+// is logged as an error, and the count stops at 0.
+void nodeCacheLoaded(size_t bytes);
+void nodeCacheReleased(size_t bytes);
+
+// Clock to stamp node accesses. Advances on every query.
+uint32_t nodeCacheClock();
+void nodeCacheTick();
+
+// Implemented with the file registry. Trims files of the current snapshot.
+size_t trimNodeCache();
+// Bytes of the contents published in the trees of the current snapshot.
+// With no query running and no other snapshot alive it is nodeCacheUsed().
+size_t nodeCachePublished();
+
+#endif /* NODECACHE_HPP_ */
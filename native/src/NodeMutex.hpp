@@ -0,0 +1,22 @@
+/*
+ * NodeMutex.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef NODEMUTEX_HPP_
+#define NODEMUTEX_HPP_
+
+#include <mutex>
+#include <stdint.h>
+
+// Lazy tree nodes are too many to have a mutex each one.
+// They share a small pool selected by node address.
+// It is held only to look at or publish what a node has, never to decode it.
+inline std::mutex & nodeMutex(void const * node)
+{
+	static std::mutex pool[64];
+	return pool[(reinterpret_cast<uintptr_t>(node) >> 4) & 63];
+}
+
+#endif /* NODEMUTEX_HPP_ */
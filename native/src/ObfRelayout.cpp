@@ -0,0 +1,408 @@
+/*
+ * ObfRelayout.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "ObfRelayout.hpp"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <climits>
+#include <vector>
+#include <algorithm>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "proto/osmand_odb.pb.h"
+#include "proto/utils.hpp"
+#include "MappedFile.hpp"
+#include "Logging.h"
+
+// Map and routing boxes have the same layout, one reader does both.
+static_assert(OsmAndMapIndex_MapDataBox::kLeftFieldNumber == OsmAndRoutingIndex_RouteDataBox::kLeftFieldNumber
+		&& OsmAndMapIndex_MapDataBox::kRightFieldNumber == OsmAndRoutingIndex_RouteDataBox::kRightFieldNumber
+		&& OsmAndMapIndex_MapDataBox::kTopFieldNumber == OsmAndRoutingIndex_RouteDataBox::kTopFieldNumber
+		&& OsmAndMapIndex_MapDataBox::kBottomFieldNumber == OsmAndRoutingIndex_RouteDataBox::kBottomFieldNumber
+		&& OsmAndMapIndex_MapDataBox::kShiftToMapDataFieldNumber == OsmAndRoutingIndex_RouteDataBox::kShiftToDataFieldNumber
+		&& OsmAndMapIndex_MapDataBox::kBoxesFieldNumber == OsmAndRoutingIndex_RouteDataBox::kBoxesFieldNumber,
+		"map and routing boxes differ");
+
+uint32_t hilbertKey(uint32_t x31, uint32_t y31)
+{
+	static uint32_t const N = 1 << 16;
+	uint32_t x = x31 >> 15;
+	uint32_t y = y31 >> 15;
+	uint32_t d = 0;
+	for (uint32_t s = N / 2; s > 0; s /= 2) {
+		uint32_t rx = (x & s) > 0;
+		uint32_t ry = (y & s) > 0;
+		d += s * s * ((3 * rx) ^ ry);
+		if (ry == 0) {
+			if (rx == 1) {
+				x = N - 1 - x;
+				y = N - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+namespace
+{
+
+struct Bounds
+{
+	int left;
+	int right;
+	int top;
+	int bottom;
+};
+
+// Leaf box pointing to a block
+struct Leaf
+{
+	uint32_t shiftPos; // of its fixed32 offset
+	uint32_t boxStart; // offsets count from here
+	uint32_t target;   // length of the block
+	uint32_t key;
+};
+
+struct Block
+{
+	uint32_t start;     // its tag
+	uint32_t lengthPos; // where leaves point
+	uint32_t end;
+	uint32_t key;
+};
+
+// Blocks are moved only inside their container: a map level or a routing index.
+struct Container
+{
+	std::vector<Leaf> leaves;
+	std::vector<Block> blocks;
+};
+
+// After the tag
+bool readBox(CodedInputStream & input, Bounds const & parent, Container & container)
+{
+	uint32_t length;
+	if (!readInt(input, length)) {
+		return false;
+	}
+	uint32_t boxStart = input.TotalBytesRead();
+	CodedInputStream::Limit old = input.PushLimit(length);
+	Bounds b = parent;
+	uint32_t shift = 0;
+	uint32_t shiftPos = 0;
+	int32_t si;
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		// Delta encoded box coordinates
+		case OsmAndMapIndex_MapDataBox::kLeftFieldNumber:
+			readSint32(input, si);
+			b.left = si + parent.left;
+			break;
+		case OsmAndMapIndex_MapDataBox::kRightFieldNumber:
+			readSint32(input, si);
+			b.right = si + parent.right;
+			break;
+		case OsmAndMapIndex_MapDataBox::kTopFieldNumber:
+			readSint32(input, si);
+			b.top = si + parent.top;
+			break;
+		case OsmAndMapIndex_MapDataBox::kBottomFieldNumber:
+			readSint32(input, si);
+			b.bottom = si + parent.bottom;
+			break;
+		case OsmAndMapIndex_MapDataBox::kShiftToMapDataFieldNumber:
+			shiftPos = input.TotalBytesRead();
+			if (!readInt(input, shift)) {
+				return false;
+			}
+			break;
+		case OsmAndMapIndex_MapDataBox::kBoxesFieldNumber:
+			if (!readBox(input, b, container)) {
+				return false;
+			}
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}
+	input.PopLimit(old);
+	if (shift != 0) {
+		uint32_t x = ((uint64_t) (uint32_t) b.left + (uint32_t) b.right) / 2;
+		uint32_t y = ((uint64_t) (uint32_t) b.top + (uint32_t) b.bottom) / 2;
+		Leaf leaf = { shiftPos, boxStart, boxStart + shift, hilbertKey(x, y) };
+		container.leaves.push_back(leaf);
+	}
+	return true;
+}
+
+// After the tag
+bool readBlock(CodedInputStream & input, uint32_t start, Container & container)
+{
+	uint32_t lengthPos = input.TotalBytesRead();
+	uint32_t length;
+	if (!input.ReadVarint32(&length) || !input.Skip(length)) {
+		return false;
+	}
+	Block block = { start, lengthPos, (uint32_t) input.TotalBytesRead(), UINT_MAX };
+	container.blocks.push_back(block);
+	return true;
+}
+
+// After the tag
+bool readMapLevel(CodedInputStream & input, std::vector<Container> & containers)
+{
+	uint32_t length;
+	if (!readInt(input, length)) {
+		return false;
+	}
+	CodedInputStream::Limit old = input.PushLimit(length);
+	Container container;
+	Bounds level = { 0, 0, 0, 0 };
+	for (;;)
+	{
+		uint32_t start = input.TotalBytesRead();
+		int tag = input.ReadTag();
+		if (tag == 0) {
+			break;
+		}
+		bool ok = true;
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndMapIndex_MapRootLevel::kLeftFieldNumber:
+			ok = readInt32(input, level.left);
+			break;
+		case OsmAndMapIndex_MapRootLevel::kRightFieldNumber:
+			ok = readInt32(input, level.right);
+			break;
+		case OsmAndMapIndex_MapRootLevel::kTopFieldNumber:
+			ok = readInt32(input, level.top);
+			break;
+		case OsmAndMapIndex_MapRootLevel::kBottomFieldNumber:
+			ok = readInt32(input, level.bottom);
+			break;
+		case OsmAndMapIndex_MapRootLevel::kBoxesFieldNumber:
+			ok = readBox(input, level, container);
+			break;
+		case OsmAndMapIndex_MapRootLevel::kBlocksFieldNumber:
+			ok = readBlock(input, start, container);
+			break;
+		default:
+			ok = skipUnknownFields(input, tag);
+			break;
+		}
+		if (!ok) {
+			return false;
+		}
+	}
+	input.PopLimit(old);
+	containers.push_back(std::move(container));
+	return true;
+}
+
+// After the tag
+bool readMapIndex(CodedInputStream & input, std::vector<Container> & containers)
+{
+	uint32_t length;
+	if (!readInt(input, length)) {
+		return false;
+	}
+	CodedInputStream::Limit old = input.PushLimit(length);
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		bool ok = WireFormatLite::GetTagFieldNumber(tag) == OsmAndMapIndex::kLevelsFieldNumber
+				? readMapLevel(input, containers) : skipUnknownFields(input, tag);
+		if (!ok) {
+			return false;
+		}
+	}
+	input.PopLimit(old);
+	return true;
+}
+
+// After the tag
+bool readRoutingIndex(CodedInputStream & input, std::vector<Container> & containers)
+{
+	uint32_t length;
+	if (!readInt(input, length)) {
+		return false;
+	}
+	CodedInputStream::Limit old = input.PushLimit(length);
+	Container container;
+	Bounds root = { 0, 0, 0, 0 };
+	for (;;)
+	{
+		uint32_t start = input.TotalBytesRead();
+		int tag = input.ReadTag();
+		if (tag == 0) {
+			break;
+		}
+		bool ok = true;
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndRoutingIndex::kRootBoxesFieldNumber:
+		case OsmAndRoutingIndex::kBasemapBoxesFieldNumber:
+			ok = readBox(input, root, container);
+			break;
+		case OsmAndRoutingIndex::kBlocksFieldNumber:
+			ok = readBlock(input, start, container);
+			break;
+		default:
+			ok = skipUnknownFields(input, tag);
+			break;
+		}
+		if (!ok) {
+			return false;
+		}
+	}
+	input.PopLimit(old);
+	containers.push_back(std::move(container));
+	return true;
+}
+
+bool lengthPosLess(Block const & b, uint32_t pos)
+{
+	return b.lengthPos < pos;
+}
+
+void writeFixed32(uint8_t * p, uint32_t v)
+{
+	p[0] = (uint8_t) (v >> 24);
+	p[1] = (uint8_t) (v >> 16);
+	p[2] = (uint8_t) (v >> 8);
+	p[3] = (uint8_t) v;
+}
+
+// Returns how many blocks changed place. Containers of unexpected shape are left as they are.
+size_t relayout(Container & c, uint8_t const * in, std::vector<uint8_t> & out)
+{
+	std::vector<Block> & blocks = c.blocks;
+	if (blocks.size() < 2) {
+		return 0;
+	}
+	// Writers put all blocks together, after the boxes
+	for (size_t i = 0; i + 1 < blocks.size(); i++) {
+		if (blocks[i].end != blocks[i + 1].start) {
+			OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "Blocks at %d are not contiguous, left in place",
+					(int) blocks[0].start);
+			return 0;
+		}
+	}
+	for (size_t l = 0; l < c.leaves.size(); l++) {
+		Leaf const & leaf = c.leaves[l];
+		std::vector<Block>::iterator b = std::lower_bound(blocks.begin(), blocks.end(), leaf.target, lengthPosLess);
+		if (b == blocks.end() || b->lengthPos != leaf.target) {
+			OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "Box at %d points outside its blocks, left in place",
+					(int) leaf.boxStart);
+			return 0;
+		}
+		b->key = std::min(b->key, leaf.key);
+	}
+
+	std::vector<size_t> order(blocks.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(),
+			[&blocks](size_t a, size_t b) { return blocks[a].key < blocks[b].key; });
+
+	std::vector<uint32_t> newLengthPos(blocks.size());
+	uint32_t cursor = blocks.front().start;
+	size_t moved = 0;
+	for (size_t k = 0; k < order.size(); k++) {
+		Block const & b = blocks[order[k]];
+		std::copy(in + b.start, in + b.end, out.begin() + cursor);
+		newLengthPos[order[k]] = cursor + (b.lengthPos - b.start);
+		moved += cursor != b.start;
+		cursor += b.end - b.start;
+	}
+	for (size_t l = 0; l < c.leaves.size(); l++) {
+		Leaf const & leaf = c.leaves[l];
+		size_t b = std::lower_bound(blocks.begin(), blocks.end(), leaf.target, lengthPosLess) - blocks.begin();
+		writeFixed32(&out[leaf.shiftPos], newLengthPos[b] - leaf.boxStart);
+	}
+	return moved;
+}
+
+} // namespace
+
+bool relayoutObf(std::string const & inputName, std::string const & outputName)
+{
+#if defined(_WIN32)
+	int fd = open(inputName.c_str(), O_RDONLY | O_BINARY);
+#else
+	int fd = open(inputName.c_str(), O_RDONLY);
+#endif
+	if (fd < 0) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be open to read : %s", inputName.c_str());
+		return false;
+	}
+	MappedFile mapped;
+	bool ok = mapped.map(fd);
+	close(fd);
+	if (!ok) {
+		return false;
+	}
+
+	std::vector<Container> containers;
+	CodedInputStream input(mapped.Data(), mapped.StreamSize());
+	input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+	int tag;
+	while (ok && (tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndStructure::kMapIndexFieldNumber:
+			ok = readMapIndex(input, containers);
+			break;
+		case OsmAndStructure::kRoutingIndexFieldNumber:
+			ok = readRoutingIndex(input, containers);
+			break;
+		default:
+			ok = skipUnknownFields(input, tag);
+			break;
+		}
+	}
+	if (!ok) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be read : %s", inputName.c_str());
+		return false;
+	}
+
+	std::vector<uint8_t> out(mapped.Data(), mapped.Data() + mapped.Size());
+	size_t blocks = 0;
+	size_t moved = 0;
+	for (size_t c = 0; c < containers.size(); c++) {
+		blocks += containers[c].blocks.size();
+		moved += relayout(containers[c], mapped.Data(), out);
+	}
+
+	FILE * f = fopen(outputName.c_str(), "wb");
+	if (f == NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be open to write : %s", outputName.c_str());
+		return false;
+	}
+	ok = fwrite(&out[0], 1, out.size(), f) == out.size();
+	ok = fclose(f) == 0 && ok;
+	if (!ok) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be written : %s", outputName.c_str());
+		return false;
+	}
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "%s: %d of %d blocks moved in %d levels and routing indexes",
+			outputName.c_str(), (int) moved, (int) blocks, (int) containers.size());
+	return true;
+}
@@ -0,0 +1,24 @@
+/*
+ * ObfRelayout.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef OBFRELAYOUT_HPP_
+#define OBFRELAYOUT_HPP_
+
+#include <string>
+#include <stdint.h>
+
+// Rewrites an OBF so data blocks near on the map are near in the file.
+// Inside each map level and each routing index, blocks are sorted along a
+// Hilbert curve over the center of the leaf boxes that point to them, and
+// the leaf offsets are patched. Tree boxes keep their place: a child box is
+// nested in its parent message, so parents already precede their children.
+// The output has the same size and structure, every reader can use it.
+bool relayoutObf(std::string const & inputName, std::string const & outputName);
+
+// Position of (x, y) along a Hilbert curve of order 16 over 31 bit coordinates.
+uint32_t hilbertKey(uint32_t x31, uint32_t y31);
+
+#endif /* OBFRELAYOUT_HPP_ */
@@ -0,0 +1,393 @@
+/*
+ * PoiIndex.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef POIINDEX_HPP_
+#define POIINDEX_HPP_
+
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include "Common.h"
+#include "common2.h"
+#include "Map.hpp"
+#include "BinaryIndex.hpp"
+#include "NodeMutex.hpp"
+#include "NodeCache.hpp"
+#include "QuerySink.hpp"
+
+#include <boost/geometry/algorithms/intersects.hpp>
+#include <boost/geometry/algorithms/covered_by.hpp>
+#include <boost/function.hpp>
+
+struct PoiIndex;
+
+// Category codes of the file: category in the low bits, subtype above.
+static uint32_t const POI_CATEGORY_BITS = 7;
+static uint32_t const POI_CATEGORY_MASK = (1 << POI_CATEGORY_BITS) - 1;
+
+struct Amenity {
+	PoiIndex const * index;
+	uint64_t id;
+	uint32_t x;
+	uint32_t y;
+	// Codes, see PoiIndex::category
+	std::vector<uint32_t> categories;
+	std::string name;
+	std::string nameEn;
+	std::string openingHours;
+	std::string site;
+	std::string phone;
+	std::string note;
+
+	Amenity() : index(NULL), id(0), x(0), y(0) {}
+
+	size_t memorySize() const
+	{
+		return sizeof(Amenity) + categories.capacity() * sizeof(uint32_t)
+				+ name.capacity() + nameEn.capacity() + openingHours.capacity()
+				+ site.capacity() + phone.capacity() + note.capacity();
+	}
+};
+typedef Amenity const * Amenity_pointer;
+typedef std::vector<Amenity_pointer> Amenities_t;
+
+// Category name -> subtypes. A category without subtypes takes all of them.
+typedef std::map<std::string, std::set<std::string> > PoiCategoryFilter_t;
+
+struct PoiPublisher {
+	Amenities_t result;
+	// Tree contents owning amenities in result, and the files they come from.
+	std::vector< SHARED_PTR<void const> > pinned;
+
+	void pin(SHARED_PTR<void const> const & p) {
+		pinned.push_back(p);
+	}
+	bool publish(Amenities_t const & r) {
+		result.insert(result.end(), r.begin(), r.end());
+		return true;
+	}
+	// Asked before each tree node is read. Once true, queries stop reading.
+	virtual bool isCancelled() const {
+		return false;
+	}
+	virtual ~PoiPublisher() {
+	}
+};
+
+struct PoiQuery {
+	uint32_t left;
+	uint32_t right;
+	uint32_t top;
+	uint32_t bottom;
+	// Radius search when radius > 0. The box is then the one around the circle.
+	uint32_t x;
+	uint32_t y;
+	double radius; // meters
+	PoiCategoryFilter_t categories; // empty: any
+	PoiPublisher* publisher;
+
+	uint numberOfVisitedObjects;
+	uint numberOfReadSubtrees;
+
+	PoiQuery(uint32_t l, uint32_t r, uint32_t t, uint32_t b, PoiPublisher* publisher)
+	: left(l), right(r), top(t), bottom(b), x(0), y(0), radius(0), publisher(publisher),
+	  numberOfVisitedObjects(0), numberOfReadSubtrees(0)
+	{}
+
+	PoiQuery(uint32_t x31, uint32_t y31, double meters, PoiPublisher* publisher)
+	: x(x31), y(y31), radius(meters), publisher(publisher),
+	  numberOfVisitedObjects(0), numberOfReadSubtrees(0)
+	{
+		double lat = get31LatitudeY(y31);
+		double lon = get31LongitudeX(x31);
+		double dLat = meters / 111320.0;
+		double dLon = dLat / std::max(cos(toRadians(lat)), 0.01);
+		left = std::max(get31TileNumberX(std::max(lon - dLon, -180.0)), 0);
+		right = get31TileNumberX(std::min(lon + dLon, 180.0));
+		top = std::max(get31TileNumberY(std::min(lat + dLat, 85.0)), 0);
+		bottom = get31TileNumberY(std::max(lat - dLat, -85.0));
+	}
+
+	bool cancelled() const {
+		return publisher != NULL && publisher->isCancelled();
+	}
+
+	bool accept(uint32_t x31, uint32_t y31) const {
+		if (x31 < left || x31 > right || y31 < top || y31 > bottom)
+			return false;
+		return radius <= 0 || squareDist31TileMetric(x, y, x31, y31) <= radius * radius;
+	}
+};
+
+// What a query takes of one index. Resolved once per index from the names.
+struct PoiCategoryMask
+{
+	bool any;
+	// [category][subtype]
+	std::vector< std::vector<bool> > accepted;
+
+	PoiCategoryMask() : any(true) {}
+
+	bool accept(uint32_t code) const
+	{
+		if (any)
+			return true;
+		uint32_t c = code & POI_CATEGORY_MASK;
+		uint32_t s = code >> POI_CATEGORY_BITS;
+		return c < accepted.size() && s < accepted[c].size() && accepted[c][s];
+	}
+	bool acceptAny(std::vector<uint32_t> const & codes) const
+	{
+		if (any)
+			return true;
+		for (size_t i = 0; i < codes.size(); i++)
+			if (accept(codes[i]))
+				return true;
+		return false;
+	}
+};
+
+// A box of the POI tree: a tile at some zoom. Children and amenities
+// are read from file the first time the box is visited.
+struct PoiTreeBounds
+{
+	typedef std::vector<PoiTreeBounds> Bounds_t;
+	struct Content
+	{
+		Bounds_t bounds;
+		// Owned. Query results keep the content alive.
+		std::vector<Amenity> amenities;
+		size_t bytes;
+
+		Content() : bytes(0) {}
+		~Content()
+		{
+			nodeCacheReleased(bytes);
+		}
+		size_t memorySize() const
+		{
+			size_t sz = sizeof(Content) + bounds.capacity() * sizeof(PoiTreeBounds)
+					+ (amenities.capacity() - amenities.size()) * sizeof(Amenity);
+			for (size_t i = 0; i < bounds.size(); i++)
+				sz += bounds[i].categories.capacity() * sizeof(uint32_t);
+			for (size_t i = 0; i < amenities.size(); i++)
+				sz += amenities[i].memorySize();
+			return sz;
+		}
+	};
+	typedef SHARED_PTR<Content const> Content_pointer;
+	typedef boost::function<void(PoiTreeBounds const &, Content &)> Reader_t;
+
+	uint32_t zoom;
+	uint32_t x;
+	uint32_t y;
+	// Codes of everything below. Empty when the file does not say.
+	std::vector<uint32_t> categories;
+
+	PoiTreeBounds()
+	: zoom(0), x(0), y(0),
+	  box(point_t(INT_MAX, INT_MAX), point_t(-1, -1)),
+	  lastUsed(0)
+	{}
+
+	// Amenities of the query box taken by mask, given to the sink as boxes are read.
+	template <typename Sink>
+	bool stream(bbox_t const & b, PoiCategoryMask const & mask, Sink & sink) const
+	{
+		using boost::geometry::intersects;
+		using boost::geometry::covered_by;
+
+		if (!intersects(b, box))
+			return true;
+		if (!categories.empty() && !mask.acceptAny(categories))
+			return true;
+		if (sink.cancelled())
+			return false;
+		Content_pointer content = readContent();
+		if (!content)
+			return true;
+		sink.node(content);
+
+		for (Bounds_t::const_iterator node = content->bounds.begin(); node != content->bounds.end(); ++node)
+			if (!node->stream(b, mask, sink))
+				return false;
+		for (std::vector<Amenity>::const_iterator a = content->amenities.begin(); a != content->amenities.end(); ++a)
+			if (covered_by(point_t(a->x, a->y), b) && mask.acceptAny(a->categories) && !sink(&*a))
+				return false;
+		return true;
+	}
+
+	void ContentReader(Reader_t r)
+	{
+		contentReader = r;
+	}
+
+	// Be careful
+	void Box(bbox_t const & b)
+	{
+		box = b;
+	}
+	bbox_t const & Box() const
+	{
+		return box;
+	}
+
+	Content_pointer loadedContent() const
+	{
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		return content;
+	}
+	uint32_t LastUsed() const
+	{
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		return lastUsed;
+	}
+	bool dropContent() const
+	{
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		if (!content || !contentReader)
+			return false;
+		content.reset();
+		return true;
+	}
+
+private:
+	// As MapTreeBounds::readContent
+	Content_pointer readContent() const
+	{
+		{
+			std::lock_guard<std::mutex> lock(nodeMutex(this));
+			lastUsed = nodeCacheClock();
+			if (content || !contentReader)
+				return content;
+		}
+		// Decoded with no lock, nodes sharing the mutex do not wait for it
+		SHARED_PTR<Content> c(new Content);
+		contentReader(*this, *c);
+		size_t bytes = c->memorySize();
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		// The first one published is kept. Only it is counted, a dropped
+		// one releases no bytes.
+		if (!content)
+		{
+			c->bytes = bytes;
+			nodeCacheLoaded(bytes);
+			content = c;
+		}
+		return content;
+	}
+
+	bbox_t box;
+
+	mutable Content_pointer content;
+	mutable uint32_t lastUsed;
+
+	Reader_t contentReader;
+};
+
+struct PoiIndex : BinaryPartIndex {
+	// Root boxes are the content of root
+	PoiTreeBounds root;
+	std::vector<std::string> categoryNames;
+	std::vector< std::vector<std::string> > subtypeNames;
+
+	PoiIndex() : BinaryPartIndex(POI_INDEX) {}
+
+	// Empty subtype when the code has none.
+	std::pair<std::string, std::string> category(uint32_t code) const
+	{
+		uint32_t c = code & POI_CATEGORY_MASK;
+		uint32_t s = code >> POI_CATEGORY_BITS;
+		std::pair<std::string, std::string> r;
+		if (c < categoryNames.size()) {
+			r.first = categoryNames[c];
+			if (s < subtypeNames[c].size())
+				r.second = subtypeNames[c][s];
+		}
+		return r;
+	}
+
+	PoiCategoryMask mask(PoiCategoryFilter_t const & filter) const
+	{
+		PoiCategoryMask m;
+		m.any = filter.empty();
+		if (m.any)
+			return m;
+		m.accepted.resize(categoryNames.size());
+		for (size_t c = 0; c < categoryNames.size(); c++) {
+			PoiCategoryFilter_t::const_iterator f = filter.find(categoryNames[c]);
+			if (f == filter.end())
+				continue;
+			// The code without subtype too
+			size_t subtypes = std::max(subtypeNames[c].size(), (size_t) 1);
+			m.accepted[c].resize(subtypes, f->second.empty());
+			for (size_t s = 0; s < subtypeNames[c].size(); s++)
+				if (f->second.count(subtypeNames[c][s]))
+					m.accepted[c][s] = true;
+		}
+		return m;
+	}
+
+	// Results stream to the publisher, which keeps what they point to.
+	void query(PoiQuery & q) const
+	{
+		using boost::geometry::intersects;
+
+		if (q.cancelled())
+			return;
+		bbox_t b(point_t(q.left, q.top), point_t(q.right, q.bottom));
+		if (!intersects(b, root.Box()))
+			return;
+		PoiCategoryMask m = mask(q.categories);
+		if (!m.any && !hasAccepted(m))
+			return;
+		Amenities_t result;
+		Sink sink(q, result);
+		root.stream(b, m, sink);
+		q.publisher->publish(result);
+	}
+
+private:
+	// Pins contents and applies the radius.
+	struct Sink : CancellableSink<Amenity_pointer, PoiQuery>
+	{
+		Sink(PoiQuery & q, Amenities_t & result)
+		: CancellableSink<Amenity_pointer, PoiQuery>(result, q), visited(q.numberOfVisitedObjects),
+		  subtrees(q.numberOfReadSubtrees)
+		{}
+
+		void node(PoiTreeBounds::Content_pointer const & content)
+		{
+			subtrees++;
+			if (query.publisher != NULL && !content->amenities.empty())
+				query.publisher->pin(content);
+		}
+		bool operator()(Amenity_pointer const & a)
+		{
+			visited++;
+			if (query.accept(a->x, a->y))
+				result.push_back(a);
+			return true;
+		}
+
+		uint & visited;
+		uint & subtrees;
+	};
+
+	static bool hasAccepted(PoiCategoryMask const & m)
+	{
+		for (size_t c = 0; c < m.accepted.size(); c++)
+			if (std::find(m.accepted[c].begin(), m.accepted[c].end(), true) != m.accepted[c].end())
+				return true;
+		return false;
+	}
+};
+
+#endif /* POIINDEX_HPP_ */
@@ -0,0 +1,56 @@
+/*
+ * QuerySink.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef QUERYSINK_HPP_
+#define QUERYSINK_HPP_
+
+#include <vector>
+
+// Tree nodes stream(b, sink) their objects to a sink, depth first,
+// reading each node only when the walk gets to it. A sink has:
+//   bool cancelled() const        asked before a node is read
+//   void node(Content_pointer)    every content read, before its objects
+//   bool operator()(Pointer obj)  each object in the box; false ends the walk
+// stream returns false when the walk was ended early.
+
+// Takes everything into a vector.
+template <typename Pointer>
+struct CollectSink
+{
+	std::vector<Pointer> & result;
+
+	explicit CollectSink(std::vector<Pointer> & r) : result(r) {}
+
+	bool cancelled() const
+	{
+		return false;
+	}
+	template <typename Content_pointer>
+	void node(Content_pointer const &)
+	{
+	}
+	bool operator()(Pointer const & obj)
+	{
+		result.push_back(obj);
+		return true;
+	}
+};
+
+// Takes everything until the query (anything with cancelled()) is cancelled.
+template <typename Pointer, typename Query>
+struct CancellableSink : CollectSink<Pointer>
+{
+	Query const & query;
+
+	CancellableSink(std::vector<Pointer> & r, Query const & q) : CollectSink<Pointer>(r), query(q) {}
+
+	bool cancelled() const
+	{
+		return query.cancelled();
+	}
+};
+
+#endif /* QUERYSINK_HPP_ */
@@ -0,0 +1,109 @@
+/*
+ * RoadAttributesCache.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef ROADATTRIBUTESCACHE_HPP_
+#define ROADATTRIBUTESCACHE_HPP_
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <climits>
+#include "Common.h"
+#include "generalRouter.h"
+
+// Entry of roads not looked up yet, and types not translated yet
+static uint32_t const NO_ROAD_ATTRIBUTES = UINT_MAX;
+
+// Router attributes of the roads of a routing context. Rules are evaluated
+// once for each set of types: roads with the same types, from any file,
+// share their entry. Types are told apart by their universal id in the
+// router. Regions are kept by pointer, the context keeps their files open.
+class RoadAttributesCache
+{
+public:
+	explicit RoadAttributesCache(GeneralRouter & router)
+	: router(router), lastRegion(nullptr), lastRules(nullptr)
+	{}
+
+	// Of the road of a segment pool, remembered by its index there
+	RoadAttributes const & road(uint32_t index, SHARED_PTR<RouteDataObject> const & road) {
+		if (index >= byRoad.size())
+			byRoad.resize(std::max<size_t>(index + 1, byRoad.size() * 2), NO_ROAD_ATTRIBUTES);
+		if (byRoad[index] == NO_ROAD_ATTRIBUTES)
+			byRoad[index] = entry(road->region, road->types);
+		return entries[byRoad[index]];
+	}
+	// Of any road
+	RoadAttributes const & road(RouteDataObject const & road) {
+		return entries[entry(road.region, road.types)];
+	}
+	// defineRoutingObstacle
+	double routingObstacle(RouteDataObject const & road, uint point) {
+		if (road.pointTypes.size() <= point || road.pointTypes[point].size() == 0)
+			return 0;
+		signature(road.region, road.pointTypes[point]);
+		std::map<std::vector<uint32_t>, double>::const_iterator it = obstacles.find(key);
+		if (it == obstacles.end())
+			it = obstacles.insert(std::make_pair(key, router.defineRoutingObstacle(key))).first;
+		return it->second;
+	}
+
+	size_t entriesCount() const {
+		return entries.size();
+	}
+	size_t memorySize() const {
+		size_t s = byRoad.capacity() * sizeof(uint32_t) + entries.capacity() * sizeof(RoadAttributes)
+				+ (bySignature.size() + obstacles.size()) * (sizeof(std::vector<uint32_t>) + 4 * sizeof(void*) + sizeof(double));
+		for (UNORDERED(map)<RoutingIndex const *, std::vector<uint32_t> >::const_iterator it = regionRules.begin();
+				it != regionRules.end(); it++) {
+			s += sizeof(*it) + it->second.capacity() * sizeof(uint32_t);
+		}
+		return s;
+	}
+
+private:
+	uint32_t entry(RoutingIndex* reg, RouteTypes_t const & types) {
+		signature(reg, types);
+		std::map<std::vector<uint32_t>, uint32_t>::const_iterator it = bySignature.find(key);
+		if (it != bySignature.end())
+			return it->second;
+		entries.push_back(router.defineRoadAttributes(key));
+		bySignature.insert(std::make_pair(key, entries.size() - 1));
+		return entries.size() - 1;
+	}
+	// Sorted universal ids of the types, in key
+	void signature(RoutingIndex* reg, RouteTypes_t const & types) {
+		if (reg != lastRegion) {
+			lastRegion = reg;
+			lastRules = &regionRules[reg];
+		}
+		key.clear();
+		for (size_t k = 0; k < types.size(); k++) {
+			uint32_t t = types[k];
+			if (t >= lastRules->size())
+				lastRules->resize(t + 1, NO_ROAD_ATTRIBUTES);
+			uint32_t & rule = (*lastRules)[t];
+			if (rule == NO_ROAD_ATTRIBUTES)
+				rule = router.universalRule(reg, t);
+			key.push_back(rule);
+		}
+		std::sort(key.begin(), key.end());
+	}
+
+	GeneralRouter & router;
+	// Universal ids of the types of each region; nodes do not move
+	UNORDERED(map)<RoutingIndex const *, std::vector<uint32_t> > regionRules;
+	RoutingIndex const * lastRegion;
+	std::vector<uint32_t> * lastRules;
+	std::vector<uint32_t> key;
+
+	std::vector<RoadAttributes> entries;
+	std::map<std::vector<uint32_t>, uint32_t> bySignature;
+	std::vector<uint32_t> byRoad;
+	std::map<std::vector<uint32_t>, double> obstacles;
+};
+
+#endif /* ROADATTRIBUTESCACHE_HPP_ */
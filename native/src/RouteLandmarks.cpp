@@ -0,0 +1,200 @@
+/*
+ * RouteLandmarks.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "RouteLandmarks.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits>
+#include <queue>
+#include <functional>
+#include <algorithm>
+
+#include "Logging.h"
+
+float const RouteLandmarks::UNREACHED = std::numeric_limits<float>::infinity();
+
+namespace {
+
+char const MAGIC[8] = { 'O', 's', 'm', 'A', 'n', 'd', 'L', 'M' };
+uint32_t const VERSION = 2;
+
+typedef std::pair<uint32_t, float> Arc; // node, time
+
+// Edges of the graph by the node they leave, or arrive at if reverse
+void adjacency(ContractionHierarchy const & graph, bool reverse, std::vector<uint32_t> & begin, std::vector<Arc> & arcs)
+{
+	begin.assign(graph.nodesCount() + 1, 0);
+	for (size_t e = 0; e < graph.edges.size(); e++) {
+		begin[(reverse ? graph.edges[e].to : graph.edges[e].from) + 1]++;
+	}
+	for (uint32_t n = 0; n < graph.nodesCount(); n++) {
+		begin[n + 1] += begin[n];
+	}
+	arcs.resize(graph.edges.size());
+	std::vector<uint32_t> at(begin.begin(), begin.end() - 1);
+	for (size_t e = 0; e < graph.edges.size(); e++) {
+		ContractionHierarchy::Edge const & edge = graph.edges[e];
+		arcs[at[reverse ? edge.to : edge.from]++] = Arc(reverse ? edge.from : edge.to, edge.time);
+	}
+}
+
+void dijkstra(std::vector<uint32_t> const & begin, std::vector<Arc> const & arcs, uint32_t source,
+		std::vector<float> & times)
+{
+	typedef std::pair<float, uint32_t> Item;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item> > open;
+	times.assign(begin.size() - 1, RouteLandmarks::UNREACHED);
+	times[source] = 0;
+	open.push(Item(0, source));
+	while (!open.empty()) {
+		Item it = open.top();
+		open.pop();
+		if (it.first > times[it.second])
+			continue;
+		for (uint32_t i = begin[it.second]; i < begin[it.second + 1]; i++) {
+			float t = it.first + arcs[i].second;
+			if (t < times[arcs[i].first]) {
+				times[arcs[i].first] = t;
+				open.push(Item(t, arcs[i].first));
+			}
+		}
+	}
+}
+
+// Reached node with the greatest time
+uint32_t farthest(std::vector<float> const & times)
+{
+	uint32_t best = 0;
+	for (uint32_t n = 1; n < times.size(); n++) {
+		if (times[n] != RouteLandmarks::UNREACHED && (times[best] == RouteLandmarks::UNREACHED || times[n] > times[best]))
+			best = n;
+	}
+	return best;
+}
+
+// What a file could hold that lowerBound() would go wrong on
+char const * checkLandmarks(RouteLandmarks const & l)
+{
+	uint32_t nodes = l.nodeX.size();
+	for (uint32_t n = 1; n < nodes; n++) {
+		if (l.nodeX[n - 1] > l.nodeX[n] || (l.nodeX[n - 1] == l.nodeX[n] && l.nodeY[n - 1] >= l.nodeY[n]))
+			return "nodes are not sorted";
+	}
+	for (size_t i = 0; i < l.landmarks.size(); i++) {
+		if (l.landmarks[i] >= nodes)
+			return "a landmark is out of the graph";
+	}
+	for (size_t i = 0; i < l.from.size(); i++) {
+		// infinity is UNREACHED
+		if (!(l.from[i] >= 0) || !(l.to[i] >= 0))
+			return "a time is negative";
+	}
+	return NULL;
+}
+} // namespace
+
+bool RouteLandmarks::write(std::string const & fileName) const
+{
+	FILE * f = fopen(fileName.c_str(), "wb");
+	if (f == NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be open to write : %s", fileName.c_str());
+		return false;
+	}
+	uint32_t counts[2] = { (uint32_t) nodeX.size(), (uint32_t) landmarks.size() };
+	bool ok = fwrite(MAGIC, 1, sizeof(MAGIC), f) == sizeof(MAGIC) && fwrite(&VERSION, sizeof(VERSION), 1, f) == 1
+			&& identity.write(f) && fwrite(counts, sizeof(counts), 1, f) == 1
+			&& writeDataArray(f, nodeX) && writeDataArray(f, nodeY) && writeDataArray(f, landmarks)
+			&& writeDataArray(f, from) && writeDataArray(f, to);
+	ok = fclose(f) == 0 && ok;
+	if (!ok) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be written : %s", fileName.c_str());
+	}
+	return ok;
+}
+
+bool RouteLandmarks::read(std::string const & fileName)
+{
+	FILE * f = fopen(fileName.c_str(), "rb");
+	if (f == NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be open to read : %s", fileName.c_str());
+		return false;
+	}
+	char magic[sizeof(MAGIC)];
+	uint32_t version;
+	uint32_t counts[2];
+	uint64_t times = 0;
+	bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+			&& fread(&version, sizeof(version), 1, f) == 1 && version == VERSION
+			&& identity.read(f) && fread(counts, sizeof(counts), 1, f) == 1;
+	if (ok) {
+		times = (uint64_t) counts[0] * counts[1];
+		// the arrays must fill the rest of the file, before anything is allocated
+		ok = remainingDataBytes(f) == ((uint64_t) counts[0] * 2 + counts[1]) * sizeof(uint32_t) + times * 2 * sizeof(float)
+				&& readDataArray(f, nodeX, counts[0]) && readDataArray(f, nodeY, counts[0])
+				&& readDataArray(f, landmarks, counts[1]) && readDataArray(f, from, times) && readDataArray(f, to, times);
+	}
+	fclose(f);
+	if (!ok) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File is not a landmarks table : %s", fileName.c_str());
+		*this = RouteLandmarks();
+		return false;
+	}
+	char const * error = checkLandmarks(*this);
+	if (error != NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Landmarks table %s is broken: %s", fileName.c_str(), error);
+		*this = RouteLandmarks();
+		return false;
+	}
+	return true;
+}
+
+RouteLandmarks_pointer loadRouteLandmarks(std::string const & fileName,
+		MapFilesSnapshot const & mapFiles, GeneralRouter const & router)
+{
+	return loadRoutingData<RouteLandmarks>(fileName, mapFiles, router);
+}
+
+bool buildRouteLandmarks(MapFilesSnapshot const & mapFiles, GeneralRouter & router, uint32_t count,
+		RouteLandmarks & landmarks)
+{
+	ContractionHierarchy graph;
+	if (!buildRoadGraph(mapFiles, router, graph))
+		return false;
+	std::vector<uint32_t> forwardBegin, backwardBegin;
+	std::vector<Arc> forward, backward;
+	adjacency(graph, false, forwardBegin, forward);
+	adjacency(graph, true, backwardBegin, backward);
+
+	uint32_t n = graph.nodesCount();
+	count = std::min(count, n);
+	landmarks = RouteLandmarks();
+	landmarks.identity = graph.identity;
+	landmarks.nodeX.swap(graph.nodeX);
+	landmarks.nodeY.swap(graph.nodeY);
+	landmarks.from.resize((size_t) n * count);
+	landmarks.to.resize((size_t) n * count);
+	// Least time from the landmarks so far
+	std::vector<float> nearest(n, RouteLandmarks::UNREACHED);
+	std::vector<float> times;
+	dijkstra(forwardBegin, forward, 0, times);
+	uint32_t next = farthest(times);
+	for (uint32_t l = 0; l < count; l++) {
+		landmarks.landmarks.push_back(next);
+		dijkstra(forwardBegin, forward, next, times);
+		for (uint32_t v = 0; v < n; v++) {
+			landmarks.from[(size_t) v * count + l] = times[v];
+			nearest[v] = std::min(nearest[v], times[v]);
+		}
+		dijkstra(backwardBegin, backward, next, times);
+		for (uint32_t v = 0; v < n; v++) {
+			landmarks.to[(size_t) v * count + l] = times[v];
+		}
+		next = farthest(nearest);
+	}
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "%d landmarks of %d nodes", (int) count, (int) n);
+	return true;
+}
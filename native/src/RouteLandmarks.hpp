@@ -0,0 +1,118 @@
+/*
+ * RouteLandmarks.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef ROUTELANDMARKS_HPP_
+#define ROUTELANDMARKS_HPP_
+
+#include <vector>
+#include <string>
+#include "ContractionHierarchy.hpp"
+
+// Times between a few landmarks and every node of the road graph of a
+// profile (see buildRoadGraph). By the triangle inequality they bound the
+// time between any two nodes from below: the A* search takes that bound
+// when it is better than the straight line one (ALT).
+struct RouteLandmarks {
+	static float const UNREACHED;
+
+	// Nodes of the graph, sorted by x then y
+	std::vector<uint32_t> nodeX;
+	std::vector<uint32_t> nodeY;
+	std::vector<uint32_t> landmarks; // nodes
+	// Times from each landmark to node n, and from n to each landmark,
+	// in [n * landmarks.size(), (n + 1) * landmarks.size())
+	std::vector<float> from;
+	std::vector<float> to;
+	// Files and profile its graph was built for
+	RoutingDataIdentity identity;
+
+	// NONE if no node is there
+	uint32_t node(uint32_t x31, uint32_t y31) const {
+		return sortedNode(nodeX, nodeY, x31, y31);
+	}
+	// Least time from node u to node v
+	float lowerBound(uint32_t u, uint32_t v) const {
+		size_t count = landmarks.size();
+		if (count == 0)
+			return 0;
+		float const * fromU = &from[u * count];
+		float const * fromV = &from[v * count];
+		float const * toU = &to[u * count];
+		float const * toV = &to[v * count];
+		float bound = 0;
+		for (size_t l = 0; l < count; l++) {
+			if (fromU[l] != UNREACHED && fromV[l] != UNREACHED && fromV[l] - fromU[l] > bound)
+				bound = fromV[l] - fromU[l];
+			if (toU[l] != UNREACHED && toV[l] != UNREACHED && toU[l] - toV[l] > bound)
+				bound = toU[l] - toV[l];
+		}
+		return bound;
+	}
+
+	// In the byte order of the machine, with its identity
+	bool write(std::string const & fileName) const;
+	// False unless the counts fit the file, landmarks are nodes and times
+	// are not negative
+	bool read(std::string const & fileName);
+
+	size_t memorySize() const {
+		return sizeof(RouteLandmarks)
+				+ (nodeX.capacity() + nodeY.capacity() + landmarks.capacity()) * sizeof(uint32_t)
+				+ (from.capacity() + to.capacity()) * sizeof(float);
+	}
+};
+typedef SHARED_PTR<RouteLandmarks const> RouteLandmarks_pointer;
+
+// Landmarks of fileName if they were built from the routing files of
+// mapFiles and for the profile of router, NULL otherwise, see loadRoutingData.
+RouteLandmarks_pointer loadRouteLandmarks(std::string const & fileName,
+		MapFilesSnapshot const & mapFiles, GeneralRouter const & router);
+
+// Landmarks one after the other, each the node farthest from the ones
+// before, and a Dijkstra from and to each of them
+bool buildRouteLandmarks(MapFilesSnapshot const & mapFiles, GeneralRouter & router, uint32_t count,
+		RouteLandmarks & landmarks);
+
+// Bounds of one search, through the nodes its route can leave the start
+// by and reach the end by (see HierarchyAccess). Points that are not
+// nodes have none.
+class LandmarkHeuristic
+{
+public:
+	LandmarkHeuristic() : landmarks(nullptr) {}
+
+	void reset(RouteLandmarks const * l, std::vector<HierarchyAccess> const & starts,
+			std::vector<HierarchyAccess> const & ends) {
+		landmarks = l;
+		sources = starts;
+		targets = ends;
+	}
+	bool active() const {
+		return landmarks != nullptr;
+	}
+	// Least time from the point to the end, or from the start to the point
+	// for the reverse search; 0 if unknown
+	double bound(uint32_t x31, uint32_t y31, bool reverse) const {
+		uint32_t n = landmarks->node(x31, y31);
+		std::vector<HierarchyAccess> const & ends = reverse ? sources : targets;
+		if (n == ContractionHierarchy::NONE || ends.empty())
+			return 0;
+		float best = reverse ? landmarks->lowerBound(ends[0].node, n) : landmarks->lowerBound(n, ends[0].node);
+		best += ends[0].time;
+		for (size_t i = 1; i < ends.size(); i++) {
+			float b = reverse ? landmarks->lowerBound(ends[i].node, n) : landmarks->lowerBound(n, ends[i].node);
+			best = std::min(best, b + ends[i].time);
+		}
+		return best;
+	}
+
+private:
+	RouteLandmarks const * landmarks;
+	std::vector<HierarchyAccess> sources;
+	std::vector<HierarchyAccess> targets;
+};
+
+#endif /* ROUTELANDMARKS_HPP_ */
@@ -9,27 +9,32 @@
 #define ROUTESEGMENT_HPP_
 
 #include <Common.h>
+#include <vector>
+#include <deque>
+
+struct RouteDataObject;
+
+// Segments are referred to by their index in the RouteSegmentPool of the
+// routing context. 0 is no segment.
+typedef uint32_t RouteSegmentIndex;
+static RouteSegmentIndex const NO_SEGMENT = 0;
 
 struct RouteSegment {
+	uint32_t road; // in the pool
 	int segmentStart;
-	SHARED_PTR<RouteDataObject> road;
 
 	// needed to store intersection of routes
-	SHARED_PTR<RouteSegment> next;
+	RouteSegmentIndex next;
 
 	// search context (needed for searching route)
-	// Initially it should be null (!) because it checks was it segment visited before
-	SHARED_PTR<RouteSegment> parentRoute;
+	// Initially it should be NO_SEGMENT (!) because it checks was it segment visited before
+	RouteSegmentIndex parentRoute;
 	int parentSegmentEnd;
 
 	// distance measured in time (seconds)
 	float distanceFromStart;
 	float distanceToEnd;
 
-	inline SHARED_PTR<RouteDataObject> const & getRoad() const {
-		return road;
-	}
-
 	inline int getSegmentStart() const {
 		return segmentStart;
 	}
@@ -49,13 +54,108 @@ struct RouteSegment {
 		return distanceToEnd;
 	}
 
-	RouteSegment(SHARED_PTR<RouteDataObject> const & road, int segmentStart)
-	: segmentStart(segmentStart), road(road),
-	  next(), parentRoute(), parentSegmentEnd(0),
+	inline void resetSearch() {
+		parentRoute = NO_SEGMENT;
+		parentSegmentEnd = 0;
+		distanceFromStart = 0;
+		distanceToEnd = 0;
+	}
+
+	RouteSegment()
+	: road(0), segmentStart(0),
+	  next(NO_SEGMENT), parentRoute(NO_SEGMENT), parentSegmentEnd(0),
+	  distanceFromStart(0), distanceToEnd(0){
+	}
+	RouteSegment(uint32_t road, int segmentStart)
+	: road(road), segmentStart(segmentStart),
+	  next(NO_SEGMENT), parentRoute(NO_SEGMENT), parentSegmentEnd(0),
 	  distanceFromStart(0), distanceToEnd(0){
 	}
-	~RouteSegment(){
+};
+
+// Segments and roads of a routing context. Segments of the map (the
+// connections) live as long as the context, those a search makes (copies
+// at restrictions, requeued ones) only until the next search. Both are in
+// blocks that never move, so references stay valid while adding.
+class RouteSegmentPool {
+	struct Blocks {
+		static uint32_t const BLOCK_BITS = 12;
+		static uint32_t const BLOCK_SIZE = 1 << BLOCK_BITS;
+		std::vector<RouteSegment *> blocks;
+		uint32_t size;
+
+		Blocks() : size(0) {}
+		~Blocks() {
+			for (size_t i = 0; i < blocks.size(); i++)
+				delete [] blocks[i];
+		}
+		inline RouteSegment & operator[](uint32_t i) const {
+			return blocks[i >> BLOCK_BITS][i & (BLOCK_SIZE - 1)];
+		}
+		inline uint32_t push(RouteSegment const & s) {
+			if ((size >> BLOCK_BITS) == blocks.size())
+				blocks.push_back(new RouteSegment[BLOCK_SIZE]);
+			(*this)[size] = s;
+			return size++;
+		}
+	private:
+		Blocks(Blocks const &);
+		Blocks & operator=(Blocks const &);
+	};
+
+public:
+	// Set in the indices of search segments
+	static uint32_t const SEARCH_BIT = 1u << 31;
+
+	RouteSegmentPool() {
+		// NO_SEGMENT
+		map.push(RouteSegment());
+		roads.push_back(SHARED_PTR<RouteDataObject>());
 	}
+
+	uint32_t addRoad(SHARED_PTR<RouteDataObject> const & road) {
+		roads.push_back(road);
+		return roads.size() - 1;
+	}
+	inline SHARED_PTR<RouteDataObject> const & road(RouteSegment const & s) const {
+		return roads[s.road];
+	}
+	inline SHARED_PTR<RouteDataObject> const & road(RouteSegmentIndex i) const {
+		return roads[(*this)[i].road];
+	}
+
+	// Kept while the context lives
+	inline RouteSegmentIndex add(RouteSegment const & s) {
+		return map.push(s);
+	}
+	// Dropped by resetSearch
+	inline RouteSegmentIndex addSearch(RouteSegment const & s) {
+		return search.push(s) | SEARCH_BIT;
+	}
+	inline RouteSegment & operator[](RouteSegmentIndex i) const {
+		return (i & SEARCH_BIT) ? search[i & ~SEARCH_BIT] : map[i];
+	}
+
+	// Before a search: all map segments as never reached, no search ones.
+	void resetSearch() {
+		for (uint32_t i = 1; i < map.size; i++)
+			map[i].resetSearch();
+		search.size = 0;
+	}
+
+	size_t size() const {
+		return map.size - 1 + search.size;
+	}
+	size_t memorySize() const {
+		return (map.blocks.size() + search.blocks.size()) * Blocks::BLOCK_SIZE * sizeof(RouteSegment)
+				+ roads.size() * sizeof(SHARED_PTR<RouteDataObject>);
+	}
+
+private:
+	Blocks map;
+	Blocks search;
+	// Deque, for references not to move either
+	std::deque<SHARED_PTR<RouteDataObject> > roads;
 };
 
 struct RouteSegmentResult {
@@ -70,9 +170,9 @@ struct RouteSegmentResult {
 };
 
 struct FinalRouteSegment {
-	SHARED_PTR<RouteSegment> direct;
+	RouteSegmentIndex direct;
 	bool reverseWaySearch;
-	SHARED_PTR<RouteSegment> opposite;
+	RouteSegmentIndex opposite;
 	float distanceFromStart;
 };
 
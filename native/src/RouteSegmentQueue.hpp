@@ -0,0 +1,223 @@
+/*
+ * RouteSegmentQueue.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef ROUTESEGMENTQUEUE_HPP_
+#define ROUTESEGMENTQUEUE_HPP_
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <climits>
+#include "RouteSegment.hpp"
+
+// Open sets of the A* searches over the segments of a pool. The segment
+// with least f() comes first, the one with least g() among equal ones.
+// A queue that can lower the key of a queued segment says so in
+// contains(); the search then updates that segment instead of queueing
+// a copy of it.
+
+// Segments are never moved once queued, improved ones are queued again
+// as copies and the old entries are popped later for nothing.
+class SegmentsPriorityQueue
+{
+	struct Comparator
+	{
+		RouteSegmentPool const * pool;
+
+		Comparator(RouteSegmentPool const & pool) : pool(&pool) {}
+		inline bool operator()(RouteSegmentIndex i1, RouteSegmentIndex i2) const
+		{
+			RouteSegment const & n1 = (*pool)[i1];
+			RouteSegment const & n2 = (*pool)[i2];
+			// We want the shortest cost to be choosen fron priority_queue, so we need to use > operator.
+			float f1 = n1.distanceFromStart + n1.distanceToEnd;
+			float f2 = n2.distanceFromStart + n2.distanceToEnd;
+			if (f1 == f2) {
+				return n1.distanceFromStart > n2.distanceFromStart;
+			}
+			return f1 > f2;
+		}
+	};
+
+public:
+	explicit SegmentsPriorityQueue(RouteSegmentPool const & pool)
+	: queue(Comparator(pool)), pushes(0), peak(0)
+	{}
+
+	bool contains(RouteSegmentIndex) const {
+		return false;
+	}
+	void update(RouteSegmentIndex) {
+	}
+	void push(RouteSegmentIndex i) {
+		queue.push(i);
+		pushes++;
+		peak = std::max(peak, queue.size());
+	}
+	RouteSegmentIndex top() const {
+		return queue.top();
+	}
+	void pop() {
+		queue.pop();
+	}
+	size_t size() const {
+		return queue.size();
+	}
+	bool empty() const {
+		return queue.empty();
+	}
+
+	// Counters
+	size_t pushed() const {
+		return pushes;
+	}
+	size_t maxSize() const {
+		return peak;
+	}
+	size_t memorySize() const {
+		return queue.size() * sizeof(RouteSegmentIndex);
+	}
+
+private:
+	std::priority_queue<RouteSegmentIndex, std::vector<RouteSegmentIndex>, Comparator> queue;
+	size_t pushes;
+	size_t peak;
+};
+
+// Heap position of segments out of it
+static uint32_t const NOT_QUEUED = UINT_MAX;
+
+// 4-ary heap that knows where each segment is, so a segment reached
+// again at a lower cost is moved up instead of queued twice. Keys are
+// copied into the heap: sifting does not touch the pool.
+class SegmentsHeap
+{
+	static uint32_t const ARITY = 4;
+
+	struct Entry {
+		float f;
+		float g;
+		RouteSegmentIndex segment;
+
+		inline bool before(Entry const & e) const {
+			return f < e.f || (f == e.f && g < e.g);
+		}
+	};
+
+public:
+	explicit SegmentsHeap(RouteSegmentPool const & pool)
+	: pool(pool), pushes(0), peak(0)
+	{}
+
+	bool contains(RouteSegmentIndex i) const {
+		std::vector<uint32_t> const & p = positions[i >> 31];
+		uint32_t slot = i & ~RouteSegmentPool::SEARCH_BIT;
+		return slot < p.size() && p[slot] != NOT_QUEUED;
+	}
+	// The segment of i is cheaper than when it was queued
+	void update(RouteSegmentIndex i) {
+		uint32_t at = position(i);
+		heap[at] = entry(i);
+		up(at);
+	}
+	void push(RouteSegmentIndex i) {
+		std::vector<uint32_t> & p = positions[i >> 31];
+		uint32_t slot = i & ~RouteSegmentPool::SEARCH_BIT;
+		if (slot >= p.size())
+			p.resize(std::max<size_t>(slot + 1, p.size() * 2), NOT_QUEUED);
+		heap.push_back(entry(i));
+		p[slot] = heap.size() - 1;
+		up(heap.size() - 1);
+		pushes++;
+		peak = std::max(peak, heap.size());
+	}
+	RouteSegmentIndex top() const {
+		return heap[0].segment;
+	}
+	void pop() {
+		position(heap[0].segment) = NOT_QUEUED;
+		Entry last = heap.back();
+		heap.pop_back();
+		if (!heap.empty()) {
+			heap[0] = last;
+			position(last.segment) = 0;
+			down(0);
+		}
+	}
+	size_t size() const {
+		return heap.size();
+	}
+	bool empty() const {
+		return heap.empty();
+	}
+
+	// Counters
+	size_t pushed() const {
+		return pushes;
+	}
+	size_t maxSize() const {
+		return peak;
+	}
+	size_t memorySize() const {
+		return heap.capacity() * sizeof(Entry)
+				+ (positions[0].capacity() + positions[1].capacity()) * sizeof(uint32_t);
+	}
+
+private:
+	inline Entry entry(RouteSegmentIndex i) const {
+		RouteSegment const & s = pool[i];
+		Entry e = { s.distanceFromStart + s.distanceToEnd, s.distanceFromStart, i };
+		return e;
+	}
+	// Map segments in positions[0], search ones in positions[1]
+	inline uint32_t & position(RouteSegmentIndex i) {
+		return positions[i >> 31][i & ~RouteSegmentPool::SEARCH_BIT];
+	}
+	void up(uint32_t at) {
+		Entry e = heap[at];
+		while (at > 0) {
+			uint32_t parent = (at - 1) / ARITY;
+			if (!e.before(heap[parent]))
+				break;
+			heap[at] = heap[parent];
+			position(heap[at].segment) = at;
+			at = parent;
+		}
+		heap[at] = e;
+		position(e.segment) = at;
+	}
+	void down(uint32_t at) {
+		Entry e = heap[at];
+		uint32_t n = heap.size();
+		for (;;) {
+			uint32_t first = at * ARITY + 1;
+			if (first >= n)
+				break;
+			uint32_t best = first;
+			uint32_t end = std::min(first + ARITY, n);
+			for (uint32_t c = first + 1; c < end; c++) {
+				if (heap[c].before(heap[best]))
+					best = c;
+			}
+			if (!heap[best].before(e))
+				break;
+			heap[at] = heap[best];
+			position(heap[at].segment) = at;
+			at = best;
+		}
+		heap[at] = e;
+		position(e.segment) = at;
+	}
+
+	RouteSegmentPool const & pool;
+	std::vector<Entry> heap;
+	std::vector<uint32_t> positions[2];
+	size_t pushes;
+	size_t peak;
+};
+
+#endif /* ROUTESEGMENTQUEUE_HPP_ */
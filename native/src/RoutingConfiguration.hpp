@@ -10,29 +10,59 @@
 
 #include "generalRouter.h"
 
+// Open set of the road search, see RouteSegmentQueue.hpp
+enum class RoutingOpenSet {
+	PRIORITY_QUEUE,
+	INDEXED_HEAP
+};
+
+struct ContractionHierarchy;
+struct RouteLandmarks;
+
 struct RoutingConfiguration
 {
 	typedef UNORDERED(map)<std::string, std::string> MAP_STR_STR;
 
 	GeneralRouter router;
 
+	// Node cache limit of the process if the first search sets it, see NodeCache.hpp
 	int memoryLimitation;
 	float initialDirection;
 
 	int zoomToLoad;
 	float heurCoefficient;
 	int planRoadDirection;
+	RoutingOpenSet openSet;
+	// Routes go over it instead of the road search when set. It must be
+	// built for router, see ContractionHierarchy.hpp.
+	SHARED_PTR<ContractionHierarchy const> hierarchy;
+	// Where the search loads hierarchy from when it is not set, if it was
+	// built for the open files and router
+	std::string hierarchyFile;
+	// Bounds the road search takes besides straight lines when set. They
+	// must be of the graph of router, see RouteLandmarks.hpp.
+	SHARED_PTR<RouteLandmarks const> landmarks;
+	// Where the search loads landmarks from, as hierarchyFile
+	std::string landmarksFile;
 
 	void initParams(MAP_STR_STR& attributes) {
 		planRoadDirection = (int) parseFloat(attributes, "planRoadDirection", 0);
 		heurCoefficient = parseFloat(attributes, "heuristicCoefficient", 1);
-		// don't use file limitations?
 		memoryLimitation = (int)parseFloat(attributes, "nativeMemoryLimitInMB", memoryLimitation);
 		zoomToLoad = (int)parseFloat(attributes, "zoomToLoadTiles", 16);
+		initNativeParams(attributes);
+	}
+
+	// Attributes only the native search has, the java side passes them alone
+	void initNativeParams(MAP_STR_STR& attributes) {
+		openSet = parseString(attributes, "nativeOpenSet", "") == "queue" ?
+				RoutingOpenSet::PRIORITY_QUEUE : RoutingOpenSet::INDEXED_HEAP;
+		hierarchyFile = parseString(attributes, "nativeHierarchy", "");
+		landmarksFile = parseString(attributes, "nativeLandmarks", "");
 	}
 
 	RoutingConfiguration(float initDirection = -360, int memLimit = 64) :
-			memoryLimitation(memLimit), initialDirection(initDirection) {
+			memoryLimitation(memLimit), initialDirection(initDirection), openSet(RoutingOpenSet::INDEXED_HEAP) {
 	}
 };
 
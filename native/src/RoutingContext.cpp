@@ -11,14 +11,14 @@
 #include "common2.h"
 #include <boost/range/adaptor/filtered.hpp>
 
-void RoutingQuery(bbox_t & b, RouteDataObjects_t & output);
+void RoutingQuery(MapFilesSnapshot const & mapFiles, bbox_t & b, RouteDataObjects_t & output);
 //extern const bool TRACE_ROUTING;
 
-SHARED_PTR<RouteSegment> RoutingContext::findRouteSegment(uint32_t x31, uint32_t y31)
+RouteSegmentIndex RoutingContext::findRouteSegment(uint32_t x31, uint32_t y31)
 {
 	bbox_t b = boost::geometry::make<bbox_t>(x31-100, y31-100, x31+100, y31+100);
 	RouteDataObjects_t dataObjects;
-	RoutingQuery(b, dataObjects);
+	RoutingQuery(*mapFiles, b, dataObjects);
 
 	auto filter = [this](RouteDataObject_pointer const & rdo)
 			{
@@ -29,7 +29,7 @@ SHARED_PTR<RouteSegment> RoutingContext::findRouteSegment(uint32_t x31, uint32_t
 	{
 		// A second try.
 		b = boost::geometry::make<bbox_t>(x31-20000, y31-20000, x31+20000, y31+20000);
-		RoutingQuery(b, dataObjects);
+		RoutingQuery(*mapFiles, b, dataObjects);
 	}
 
 	// If we have some dataObjects we must add registered versions of roads
@@ -83,24 +83,24 @@ SHARED_PTR<RouteSegment> RoutingContext::findRouteSegment(uint32_t x31, uint32_t
 		proj->pointsX.insert(proj->pointsX.begin() + index, candidateX);
 		proj->pointsY.insert(proj->pointsY.begin() + index, candidateY);
 		if (proj->pointTypes.size() > index) {
-			proj->pointTypes.insert(proj->pointTypes.begin() + index, std::vector<uint32_t>());
+			proj->pointTypes.insert(proj->pointTypes.begin() + index, RouteTypes_t());
 		}
 		// re-register the best road because one more point was inserted
 		registerRouteDataObject(proj);
 		// We get RoutingContext map view data. So it will be updated if necessary.
 		return loadRouteSegment(candidateX, candidateY);
 	}
-	return nullptr;
+	return NO_SEGMENT;
 }
 
-SHARED_PTR<RouteSegment> RoutingContext::loadRouteSegment(uint32_t x31, uint32_t y31)
+RouteSegmentIndex RoutingContext::loadRouteSegment(uint32_t x31, uint32_t y31)
 {
 	int64_t key = makeKey(x31, y31);
 	if (connections.count(key) == 0)
 		loadMap(x31, y31);
-	SHARED_PTR<RouteSegment> segment = connections[key];
+	RouteSegmentIndex segment = connections[key];
 
-	if (segment == nullptr)
+	if (segment == NO_SEGMENT)
 		std::cerr << "loadSegment(" << x31 << ',' << y31 << ")=NULL" << std::endl;
 	return segment;
 	// return connections[key];
@@ -108,16 +108,18 @@ SHARED_PTR<RouteSegment> RoutingContext::loadRouteSegment(uint32_t x31, uint32_t
 
 void RoutingContext::add(SHARED_PTR<RouteDataObject> const & o, bbox_t const & b)
 {
+	uint32_t road = 0;
 	for (int i = o->pointsX.size()-1; i >= 0; --i)
 	{
 		uint32_t x31 = o->pointsX[i];
 		uint32_t y31 = o->pointsY[i];
 		if (!boost::geometry::covered_by(point_t(x31, y31), b)) continue;
-		int64_t l = makeKey(x31, y31);
-		SHARED_PTR<RouteSegment> segment = SHARED_PTR<RouteSegment>(new RouteSegment(o, i));
-		if (connections.count(l) != 0)
-			segment->next = connections[l];
-		connections[l] = segment;
+		if (road == 0)
+			road = segments.addRoad(o);
+		RouteSegment segment(road, i);
+		RouteSegmentIndex & first = connections[makeKey(x31, y31)];
+		segment.next = first;
+		first = segments.add(segment);
 	}
 }
 
@@ -138,7 +140,7 @@ void RoutingContext::loadMap(int x31, int y31)
 				(x31+1) << GRANULARITY, (y31+1) << GRANULARITY);
 		RouteDataObjects_t objects;
 		timeToLoad.Start();
-		RoutingQuery(b, objects);
+		RoutingQuery(*mapFiles, b, objects);
 		timeToLoad.Pause();
 		for (int i = objects.size()-1; i >= 0; --i)
 		{
@@ -157,27 +159,29 @@ void RoutingContext::registerRouteDataObject(SHARED_PTR<RouteDataObject> const &
 	// UPDATE connections data.
 	// Always after loadMap calls
 	SHARED_PTR<RouteDataObject> const & ro = registered.back();
+	uint32_t road = segments.addRoad(ro);
 	for (int i = ro->pointsX.size()-1; i >= 0; --i)
 	{
 		uint32_t x31 = ro->pointsX[i];
 		uint32_t y31 = ro->pointsY[i];
 		loadMap(x31, y31);
 		int64_t l = makeKey(x31, y31);
-		SHARED_PTR<RouteSegment> segment = connections[l];
+		RouteSegmentIndex segment = connections[l];
 		// If no info at this point, directly add RouteSegment
-		if (segment == nullptr)
+		if (segment == NO_SEGMENT)
 		{
-			connections[l] = SHARED_PTR<RouteSegment>(new RouteSegment(ro, i));
+			connections[l] = segments.add(RouteSegment(road, i));
 			continue;
 		}
-		while (segment != nullptr)
+		while (segment != NO_SEGMENT)
 		{
-			if (segment->road->id == ro->id)
+			RouteSegment & s = segments[segment];
+			if (segments.road(s)->id == ro->id)
 			{
-				segment->road = ro;
-				segment->segmentStart = i;
+				s.road = road;
+				s.segmentStart = i;
 			}
-			segment = segment->next;
+			segment = s.next;
 		}
 	}
 }
@@ -15,21 +15,31 @@
 #include "RoutingConfiguration.hpp"
 #include "RouteSegment.hpp"
 #include "RouteCalculationProgress.hpp"
+#include "RoadAttributesCache.hpp"
+#include "RouteLandmarks.hpp"
+
+struct MapFilesSnapshot;
+SHARED_PTR<MapFilesSnapshot const> currentMapFiles();
 size_t RoutingMemorySize();
 
 struct RoutingContext
 {
 public:
 	RoutingContext(RoutingConfiguration& config)
-		: visitedSegments(0),//// loadedTiles(0),
-		  config(config), finalRouteSegment()
+		: config(config), finalRouteSegment(), attributes(config.router),
+		  visitedSegments(0), queuedSegments(0), maxQueueSize(0),//// loadedTiles(0),
+		  mapFiles(currentMapFiles())
 	{
 		precalcRoute.empty = true;
 	}
 
 	// Public interface
-	SHARED_PTR<RouteSegment> findRouteSegment(uint32_t x31, uint32_t y31);
-	SHARED_PTR<RouteSegment> loadRouteSegment(uint32_t x31, uint32_t y31);
+	RouteSegmentIndex findRouteSegment(uint32_t x31, uint32_t y31);
+	RouteSegmentIndex loadRouteSegment(uint32_t x31, uint32_t y31);
+	// Files the route is calculated over
+	MapFilesSnapshot const & routingFiles() const {
+		return *mapFiles;
+	}
 
 public:
 	bool isInterrupted() const {
@@ -44,21 +54,32 @@ public:
 	//bool basemap;
 	PrecalculatedRouteDirection precalcRoute;
 	SHARED_PTR<FinalRouteSegment> finalRouteSegment;
+	// Connections and search state
+	RouteSegmentPool segments;
+	// Router attributes of the roads in segments
+	RoadAttributesCache attributes;
+	// Of the search, when the configuration has landmarks
+	LandmarkHeuristic landmarkBounds;
 
 	// Counters
 	int visitedSegments;
+	size_t queuedSegments; // pushed into the open sets
+	size_t maxQueueSize;   // largest sizes of both open sets, added
 	OsmAnd::ElapsedTimer timeToLoad;
 	OsmAnd::ElapsedTimer timeToCalculate;
 	SHARED_PTR<RouteCalculationProgress> progress;
 
 private:
+	// Roads keep pointers into their files. A route is calculated over the
+	// files open when it started, even if they are replaced meanwhile.
+	SHARED_PTR<MapFilesSnapshot const> mapFiles;
 	// Map representation for routing
 	// To manage modified roads.
 	std::vector<SHARED_PTR<RouteDataObject> > registered;
 	// To memo map chuncks loaded
 	UNORDERED(set)<int64_t> loaded;
-	// To memo connections between roads.
-	UNORDERED(map)<int64_t, SHARED_PTR<RouteSegment> > connections;
+	// To memo connections between roads: first segment at each point.
+	UNORDERED(map)<int64_t, RouteSegmentIndex> connections;
 
 private:
 	// Map related
@@ -68,9 +89,9 @@ private:
 	}
 	void loadMap(int x31, int y31);
 	void add(SHARED_PTR<RouteDataObject> const & o, bbox_t const & b);
-	bool acceptLine(SHARED_PTR<RouteDataObject> const & r) const
+	bool acceptLine(SHARED_PTR<RouteDataObject> const & r)
 	{
-		return config.router.acceptLine(r);
+		return attributes.road(*r).accepted;
 	}
 	// Register modified route data objects with a live time equal to that of context.
 	void registerRouteDataObject(SHARED_PTR<RouteDataObject> const & o);
@@ -82,7 +103,9 @@ public:
 		return sizeof(RoutingContext)
 				+ registered.capacity() * (sizeof(RouteDataObject) + sizeof(RouteDataObject_pointer))
 				+ loaded.size() * sizeof(int64_t)
-				+ connections.size() * (sizeof(std::pair<int64_t, std::shared_ptr<RouteSegment> >) + sizeof(RouteSegment))
+				+ connections.size() * sizeof(std::pair<int64_t, RouteSegmentIndex>)
+				+ segments.memorySize()
+				+ attributes.memorySize()
 				+ RoutingMemorySize();
 	}
 
@@ -0,0 +1,134 @@
+/*
+ * RoutingDataFile.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "RoutingDataFile.hpp"
+
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "binaryRead.h"
+#include "generalRouter.h"
+#include "Logging.h"
+
+namespace {
+
+uint32_t const MAX_NAME = 4096;
+
+bool byName(RoutingDataIdentity::File const & a, RoutingDataIdentity::File const & b)
+{
+	return a.name < b.name;
+}
+
+} // namespace
+
+RoutingDataIdentity::RoutingDataIdentity(MapFilesSnapshot const & mapFiles, GeneralRouter const & router)
+: profile(router.profileHash())
+{
+	MapFilesSnapshot::Files_t::const_iterator it = mapFiles.files.begin();
+	for (; it != mapFiles.files.end(); it++) {
+		BinaryMapFile const * file = it->second.get();
+		if (file->routingIndexes.empty() || file->isBasemap())
+			continue;
+		std::string::size_type slash = file->inputName.find_last_of("/\\");
+		File f = { slash == std::string::npos ? file->inputName : file->inputName.substr(slash + 1),
+				file->fileSize, file->dateModified / 1000 };
+		files.push_back(f);
+	}
+	std::sort(files.begin(), files.end(), byName);
+}
+
+bool RoutingDataIdentity::write(FILE * f) const
+{
+	uint32_t count = files.size();
+	bool ok = fwrite(&count, sizeof(count), 1, f) == 1;
+	for (size_t i = 0; ok && i < files.size(); i++) {
+		uint32_t length = files[i].name.size();
+		uint64_t numbers[2] = { files[i].size, files[i].dateModified };
+		ok = fwrite(&length, sizeof(length), 1, f) == 1 && fwrite(files[i].name.data(), 1, length, f) == length
+				&& fwrite(numbers, sizeof(numbers), 1, f) == 1;
+	}
+	return ok && fwrite(&profile, sizeof(profile), 1, f) == 1;
+}
+
+bool RoutingDataIdentity::read(FILE * f)
+{
+	uint32_t count;
+	if (fread(&count, sizeof(count), 1, f) != 1)
+		return false;
+	// a name length and two numbers at least each
+	uint64_t const fileBytes = sizeof(uint32_t) + 2 * sizeof(uint64_t);
+	if (count > remainingDataBytes(f) / fileBytes)
+		return false;
+	files.resize(count);
+	for (size_t i = 0; i < files.size(); i++) {
+		uint32_t length;
+		uint64_t numbers[2];
+		if (fread(&length, sizeof(length), 1, f) != 1 || length > MAX_NAME)
+			return false;
+		files[i].name.resize(length);
+		if ((length > 0 && fread(&files[i].name[0], 1, length, f) != length)
+				|| fread(numbers, sizeof(numbers), 1, f) != 1)
+			return false;
+		files[i].size = numbers[0];
+		files[i].dateModified = numbers[1];
+	}
+	return fread(&profile, sizeof(profile), 1, f) == 1;
+}
+
+bool RoutingDataIdentity::matches(RoutingDataIdentity const & current, std::string const & fileName) const
+{
+	bool ok = true;
+	if (profile != current.profile) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "%s was made for another routing profile", fileName.c_str());
+		ok = false;
+	}
+	// Both are sorted by name
+	size_t i = 0;
+	size_t j = 0;
+	while (i < files.size() || j < current.files.size()) {
+		if (j == current.files.size() || (i < files.size() && files[i].name < current.files[j].name)) {
+			OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "%s was made with %s, which is not open",
+					fileName.c_str(), files[i++].name.c_str());
+			ok = false;
+		} else if (i == files.size() || current.files[j].name < files[i].name) {
+			OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "%s was made without %s, which is open",
+					fileName.c_str(), current.files[j++].name.c_str());
+			ok = false;
+		} else {
+			if (files[i].size != current.files[j].size || files[i].dateModified != current.files[j].dateModified) {
+				OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "%s was made with another version of %s",
+						fileName.c_str(), files[i].name.c_str());
+				ok = false;
+			}
+			i++;
+			j++;
+		}
+	}
+	return ok;
+}
+
+uint64_t remainingDataBytes(FILE * f)
+{
+	long position = ftell(f);
+	if (position < 0 || fseek(f, 0, SEEK_END) != 0)
+		return 0;
+	long end = ftell(f);
+	if (end < position || fseek(f, position, SEEK_SET) != 0)
+		return 0;
+	return end - position;
+}
+
+bool RoutingDataStamp::of(std::string const & fileName)
+{
+	struct stat st;
+	if (stat(fileName.c_str(), &st) != 0) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "Routing data file %s is not there", fileName.c_str());
+		return false;
+	}
+	size = st.st_size;
+	dateModified = st.st_mtime;
+	return true;
+}
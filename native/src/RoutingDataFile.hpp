@@ -0,0 +1,104 @@
+/*
+ * RoutingDataFile.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef ROUTINGDATAFILE_HPP_
+#define ROUTINGDATAFILE_HPP_
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <mutex>
+#include "Common.h"
+
+struct MapFilesSnapshot;
+class GeneralRouter;
+
+// What routing data precomputed for a profile (ContractionHierarchy,
+// RouteLandmarks) was made of: the files the road search reads, and the
+// profile. Data only goes with the same ones, other roads or rules would
+// give wrong routes.
+struct RoutingDataIdentity {
+	struct File {
+		std::string name; // without its directory
+		uint64_t size;
+		uint64_t dateModified; // s, some file systems keep no more
+	};
+	std::vector<File> files; // by name
+	uint64_t profile; // GeneralRouter::profileHash()
+
+	RoutingDataIdentity() : profile(0) {}
+	// Of the non basemap files with routing indexes
+	RoutingDataIdentity(MapFilesSnapshot const & mapFiles, GeneralRouter const & router);
+
+	bool write(FILE * f) const;
+	// False when the data would not fit in the rest of the file
+	bool read(FILE * f);
+	// Logs what differs, for the data of fileName
+	bool matches(RoutingDataIdentity const & current, std::string const & fileName) const;
+};
+
+// Data files are arrays in the byte order of the machine
+template <typename T>
+bool writeDataArray(FILE * f, std::vector<T> const & v)
+{
+	return v.empty() || fwrite(&v[0], sizeof(T), v.size(), f) == v.size();
+}
+
+template <typename T>
+bool readDataArray(FILE * f, std::vector<T> & v, uint64_t size)
+{
+	v.resize(size);
+	return v.empty() || fread(&v[0], sizeof(T), v.size(), f) == v.size();
+}
+
+// Bytes from the position to the end, to check counts before allocating
+uint64_t remainingDataBytes(FILE * f);
+
+// Size and modification time of a data file, to know when it changed
+struct RoutingDataStamp {
+	uint64_t size;
+	uint64_t dateModified; // s
+	RoutingDataStamp() : size(0), dateModified(0) {}
+	// False, and logged, if the file is not there
+	bool of(std::string const & fileName);
+	bool operator==(RoutingDataStamp const & o) const {
+		return size == o.size && dateModified == o.dateModified;
+	}
+};
+
+// Data T (ContractionHierarchy, RouteLandmarks) of fileName if it was built
+// from the routing files of mapFiles and for the profile of router, NULL
+// otherwise. The last file read is kept for the next searches while its
+// name, size and modification time stay the same; a file that could not be
+// read is tried again by the next search.
+template <typename T>
+SHARED_PTR<T const> loadRoutingData(std::string const & fileName,
+		MapFilesSnapshot const & mapFiles, GeneralRouter const & router)
+{
+	static std::mutex loadedLock;
+	static std::string loadedName;
+	static RoutingDataStamp loadedStamp;
+	static SHARED_PTR<T const> loaded;
+
+	RoutingDataIdentity current(mapFiles, router);
+	std::lock_guard<std::mutex> lock(loadedLock);
+	RoutingDataStamp stamp;
+	if (!stamp.of(fileName))
+		return SHARED_PTR<T const>();
+	if (!loaded || loadedName != fileName || !(loadedStamp == stamp)) {
+		SHARED_PTR<T> data(new T);
+		if (!data->read(fileName))
+			return SHARED_PTR<T const>();
+		loaded = data;
+		loadedName = fileName;
+		loadedStamp = stamp;
+	}
+	if (!loaded->identity.matches(current, fileName))
+		return SHARED_PTR<T const>();
+	return loaded;
+}
+
+#endif /* ROUTINGDATAFILE_HPP_ */
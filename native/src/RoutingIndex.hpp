@@ -23,6 +23,12 @@
 
 #include "Map.hpp"
 #include "BinaryIndex.hpp"
+#include "NodeMutex.hpp"
+#include "NodeCache.hpp"
+#include "ArenaSpan.hpp"
+#include "QuerySink.hpp"
+#include "DeltaOverlay.hpp"
+#include "TagDictionary.hpp"
 
 #include <boost/geometry/algorithms/intersects.hpp>
 #include <boost/geometry/algorithms/equals.hpp>////
@@ -34,24 +40,40 @@
 #include <Logging.h>
 
 struct RoutingIndex;
+typedef ArenaSpan<uint32_t> RouteTypes_t;
+
+// Objects read from a file are views over the RouteDataArena of their node.
+// Copies own their data (see ArenaSpan).
 struct RouteDataObject {
 	RoutingIndex* region;
-	std::vector<uint32_t> types ;
-	std::vector<uint32_t> pointsX ;
-	std::vector<uint32_t> pointsY ;
-	std::vector<uint64_t> restrictions ;
-	std::vector<std::vector<uint32_t> > pointTypes;
+	RouteTypes_t types ;
+	ArenaSpan<uint32_t> pointsX ;
+	ArenaSpan<uint32_t> pointsY ;
+	ArenaSpan<uint64_t> restrictions ;
+	ArenaSpan<RouteTypes_t> pointTypes;
 	int64_t id;
 
-	UNORDERED(map)<int, std::string > names;
-	std::vector<std::pair<uint32_t, uint32_t> > namesIds;
+	// (tag rule, string table index) pairs, one per tag.
+	// Names are looked up in the string table of the data block when asked.
+	ArenaSpan<std::pair<uint32_t, uint32_t> > namesIds;
+	StringTable_pointer stringTable;
 
-	RouteDataObject() : box(point_t(INT_MAX, INT_MAX), point_t(-1, -1))
+	RouteDataObject() : region(NULL), id(0), box(point_t(INT_MAX, INT_MAX), point_t(-1, -1))
 	{}
 
+	size_t namesCount() const {
+		return namesIds.size();
+	}
+	uint32_t nameTag(size_t i) const {
+		return namesIds[i].first;
+	}
+	std::string const & name(size_t i) const {
+		return (*stringTable)[namesIds[i].second];
+	}
+
 	std::string getName() {
-		if(names.size() > 0) {
-			return names.begin()->second;
+		if(namesCount() > 0) {
+			return name(0);
 		}
 		return "";
 	}
@@ -60,19 +82,19 @@ struct RouteDataObject {
 		return id;
 	}
 
+	// Arena memory is accounted by the arena.
 	size_t memorySize() const
 	{
-		size_t s = sizeof(this);
-		s += pointsX.capacity()*sizeof(uint32_t);
-		s += pointsY.capacity()*sizeof(uint32_t);
-		s += types.capacity()*sizeof(uint32_t);
-		s += restrictions.capacity()*sizeof(uint64_t);
-		std::vector<std::vector<uint32_t> >::const_iterator t = pointTypes.begin();
-		for(;t!=pointTypes.end(); t++) {
-			s+= (*t).capacity() * sizeof(uint32_t);
+		size_t s = sizeof(RouteDataObject);
+		s += pointsX.ownedMemorySize();
+		s += pointsY.ownedMemorySize();
+		s += types.ownedMemorySize();
+		s += restrictions.ownedMemorySize();
+		s += pointTypes.ownedMemorySize();
+		for (size_t t = 0; t < pointTypes.size(); t++) {
+			s += pointTypes[t].ownedMemorySize();
 		}
-		s += namesIds.capacity()*sizeof(std::pair<uint32_t, uint32_t>);
-		s += names.size()*sizeof(std::pair<int, std::string>)*10;
+		s += namesIds.ownedMemorySize();
 		return s;
 	}
 
@@ -185,46 +207,113 @@ private:
 typedef std::shared_ptr<RouteDataObject> RouteDataObject_pointer;
 typedef std::vector<RouteDataObject_pointer> RouteDataObjects_t;
 
+// Everything the objects of one leaf node have, in a few flat arrays
+// instead of several small vectors per object.
+// Object pointers handed out share ownership of the whole arena.
+struct RouteDataArena
+{
+	std::vector<RouteDataObject> objects;
+	std::vector<uint32_t> pointsX;
+	std::vector<uint32_t> pointsY;
+	// Road types and point types
+	std::vector<uint32_t> types;
+	std::vector<RouteTypes_t> pointTypes;
+	std::vector<uint64_t> restrictions;
+	std::vector<std::pair<uint32_t, uint32_t> > namesIds;
+	StringTable_pointer stringTable;
+
+	size_t memorySize() const
+	{
+		size_t sz = sizeof(RouteDataArena);
+		sz += objects.capacity() * sizeof(RouteDataObject);
+		sz += (pointsX.capacity() + pointsY.capacity() + types.capacity()) * sizeof(uint32_t);
+		sz += pointTypes.capacity() * sizeof(RouteTypes_t);
+		sz += restrictions.capacity() * sizeof(uint64_t);
+		sz += namesIds.capacity() * sizeof(std::pair<uint32_t, uint32_t>);
+		if (stringTable) {
+			for (size_t i = 0; i < stringTable->size(); i++)
+				sz += sizeof(std::string) + (*stringTable)[i].capacity();
+		}
+		return sz;
+	}
+};
+typedef SHARED_PTR<RouteDataArena const> RouteDataArena_pointer;
+
 struct RouteSubregion
 {
 	typedef std::vector<RouteSubregion> SubRegions_t;
-	typedef boost::function<void(RouteSubregion &)> Reader_t;
+	// Could be an intermediate or leaf node depending on what data has.
+	struct Content
+	{
+		SubRegions_t subregions;
+		RouteDataArena_pointer arena;
+		// Indexed by id inside the block. They point into the arena.
+		RouteDataObjects_t dataObjects;
+		size_t bytes;
+
+		Content() : bytes(0) {}
+		~Content()
+		{
+			nodeCacheReleased(bytes);
+		}
+		size_t memorySize() const
+		{
+			size_t sz = sizeof(Content) + subregions.capacity() * sizeof(RouteSubregion)
+					+ dataObjects.capacity() * sizeof(RouteDataObject_pointer);
+			if (arena)
+				sz += arena->memorySize();
+			return sz;
+		}
+	};
+	typedef SHARED_PTR<Content const> Content_pointer;
+	typedef boost::function<void(RouteSubregion const &, Content &)> Reader_t;
 
+	uint32_t length;
 	uint32_t filePointer;
+	uint32_t shiftToData; // 0 for intermediate nodes
 	uint32_t left;
 	uint32_t right;
 	uint32_t top;
 	uint32_t bottom;
 	RoutingIndex* routingIndex;
 
-	RouteSubregion(RoutingIndex* ind) : routingIndex(ind){
+	RouteSubregion(RoutingIndex* ind) : length(0), filePointer(0), shiftToData(0), routingIndex(ind),
+			lastUsed(0){
 	}
 
-	// TODO extract as algorithm and do a lazy implementation.
-	// Incrementally add results
-	void query(bbox_t const & b, RouteDataObjects_t & result) const
+	// Objects in b, given to the sink as nodes are read (see QuerySink.hpp).
+	template <typename Sink>
+	bool stream(bbox_t const & b, Sink & sink) const
 	{
 		using boost::geometry::intersects;
-		using boost::range::for_each;
-		using boost::range::copy;
 
 		// I can't say anything
 		if (!intersects(b, box))
-			return;
-
+			return true;
+		// Nothing is read for an abandoned query.
+		if (sink.cancelled())
+			return false;
 //std::cerr << " RSR query box? " << b << " in " << box << std::endl;
-		// Before using data
-		((RouteSubregion *)this)->readContent();  // TODO cast????
+		// Before using data. Content is kept alive while we use it.
+		Content_pointer content = readContent();
+		if (!content)
+			return true;
+		sink.node(content);
+
+		for (SubRegions_t::const_iterator node = content->subregions.begin(); node != content->subregions.end(); ++node)
+			if (!node->stream(b, sink))
+				return false;
+		// Objects share the arena so they stay valid without the content.
+		for (RouteDataObjects_t::const_iterator obj = content->dataObjects.begin(); obj != content->dataObjects.end(); ++obj)
+			if ((*obj != nullptr) && intersects(b, (*obj)->Box()) && !sink(*obj))
+				return false;
+		return true;
+	}
 
-		// THINK: Maybe using boost::function to do only 1 call (one of them do nothing)
-		for_each(subregions,
-				[&b, &result](RouteSubregion const & node){node.query(b, result);});
-		for_each(dataObjects,
-				[&b, &result](RouteDataObject_pointer const & obj)
-					{
-			if ((obj != nullptr) && intersects(b, obj->Box()))
-				result.push_back(obj);
-					});
+	void query(bbox_t const & b, RouteDataObjects_t & result) const
+	{
+		CollectSink<RouteDataObject_pointer> sink(result);
+		stream(b, sink);
 	}
 
 	// TODO Remove as soon as possible
@@ -239,26 +328,30 @@ struct RouteSubregion
 			return;
 
 		// Before using data
-		((RouteSubregion *)this)->readContent();  // TODO cast????
+		Content_pointer content = readContent();
+		if (!content)
+			return;
 
 //std::cerr << " RSR querySub OK" << std::endl;
-		for_each(subregions,
+		for_each(content->subregions,
 				 [&b, &result](RouteSubregion const & node){node.querySub(b, result);});
 		if (boost::geometry::equals(b, box))
 		{
 //std::cerr << " RSR querySub #RDO " << dataObjects.size() << std::endl;
-			copy(dataObjects, std::back_inserter(result));
+			copy(content->dataObjects, std::back_inserter(result));
 		}
 	}
 
 	size_t memorySize() const
 	{
 		size_t sz = 0;
+		Content_pointer content = loadedContent();
+		if (!content)
+			return sz;
 		using boost::range::for_each;
-		for_each(subregions,
+		for_each(content->subregions,
 				[&sz](RouteSubregion const & node){sz += node.memorySize();});
-		for_each(dataObjects,
-				[&sz](RouteDataObject_pointer const & rdo){if (rdo != nullptr) sz += rdo->memorySize();});
+		sz += content->memorySize();
 		return sz;
 	}
 
@@ -267,10 +360,6 @@ struct RouteSubregion
 		contentReader = r;
 	}
 
-	void DataObjects(RouteDataObjects_t && objs)
-	{
-		dataObjects = objs;
-	}
 	// Be careful
 	void Box(bbox_t const & b)
 	{
@@ -280,27 +369,60 @@ struct RouteSubregion
 	{
 		return box;
 	}
-private:
 
-	// Read if not yet
-	void readContent()
+	// What is already in memory, without reading anything.
+	Content_pointer loadedContent() const
+	{
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		return content;
+	}
+	uint32_t LastUsed() const
+	{
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		return lastUsed;
+	}
+	// Back to not read state. Current users keep their copy.
+	bool dropContent() const
 	{
-		if (!hasContent())
-			if (contentReader)
-				contentReader(*this);
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		if (!content || !contentReader)
+			return false;
+		content.reset();
+		return true;
 	}
+private:
 
-	// Both data structures empty
-	bool hasContent() const
+	// Read if not yet.
+	// Several threads can arrive here at the same time and decode it, but
+	// all of them get the result the first one published.
+	Content_pointer readContent() const
 	{
-		return !subregions.empty() || !dataObjects.empty();
+		{
+			std::lock_guard<std::mutex> lock(nodeMutex(this));
+			lastUsed = nodeCacheClock();
+			if (content || !contentReader)
+				return content;
+		}
+		// Decoded with no lock, nodes sharing the mutex do not wait for it
+		SHARED_PTR<Content> c(new Content);
+		contentReader(*this, *c);
+		size_t bytes = c->memorySize();
+		std::lock_guard<std::mutex> lock(nodeMutex(this));
+		// The first one published is kept. Only it is counted, a dropped
+		// one releases no bytes.
+		if (!content)
+		{
+			c->bytes = bytes;
+			nodeCacheLoaded(bytes);
+			content = c;
+		}
+		return content;
 	}
 
 	bbox_t box;
 
-	// Could be an intermediate or leaf node depending on what data has.
-public: 	SubRegions_t subregions; private:
-	RouteDataObjects_t dataObjects;
+	mutable Content_pointer content;
+	mutable uint32_t lastUsed;
 
 	Reader_t contentReader;
 };
@@ -308,6 +430,10 @@ public: 	SubRegions_t subregions; private:
 struct RoutingIndex : BinaryPartIndex
 {
 	std::vector<tag_value> decodingRules;
+	// Interned ids (TagDictionary) of each rule, and of its tag with no value
+	// for rules of names
+	std::vector<uint32_t> decodingIds;
+	std::vector<uint32_t> nameIds;
 	typedef std::vector<RouteSubregion> regions_t;
 	regions_t subregions;
 	regions_t basesubregions;
@@ -317,7 +443,9 @@ struct RoutingIndex : BinaryPartIndex
 	{}
 
 	// TODO What really is basemap????
-	void query(bbox_t const & b, bool base, RouteDataObjects_t & result) const
+	// overlay: what deltas hide in this file (see DeltaOverlay.hpp), may be NULL
+	void query(bbox_t const & b, bool base, RouteDataObjects_t & result,
+			FileOverlay const * overlay = NULL) const
 	{
 //std::cerr << "RI.query " << (base?"basemap ":"map ") << "box? " << b << " in " << box << std::endl;
 		using boost::geometry::intersects;
@@ -328,13 +456,16 @@ struct RoutingIndex : BinaryPartIndex
 		if (!intersects(b, box))
 			return;
 
+		size_t from = result.size();
 		auto & rs = base?basesubregions:subregions;
 		for_each(rs,
 				 [&b, &result](RouteSubregion const & node){node.query(b, result);});
+		applyRouteOverlay(overlay, result, from);
 	}
 
 	// Remove as soon as possible
-	void querySub(bbox_t const & b, bool base, RouteDataObjects_t & result) const
+	void querySub(bbox_t const & b, bool base, RouteDataObjects_t & result,
+			FileOverlay const * overlay = NULL) const
 	{
 		using boost::range::for_each;
 
@@ -342,9 +473,11 @@ struct RoutingIndex : BinaryPartIndex
 		if (!boost::geometry::covered_by(b, box))
 			return;
 
+		size_t from = result.size();
 		auto & rs = base?basesubregions:subregions;
 		for_each(rs,
 				 [&b, &result](RouteSubregion const & node){node.querySub(b, result);});
+		applyRouteOverlay(overlay, result, from);
 	}
 
 	size_t memorySize() const
@@ -358,10 +491,16 @@ struct RoutingIndex : BinaryPartIndex
 
 	void initRouteEncodingRule(uint32_t id, std::string const & tag, std::string const & val) {
 		tag_value pair = tag_value(tag, val);
+		uint32_t pairId = internTagValue(pair);
+		uint32_t nameId = internTagValue(tag, "");
 		while(decodingRules.size() < id + 1){
 			decodingRules.push_back(pair);
+			decodingIds.push_back(pairId);
+			nameIds.push_back(nameId);
 		}
 		decodingRules[id] = pair;
+		decodingIds[id] = pairId;
+		nameIds[id] = nameId;
 	}
 
 	bbox_t const & Box() const
@@ -374,8 +513,28 @@ struct RoutingIndex : BinaryPartIndex
 		box = b;
 	}
 
+	// Indexes opened from the cache read their encoding rules
+	// just before the first object is decoded.
+	void RulesReader(boost::function<void()> r)
+	{
+		rulesReader = r;
+	}
+	void loadRules() const
+	{
+		std::lock_guard<std::mutex> lock(rulesMutex);
+		if (rulesReader)
+		{
+			boost::function<void()> r;
+			r.swap(rulesReader);
+			r();
+		}
+	}
+
 private:
 	bbox_t box;
+
+	mutable std::mutex rulesMutex;
+	mutable boost::function<void()> rulesReader;
 };
 
 #endif // _ROUTING_INDEX_HPP
@@ -8,24 +8,35 @@
 #ifndef SEARCHQUERY_HPP_
 #define SEARCHQUERY_HPP_
 
+#include "Common.h"
 #include "renderRules.h"
+#include "TagDictionary.hpp"
+#include "MapObjectArena.hpp"
 
 struct ResultPublisher {
 	std::vector< MapDataObject*> result;
+	// Tree contents owning objects in result. They live as long as the result.
+	std::vector< SHARED_PTR<void const> > pinned;
+	// Objects made by the search itself. Freed at once with the result.
+	MapObjectArena arena;
+
+	void pin(SHARED_PTR<void const> const & content) {
+		pinned.push_back(content);
+	}
 
 	bool publish(MapDataObject* r) {
 		result.push_back(r);
 		return true;
 	}
 	bool publish(std::vector<MapDataObject*> const & r) {
-		result.insert(result.begin(), r.begin(), r.end());
+		result.insert(result.end(), r.begin(), r.end());
 		return true;
 	}
-	bool isCancelled() const {
+	// Asked before each tree node is read. Once true, queries stop reading.
+	virtual bool isCancelled() const {
 		return false;
 	}
 	virtual ~ResultPublisher() {
-		//deleteObjects(result);
 	}
 };
 
@@ -46,39 +57,64 @@ struct SearchQuery {
 	uint numberOfReadSubtrees;
 	uint numberOfAcceptedSubtrees;
 
+	// Rendering rules answer by tag value for a zoom, so ask once per pair.
+	// Indexed by TagDictionary id.
+	enum { TYPE_UNKNOWN = 0, TYPE_ACCEPTED, TYPE_REJECTED };
+	std::vector<char> acceptedTypes;
+	int acceptedTypesZoom;
+
 	SearchQuery(int l, int r, int t, int b, RenderingRuleSearchRequest* req, ResultPublisher* publisher) :
-			req(req), left(l), right(r), top(t), bottom(b),publisher(publisher) {
+			req(req), left(l), right(r), top(t), bottom(b),publisher(publisher), acceptedTypesZoom(-1) {
 		numberOfAcceptedObjects = numberOfVisitedObjects = 0;
 		numberOfAcceptedSubtrees = numberOfReadSubtrees = 0;
 		ocean = mixed = false;
 	}
 	SearchQuery(int l, int r, int t, int b) :
-				left(l), right(r), top(t), bottom(b) {
+				req(NULL), left(l), right(r), top(t), bottom(b), publisher(NULL), acceptedTypesZoom(-1) {
 	}
 
-	SearchQuery(){
+	SearchQuery() : req(NULL), publisher(NULL), acceptedTypesZoom(-1) {
+
+	}
 
+	bool cancelled() const {
+		return publisher != NULL && publisher->isCancelled();
 	}
 
 	bool publish(MapDataObject* obj) {
 		return publisher->publish(obj);
 	}
 
-	bool acceptTypes(std::vector<tag_value> const & types)
+	bool acceptTypes(TagValueIds const & types)
 	{
-		for (std::vector<tag_value>::const_iterator type = types.begin(); type != types.end(); type++)
+		if (acceptedTypesZoom != zoom) {
+			acceptedTypes.clear();
+			acceptedTypesZoom = zoom;
+		}
+		for (size_t i = 0; i < types.size(); i++)
 		{
-			req->setIntFilter(req->props()->R_MINZOOM, zoom);
-			req->setStringFilter(req->props()->R_TAG, type->first);
-			req->setStringFilter(req->props()->R_VALUE, type->second);
-			for (int i = 1; i <= 3; i++)
-				if (req->search(i, false))
-					return true;
-			req->setStringFilter(req->props()->R_NAME_TAG, "");
-			if (req->search(RenderingRulesStorage::TEXT_RULES, false))
+			uint32_t id = types.id(i);
+			if (id >= acceptedTypes.size())
+				acceptedTypes.resize(id + 1, TYPE_UNKNOWN);
+			if (acceptedTypes[id] == TYPE_UNKNOWN)
+				acceptedTypes[id] = acceptType(types[i]) ? TYPE_ACCEPTED : TYPE_REJECTED;
+			if (acceptedTypes[id] == TYPE_ACCEPTED)
 				return true;
 		}
+		return false;
+	}
 
+	bool acceptType(tag_value const & type)
+	{
+		req->setIntFilter(req->props()->R_MINZOOM, zoom);
+		req->setStringFilter(req->props()->R_TAG, type.first);
+		req->setStringFilter(req->props()->R_VALUE, type.second);
+		for (int i = 1; i <= 3; i++)
+			if (req->search(i, false))
+				return true;
+		req->setStringFilter(req->props()->R_NAME_TAG, "");
+		if (req->search(RenderingRulesStorage::TEXT_RULES, false))
+			return true;
 		return false;
 	}
 };
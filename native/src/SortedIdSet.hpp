@@ -0,0 +1,72 @@
+/*
+ * SortedIdSet.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef SORTEDIDSET_HPP_
+#define SORTEDIDSET_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+
+// Object ids already taken by one query, to skip the copies of an object
+// found in other map files or other tree nodes.
+// Kept as a sorted vector: 8 bytes an id and no allocation per id.
+// Ids are added a batch (the objects of one file) at a time.
+class SortedIdSet
+{
+public:
+	bool contains(long long id) const
+	{
+		return std::binary_search(ids.begin(), ids.end(), id);
+	}
+
+	// fresh[i] is set when batch[i] was not in the set and is the first
+	// of its id in batch. Fresh ids are added. Ids <= 0 are always fresh
+	// and never added: they are not real object ids.
+	void insert(std::vector<long long> const & batch, std::vector<bool> & fresh)
+	{
+		fresh.assign(batch.size(), true);
+		order.clear();
+		for (size_t i = 0; i < batch.size(); i++) {
+			if (batch[i] > 0) {
+				order.push_back(std::make_pair(batch[i], i));
+			}
+		}
+		// Ties keep batch order, so the first copy wins
+		std::sort(order.begin(), order.end());
+		size_t before = ids.size();
+		for (size_t k = 0; k < order.size(); k++) {
+			if ((k > 0 && order[k].first == order[k - 1].first)
+					|| std::binary_search(ids.begin(), ids.begin() + before, order[k].first)) {
+				fresh[order[k].second] = false;
+			} else {
+				ids.push_back(order[k].first);
+			}
+		}
+		std::inplace_merge(ids.begin(), ids.begin() + before, ids.end());
+	}
+
+	// Also to add a whole set: insert(other.sorted(), fresh)
+	std::vector<long long> const & sorted() const
+	{
+		return ids;
+	}
+	size_t size() const
+	{
+		return ids.size();
+	}
+	void clear()
+	{
+		ids.clear();
+	}
+
+private:
+	std::vector<long long> ids;
+	std::vector<std::pair<long long, size_t> > order;
+};
+
+#endif /* SORTEDIDSET_HPP_ */
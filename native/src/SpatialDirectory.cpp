@@ -0,0 +1,95 @@
+/*
+ * SpatialDirectory.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "SpatialDirectory.hpp"
+#include "binaryRead.h"
+
+#include <algorithm>
+#include <iterator>
+
+void SpatialDirectory::rebuild(std::map<std::string, SHARED_PTR<BinaryMapFile> > const & files)
+{
+	entries.clear();
+	owners.clear();
+	basemapFiles = 0;
+	std::vector<Value_t> values;
+	std::map<std::string, SHARED_PTR<BinaryMapFile> >::const_iterator i = files.begin();
+	for (; i != files.end(); i++) {
+		BinaryMapFile * file = i->second.get();
+		if (file->isBasemap())
+			basemapFiles++;
+		for (size_t m = 0; m < file->mapIndexes.size(); m++) {
+			MapIndex const * index = file->mapIndexes[m];
+			for (size_t l = 0; l < index->levels.size(); l++) {
+				Entry e = { file, index, &index->levels[l], NULL, NULL, false };
+				values.push_back(Value_t(index->levels[l].Box(), entries.size()));
+				entries.push_back(e);
+				owners.push_back(file);
+			}
+		}
+		for (size_t r = 0; r < file->routingIndexes.size(); r++) {
+			RoutingIndex const * index = file->routingIndexes[r];
+			for (int base = 0; base < 2; base++) {
+				RoutingIndex::regions_t const & regions = base ? index->basesubregions : index->subregions;
+				for (size_t s = 0; s < regions.size(); s++) {
+					Entry e = { file, NULL, NULL, index, &regions[s], base == 1 };
+					values.push_back(Value_t(regions[s].Box(), entries.size()));
+					entries.push_back(e);
+					owners.push_back(file);
+				}
+			}
+		}
+	}
+	// Packing constructor does a bulk load.
+	Tree_t packed(values.begin(), values.end());
+	tree.swap(packed);
+}
+
+void SpatialDirectory::query(bbox_t const & b, std::vector<size_t> & hits) const
+{
+	std::vector<Value_t> found;
+	tree.query(boost::geometry::index::intersects(b), std::back_inserter(found));
+	hits.reserve(found.size());
+	for (size_t i = 0; i < found.size(); i++)
+		hits.push_back(found[i].second);
+	// Entries were numbered in registry order.
+	std::sort(hits.begin(), hits.end());
+}
+
+void SpatialDirectory::queryMap(bbox_t const & b, std::vector<Entry const *> & result) const
+{
+	std::vector<size_t> hits;
+	query(b, hits);
+	for (size_t i = 0; i < hits.size(); i++) {
+		Entry const & e = entries[hits[i]];
+		if (e.level != NULL)
+			result.push_back(&e);
+	}
+}
+
+void SpatialDirectory::queryRouting(bbox_t const & b, bool basemap, std::vector<Entry const *> & result) const
+{
+	std::vector<size_t> hits;
+	query(b, hits);
+	for (size_t i = 0; i < hits.size(); i++) {
+		Entry const & e = entries[hits[i]];
+		if (e.subregion != NULL && e.basemap == basemap)
+			result.push_back(&e);
+	}
+}
+
+void SpatialDirectory::queryMapFiles(bbox_t const & b, std::vector<BinaryMapFile *> & result) const
+{
+	std::vector<size_t> hits;
+	query(b, hits);
+	for (size_t i = 0; i < hits.size(); i++) {
+		if (entries[hits[i]].level == NULL)
+			continue;
+		BinaryMapFile * file = owners[hits[i]];
+		if (result.empty() || result.back() != file)
+			result.push_back(file);
+	}
+}
@@ -0,0 +1,70 @@
+/*
+ * SpatialDirectory.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef SPATIALDIRECTORY_HPP_
+#define SPATIALDIRECTORY_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <boost/geometry/index/rtree.hpp>
+
+#include "Common.h"
+#include "Map.hpp"
+
+struct BinaryMapFile;
+struct MapIndex;
+struct MapRoot;
+struct RoutingIndex;
+struct RouteSubregion;
+
+// R-tree over the roots of every open file: map levels and routing subregions.
+// Queries use it to visit only what intersects instead of every open file.
+// It is rebuilt (bulk loaded) each time the set of open files changes.
+class SpatialDirectory
+{
+public:
+	SpatialDirectory() : basemapFiles(0) {}
+
+	struct Entry
+	{
+		BinaryMapFile const * file;
+		// Either the map pair or the routing pair is set.
+		MapIndex const * mapIndex;
+		MapRoot const * level;
+		RoutingIndex const * routingIndex;
+		RouteSubregion const * subregion;
+		bool basemap; // Routing basemap subregion
+	};
+
+	void rebuild(std::map<std::string, SHARED_PTR<BinaryMapFile> > const & files);
+
+	// Results keep registry order (as iterating the files does).
+	void queryMap(bbox_t const & b, std::vector<Entry const *> & result) const;
+	void queryRouting(bbox_t const & b, bool basemap, std::vector<Entry const *> & result) const;
+	// Distinct files with a map level intersecting b, in registry order.
+	void queryMapFiles(bbox_t const & b, std::vector<BinaryMapFile *> & result) const;
+
+	bool hasBasemap() const
+	{
+		return basemapFiles > 0;
+	}
+
+private:
+	typedef std::pair<bbox_t, size_t> Value_t;
+	typedef boost::geometry::index::rtree<Value_t, boost::geometry::index::quadratic<16> > Tree_t;
+
+	void query(bbox_t const & b, std::vector<size_t> & hits) const;
+
+	std::vector<Entry> entries;
+	std::vector<BinaryMapFile *> owners; // by entry
+	Tree_t tree;
+	int basemapFiles;
+};
+
+#endif /* SPATIALDIRECTORY_HPP_ */
@@ -0,0 +1,106 @@
+/*
+ * TagDictionary.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "TagDictionary.hpp"
+
+#include <map>
+#include <mutex>
+#include <atomic>
+
+#include "Logging.h"
+
+namespace
+{
+	struct Entry
+	{
+		tag_value tv;
+		uint32_t tag;
+	};
+
+	// Entries live in fixed chunks that never move, so readers need no lock.
+	uint32_t const CHUNK_BITS = 12;
+	uint32_t const CHUNK_SIZE = 1 << CHUNK_BITS;
+	uint32_t const MAX_CHUNKS = 4096;
+
+	Entry * chunks[MAX_CHUNKS];
+	std::atomic<uint32_t> entriesCount(0);
+
+	std::mutex internMutex;
+	std::map<tag_value, uint32_t> pairIds;
+	std::map<std::string, uint32_t> tagIds;
+
+	Entry & entry(uint32_t id)
+	{
+		return chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)];
+	}
+
+	// Caller holds internMutex
+	uint32_t tagId(std::string const & tag)
+	{
+		std::map<std::string, uint32_t>::const_iterator it = tagIds.find(tag);
+		if (it != tagIds.end())
+			return it->second;
+		uint32_t id = tagIds.size();
+		tagIds[tag] = id;
+		return id;
+	}
+
+	// Caller holds internMutex
+	uint32_t addEntry(tag_value const & tv)
+	{
+		uint32_t id = entriesCount.load();
+		if (chunks[id >> CHUNK_BITS] == NULL) {
+			chunks[id >> CHUNK_BITS] = new Entry[CHUNK_SIZE];
+		}
+		Entry & e = entry(id);
+		e.tv = tv;
+		e.tag = tagId(tv.first);
+		pairIds[tv] = id;
+		entriesCount.store(id + 1);
+		return id;
+	}
+}
+
+uint32_t internTag(std::string const & tag)
+{
+	std::lock_guard<std::mutex> lock(internMutex);
+	return tagId(tag);
+}
+
+uint32_t internTagValue(std::string const & tag, std::string const & value)
+{
+	tag_value tv(tag, value);
+	std::lock_guard<std::mutex> lock(internMutex);
+	if (entriesCount.load() == EMPTY_TAG_VALUE) {
+		addEntry(tag_value("", ""));
+	}
+	std::map<tag_value, uint32_t>::const_iterator it = pairIds.find(tv);
+	if (it != pairIds.end())
+		return it->second;
+	uint32_t id = entriesCount.load();
+	if ((id >> CHUNK_BITS) >= MAX_CHUNKS) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Too many different tag values %d", id);
+		return EMPTY_TAG_VALUE;
+	}
+	return addEntry(tv);
+}
+
+uint32_t findTagValue(std::string const & tag, std::string const & value)
+{
+	std::lock_guard<std::mutex> lock(internMutex);
+	std::map<tag_value, uint32_t>::const_iterator it = pairIds.find(tag_value(tag, value));
+	return it == pairIds.end() ? NO_TAG_VALUE : it->second;
+}
+
+tag_value const & tagValue(uint32_t id)
+{
+	return entry(id).tv;
+}
+
+uint32_t tagOf(uint32_t id)
+{
+	return entry(id).tag;
+}
@@ -0,0 +1,59 @@
+/*
+ * TagDictionary.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef TAGDICTIONARY_HPP_
+#define TAGDICTIONARY_HPP_
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include <Common.h>
+
+// Every tag/value pair used by map objects has a small integer id, shared by
+// all map files. Objects keep ids and compare them instead of strings.
+// Ids never change and pairs are never removed, so references returned stay
+// valid while the process lives. Interning locks; reading by id does not.
+// Pairs are interned when files and styles are read: per object checks take
+// ids resolved then, or findTagValue.
+uint32_t internTagValue(std::string const & tag, std::string const & value);
+inline uint32_t internTagValue(tag_value const & tv)
+{
+	return internTagValue(tv.first, tv.second);
+}
+// Id 0 is the empty pair. Pairs beyond the dictionary size get it, so they
+// never match a real pair.
+uint32_t const EMPTY_TAG_VALUE = 0;
+uint32_t const NO_TAG_VALUE = 0xFFFFFFFF;
+// Id of a pair already interned, NO_TAG_VALUE if none. Never adds the pair.
+uint32_t findTagValue(std::string const & tag, std::string const & value);
+// Id of the tag alone, to compare keys of different pairs.
+uint32_t internTag(std::string const & tag);
+
+tag_value const & tagValue(uint32_t id);
+// internTag of the pair tag
+uint32_t tagOf(uint32_t id);
+
+// Sequence of pair ids that reads as a sequence of pairs.
+class TagValueIds
+{
+public:
+	size_t size() const { return ids.size(); }
+	bool empty() const { return ids.empty(); }
+	size_t capacity() const { return ids.capacity(); }
+	void reserve(size_t n) { ids.reserve(n); }
+
+	tag_value const & operator[](size_t i) const { return tagValue(ids[i]); }
+	uint32_t id(size_t i) const { return ids[i]; }
+
+	void push_back(tag_value const & tv) { ids.push_back(internTagValue(tv)); }
+	void pushId(uint32_t id) { ids.push_back(id); }
+
+private:
+	std::vector<uint32_t> ids;
+};
+
+#endif /* TAGDICTIONARY_HPP_ */
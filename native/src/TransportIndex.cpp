@@ -0,0 +1,175 @@
+/*
+ * TransportIndex.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "TransportIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include "common2.h"
+
+namespace
+{
+
+bool byX(TransportLineStop const * a, TransportLineStop const * b)
+{
+	return a->x < b->x || (a->x == b->x && a->id < b->id);
+}
+
+// Compressed rows from (row, value) pairs
+template <typename T>
+void compress(std::vector< std::pair<uint32_t, T> > & pairs, uint32_t rows,
+		std::vector<uint32_t> & begin, std::vector<T> & values)
+{
+	begin.assign(rows + 1, 0);
+	for (size_t i = 0; i < pairs.size(); i++)
+		begin[pairs[i].first + 1]++;
+	for (uint32_t r = 0; r < rows; r++)
+		begin[r + 1] += begin[r];
+	values.resize(pairs.size());
+	std::vector<uint32_t> cursor(begin.begin(), begin.end() - 1);
+	for (size_t i = 0; i < pairs.size(); i++)
+		values[cursor[pairs[i].first]++] = pairs[i].second;
+}
+
+} // namespace
+
+uint32_t TransportNetwork::addText(std::string const & s)
+{
+	uint32_t offset = texts.size();
+	texts.append(s.c_str(), s.size() + 1);
+	return offset;
+}
+
+void TransportNetwork::build(TransportLines const & lines, TransportSchedule const & schedule)
+{
+	// One stop per id, as the first route with it has it
+	std::vector<TransportLineStop const *> all;
+	for (size_t l = 0; l < lines.lines.size(); l++) {
+		TransportLine const & line = lines.lines[l];
+		for (size_t i = 0; i < line.directStops.size(); i++)
+			all.push_back(&line.directStops[i]);
+		for (size_t i = 0; i < line.reverseStops.size(); i++)
+			all.push_back(&line.reverseStops[i]);
+	}
+	std::stable_sort(all.begin(), all.end(), [](TransportLineStop const * a, TransportLineStop const * b)
+			{ return a->id < b->id; });
+	all.erase(std::unique(all.begin(), all.end(), [](TransportLineStop const * a, TransportLineStop const * b)
+			{ return a->id == b->id; }), all.end());
+	// Ids to positions, before sorting by x
+	std::vector<uint64_t> ids(all.size());
+	for (size_t s = 0; s < all.size(); s++)
+		ids[s] = all[s]->id;
+	std::sort(all.begin(), all.end(), byX);
+	std::vector<uint32_t> position(all.size());
+	for (size_t s = 0; s < all.size(); s++) {
+		position[std::lower_bound(ids.begin(), ids.end(), all[s]->id) - ids.begin()] = s;
+		stopIds.push_back(all[s]->id);
+		stopX.push_back(all[s]->x);
+		stopY.push_back(all[s]->y);
+		stopNames.push_back(addText(lines.string(all[s]->name)));
+	}
+
+	std::vector< std::pair<uint32_t, StopRoute> > atStops;
+	std::vector<uint32_t> stops;
+	std::vector<uint32_t> offsets;
+	for (size_t l = 0; l < lines.lines.size(); l++) {
+		TransportLine const & line = lines.lines[l];
+		std::string const & type = lines.string(line.type);
+		TransportService const & service = schedule.service(type);
+		for (int reverse = 0; reverse < 2; reverse++) {
+			std::vector<TransportLineStop> const & lineStops = reverse ? line.reverseStops : line.directStops;
+			stops.clear();
+			for (size_t i = 0; i < lineStops.size(); i++) {
+				uint32_t s = position[std::lower_bound(ids.begin(), ids.end(), lineStops[i].id) - ids.begin()];
+				if (stops.empty() || stops.back() != s)
+					stops.push_back(s);
+			}
+			if (stops.size() < 2)
+				continue;
+
+			// From the first stop
+			double speed = std::max(service.speed, 1.0) / 3.6;
+			offsets.assign(1, 0);
+			for (size_t i = 1; i < stops.size(); i++) {
+				double d = distance31TileMetric(stopX[stops[i - 1]], stopY[stops[i - 1]], stopX[stops[i]], stopY[stops[i]]);
+				offsets.push_back(offsets.back() + schedule.dwell + (uint32_t) ceil(d / speed));
+			}
+			uint32_t trips = 1;
+			if (service.headway > 0 && schedule.lastDeparture > schedule.firstDeparture)
+				trips += (schedule.lastDeparture - schedule.firstDeparture) / service.headway;
+
+			Route r;
+			r.id = line.id;
+			r.name = addText(lines.string(line.name));
+			r.ref = addText(line.ref);
+			r.type = addText(type);
+			r.firstStop = routeStops.size();
+			r.stops = stops.size();
+			r.firstTime = times.size();
+			r.trips = trips;
+			r.reverse = reverse;
+			for (uint32_t i = 0; i < r.stops; i++) {
+				StopRoute sr = { (uint32_t) routes.size(), i };
+				atStops.push_back(std::make_pair(stops[i], sr));
+			}
+			routeStops.insert(routeStops.end(), stops.begin(), stops.end());
+			for (uint32_t t = 0; t < trips; t++)
+				for (uint32_t i = 0; i < r.stops; i++)
+					times.push_back(schedule.firstDeparture + t * service.headway + offsets[i]);
+			routes.push_back(r);
+		}
+	}
+	compress(atStops, stopsCount(), stopRoutesBegin, stopRoutes);
+
+	// Footpaths. Stops are sorted by x: only a window of them is near each one.
+	std::vector< std::pair<uint32_t, Transfer> > paths;
+	uint32_t window = xWindow(schedule.transferRadius);
+	for (uint32_t i = 0; i < stopsCount(); i++) {
+		for (uint32_t j = i + 1; j < stopsCount() && stopX[j] - stopX[i] <= window; j++) {
+			double d = distance31TileMetric(stopX[i], stopY[i], stopX[j], stopY[j]);
+			if (d > schedule.transferRadius)
+				continue;
+			uint32_t seconds = (uint32_t) ceil(d / schedule.walkSpeed);
+			Transfer to = { j, seconds };
+			Transfer from = { i, seconds };
+			paths.push_back(std::make_pair(i, to));
+			paths.push_back(std::make_pair(j, from));
+		}
+	}
+	compress(paths, stopsCount(), transfersBegin, transfers);
+
+	std::vector<Route>(routes).swap(routes);
+	std::vector<uint32_t>(routeStops).swap(routeStops);
+	std::vector<uint32_t>(times).swap(times);
+	std::string(texts).swap(texts);
+}
+
+uint32_t TransportNetwork::earliestTrip(Route const & r, uint32_t position, uint32_t t) const
+{
+	// Trips do not overtake: times at a stop grow with the trip
+	uint32_t lo = 0;
+	uint32_t hi = r.trips;
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		if (time(r, mid, position) < t)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < r.trips ? lo : NONE;
+}
+
+uint32_t TransportNetwork::xWindow(double meters)
+{
+	static double const metersPerUnit = distance31TileMetric(0, 0, 1 << 20, 0) / (1 << 20);
+	return (uint32_t) (meters / metersPerUnit) + 1;
+}
+
+std::pair<uint32_t, uint32_t> TransportNetwork::stopsBetween(uint32_t left, uint32_t right) const
+{
+	return std::make_pair(std::lower_bound(stopX.begin(), stopX.end(), left) - stopX.begin(),
+			std::upper_bound(stopX.begin(), stopX.end(), right) - stopX.begin());
+}
@@ -0,0 +1,236 @@
+/*
+ * TransportIndex.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef TRANSPORTINDEX_HPP_
+#define TRANSPORTINDEX_HPP_
+
+#include <vector>
+#include <string>
+#include <map>
+#include <climits>
+#include <mutex>
+#include "Common.h"
+#include "Map.hpp"
+#include "BinaryIndex.hpp"
+
+#include <boost/function.hpp>
+
+// Files have routes and their stops but no timetables. Trips are made
+// from these: one every headway along the service day, at a speed per
+// type of route. Times are seconds from midnight.
+struct TransportService {
+	double speed;     // km/h
+	uint32_t headway; // s
+};
+
+struct TransportSchedule {
+	uint32_t firstDeparture;
+	uint32_t lastDeparture;
+	uint32_t dwell; // s at every stop
+	// Stops closer than this are joined by footpaths
+	double transferRadius; // m
+	double walkSpeed;      // m/s
+	TransportService defaultService;
+	// By route type: bus, tram, subway...
+	std::map<std::string, TransportService> services;
+
+	TransportSchedule()
+	: firstDeparture(5 * 3600), lastDeparture(24 * 3600), dwell(20),
+	  transferRadius(250), walkSpeed(1.2)
+	{
+		TransportService bus = { 20, 600 };
+		TransportService tram = { 18, 480 };
+		TransportService fast = { 35, 300 };
+		TransportService train = { 50, 1200 };
+		defaultService = bus;
+		services["bus"] = bus;
+		services["trolleybus"] = bus;
+		services["share_taxi"] = bus;
+		services["tram"] = tram;
+		services["light_rail"] = fast;
+		services["subway"] = fast;
+		services["monorail"] = fast;
+		services["train"] = train;
+	}
+
+	TransportService const & service(std::string const & type) const {
+		std::map<std::string, TransportService>::const_iterator it = services.find(type);
+		return it == services.end() ? defaultService : it->second;
+	}
+};
+
+// A route as the file has it. Names are in TransportLines::strings.
+struct TransportLineStop {
+	uint64_t id;
+	uint32_t x;
+	uint32_t y;
+	uint32_t name;
+};
+
+struct TransportLine {
+	uint64_t id;
+	uint32_t type;
+	uint32_t name;
+	uint32_t operatorName;
+	std::string ref;
+	uint32_t distance;
+	std::vector<TransportLineStop> directStops;
+	std::vector<TransportLineStop> reverseStops;
+
+	TransportLine() : id(0), type(0), name(0), operatorName(0), distance(0) {}
+};
+
+struct TransportLines {
+	std::vector<TransportLine> lines;
+	std::vector<std::string> strings;
+
+	std::string const & string(uint32_t i) const {
+		static std::string const none;
+		return i < strings.size() ? strings[i] : none;
+	}
+};
+
+// Timetable of a transport index in flat arrays, as the journey planner
+// walks it. Stops are sorted by x. A route is one direction of a line:
+// all its trips stop at the same stops, and never overtake each other.
+// Built once per index, then only read.
+struct TransportNetwork {
+	static uint32_t const NONE = UINT_MAX;
+
+	// Stops
+	std::vector<uint64_t> stopIds;
+	std::vector<uint32_t> stopX;
+	std::vector<uint32_t> stopY;
+	std::vector<uint32_t> stopNames; // in texts
+
+	// Routes at each stop: stopRoutes[stopRoutesBegin[s]] to stopRoutes[stopRoutesBegin[s + 1]]
+	struct StopRoute {
+		uint32_t route;
+		uint32_t position; // of the stop in the route
+	};
+	std::vector<uint32_t> stopRoutesBegin;
+	std::vector<StopRoute> stopRoutes;
+
+	// Footpaths, the same way
+	struct Transfer {
+		uint32_t stop;
+		uint32_t seconds;
+	};
+	std::vector<uint32_t> transfersBegin;
+	std::vector<Transfer> transfers;
+
+	struct Route {
+		uint64_t id;     // of the line
+		uint32_t name;   // in texts
+		uint32_t ref;    // in texts
+		uint32_t type;   // in texts
+		uint32_t firstStop; // in routeStops
+		uint32_t stops;
+		uint32_t firstTime; // in times
+		uint32_t trips;
+		bool reverse;
+	};
+	std::vector<Route> routes;
+	std::vector<uint32_t> routeStops;
+	// Trip t of route r is at its stop i at times[r.firstTime + t * r.stops + i]
+	std::vector<uint32_t> times;
+
+	// '\0' terminated
+	std::string texts;
+
+	TransportNetwork() {}
+	TransportNetwork(TransportLines const & lines, TransportSchedule const & schedule) {
+		build(lines, schedule);
+	}
+
+	void build(TransportLines const & lines, TransportSchedule const & schedule);
+
+	uint32_t stopsCount() const {
+		return stopIds.size();
+	}
+	char const * text(uint32_t offset) const {
+		return texts.c_str() + offset;
+	}
+	uint32_t stop(Route const & r, uint32_t position) const {
+		return routeStops[r.firstStop + position];
+	}
+	uint32_t time(Route const & r, uint32_t trip, uint32_t position) const {
+		return times[r.firstTime + trip * r.stops + position];
+	}
+	// First trip of r at position not before t, NONE when there is none
+	uint32_t earliestTrip(Route const & r, uint32_t position, uint32_t t) const;
+	// Stops whose x is in [left, right]
+	std::pair<uint32_t, uint32_t> stopsBetween(uint32_t left, uint32_t right) const;
+	// x units covering at least meters, as distance31TileMetric measures them
+	static uint32_t xWindow(double meters);
+
+	size_t memorySize() const {
+		return sizeof(TransportNetwork) + stopIds.capacity() * sizeof(uint64_t)
+				+ (stopX.capacity() + stopY.capacity() + stopNames.capacity()) * sizeof(uint32_t)
+				+ stopRoutesBegin.capacity() * sizeof(uint32_t) + stopRoutes.capacity() * sizeof(StopRoute)
+				+ transfersBegin.capacity() * sizeof(uint32_t) + transfers.capacity() * sizeof(Transfer)
+				+ routes.capacity() * sizeof(Route) + routeStops.capacity() * sizeof(uint32_t)
+				+ times.capacity() * sizeof(uint32_t) + texts.capacity();
+	}
+
+private:
+	uint32_t addText(std::string const & s);
+};
+typedef SHARED_PTR<TransportNetwork const> TransportNetwork_pointer;
+
+struct TransportIndex : BinaryPartIndex {
+	typedef boost::function<void(TransportLines &)> LinesReader_t;
+
+	TransportIndex()
+	: BinaryPartIndex(TRANSPORT_INDEX),
+	  box(point_t(INT_MAX, INT_MAX), point_t(-1, -1))
+	{}
+
+	// Read and built the first time, as AddressIndex::names.
+	TransportNetwork_pointer network() const
+	{
+		std::lock_guard<std::mutex> lock(networkMutex);
+		if (!networkContent && linesReader) {
+			TransportLines lines;
+			linesReader(lines);
+			networkContent.reset(new TransportNetwork(lines, schedule));
+		}
+		return networkContent;
+	}
+
+	// Networks already given keep the old schedule.
+	void Schedule(TransportSchedule const & s)
+	{
+		std::lock_guard<std::mutex> lock(networkMutex);
+		schedule = s;
+		networkContent.reset();
+	}
+
+	void LinesReader(LinesReader_t r)
+	{
+		linesReader = r;
+	}
+
+	// Be careful
+	void Box(bbox_t const & b)
+	{
+		box = b;
+	}
+	bbox_t const & Box() const
+	{
+		return box;
+	}
+
+private:
+	bbox_t box;
+
+	mutable std::mutex networkMutex;
+	mutable TransportNetwork_pointer networkContent;
+	TransportSchedule schedule;
+	LinesReader_t linesReader;
+};
+
+#endif /* TRANSPORTINDEX_HPP_ */
@@ -0,0 +1,229 @@
+/*
+ * TransportPlanner.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "TransportPlanner.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include "common2.h"
+
+static uint32_t const NONE = TransportNetwork::NONE;
+
+TransitPlanner::TransitPlanner(TransportNetwork_pointer const & network)
+: network(network), stops(network->stopsCount()), rounds(0),
+  best(stops, NONE), egress(stops, NONE), isMarked(stops, false),
+  queue(network->routes.size(), NONE), target(NONE), targetRound(0), targetStop(NONE),
+  routesScanned(0)
+{
+}
+
+void TransitPlanner::reset()
+{
+	for (size_t i = 0; i < touched.size(); i++) {
+		uint32_t s = touched[i];
+		best[s] = NONE;
+		for (uint32_t k = 0; k < rounds; k++) {
+			label(k, s).time = NONE;
+			label(k, s).kind = NOT_REACHED;
+		}
+	}
+	touched.clear();
+	for (size_t i = 0; i < egressStops.size(); i++)
+		egress[egressStops[i]] = NONE;
+	egressStops.clear();
+	for (size_t i = 0; i < marked.size(); i++)
+		isMarked[marked[i]] = false;
+	marked.clear();
+}
+
+void TransitPlanner::reached(uint32_t round, uint32_t stop, Label const & l)
+{
+	if (best[stop] == NONE)
+		touched.push_back(stop);
+	best[stop] = l.time;
+	label(round, stop) = l;
+	if (!isMarked[stop]) {
+		isMarked[stop] = true;
+		marked.push_back(stop);
+	}
+	if (egress[stop] != NONE && l.time + egress[stop] < target) {
+		target = l.time + egress[stop];
+		targetRound = round;
+		targetStop = stop;
+	}
+}
+
+uint32_t TransitPlanner::readyAt(uint32_t round, uint32_t stop, uint32_t slack)
+{
+	// Labels only improve, the last one is the best
+	for (uint32_t k = round; k-- > 0;) {
+		Label const & l = label(k, stop);
+		if (l.kind != NOT_REACHED)
+			return k == 0 ? l.time : l.time + slack;
+	}
+	return NONE;
+}
+
+void TransitPlanner::walk(uint32_t round)
+{
+	TransportNetwork const & n = *network;
+	typedef std::pair<uint32_t, uint32_t> Walk; // time, stop
+	walks.clear();
+	for (size_t m = 0; m < marked.size(); m++)
+		walks.push_back(Walk(label(round, marked[m]).time, marked[m]));
+	std::make_heap(walks.begin(), walks.end(), std::greater<Walk>());
+	while (!walks.empty()) {
+		std::pop_heap(walks.begin(), walks.end(), std::greater<Walk>());
+		Walk w = walks.back();
+		walks.pop_back();
+		if (w.first != label(round, w.second).time)
+			continue;
+		for (uint32_t i = n.transfersBegin[w.second]; i < n.transfersBegin[w.second + 1]; i++) {
+			TransportNetwork::Transfer const & tr = n.transfers[i];
+			uint32_t t = w.first + tr.seconds;
+			if (t >= best[tr.stop] || t >= target)
+				continue;
+			Label l = { t, w.second, NONE, NONE, WALK };
+			reached(round, tr.stop, l);
+			walks.push_back(Walk(t, tr.stop));
+			std::push_heap(walks.begin(), walks.end(), std::greater<Walk>());
+		}
+	}
+}
+
+bool TransitPlanner::plan(TransitQuery const & q, TransitJourney & journey)
+{
+	TransportNetwork const & n = *network;
+	reset();
+	if (rounds != q.maxTransfers + 2) {
+		rounds = q.maxTransfers + 2;
+		Label none = { NONE, NONE, NONE, NONE, NOT_REACHED };
+		labels.assign((size_t) rounds * stops, none);
+	}
+	routesScanned = 0;
+	journey = TransitJourney();
+	journey.network = network;
+
+	target = NONE;
+	targetRound = 0;
+	targetStop = NONE;
+	double direct = distance31TileMetric(q.fromX, q.fromY, q.toX, q.toY);
+	if (direct <= q.walkRadius)
+		target = q.departure + (uint32_t) ceil(direct / q.walkSpeed);
+
+	uint32_t window = n.xWindow(q.walkRadius);
+	std::pair<uint32_t, uint32_t> near = n.stopsBetween(q.toX - std::min(window, q.toX), q.toX + window);
+	for (uint32_t s = near.first; s < near.second; s++) {
+		double d = distance31TileMetric(n.stopX[s], n.stopY[s], q.toX, q.toY);
+		if (d <= q.walkRadius) {
+			egress[s] = (uint32_t) ceil(d / q.walkSpeed);
+			egressStops.push_back(s);
+		}
+	}
+	near = n.stopsBetween(q.fromX - std::min(window, q.fromX), q.fromX + window);
+	for (uint32_t s = near.first; s < near.second && !egressStops.empty(); s++) {
+		double d = distance31TileMetric(n.stopX[s], n.stopY[s], q.fromX, q.fromY);
+		uint32_t t = q.departure + (uint32_t) ceil(d / q.walkSpeed);
+		if (d > q.walkRadius || t >= best[s])
+			continue;
+		Label l = { t, NONE, NONE, NONE, ACCESS };
+		reached(0, s, l);
+	}
+	walk(0);
+
+	for (uint32_t k = 1; k < rounds && !marked.empty(); k++) {
+		// Routes through stops improved last round, from the first of them
+		for (size_t m = 0; m < marked.size(); m++) {
+			uint32_t p = marked[m];
+			isMarked[p] = false;
+			for (uint32_t i = n.stopRoutesBegin[p]; i < n.stopRoutesBegin[p + 1]; i++) {
+				TransportNetwork::StopRoute const & sr = n.stopRoutes[i];
+				if (queue[sr.route] == NONE)
+					queued.push_back(sr.route);
+				queue[sr.route] = std::min(queue[sr.route], sr.position);
+			}
+		}
+		marked.clear();
+
+		for (size_t qr = 0; qr < queued.size(); qr++) {
+			uint32_t r = queued[qr];
+			TransportNetwork::Route const & route = n.routes[r];
+			uint32_t trip = NONE;
+			uint32_t board = 0;
+			routesScanned++;
+			for (uint32_t i = queue[r]; i < route.stops; i++) {
+				uint32_t s = n.stop(route, i);
+				if (trip != NONE) {
+					uint32_t t = n.time(route, trip, i);
+					if (t < best[s] && t < target) {
+						Label l = { t, r, trip, board, RIDE };
+						reached(k, s, l);
+					}
+				}
+				// An earlier trip from here
+				uint32_t ready = readyAt(k, s, q.transferSlack);
+				if (ready != NONE && (trip == NONE || ready < n.time(route, trip, i))) {
+					uint32_t t = n.earliestTrip(route, i, ready);
+					if (t != NONE && (trip == NONE || t < trip)) {
+						trip = t;
+						board = i;
+					}
+				}
+			}
+			queue[r] = NONE;
+		}
+		queued.clear();
+		walk(k);
+	}
+
+	if (target == NONE)
+		return false;
+	journey.arrival = target;
+	journeyTo(q, targetRound, targetStop, journey);
+	return true;
+}
+
+void TransitPlanner::journeyTo(TransitQuery const & q, uint32_t round, uint32_t stop, TransitJourney & journey)
+{
+	TransportNetwork const & n = *network;
+	std::vector<TransitLeg> & legs = journey.legs;
+	if (stop == NONE) {
+		TransitLeg walk = { TransitLeg::WALK, NONE, NONE, NONE, NONE, q.departure, journey.arrival };
+		legs.push_back(walk);
+		return;
+	}
+	// From the end
+	TransitLeg last = { TransitLeg::WALK, NONE, NONE, stop, NONE, label(round, stop).time, journey.arrival };
+	legs.push_back(last);
+	uint32_t s = stop;
+	uint32_t k = round;
+	for (;;) {
+		Label const & l = label(k, s);
+		if (l.kind == ACCESS) {
+			TransitLeg first = { TransitLeg::WALK, NONE, NONE, NONE, s, q.departure, l.time };
+			legs.push_back(first);
+			break;
+		}
+		if (l.kind == WALK) {
+			TransitLeg walk = { TransitLeg::WALK, NONE, NONE, l.route, s, label(k, l.route).time, l.time };
+			legs.push_back(walk);
+			s = l.route;
+			continue;
+		}
+		TransportNetwork::Route const & route = n.routes[l.route];
+		uint32_t from = n.stop(route, l.boardPosition);
+		TransitLeg ride = { TransitLeg::RIDE, l.route, l.trip, from, s,
+				n.time(route, l.trip, l.boardPosition), l.time };
+		legs.push_back(ride);
+		s = from;
+		// Boarded with the best arrival of an earlier round
+		do {
+			k--;
+		} while (label(k, s).kind == NOT_REACHED);
+	}
+	std::reverse(legs.begin(), legs.end());
+}
@@ -0,0 +1,133 @@
+/*
+ * TransportPlanner.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef TRANSPORTPLANNER_HPP_
+#define TRANSPORTPLANNER_HPP_
+
+#include <vector>
+#include <utility>
+#include "TransportIndex.hpp"
+
+struct TransitQuery {
+	uint32_t fromX;
+	uint32_t fromY;
+	uint32_t toX;
+	uint32_t toY;
+	uint32_t departure; // s from midnight
+	uint32_t maxTransfers;
+	// Walking to the first stop and from the last one
+	double walkRadius; // m
+	double walkSpeed;  // m/s
+	// Changing vehicle, on top of walking between stops
+	uint32_t transferSlack; // s
+
+	TransitQuery(uint32_t fx, uint32_t fy, uint32_t tx, uint32_t ty, uint32_t departure)
+	: fromX(fx), fromY(fy), toX(tx), toY(ty), departure(departure), maxTransfers(4),
+	  walkRadius(600), walkSpeed(1.2), transferSlack(60)
+	{}
+};
+
+struct TransitLeg {
+	enum Kind { WALK, RIDE };
+	Kind kind;
+	// Route and trip in the network of the journey, for rides
+	uint32_t route;
+	uint32_t trip;
+	// NONE for the start and the end of the journey
+	uint32_t fromStop;
+	uint32_t toStop;
+	uint32_t departure;
+	uint32_t arrival;
+};
+
+struct TransitJourney {
+	// Legs point into it
+	TransportNetwork_pointer network;
+	std::vector<TransitLeg> legs;
+	uint32_t arrival; // NONE when there is no journey
+
+	TransitJourney() : arrival(TransportNetwork::NONE) {}
+
+	bool found() const {
+		return arrival != TransportNetwork::NONE;
+	}
+	uint32_t rides() const {
+		uint32_t n = 0;
+		for (size_t i = 0; i < legs.size(); i++)
+			n += legs[i].kind == TransitLeg::RIDE;
+		return n;
+	}
+};
+
+// Earliest arrival journeys by rounds (RAPTOR): round k finds the best
+// arrivals with k rides, scanning each route once from the stops the
+// round before improved, then walking on from where it arrived. Keeps
+// its arrays between queries, one planner per thread. searchTransitRoute
+// keeps the planners of the searches for the next ones on their network.
+class TransitPlanner
+{
+public:
+	explicit TransitPlanner(TransportNetwork_pointer const & network);
+
+	// Among the earliest arrivals, the one with fewest rides.
+	// False when the end cannot be reached.
+	bool plan(TransitQuery const & q, TransitJourney & journey);
+
+	// Scanned in the last plan
+	uint32_t scannedRoutes() const {
+		return routesScanned;
+	}
+
+	TransportNetwork_pointer const & plannedNetwork() const {
+		return network;
+	}
+
+private:
+	enum Kind { NOT_REACHED, ACCESS, RIDE, WALK };
+	struct Label {
+		uint32_t time;
+		uint32_t route; // ride: route and trip; walk: stop it comes from
+		uint32_t trip;
+		uint32_t boardPosition;
+		Kind kind;
+	};
+
+	Label & label(uint32_t round, uint32_t stop) {
+		return labels[round * stops + stop];
+	}
+	// When a vehicle can be boarded at stop with the rides before round, NONE if never
+	uint32_t readyAt(uint32_t round, uint32_t stop, uint32_t slack);
+	void reached(uint32_t round, uint32_t stop, Label const & l);
+	// Footpaths from the stops improved in round, as far as they improve others
+	void walk(uint32_t round);
+	void reset();
+	void journeyTo(TransitQuery const & q, uint32_t round, uint32_t stop, TransitJourney & journey);
+
+	TransportNetwork_pointer network;
+	uint32_t stops;
+	uint32_t rounds;
+	std::vector<Label> labels;   // [round][stop]
+	std::vector<uint32_t> best;  // of any round
+	std::vector<uint32_t> egress; // walk to the end, NONE when too far
+	std::vector<uint32_t> egressStops;
+	std::vector<uint32_t> touched; // stops to reset
+	std::vector<uint32_t> marked;
+	std::vector<bool> isMarked;
+	std::vector<uint32_t> queue; // first marked position of queued routes
+	std::vector<uint32_t> queued;
+	std::vector< std::pair<uint32_t, uint32_t> > walks; // heap
+	// Best arrival at the end, from targetStop of targetRound (NONE walking straight)
+	uint32_t target;
+	uint32_t targetRound;
+	uint32_t targetStop;
+	uint32_t routesScanned;
+};
+
+// Earliest arrival over the transport indexes of open files, as
+// searchRouteInternal does for roads. The journey keeps its network.
+bool searchTransitRoute(TransitQuery const & q, TransitJourney & journey);
+
+#endif /* TRANSPORTPLANNER_HPP_ */
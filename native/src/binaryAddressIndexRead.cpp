@@ -0,0 +1,360 @@
+/*
+ * binaryAddressIndexRead.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "AddressIndex.hpp"
+
+#include "proto/osmand_odb.pb.h"
+#include "proto/utils.hpp"
+#include "MappedFile.hpp"
+#include "Logging.h"
+
+////
+// EXTERNAL
+bool readTileBox(CodedInputStream & input, bbox_t & output);
+
+
+///////////////////////////////
+// Streets and buildings are at zoom 24, relative to their city or street.
+static const int ADDRESS_ZOOM = 24;
+
+bool readAddressBuilding(CodedInputStream & input, AddressBuilding & output,
+		uint32_t street24X, uint32_t street24Y)
+{
+	LDMessage<> inputManager(input);
+	int32_t si;
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case BuildingIndex::kIdFieldNumber:
+			readUInt64(input, output.id);
+			break;
+		case BuildingIndex::kNameFieldNumber:
+			WireFormatLite::ReadString(&input, &output.name);
+			break;
+		case BuildingIndex::kName2FieldNumber:
+			WireFormatLite::ReadString(&input, &output.name2);
+			break;
+		case BuildingIndex::kInterpolationFieldNumber:
+			readSint32(input, output.interpolation);
+			break;
+		case BuildingIndex::kXFieldNumber:
+			readSint32(input, si);
+			output.x = (si + street24X) << (31 - ADDRESS_ZOOM);
+			break;
+		case BuildingIndex::kYFieldNumber:
+			readSint32(input, si);
+			output.y = (si + street24Y) << (31 - ADDRESS_ZOOM);
+			break;
+		case BuildingIndex::kX2FieldNumber:
+			readSint32(input, si);
+			output.x2 = (si + street24X) << (31 - ADDRESS_ZOOM);
+			break;
+		case BuildingIndex::kY2FieldNumber:
+			readSint32(input, si);
+			output.y2 = (si + street24Y) << (31 - ADDRESS_ZOOM);
+			break;
+		case BuildingIndex::kPostcodeFieldNumber:
+			WireFormatLite::ReadString(&input, &output.postcode);
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	return true;
+}
+
+// The street message again, now for its buildings.
+bool readAddressBuildings(CodedInputStream & input, AddressStreet const & street,
+		std::vector<AddressBuilding> & output)
+{
+	LDMessage<> inputManager(input);
+	uint32_t street24X = street.x >> (31 - ADDRESS_ZOOM);
+	uint32_t street24Y = street.y >> (31 - ADDRESS_ZOOM);
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case StreetIndex::kBuildingsFieldNumber:
+		{
+			AddressBuilding building;
+			if (!readAddressBuilding(input, building, street24X, street24Y)) {
+				return false;
+			}
+			output.push_back(std::move(building));
+			break;
+		}
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	return true;
+}
+
+// Buildings and intersections are skipped, they are read only for a chosen street.
+bool readAddressStreet(CodedInputStream & input, AddressNames & names, uint32_t city)
+{
+	AddressStreet street = { 0, 0, 0, 0, 0, (uint32_t) input.TotalBytesRead(), city };
+	LDMessage<> inputManager(input);
+	uint32_t city24X = names.cities[city].x >> (31 - ADDRESS_ZOOM);
+	uint32_t city24Y = names.cities[city].y >> (31 - ADDRESS_ZOOM);
+	std::string name;
+	std::string nameEn;
+	int32_t si;
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case StreetIndex::kIdFieldNumber:
+			readUInt64(input, street.id);
+			break;
+		case StreetIndex::kNameFieldNumber:
+			WireFormatLite::ReadString(&input, &name);
+			break;
+		case StreetIndex::kNameEnFieldNumber:
+			WireFormatLite::ReadString(&input, &nameEn);
+			break;
+		case StreetIndex::kXFieldNumber:
+			readSint32(input, si);
+			street.x = (si + city24X) << (31 - ADDRESS_ZOOM);
+			break;
+		case StreetIndex::kYFieldNumber:
+			readSint32(input, si);
+			street.y = (si + city24Y) << (31 - ADDRESS_ZOOM);
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+
+	uint32_t object = names.cities.size() + names.streets.size();
+	street.name = names.addText(name);
+	street.nameEn = names.addText(nameEn);
+	names.addName(name, object);
+	if (nameEn != name)
+		names.addName(nameEn, object);
+	names.streets.push_back(street);
+	return true;
+}
+
+bool readAddressCityBlock(CodedInputStream & input, AddressNames & names, uint32_t city)
+{
+	LDMessage<> inputManager(input);
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case CityBlockIndex::kStreetsFieldNumber:
+			if (!readAddressStreet(input, names, city)) {
+				return false;
+			}
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	return true;
+}
+
+bool readAddressCity(CodedInputStream & input, AddressNames & names, uint32_t blockType)
+{
+	uint32_t fp = input.TotalBytesRead();
+	LDMessage<> inputManager(input);
+	AddressCity city = { 0, 0, 0, 0, 0, 0, 0, (uint8_t) blockType };
+	std::string name;
+	std::string nameEn;
+	uint32_t u;
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case CityIndex::kCityTypeFieldNumber:
+			readUInt32(input, u);
+			city.cityType = u;
+			break;
+		case CityIndex::kIdFieldNumber:
+			readUInt64(input, city.id);
+			break;
+		case CityIndex::kNameFieldNumber:
+			WireFormatLite::ReadString(&input, &name);
+			break;
+		case CityIndex::kNameEnFieldNumber:
+			WireFormatLite::ReadString(&input, &nameEn);
+			break;
+		case CityIndex::kXFieldNumber:
+			readUInt32(input, city.x);
+			break;
+		case CityIndex::kYFieldNumber:
+			readUInt32(input, city.y);
+			break;
+		// Relative to the city message
+		case CityIndex::kShiftToCityBlockIndexFieldNumber:
+			readInt(input, u);
+			city.blockOffset = fp + u;
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+
+	uint32_t object = names.cities.size();
+	city.name = names.addText(name);
+	city.nameEn = names.addText(nameEn);
+	names.addName(name, object);
+	if (nameEn != name)
+		names.addName(nameEn, object);
+	names.cities.push_back(city);
+	return true;
+}
+
+// Cities of the block, then the streets of each one.
+bool readAddressCities(MappedFile const & file, AddressIndex::CitiesBlock const & block,
+		AddressNames & names)
+{
+	CodedInputStream input(file.Data(), file.StreamSize());
+	input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+	input.Seek(block.filePointer); // Positions are absolute inside the mapped file
+	CodedInputStream::Limit old = input.PushLimit(block.length);
+	size_t first = names.cities.size();
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndAddressIndex_CitiesIndex::kCitiesFieldNumber:
+			if (!readAddressCity(input, names, block.type)) {
+				return false;
+			}
+			break;
+		case OsmAndAddressIndex_CitiesIndex::kBlocksFieldNumber:
+			// Fast end
+			input.Skip(input.BytesUntilLimit());
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	input.PopLimit(old);
+
+	for (size_t c = first; c < names.cities.size(); c++) {
+		if (names.cities[c].blockOffset == 0)
+			continue;
+		// Offsets need not grow: each block gets a stream of its own
+		CodedInputStream blockInput(file.Data(), file.StreamSize());
+		blockInput.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+		blockInput.Seek(names.cities[c].blockOffset);
+		if (!readAddressCityBlock(blockInput, names, c)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Only where cities are. They are read with their streets on the first search.
+bool readAddressCitiesBlock(CodedInputStream & input, AddressIndex & output)
+{
+	LDMessage<OSMAND_FIXED32> inputManager(input);
+	AddressIndex::CitiesBlock block = { 0, (uint32_t) input.TotalBytesRead(), (uint32_t) input.BytesUntilLimit() };
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndAddressIndex_CitiesIndex::kTypeFieldNumber:
+			readUInt32(input, block.type);
+			// Fast end
+			input.Skip(input.BytesUntilLimit());
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	output.citiesBlocks.push_back(block);
+	return true;
+}
+
+bool readAddressIndex(CodedInputStream & input, AddressIndex & output,
+		MappedFile const & file)
+{
+	LDMessage<OSMAND_FIXED32> inputManager(input);
+	output.filePointer = input.TotalBytesRead();
+	output.length = input.BytesUntilLimit();
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndAddressIndex::kNameFieldNumber:
+			WireFormatLite::ReadString(&input, &output.name);
+			break;
+		case OsmAndAddressIndex::kNameEnFieldNumber:
+			WireFormatLite::ReadString(&input, &output.nameEn);
+			break;
+		case OsmAndAddressIndex::kBoundariesFieldNumber:
+		{
+			bbox_t box;
+			readTileBox(input, box);
+			output.Box(box);
+			break;
+		}
+		case OsmAndAddressIndex::kCitiesFieldNumber:
+			readAddressCitiesBlock(input, output);
+			break;
+		default:
+			// The name index of the file too. Names are indexed by AddressNames.
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // end of while
+
+	AddressIndex const & index = output;
+	output.Readers([&index, &file](AddressNames & names)
+			{
+		for (size_t b = 0; b < index.citiesBlocks.size(); b++) {
+			if (!readAddressCities(file, index.citiesBlocks[b], names)) {
+				OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Address index %s could not be read",
+						index.name.c_str());
+				return;
+			}
+		}
+			},
+			[&file](AddressStreet const & street, std::vector<AddressBuilding> & buildings)
+			{
+		CodedInputStream input(file.Data(), file.StreamSize());
+		input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+		input.Seek(street.offset); // Positions are absolute inside the mapped file
+		readAddressBuildings(input, street, buildings);
+			});
+	return true;
+}
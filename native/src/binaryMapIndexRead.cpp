@@ -8,19 +8,20 @@
 #include "MapIndex.hpp"
 
 #include "proto/osmand_odb.pb.h"
+#include "proto/osmand_index.pb.h"
 #include "proto/utils.hpp"
+#include "MappedFile.hpp"
 
 ////
 // EXTERNAL
-typedef std::vector<std::string> StringTable_t;
 bool readStringTable(CodedInputStream & input, StringTable_t & list);
 
 
 ///////////////////////////////
 //// MapIndex
 
-typedef UNORDERED(map)<std::string, unsigned int> stringIds_t;
-bool readStrIds(CodedInputStream & input, stringIds_t & output,
+// (rule, string table index) pairs. Strings come later in the block.
+bool readStrIds(CodedInputStream & input, MapDataObject & output,
 		MapIndex const & root)
 {
 	LDMessage<> inputManager(input);
@@ -29,17 +30,26 @@ bool readStrIds(CodedInputStream & input, stringIds_t & output,
 	{
 		readInt32(input, i);
 		readInt32(input, j);
-		// TODO: What about doing that in future when needed??????
-		UNORDERED(map)<int, tag_value>::const_iterator dR = root.decodingRules.find(i);
-		if (dR != root.decodingRules.end()) {
-			output[dR->second.first] = j;
+		if (i < 0 || (size_t) i >= root.decodingIds.size()
+				|| root.decodingIds[i] == NO_TAG_VALUE || j < 0) {
+			continue;
+		}
+		std::pair<uint32_t, uint32_t> nameId(root.decodingIds[i], j);
+		// Last one of a tag wins
+		size_t k = 0;
+		while (k < output.namesIds.size() && tagOf(output.namesIds[k].first) != tagOf(nameId.first)) {
+			k++;
+		}
+		if (k < output.namesIds.size()) {
+			output.namesIds[k] = nameId;
+		} else {
+			output.namesIds.push_back(nameId);
 		}
 	}
 	return true;
 }
 
-typedef std::vector<tag_value> Types_t;
-bool readTypes(CodedInputStream & input, Types_t & output,
+bool readTypes(CodedInputStream & input, TagValueIds & output,
 		MapIndex const & root)
 {
 	LDMessage<> inputManager(input);
@@ -47,10 +57,10 @@ bool readTypes(CodedInputStream & input, Types_t & output,
 	while (input.BytesUntilLimit() > 0)
 	{
 		readInt32(input, type);
-		// TODO: What about doing that in future when needed??????
-		UNORDERED(map)<int, tag_value>::const_iterator dR = root.decodingRules.find(type);
-		if (dR != root.decodingRules.end()) {
-			output.push_back(dR->second);
+		// Rules were interned when read. No strings here.
+		if (type >= 0 && (size_t) type < root.decodingIds.size()
+				&& root.decodingIds[type] != NO_TAG_VALUE) {
+			output.pushId(root.decodingIds[type]);
 		}
 	}
 	return true;
@@ -66,20 +76,14 @@ bool readCoordinates(CodedInputStream & input, coordinates & output,
 	// Delta encoded coordinates
 	int px = tree.Box().min_corner().x() & MASK_TO_READ;
 	int py = tree.Box().min_corner().y() & MASK_TO_READ;
-	int x;
-	int y;
-	while (input.BytesUntilLimit() > 0)
-	{
-		readSint32(input, x);
-		readSint32(input, y);
+	return readSint32Pairs(input, [&output, &px, &py](int x, int y)
+			{
 		x = (x << SHIFT_COORDINATES) + px;
 		y = (y << SHIFT_COORDINATES) + py;
 		output.push_back(std::make_pair(x, y));
 		px = x;
 		py = y;
-	}
-
-	return true;
+			});
 }
 
 bool readMainCoordinates(CodedInputStream & input, MapDataObject & output,
@@ -138,7 +142,7 @@ MapDataObject* readMapDataObject(CodedInputStream & input,
 		}
 			break;
 		case MapData::kStringNamesFieldNumber:
-			readStrIds(input, dataObject->stringIds, index);
+			readStrIds(input, *dataObject, index);
 			break;
 		default:
 			if (!skipUnknownFields(input, tag))
@@ -153,15 +157,16 @@ MapDataObject* readMapDataObject(CodedInputStream & input,
 	return dataObject;
 }
 
-bool readMapDataBlocks(CodedInputStream & input, MapTreeBounds & output,
-		MapIndex const & index)
+bool readMapDataBlocks(CodedInputStream & input, MapTreeBounds const & node,
+		MapTreeBounds::Content & output, MapIndex const & index)
 {
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "readMapData from %d", input.TotalBytesRead());
 	LDMessage<> inputManager(input);
+	index.loadRules();
 	uint64_t baseId = 0;
 	MapDataObjects_t dataObjects;
 	dataObjects.reserve(NODE_CAPACITY);
-	StringTable_t stringTable;
+	SHARED_PTR<StringTable_t> stringTable;
 	int tag;
 	while ((tag = input.ReadTag()) != 0)
 	{
@@ -173,13 +178,19 @@ bool readMapDataBlocks(CodedInputStream & input, MapTreeBounds & output,
 		case MapDataBlock::kStringTableFieldNumber:
 		{
 			if(dataObjects.size() > 0) {
-				readStringTable(input, stringTable);
+				stringTable.reset(new StringTable_t);
+				readStringTable(input, *stringTable);
+				// One table for the block, objects keep indexes into it
 				for (MapDataObjects_t::const_iterator obj = dataObjects.begin(); obj != dataObjects.end(); obj++) {
-					UNORDERED(map)<std::string, unsigned int >::const_iterator  val=(*obj)->stringIds.begin();
-					while(val != (*obj)->stringIds.end()){
-						(*obj)->objectNames[val->first]=stringTable[val->second];
-						val++;
+					std::vector< std::pair<uint32_t, uint32_t> > & ids = (*obj)->namesIds;
+					size_t k = 0;
+					for (size_t n = 0; n < ids.size(); n++) {
+						if (ids[n].second < stringTable->size()) {
+							ids[k++] = ids[n];
+						}
 					}
+					ids.resize(k);
+					(*obj)->stringTable = stringTable;
 				}
 			}
 			else
@@ -188,7 +199,7 @@ bool readMapDataBlocks(CodedInputStream & input, MapTreeBounds & output,
 		}
 		case MapDataBlock::kDataObjectsFieldNumber:
 		{
-			MapDataObject* mapObject = readMapDataObject(input, output, index);
+			MapDataObject* mapObject = readMapDataObject(input, node, index);
 			if (mapObject != NULL) {
 				mapObject->id += baseId;
 				dataObjects.push_back(mapObject);
@@ -203,14 +214,21 @@ bool readMapDataBlocks(CodedInputStream & input, MapTreeBounds & output,
 		}
 	} // End of while
 
-	output.DataObjects(std::move(dataObjects));
+	// Objects read after the string table can not have names
+	for (MapDataObjects_t::const_iterator obj = dataObjects.begin(); obj != dataObjects.end(); obj++) {
+		if (!(*obj)->stringTable) {
+			(*obj)->namesIds.clear();
+		}
+	}
+	output.dataObjects = std::move(dataObjects);
+	output.stringTable = stringTable;
 	return true;
 }
 
 bool readMapTreeBoundsBase(CodedInputStream & input, MapTreeBounds & output,
-		MapTreeBounds const & root, MapIndex const & index, int fd);
-bool readMapTreeBoundsNodes(CodedInputStream & input, MapTreeBounds & output,
-		MapIndex const & index, int fd)
+		MapTreeBounds const & root, MapIndex const & index, MappedFile const & file);
+bool readMapTreeBoundsNodes(CodedInputStream & input, MapTreeBounds const & parent,
+		MapTreeBounds::Content & output, MapIndex const & index, MappedFile const & file)
 {
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "readRouteTreeNodes from %d", input.TotalBytesRead());
 	LDMessage<OSMAND_FIXED32> inputManager(input);
@@ -224,10 +242,10 @@ bool readMapTreeBoundsNodes(CodedInputStream & input, MapTreeBounds & output,
 		case OsmAndMapIndex_MapDataBox::kBoxesFieldNumber:
 		{
 			MapTreeBounds node;
-			if (output.ocean) {
-				node.ocean = output.ocean;
+			if (parent.ocean) {
+				node.ocean = parent.ocean;
 			}
-			readMapTreeBoundsBase(input, node, output, index, fd);
+			readMapTreeBoundsBase(input, node, parent, index, file);
 			nodes.push_back(std::move(node));
 			break;
 		}
@@ -239,12 +257,12 @@ bool readMapTreeBoundsNodes(CodedInputStream & input, MapTreeBounds & output,
 		}
 	}  // End of while
 
-	output.Children(std::move(nodes));
+	output.bounds = std::move(nodes);
 	return true;
 }
 
 bool readMapTreeBoundsBase(CodedInputStream & input, MapTreeBounds & output,
-		MapTreeBounds const & root, MapIndex const & index, int fd)
+		MapTreeBounds const & root, MapIndex const & index, MappedFile const & file)
 {
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "new MapBB pos %d", input.TotalBytesRead());
 	uint32_t lPos = input.TotalBytesRead();
@@ -300,39 +318,31 @@ bool readMapTreeBoundsBase(CodedInputStream & input, MapTreeBounds & output,
 //}
 	if (objectsOffset == 0)
 	{  // An intermediate node.
-		output.ContentReader([lPos, &index, fd](MapTreeBounds & output)
+		output.ContentReader([lPos, &index, &file](MapTreeBounds const & node, MapTreeBounds::Content & content)
 				{
-			int filed = dup(fd); // Duplicated fd to permit parallel access.
-			lseek(filed, 0, SEEK_SET); // need to start from begining
-			FileInputStream is(filed);
-			is.SetCloseOnDelete(true);
-			CodedInputStream input(&is);
+			CodedInputStream input(file.Data(), file.StreamSize());
 			input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
-			input.Seek(lPos); // Needed to correctelly set TotalBytesRead
-			readMapTreeBoundsNodes(input, output, index, fd);
+			input.Seek(lPos); // Positions are absolute inside the mapped file
+			readMapTreeBoundsNodes(input, node, content, index, file);
 				});
 	}
 	else
 	{  // A leaf node.
 		uint32_t pos = mPos+objectsOffset;
-		output.ContentReader([pos, &index, fd](MapTreeBounds & output)
+		output.ContentReader([pos, &index, &file](MapTreeBounds const & node, MapTreeBounds::Content & content)
 				{
-			int filed = dup(fd); // Duplicated fd to permit parallel access.
-			lseek(filed, 0, SEEK_SET); // need to start from begining
-			FileInputStream is(filed);
-			is.SetCloseOnDelete(true);
-			CodedInputStream input(&is);
+			CodedInputStream input(file.Data(), file.StreamSize());
 			input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
-			input.Seek(pos); // Needed to correctelly set TotalBytesRead
-			readMapDataBlocks(input, output, index);
+			input.Seek(pos); // Positions are absolute inside the mapped file
+			readMapDataBlocks(input, node, content, index);
 				});
 	}
 
 	return true;
 }
 
-bool readMapLevelNodes(CodedInputStream & input, MapTreeBounds & output,
-		MapIndex const & index, int fd)
+bool readMapLevelNodes(CodedInputStream & input, MapTreeBounds const & level,
+		MapTreeBounds::Content & output, MapIndex const & index, MappedFile const & file)
 {
 	LDMessage<OSMAND_FIXED32> inputMnager(input);
 	MapRoot::Bounds_t nodes(NODE_CAPACITY);
@@ -344,7 +354,7 @@ bool readMapLevelNodes(CodedInputStream & input, MapTreeBounds & output,
 		case OsmAndMapIndex_MapRootLevel::kBoxesFieldNumber:
 		{
 			MapTreeBounds bounds;
-			readMapTreeBoundsBase(input, bounds, output, index, fd);
+			readMapTreeBoundsBase(input, bounds, level, index, file);
 			nodes.push_back(std::move(bounds));
 		}
 			break;
@@ -360,16 +370,18 @@ bool readMapLevelNodes(CodedInputStream & input, MapTreeBounds & output,
 		}
 	}  // End of while
 
-	output.Children(std::move(nodes));
+	output.bounds = std::move(nodes);
 	return true;
 }
 
 bool readMapLevelBase(CodedInputStream & input, MapRoot & output,
-		MapIndex const & index, int fd)
+		MapIndex const & index, MappedFile const & file)
 {
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "new MapLevel pos %d", input.TotalBytesRead());
 	uint32_t pos = input.TotalBytesRead();
 	LDMessage<OSMAND_FIXED32> inputManager(input);
+	output.filePointer = input.TotalBytesRead();
+	output.length = input.BytesUntilLimit();
 	int tag;
 	int si;
 	while ((tag = input.ReadTag()) != 0)
@@ -418,16 +430,12 @@ bool readMapLevelBase(CodedInputStream & input, MapRoot & output,
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, msg.str().c_str());
 //}
 	// Lazy read of nodes
-	output.ContentReader([pos, &index, fd](MapTreeBounds & output)
+	output.ContentReader([pos, &index, &file](MapTreeBounds const & level, MapTreeBounds::Content & content)
 			{
-		int filed = dup(fd);
-		lseek(filed, 0, SEEK_SET);  // We start from the begining
-		FileInputStream is(filed);
-		is.SetCloseOnDelete(true);
-		CodedInputStream input(&is);
+		CodedInputStream input(file.Data(), file.StreamSize());
 		input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
-		input.Seek(pos); // Needed to correctelly set TotalBytesRead
-		readMapLevelNodes(input, output, index, fd);
+		input.Seek(pos); // Positions are absolute inside the mapped file
+		readMapLevelNodes(input, level, content, index, file);
 			});
 
 	return true;
@@ -470,10 +478,12 @@ bool readMapEncodingRule(CodedInputStream & input, MapIndex & output, uint32_t i
 }
 
 bool readMapIndex(CodedInputStream & input, MapIndex & output,
-		int fd)
+		MappedFile const & file)
 {
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "new MapIndex pos %d", input.TotalBytesRead());
 	LDMessage<OSMAND_FIXED32> inputManager(input);
+	output.filePointer = input.TotalBytesRead();
+	output.length = input.BytesUntilLimit();
 	output.levels.reserve(4);
 	uint32_t tag;
 	uint32_t defaultId = 1;
@@ -490,7 +500,7 @@ bool readMapIndex(CodedInputStream & input, MapIndex & output,
 		case OsmAndMapIndex::kLevelsFieldNumber:
 		{
 			MapRoot mapLevel;
-			readMapLevelBase(input, mapLevel, output, fd);
+			readMapLevelBase(input, mapLevel, output, file);
 			output.levels.push_back(std::move(mapLevel));
 			break;
 		}
@@ -519,3 +529,76 @@ bool readMapIndex(CodedInputStream & input, MapIndex & output,
 //			output.decodingRules.size(), output.levels.size());
 	return true;
 }
+
+// Only encoding rules. Used by indexes opened from cache.
+bool readMapIndexRules(CodedInputStream & input, MapIndex & output)
+{
+	LDMessage<OSMAND_FIXED32> inputManager(input);
+	uint32_t tag;
+	uint32_t defaultId = 1;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndMapIndex::kRulesFieldNumber:
+			readMapEncodingRule(input, output, defaultId++);
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // end of while
+
+	output.finishInitializingTags();
+	return true;
+}
+
+// Builds the index from the cache without touching the file.
+// Rules and level nodes are read lazily.
+void initMapIndexFromCache(MapPart const & part, MapIndex & output,
+		MappedFile const & file)
+{
+	output.name = part.name();
+	output.filePointer = part.offset();
+	output.length = part.size();
+	// Cache offsets are just after the length.
+	uint32_t indexPos = part.offset() - 4;
+	MapIndex * index = &output;
+	output.RulesReader([indexPos, index, &file]()
+			{
+		CodedInputStream input(file.Data(), file.StreamSize());
+		input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+		input.Seek(indexPos);
+		readMapIndexRules(input, *index);
+			});
+
+	output.levels.reserve(part.levels_size());
+	bbox_t box(output.Box());
+	for (int j = 0; j < part.levels_size(); j++)
+	{
+		MapLevel const & ml = part.levels(j);
+		MapRoot mapLevel;
+		mapLevel.left = ml.left();
+		mapLevel.right = ml.right();
+		mapLevel.top = ml.top();
+		mapLevel.bottom = ml.bottom();
+		mapLevel.minZoom = ml.minzoom();
+		mapLevel.maxZoom = ml.maxzoom();
+		mapLevel.filePointer = ml.offset();
+		mapLevel.length = ml.size();
+		mapLevel.Box(bbox_t(point_t(mapLevel.left, mapLevel.top), point_t(mapLevel.right, mapLevel.bottom)));
+		uint32_t pos = ml.offset() - 4;
+		mapLevel.ContentReader([pos, index, &file](MapTreeBounds const & level, MapTreeBounds::Content & content)
+				{
+			CodedInputStream input(file.Data(), file.StreamSize());
+			input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+			input.Seek(pos); // Positions are absolute inside the mapped file
+			readMapLevelNodes(input, level, content, *index, file);
+				});
+		boost::geometry::expand(box, mapLevel.Box());
+		output.levels.push_back(std::move(mapLevel));
+	}
+	output.Box(box);
+}
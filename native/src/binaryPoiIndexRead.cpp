@@ -0,0 +1,394 @@
+/*
+ * binaryPoiIndexRead.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "PoiIndex.hpp"
+
+#include "proto/osmand_odb.pb.h"
+#include "proto/utils.hpp"
+#include "MappedFile.hpp"
+
+///////////////////////////////
+// Amenity coordinates are at zoom 24, relative to their data block tile.
+static const int POI_ZOOM = 24;
+
+bool readPoiAtom(CodedInputStream & input, Amenity & output,
+		uint32_t px, uint32_t py, uint32_t zoom)
+{
+	LDMessage<> inputManager(input);
+	int tag;
+	int32_t si;
+	uint32_t category;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndPoiBoxDataAtom::kDxFieldNumber:
+			readSint32(input, si);
+			output.x = (si + (px << (POI_ZOOM - zoom))) << (31 - POI_ZOOM);
+			break;
+		case OsmAndPoiBoxDataAtom::kDyFieldNumber:
+			readSint32(input, si);
+			output.y = (si + (py << (POI_ZOOM - zoom))) << (31 - POI_ZOOM);
+			break;
+		case OsmAndPoiBoxDataAtom::kCategoriesFieldNumber:
+			readUInt32(input, category);
+			output.categories.push_back(category);
+			break;
+		case OsmAndPoiBoxDataAtom::kIdFieldNumber:
+			readUInt64(input, output.id);
+			break;
+		case OsmAndPoiBoxDataAtom::kNameFieldNumber:
+			WireFormatLite::ReadString(&input, &output.name);
+			break;
+		case OsmAndPoiBoxDataAtom::kNameEnFieldNumber:
+			WireFormatLite::ReadString(&input, &output.nameEn);
+			break;
+		case OsmAndPoiBoxDataAtom::kOpeningHoursFieldNumber:
+			WireFormatLite::ReadString(&input, &output.openingHours);
+			break;
+		case OsmAndPoiBoxDataAtom::kSiteFieldNumber:
+			WireFormatLite::ReadString(&input, &output.site);
+			break;
+		case OsmAndPoiBoxDataAtom::kPhoneFieldNumber:
+			WireFormatLite::ReadString(&input, &output.phone);
+			break;
+		case OsmAndPoiBoxDataAtom::kNoteFieldNumber:
+			WireFormatLite::ReadString(&input, &output.note);
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	return true;
+}
+
+bool readPoiData(CodedInputStream & input, std::vector<Amenity> & output, PoiIndex const & index)
+{
+	LDMessage<OSMAND_FIXED32> inputManager(input);
+	uint32_t zoom = 0;
+	uint32_t x = 0;
+	uint32_t y = 0;
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndPoiBoxData::kZoomFieldNumber:
+			readUInt32(input, zoom);
+			break;
+		case OsmAndPoiBoxData::kXFieldNumber:
+			readUInt32(input, x);
+			break;
+		case OsmAndPoiBoxData::kYFieldNumber:
+			readUInt32(input, y);
+			break;
+		case OsmAndPoiBoxData::kPoiDataFieldNumber:
+		{
+			Amenity amenity;
+			amenity.index = &index;
+			if (!readPoiAtom(input, amenity, x, y, zoom)) {
+				return false;
+			}
+			output.push_back(std::move(amenity));
+			break;
+		}
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	return true;
+}
+
+bool readPoiCategories(CodedInputStream & input, std::vector<uint32_t> & output)
+{
+	LDMessage<> inputManager(input);
+	int tag;
+	uint32_t category;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndPoiCategories::kCategoriesFieldNumber:
+			readUInt32(input, category);
+			output.push_back(category);
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	return true;
+}
+
+bool readPoiBoxBase(CodedInputStream & input, PoiTreeBounds & output,
+		PoiTreeBounds const & parent, PoiIndex const & index, MappedFile const & file);
+bool readPoiBoxNodes(CodedInputStream & input, PoiTreeBounds const & parent,
+		PoiTreeBounds::Content & output, PoiIndex const & index, MappedFile const & file)
+{
+	LDMessage<OSMAND_FIXED32> inputManager(input);
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndPoiBox::kSubBoxesFieldNumber:
+		{
+			PoiTreeBounds node;
+			if (!readPoiBoxBase(input, node, parent, index, file)) {
+				return false;
+			}
+			output.bounds.push_back(std::move(node));
+			break;
+		}
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	return true;
+}
+
+// Only the box itself. Sub boxes and amenities are read when it is visited.
+bool readPoiBoxBase(CodedInputStream & input, PoiTreeBounds & output,
+		PoiTreeBounds const & parent, PoiIndex const & index, MappedFile const & file)
+{
+	uint32_t lPos = input.TotalBytesRead();
+	LDMessage<OSMAND_FIXED32> inputManager(input);
+	uint32_t dataOffset = 0;
+	bool subBoxes = false;
+	int32_t dx = 0;
+	int32_t dy = 0;
+	uint32_t dz = 0;
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		// Tile relative to the parent one
+		case OsmAndPoiBox::kZoomFieldNumber:
+			readUInt32(input, dz);
+			break;
+		case OsmAndPoiBox::kLeftFieldNumber:
+			readSint32(input, dx);
+			break;
+		case OsmAndPoiBox::kTopFieldNumber:
+			readSint32(input, dy);
+			break;
+		case OsmAndPoiBox::kCategoriesFieldNumber:
+			readPoiCategories(input, output.categories);
+			break;
+		case OsmAndPoiBox::kSubBoxesFieldNumber:
+			subBoxes = true;
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		case OsmAndPoiBox::kShiftToDataFieldNumber:
+			readInt(input, dataOffset);
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // end of while
+
+	output.zoom = parent.zoom + dz;
+	output.x = dx + (parent.x << dz);
+	output.y = dy + (parent.y << dz);
+	int shift = 31 - output.zoom;
+	uint64_t left = (uint64_t) output.x << shift;
+	uint64_t top = (uint64_t) output.y << shift;
+	uint64_t right = std::min(((uint64_t) output.x + 1) << shift, (uint64_t) INT_MAX + 1) - 1;
+	uint64_t bottom = std::min(((uint64_t) output.y + 1) << shift, (uint64_t) INT_MAX + 1) - 1;
+	output.Box(bbox_t(point_t(left, top), point_t(right, bottom)));
+
+	if (!subBoxes && dataOffset == 0)
+		return true;
+	uint32_t dataPos = dataOffset == 0 ? 0 : index.filePointer + dataOffset;
+	output.ContentReader([lPos, subBoxes, dataPos, &index, &file](PoiTreeBounds const & node, PoiTreeBounds::Content & content)
+			{
+		CodedInputStream input(file.Data(), file.StreamSize());
+		input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+		if (subBoxes) {
+			input.Seek(lPos); // Positions are absolute inside the mapped file
+			readPoiBoxNodes(input, node, content, index, file);
+		}
+		if (dataPos != 0) {
+			input.Seek(dataPos);
+			readPoiData(input, content.amenities, index);
+		}
+			});
+	return true;
+}
+
+// Root boxes follow each other from pos to the end of the index.
+bool readPoiRootBoxes(CodedInputStream & input, PoiTreeBounds const & root,
+		PoiTreeBounds::Content & output, PoiIndex const & index, MappedFile const & file)
+{
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndPoiIndex::kBoxesFieldNumber:
+		{
+			PoiTreeBounds node;
+			if (!readPoiBoxBase(input, node, root, index, file)) {
+				return false;
+			}
+			output.bounds.push_back(std::move(node));
+			break;
+		}
+		case OsmAndPoiIndex::kPoiDataFieldNumber:
+			// Fast end
+			input.Skip(input.BytesUntilLimit());
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	return true;
+}
+
+// Also used by address indexes
+bool readTileBox(CodedInputStream & input, bbox_t & output)
+{
+	LDMessage<> inputManager(input);
+	uint32_t left = 0, right = 0, top = 0, bottom = 0;
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndTileBox::kLeftFieldNumber:
+			readUInt32(input, left);
+			break;
+		case OsmAndTileBox::kRightFieldNumber:
+			readUInt32(input, right);
+			break;
+		case OsmAndTileBox::kTopFieldNumber:
+			readUInt32(input, top);
+			break;
+		case OsmAndTileBox::kBottomFieldNumber:
+			readUInt32(input, bottom);
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	output = bbox_t(point_t(left, top), point_t(right, bottom));
+	return true;
+}
+
+bool readPoiCategoryTable(CodedInputStream & input, PoiIndex & output)
+{
+	LDMessage<> inputManager(input);
+	std::string category;
+	std::vector<std::string> subtypes;
+	int tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndCategoryTable::kCategoryFieldNumber:
+			WireFormatLite::ReadString(&input, &category);
+			break;
+		case OsmAndCategoryTable::kSubcategoriesFieldNumber:
+		{
+			std::string s;
+			WireFormatLite::ReadString(&input, &s);
+			subtypes.push_back(std::move(s));
+			break;
+		}
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	output.categoryNames.push_back(std::move(category));
+	output.subtypeNames.push_back(std::move(subtypes));
+	return true;
+}
+
+bool readPoiIndex(CodedInputStream & input, PoiIndex & output,
+		MappedFile const & file)
+{
+	LDMessage<OSMAND_FIXED32> inputManager(input);
+	output.filePointer = input.TotalBytesRead();
+	output.length = input.BytesUntilLimit();
+	uint32_t boxesPos = 0;
+	for (;;)
+	{
+		uint32_t pos = input.TotalBytesRead();
+		uint32_t tag = input.ReadTag();
+		if (tag == 0) {
+			break;
+		}
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndPoiIndex::kNameFieldNumber:
+			WireFormatLite::ReadString(&input, &output.name);
+			break;
+		case OsmAndPoiIndex::kBoundariesFieldNumber:
+		{
+			bbox_t box;
+			readTileBox(input, box);
+			output.root.Box(box);
+			break;
+		}
+		case OsmAndPoiIndex::kCategoriesTableFieldNumber:
+			readPoiCategoryTable(input, output);
+			break;
+		case OsmAndPoiIndex::kBoxesFieldNumber:
+		case OsmAndPoiIndex::kPoiDataFieldNumber:
+			// Fast end
+			boxesPos = pos;
+			input.Skip(input.BytesUntilLimit());
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // end of while
+
+	if (boxesPos == 0)
+		return true;
+	// Lazy read of root boxes
+	uint32_t end = output.filePointer + output.length;
+	PoiIndex const & index = output;
+	output.root.ContentReader([boxesPos, end, &index, &file](PoiTreeBounds const & root, PoiTreeBounds::Content & content)
+			{
+		CodedInputStream input(file.Data(), file.StreamSize());
+		input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+		input.Seek(boxesPos); // Positions are absolute inside the mapped file
+		CodedInputStream::Limit old = input.PushLimit(end - boxesPos);
+		readPoiRootBoxes(input, root, content, index, file);
+		input.PopLimit(old);
+			});
+	return true;
+}
@@ -2,6 +2,8 @@
 #include "MapIndex.hpp"
 #include "binaryRead.h"
 #include "multipolygons.h"
+#include "SpatialDirectory.hpp"
+#include "SortedIdSet.hpp"
 
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -14,6 +16,10 @@
 #include <boost/geometry/algorithms/expand.hpp>
 
 #include "Logging.h"
+#include "ElapsedTimer.h"
+
+#include <atomic>
+#include <thread>
 
 #if defined(WIN32)
 #undef min
@@ -27,15 +33,89 @@ using google::protobuf::internal::WireFormatLite;
 static int zoomForBaseRouteRendering  = 14;
 static int detailedZoomStart = 13;
 static int zoomOnlyForBasemaps  = 11;
-std::map< std::string, BinaryMapFile* > openFiles;
-OsmAndStoredIndex* cache = NULL;
+// Current snapshot. The lock is held only to copy or replace the pointer.
+static MapFilesSnapshot_pointer mapFiles(new MapFilesSnapshot);
+static std::mutex mapFilesLock;
+// Opening and closing files make the next snapshot one at a time.
+static std::mutex mapFilesWriting;
+
+MapFilesSnapshot_pointer currentMapFiles()
+{
+	std::lock_guard<std::mutex> lock(mapFilesLock);
+	return mapFiles;
+}
+
+// Copy of the current files to change. Caller must hold mapFilesWriting.
+static SHARED_PTR<MapFilesSnapshot> nextMapFiles()
+{
+	MapFilesSnapshot_pointer current = currentMapFiles();
+	SHARED_PTR<MapFilesSnapshot> next(new MapFilesSnapshot);
+	next->files = current->files;
+	next->deltas = current->deltas;
+	return next;
+}
+
+// Each file hides the ids of the deltas newer than it over the same base.
+// Names that are not open are skipped.
+static void buildOverlays(MapFilesSnapshot & next)
+{
+	std::vector<bool> fresh;
+	std::map<std::string, std::vector<std::string> >::const_iterator base = next.deltas.begin();
+	for (; base != next.deltas.end(); base++) {
+		FileOverlay newer;
+		for (size_t d = base->second.size(); d-- > 0; ) {
+			MapFilesSnapshot::Files_t::const_iterator file = next.files.find(base->second[d]);
+			if (file == next.files.end())
+				continue;
+			BinaryMapFile const * delta = file->second.get();
+			FileOverlay & overlay = next.overlays[delta];
+			overlay = newer;
+			overlay.delta = true;
+			newer.hiddenMap.insert(delta->deltaMapIds.sorted(), fresh);
+			newer.hiddenRoute.insert(delta->deltaRouteIds.sorted(), fresh);
+		}
+		MapFilesSnapshot::Files_t::const_iterator file = next.files.find(base->first);
+		if (file != next.files.end()) {
+			next.overlays[file->second.get()] = newer;
+		}
+	}
+}
+
+// Caller must hold mapFilesWriting.
+static void publishMapFiles(SHARED_PTR<MapFilesSnapshot> const & next)
+{
+	next->directory.rebuild(next->files);
+	buildOverlays(*next);
+	MapFilesSnapshot_pointer previous;
+	{
+		std::lock_guard<std::mutex> lock(mapFilesLock);
+		previous = mapFiles;
+		mapFiles = next;
+	}
+	// Files only in previous are closed here if no query uses them
+}
+// Index cache of the Java side. The lock is held only to copy or replace
+// the pointer: files being opened keep the cache they started with.
+static SHARED_PTR<OsmAndStoredIndex const> cache;
+static std::mutex cacheLock;
+
+static SHARED_PTR<OsmAndStoredIndex const> currentCache()
+{
+	std::lock_guard<std::mutex> lock(cacheLock);
+	return cache;
+}
 
 bool readMapIndex(CodedInputStream & input, MapIndex & output,
-		int fd);
+		MappedFile const & file);
 bool readRoutingIndex(CodedInputStream & input, RoutingIndex & output,
-		int fd);
+		MappedFile const & file);
+bool readPoiIndex(CodedInputStream & input, PoiIndex & output,
+		MappedFile const & file);
+bool readAddressIndex(CodedInputStream & input, AddressIndex & output,
+		MappedFile const & file);
+bool readTransportIndex(CodedInputStream & input, TransportIndex & output,
+		MappedFile const & file);
 
-typedef std::vector<std::string> StringTable_t;
 bool readStringTable(CodedInputStream & input, StringTable_t & list)
 {
 	LDMessage<> inputManager(input);
@@ -82,45 +162,50 @@ bool checkObjectBounds(SearchQuery* q, MapDataObject* o) {
 	return false;
 }
 
-typedef UNORDERED(set)<long long> IDS_SET;
-
-void readMapObjectsForRendering(SearchQuery * q, std::vector<MapDataObject*> & basemapResult, std::vector<MapDataObject*>& tempResult,
+void readMapObjectsForRendering(SearchQuery * q, MapFilesSnapshot const & mapFiles,
+		std::vector<MapDataObject*> & basemapResult, std::vector<MapDataObject*>& tempResult,
 		std::vector<MapDataObject*>& coastLines, std::vector<MapDataObject*>& basemapCoastLines,
 		int& count, bool& basemapExists, int& renderRouteDataFile, bool skipDuplicates, int& renderedState) {
 	using boost::range::for_each;
-	if (skipDuplicates) {
-		// override it for now
-		// TODO skip duplicates doesn't work correctly with basemap ?
-		skipDuplicates = false;
-	}
-	std::map<std::string, BinaryMapFile*>::const_iterator i = openFiles.begin();
-	for (; i != openFiles.end() && !q->publisher->isCancelled(); i++) {
-		BinaryMapFile const * file = i->second;
-		basemapExists |= file->isBasemap();
-	}
-	IDS_SET ids;
-	i = openFiles.begin();
-	for (; i != openFiles.end() && !q->publisher->isCancelled(); i++) {
-		BinaryMapFile* file = i->second;
+	static uint32_t const coastlineId = internTagValue("natural", "coastline");
+	basemapExists |= mapFiles.directory.hasBasemap();
+	bbox_t qbox(point_t(q->left, q->top), point_t(q->right, q->bottom));
+	std::vector<BinaryMapFile*> files;
+	mapFiles.directory.queryMapFiles(qbox, files);
+	// A basemap object has the id of the detailed one it generalizes, and
+	// basemap results may be dropped later, so each kind has its own ids.
+	SortedIdSet ids;
+	SortedIdSet basemapIds;
+	std::vector<long long> batchIds;
+	std::vector<bool> fresh;
+	std::vector<BinaryMapFile*>::const_iterator i = files.begin();
+	for (; i != files.end() && !q->cancelled(); i++) {
+		BinaryMapFile* file = *i;
 		if (q->req != NULL) {
 			q->req->clearState();
 		}
 		q->publisher->result.clear();
 		if((renderRouteDataFile == 1 || q->zoom < zoomOnlyForBasemaps) && !file->isBasemap()) {
 			continue;
-		} else if (!q->publisher->isCancelled()) {
-			bool basemap = i->second->isBasemap();
-			for_each(file->mapIndexes, [&q](MapIndex const * index){ index->query(*q); });
-			std::vector<MapDataObject*>::const_iterator r = q->publisher->result.begin();
-			tempResult.reserve((size_t) (q->publisher->result.size() + tempResult.size()));
-
-			for (; r != q->publisher->result.end(); r++) {				
-				if (skipDuplicates && (*r)->id > 0) {
-					if (ids.find((*r)->id) != ids.end()) {
-						continue;
-					}
-					ids.insert((*r)->id);
+		} else if (!q->cancelled()) {
+			bool basemap = file->isBasemap();
+			FileOverlay const * overlay = mapFiles.overlay(file);
+			for_each(file->mapIndexes, [&q, overlay](MapIndex const * index){ index->query(*q, overlay); });
+			std::vector<MapDataObject*> const & found = q->publisher->result;
+			tempResult.reserve((size_t) (found.size() + tempResult.size()));
+			if (skipDuplicates) {
+				batchIds.clear();
+				for (size_t k = 0; k < found.size(); k++) {
+					batchIds.push_back(found[k]->id);
+				}
+				(basemap ? basemapIds : ids).insert(batchIds, fresh);
+			}
+
+			for (size_t k = 0; k < found.size(); k++) {
+				if (skipDuplicates && !fresh[k]) {
+					continue;
 				}
+				std::vector<MapDataObject*>::const_iterator r = found.begin() + k;
 				// TODO What this check means?
 				if(basemap) {
 					if(renderedState % 2 == 0 && checkObjectBounds(q, *r)) {
@@ -133,7 +218,7 @@ void readMapObjectsForRendering(SearchQuery * q, std::vector<MapDataObject*> & b
 				}
 
 				count++;
-				if ((*r)->contains("natural", "coastline")) {
+				if ((*r)->contains(coastlineId)) {
 					if (basemap) {
 						basemapCoastLines.push_back(*r);
 					} else {
@@ -154,72 +239,77 @@ void readMapObjectsForRendering(SearchQuery * q, std::vector<MapDataObject*> & b
 }
 
 void convertRouteDataObjecToMapObjects(SearchQuery* q, RouteDataObjects_t const & list,
-		std::vector<MapDataObject*>& tempResult, bool skipDuplicates, IDS_SET& ids, int& renderedState) {
-	RouteDataObjects_t::const_iterator rIterator = list.begin();
+		std::vector<MapDataObject*>& tempResult, bool skipDuplicates, SortedIdSet& ids, int& renderedState) {
+	std::vector<bool> fresh;
+	if (skipDuplicates) {
+		std::vector<long long> batchIds;
+		batchIds.reserve(list.size());
+		for (size_t k = 0; k < list.size(); k++) {
+			batchIds.push_back(list[k] == NULL ? 0 : list[k]->id);
+		}
+		ids.insert(batchIds, fresh);
+	}
 	tempResult.reserve((size_t) (list.size() + tempResult.size()));
-	for (; rIterator != list.end(); rIterator++) {
-		RouteDataObject_pointer r = (*rIterator);
+	for (size_t k = 0; k < list.size(); k++) {
+		RouteDataObject_pointer const & r = list[k];
 		if(r == NULL) {
 			continue;
 		}
-
-		if (skipDuplicates && r->id > 0) {
-			if (ids.find(r->id) != ids.end()) {
-				continue;
-			}
-			ids.insert(r->id);
+		if (skipDuplicates && !fresh[k]) {
+			continue;
 		}
-		MapDataObject* obj = new MapDataObject;
-		bool add = true;
-		std::vector<uint32_t>::const_iterator typeIt = r->types.begin();
+		MapDataObject* obj = q->publisher->arena.create();
+		RouteTypes_t::const_iterator typeIt = r->types.begin();
 		for (; typeIt != r->types.end(); typeIt++) {
 			uint32_t k = (*typeIt);
 			if (k < r->region->decodingRules.size()) {
 				tag_value const & t = r->region->decodingRules[k];
 				if (t.first == "highway" || t.first == "route" || t.first == "railway" || t.first == "aeroway"
 						|| t.first == "aerialway") {
-					obj->types.push_back(t);
+					obj->types.pushId(r->region->decodingIds[k]);
 				} else {
-					obj->additionalTypes.push_back(t);
+					obj->additionalTypes.pushId(r->region->decodingIds[k]);
 				}
 			}
 		}
-		if (add) {
-			for (uint32_t s = 0; s < r->pointsX.size(); s++) {
-				obj->points.push_back(std::pair<int, int>(r->pointsX[s], r->pointsY[s]));
-			}
-			obj->id = r->id;
-			UNORDERED(map)<int, std::string >::const_iterator nameIterator = r->names.begin();
-			for (; nameIterator != r->names.end(); nameIterator++) {
-				obj->objectNames[r->region->decodingRules[nameIterator->first].first] = nameIterator->second;
-			}
-			obj->area = false;
-			if(renderedState < 2 && checkObjectBounds(q, obj)) {
-				renderedState |= 2;
-			}
-			tempResult.push_back(obj);
-		} else {
-			delete obj;
+		obj->points.reserve(r->pointsX.size());
+		for (uint32_t s = 0; s < r->pointsX.size(); s++) {
+			obj->points.push_back(std::pair<int, int>(r->pointsX[s], r->pointsY[s]));
+		}
+		obj->id = r->id;
+		// Same string table as the road, only the tags are translated
+		obj->stringTable = r->stringTable;
+		obj->namesIds.reserve(r->namesCount());
+		for (size_t n = 0; n < r->namesCount(); n++) {
+			obj->namesIds.push_back(std::make_pair(r->region->nameIds[r->nameTag(n)], r->namesIds[n].second));
 		}
+		obj->area = false;
+		if(renderedState < 2 && checkObjectBounds(q, obj)) {
+			renderedState |= 2;
+		}
+		tempResult.push_back(obj);
 	}
 }
 
-void readRouteDataAsMapObjects(SearchQuery* q, BinaryMapFile* file, std::vector<MapDataObject*>& tempResult,
-		bool skipDuplicates, IDS_SET& ids, int& renderedState) {
-	std::vector<RoutingIndex*>::iterator routeIndex = file->routingIndexes.begin();
-	for (; routeIndex != file->routingIndexes.end(); routeIndex++) {
-		if (q->publisher->isCancelled()) {
+// subregions are the directory entries of one routing index
+void readRouteDataAsMapObjects(SearchQuery* q, std::vector<SpatialDirectory::Entry const *> const & subregions,
+		FileOverlay const * overlay,
+		std::vector<MapDataObject*>& tempResult, bool skipDuplicates, SortedIdSet& ids, int& renderedState) {
+	bbox_t qbox(point_t(q->left, q->top), point_t(q->right, q->bottom));
+	RouteDataObjects_t temp;
+	CancellableSink<RouteDataObject_pointer, SearchQuery> sink(temp, *q);
+	for (size_t s = 0; s < subregions.size(); s++) {
+		if (!subregions[s]->subregion->stream(qbox, sink))
 			break;
-		}
-		bbox_t qbox(point_t(q->left, q->top), point_t(q->right, q->bottom));
-		RouteDataObjects_t temp;
-		(*routeIndex)->query(qbox, (q->zoom <= zoomForBaseRouteRendering), temp);
-		convertRouteDataObjecToMapObjects(q, temp, tempResult, skipDuplicates, ids, renderedState);
 	}
+	applyRouteOverlay(overlay, temp);
+	convertRouteDataObjecToMapObjects(q, temp, tempResult, skipDuplicates, ids, renderedState);
 }
 
 ResultPublisher* searchObjectsForRendering(SearchQuery * q, bool skipDuplicates, int renderRouteDataFile,
 		std::string const & msgNothingFound, int& renderedState) {
+	MapFilesSnapshot_pointer mapFiles = currentMapFiles();
+	nodeCacheTick();
 	int count = 0;
 	std::vector<MapDataObject*> basemapResult;
 	std::vector<MapDataObject*> tempResult;
@@ -227,16 +317,24 @@ ResultPublisher* searchObjectsForRendering(SearchQuery * q, bool skipDuplicates,
 	std::vector<MapDataObject*> basemapCoastLines;
 
 	bool basemapExists = false;
-	readMapObjectsForRendering(q, basemapResult, tempResult, coastLines, basemapCoastLines, count,
+	readMapObjectsForRendering(q, *mapFiles, basemapResult, tempResult, coastLines, basemapCoastLines, count,
 			basemapExists, renderRouteDataFile, skipDuplicates, renderedState);
 
 	bool objectsFromMapSectionRead = tempResult.size() > 0;
 	bool objectsFromRoutingSectionRead = false;
 	if (renderRouteDataFile >= 0 && q->zoom >= zoomOnlyForBasemaps) {
-		IDS_SET ids;
-		std::map<std::string, BinaryMapFile*>::const_iterator i = openFiles.begin();
-		for (; i != openFiles.end() && !q->publisher->isCancelled(); i++) {
-			BinaryMapFile* file = i->second;
+		SortedIdSet ids;
+		bbox_t qbox(point_t(q->left, q->top), point_t(q->right, q->bottom));
+		std::vector<SpatialDirectory::Entry const *> entries;
+		mapFiles->directory.queryRouting(qbox, q->zoom <= zoomForBaseRouteRendering, entries);
+		// Entries come grouped by file and routing index
+		std::vector<SpatialDirectory::Entry const *>::const_iterator i = entries.begin();
+		while (i != entries.end() && !q->cancelled()) {
+			std::vector<SpatialDirectory::Entry const *>::const_iterator end = i;
+			while (end != entries.end() && (*end)->routingIndex == (*i)->routingIndex) {
+				end++;
+			}
+			BinaryMapFile const * file = (*i)->file;
 			// false positive case when we have 2 sep maps Country-roads & Country
 			if(file->mapIndexes.size() == 0 || renderRouteDataFile == 1) {
 				if (q->req != NULL) {
@@ -244,20 +342,18 @@ ResultPublisher* searchObjectsForRendering(SearchQuery * q, bool skipDuplicates,
 				}
 				q->publisher->result.clear();
 				uint sz = tempResult.size();
-				readRouteDataAsMapObjects(q, file, tempResult, skipDuplicates, ids, renderedState);
+				std::vector<SpatialDirectory::Entry const *> subregions(i, end);
+				readRouteDataAsMapObjects(q, subregions, mapFiles->overlay(file), tempResult, skipDuplicates, ids, renderedState);
 				objectsFromRoutingSectionRead = tempResult.size() != sz;
 			}
+			i = end;
 		}
 		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Route objects %d", tempResult.size());
 	}
 
 	// sort results/ analyze coastlines and publish back to publisher
-	if (q->publisher->isCancelled()) {
-		//deleteObjects(coastLines);
-		//deleteObjects(tempResult);
-		//deleteObjects(basemapCoastLines);
-		//deleteObjects(basemapResult);
-	} else {
+	// Objects made here live in the publisher arena, a cancelled search frees them with it.
+	if (!q->cancelled()) {
 		bool ocean = q->ocean;
 		bool land = q->mixed;
 		bool addBasemapCoastlines = true;
@@ -267,7 +363,7 @@ ResultPublisher* searchObjectsForRendering(SearchQuery * q, bool skipDuplicates,
 		bool detailedLandData = q->zoom >= 14 && tempResult.size() > 0 && objectsFromMapSectionRead;
 		if (!coastLines.empty()) {
 			bool coastlinesWereAdded = processCoastlines(coastLines, q->left, q->right, q->bottom, q->top, q->zoom,
-					basemapCoastLines.empty(), true, tempResult);
+					basemapCoastLines.empty(), true, tempResult, q->publisher->arena);
 			addBasemapCoastlines = (!coastlinesWereAdded && !detailedLandData) || q->zoom <= zoomOnlyForBasemaps;
 		} else {
 			addBasemapCoastlines = !detailedLandData;
@@ -275,17 +371,13 @@ ResultPublisher* searchObjectsForRendering(SearchQuery * q, bool skipDuplicates,
 		bool fillCompleteArea = false;
 		if (addBasemapCoastlines) {
 			bool coastlinesWereAdded = processCoastlines(basemapCoastLines, q->left, q->right, q->bottom, q->top, q->zoom,
-					true, true, tempResult);
+					true, true, tempResult, q->publisher->arena);
 			fillCompleteArea = !coastlinesWereAdded;
 		}
-		// processCoastlines always create new objects
-		// FIXME NOW WE HAVE MEMORY LEAKS
-		//deleteObjects(basemapCoastLines);
-		//deleteObjects(coastLines);
 		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info,"Land %d ocean %d fillCompleteArea %d", 
 							land, ocean, fillCompleteArea);
 		if (fillCompleteArea) {
-			MapDataObject* o = new MapDataObject();
+			MapDataObject* o = q->publisher->arena.create();
 			o->points.push_back(int_pair(q->left, q->top));
 			o->points.push_back(int_pair(q->right, q->top));
 			o->points.push_back(int_pair(q->right, q->bottom));
@@ -303,16 +395,15 @@ ResultPublisher* searchObjectsForRendering(SearchQuery * q, bool skipDuplicates,
 		if (emptyData || basemapMissing) {
 			// message
 			// avoid overflow int errors
-			MapDataObject* o = new MapDataObject();
+			MapDataObject* o = q->publisher->arena.create();
 			o->points.push_back(int_pair(q->left + (q->right - q->left) / 2, q->top + (q->bottom - q->top) / 2));
 			o->types.push_back(tag_value("natural", "coastline"));
-			o->objectNames["name"] = msgNothingFound;
+			static uint32_t const nameId = internTagValue("name", "");
+			o->setName(nameId, msgNothingFound);
 			tempResult.push_back(o);
 		}
 		if (q->zoom <= zoomOnlyForBasemaps || emptyData || (objectsFromRoutingSectionRead && q->zoom < detailedZoomStart)) {
 			tempResult.insert(tempResult.end(), basemapResult.begin(), basemapResult.end());
-		} else {
-			//deleteObjects(basemapResult);
 		}
 		q->publisher->result.clear();
 		q->publisher->publish(tempResult);
@@ -321,6 +412,9 @@ ResultPublisher* searchObjectsForRendering(SearchQuery * q, bool skipDuplicates,
 				q->numberOfReadSubtrees, q->numberOfAcceptedSubtrees, q->numberOfVisitedObjects, q->numberOfAcceptedObjects,
 				q->publisher->result.size());
 	}
+	if (nodeCacheOverLimit()) {
+		trimNodeCache();
+	}
 	return q->publisher;
 }
 
@@ -328,13 +422,39 @@ ResultPublisher* searchObjectsForRendering(SearchQuery * q, bool skipDuplicates,
 ///// End MapIndex
 
 bool closeBinaryMapFile(std::string const & inputName) {
-	std::map<std::string, BinaryMapFile*>::iterator iterator;
-	if ((iterator = openFiles.find(inputName)) != openFiles.end()) {
-		delete iterator->second;
-		openFiles.erase(iterator);
-		return true;
+	std::lock_guard<std::mutex> writing(mapFilesWriting);
+	SHARED_PTR<MapFilesSnapshot> next = nextMapFiles();
+	if (next->files.find(inputName) == next->files.end()) {
+		return false;
 	}
-	return false;
+	// A base takes its deltas with it, and they take theirs
+	std::vector<std::string> closing(1, inputName);
+	std::map<std::string, std::vector<std::string> >::iterator base;
+	while (!closing.empty()) {
+		std::string name = closing.back();
+		closing.pop_back();
+		next->files.erase(name);
+		base = next->deltas.find(name);
+		if (base != next->deltas.end()) {
+			closing.insert(closing.end(), base->second.begin(), base->second.end());
+			next->deltas.erase(base);
+		}
+	}
+	// Closed deltas leave every list they are in
+	MapFilesSnapshot::Files_t const & files = next->files;
+	for (base = next->deltas.begin(); base != next->deltas.end(); ) {
+		std::vector<std::string> & names = base->second;
+		names.erase(std::remove_if(names.begin(), names.end(), [&files](std::string const & name) {
+			return files.find(name) == files.end();
+		}), names.end());
+		if (names.empty()) {
+			base = next->deltas.erase(base);
+		} else {
+			base++;
+		}
+	}
+	publishMapFiles(next);
+	return true;
 }
 
 bool initMapFilesFromCache(std::string const & inputName) {
@@ -349,20 +469,148 @@ bool initMapFilesFromCache(std::string const & inputName) {
 		return false;
 	}
 	FileInputStream input(fileDescriptor);
+	input.SetCloseOnDelete(true);
 	CodedInputStream cis(&input);
 	cis.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
-	OsmAndStoredIndex* c = new OsmAndStoredIndex();
+	SHARED_PTR<OsmAndStoredIndex> c(new OsmAndStoredIndex());
 	if(c->MergeFromCodedStream(&cis)){
-		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Native Cache file initialized %s", inputName.c_str());
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Native Cache file initialized %s (%d files)",
+				inputName.c_str(), c->fileindex_size());
+		std::lock_guard<std::mutex> lock(cacheLock);
 		cache = c;
-		for (int i = 0; i < cache->fileindex_size(); i++) {
-			FileIndex fi = cache->fileindex(i);
-		}
 		return true;
 	}
 	return false;
 }
 
+// The cache keeps names without their directory
+static bool isFileNamed(std::string const & path, std::string const & fileName)
+{
+	if (path.length() < fileName.length()
+			|| path.compare(path.length() - fileName.length(), fileName.length(), fileName) != 0)
+		return false;
+	if (path.length() == fileName.length())
+		return true;
+	char separator = path[path.length() - fileName.length() - 1];
+	return separator == '/' || separator == '\\';
+}
+
+// Cached entry is valid only for exactly the same file. It lives as long as stored.
+FileIndex const * findCachedFile(OsmAndStoredIndex const * stored, std::string const & inputName,
+		BinaryMapFile const & file)
+{
+	if (stored == NULL) {
+		return NULL;
+	}
+	for (int i = 0; i < stored->fileindex_size(); i++) {
+		FileIndex const & fi = stored->fileindex(i);
+		// Java side stores milliseconds. Some file systems only keep seconds.
+		if (isFileNamed(inputName, fi.filename()) && (uint64_t) fi.size() == file.fileSize
+				&& (uint64_t) fi.datemodified() / 1000 == file.dateModified / 1000
+				&& (uint32_t) fi.version() == MAP_VERSION) {
+			return &fi;
+		}
+	}
+	return NULL;
+}
+
+void initMapIndexFromCache(MapPart const & part, MapIndex & output, MappedFile const & file);
+void initRoutingIndexFromCache(RoutingPart const & part, RoutingIndex & output, MappedFile const & file);
+
+// Only the top of the trees comes from cache. Everything else is read lazily as usual.
+void initMapStructureFromCache(FileIndex const & fi, BinaryMapFile & file)
+{
+	file.version = fi.version();
+	file.dateCreated = fi.datemodified();
+	for (int i = 0; i < fi.mapindex_size(); i++) {
+		MapIndex * mapIndex = new MapIndex();
+		initMapIndexFromCache(fi.mapindex(i), *mapIndex, file.mapped);
+		file.basemap = file.basemap || mapIndex->name.find("basemap") != std::string::npos;
+		file.mapIndexes.push_back(mapIndex);
+	}
+	for (int i = 0; i < fi.routingindex_size(); i++) {
+		RoutingIndex * routingIndex = new RoutingIndex();
+		initRoutingIndexFromCache(fi.routingindex(i), *routingIndex, file.mapped);
+		file.routingIndexes.push_back(routingIndex);
+	}
+}
+
+bool saveMapFilesCache(std::string const & outputName) {
+	GOOGLE_PROTOBUF_VERIFY_VERSION;
+	OsmAndStoredIndex stored;
+	stored.set_version(MAP_VERSION);
+	stored.set_datecreated(time(NULL) * 1000ll);
+	{
+		MapFilesSnapshot_pointer mapFiles = currentMapFiles();
+		MapFilesSnapshot::Files_t::const_iterator it = mapFiles->files.begin();
+		for (; it != mapFiles->files.end(); it++) {
+			BinaryMapFile const * file = it->second.get();
+			FileIndex * fi = stored.add_fileindex();
+			std::string::size_type slash = file->inputName.find_last_of("/\\");
+			fi->set_filename(slash == std::string::npos ? file->inputName : file->inputName.substr(slash + 1));
+			fi->set_size(file->fileSize);
+			fi->set_datemodified(file->dateModified);
+			fi->set_version(file->version);
+			for (size_t i = 0; i < file->mapIndexes.size(); i++) {
+				MapIndex const * mi = file->mapIndexes[i];
+				MapPart * mp = fi->add_mapindex();
+				mp->set_name(mi->name);
+				mp->set_offset(mi->filePointer);
+				mp->set_size(mi->length);
+				for (size_t j = 0; j < mi->levels.size(); j++) {
+					MapRoot const & mr = mi->levels[j];
+					MapLevel * ml = mp->add_levels();
+					ml->set_left(mr.left);
+					ml->set_right(mr.right);
+					ml->set_top(mr.top);
+					ml->set_bottom(mr.bottom);
+					ml->set_minzoom(mr.minZoom);
+					ml->set_maxzoom(mr.maxZoom);
+					ml->set_offset(mr.filePointer);
+					ml->set_size(mr.length);
+				}
+			}
+			for (size_t i = 0; i < file->routingIndexes.size(); i++) {
+				RoutingIndex const * ri = file->routingIndexes[i];
+				RoutingPart * rp = fi->add_routingindex();
+				rp->set_name(ri->name);
+				rp->set_offset(ri->filePointer);
+				rp->set_size(ri->length);
+				for (int base = 0; base < 2; base++) {
+					RoutingIndex::regions_t const & regions = base ? ri->basesubregions : ri->subregions;
+					for (size_t j = 0; j < regions.size(); j++) {
+						RouteSubregion const & sub = regions[j];
+						RoutingSubregion * rs = rp->add_subregions();
+						rs->set_left(sub.left);
+						rs->set_right(sub.right);
+						rs->set_top(sub.top);
+						rs->set_bottom(sub.bottom);
+						rs->set_offset(sub.filePointer);
+						rs->set_size(sub.length);
+						rs->set_shiftodata(sub.shiftToData);
+						rs->set_basemap(base == 1);
+					}
+				}
+			}
+		}
+	}
+#if defined(_WIN32)
+	int fileDescriptor = open(outputName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+#else
+	int fileDescriptor = open(outputName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	if (fileDescriptor < 0) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file could not be open to write : %s", outputName.c_str());
+		return false;
+	}
+	bool ok = stored.SerializeToFileDescriptor(fileDescriptor);
+	close(fileDescriptor);
+	if (!ok) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Cache file could not be written : %s", outputName.c_str());
+	}
+	return ok;
+}
+
 bool initMapStructure(CodedInputStream & input, BinaryMapFile & file)
 {
 	uint32_t tag;
@@ -383,7 +631,7 @@ bool initMapStructure(CodedInputStream & input, BinaryMapFile & file)
 			// We had a problem with the time of life of mapIndex reference pased into lazy reading.
 			// Now we use dynamic memory.
 			MapIndex * mapIndex = new MapIndex();
-			readMapIndex(input, *mapIndex, file.fd);//, false);
+			readMapIndex(input, *mapIndex, file.mapped);//, false);
 			file.basemap = file.basemap || mapIndex->name.find("basemap") != std::string::npos;
 			file.mapIndexes.push_back(std::move(mapIndex));
 			break;
@@ -391,10 +639,31 @@ bool initMapStructure(CodedInputStream & input, BinaryMapFile & file)
 		case OsmAndStructure::kRoutingIndexFieldNumber:
 		{
 			RoutingIndex* routingIndex = new RoutingIndex;
-			readRoutingIndex(input, *routingIndex, file.fd);
+			readRoutingIndex(input, *routingIndex, file.mapped);
 			file.routingIndexes.push_back(routingIndex);
 			break;
 		}
+		case OsmAndStructure::kPoiIndexFieldNumber:
+		{
+			PoiIndex* poiIndex = new PoiIndex;
+			readPoiIndex(input, *poiIndex, file.mapped);
+			file.poiIndexes.push_back(poiIndex);
+			break;
+		}
+		case OsmAndStructure::kAddressIndexFieldNumber:
+		{
+			AddressIndex* addressIndex = new AddressIndex;
+			readAddressIndex(input, *addressIndex, file.mapped);
+			file.addressIndexes.push_back(addressIndex);
+			break;
+		}
+		case OsmAndStructure::kTransportIndexFieldNumber:
+		{
+			TransportIndex* transportIndex = new TransportIndex;
+			readTransportIndex(input, *transportIndex, file.mapped);
+			file.transportIndexes.push_back(transportIndex);
+			break;
+		}
 		case OsmAndStructure::kVersionConfirmFieldNumber:
 			readUInt32(input, versionConfirm);
 			break;
@@ -416,10 +685,47 @@ bool initMapStructure(CodedInputStream & input, BinaryMapFile & file)
 	return true;
 }
 
-BinaryMapFile* initBinaryMapFile(std::string const & inputName) {
-	GOOGLE_PROTOBUF_VERIFY_VERSION;
-	closeBinaryMapFile(inputName);
+// The cache has no POI, address and transport indexes. Their headers are small, read them from the file.
+static bool initSearchStructure(CodedInputStream & input, BinaryMapFile & file)
+{
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndStructure::kPoiIndexFieldNumber:
+		{
+			PoiIndex* poiIndex = new PoiIndex;
+			readPoiIndex(input, *poiIndex, file.mapped);
+			file.poiIndexes.push_back(poiIndex);
+			break;
+		}
+		case OsmAndStructure::kAddressIndexFieldNumber:
+		{
+			AddressIndex* addressIndex = new AddressIndex;
+			readAddressIndex(input, *addressIndex, file.mapped);
+			file.addressIndexes.push_back(addressIndex);
+			break;
+		}
+		case OsmAndStructure::kTransportIndexFieldNumber:
+		{
+			TransportIndex* transportIndex = new TransportIndex;
+			readTransportIndex(input, *transportIndex, file.mapped);
+			file.transportIndexes.push_back(transportIndex);
+			break;
+		}
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}
+	return true;
+}
 
+// Reads file structure without registering it. On failure returns NULL and the reason in error.
+static BinaryMapFile* openBinaryMapFile(std::string const & inputName, std::string & error) {
 #if defined(_WIN32)
 	int fileDescriptor = open(inputName.c_str(), O_RDONLY | O_BINARY);
 	int routeDescriptor = open(inputName.c_str(), O_RDONLY | O_BINARY);
@@ -428,108 +734,237 @@ BinaryMapFile* initBinaryMapFile(std::string const & inputName) {
 	int routeDescriptor = open(inputName.c_str(), O_RDONLY);
 #endif
 	if (fileDescriptor < 0 || routeDescriptor < 0 || routeDescriptor == fileDescriptor) {
-		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File could not be open to read from C : %s", inputName.c_str());
+		if (fileDescriptor >= 0) close(fileDescriptor);
+		if (routeDescriptor >= 0 && routeDescriptor != fileDescriptor) close(routeDescriptor);
+		error = "File could not be open to read from C";
 		return NULL;
 	}
 	BinaryMapFile* mapFile = new BinaryMapFile();
 	mapFile->fd = fileDescriptor;
 
 	mapFile->routefd = routeDescriptor;
-/*** Now we forget cached files. We use our lazy implementation.
-	FileIndex* fo = NULL;
-	if (cache != NULL) {
-		struct stat stat;
-		fstat(fileDescriptor, &stat);
-		for (int i = 0; i < cache->fileindex_size(); i++) {
-			FileIndex const & fi = cache->fileindex(i);
-			if (hasEnding(inputName, fi.filename()) && fi.size() == stat.st_size) {
-				fo = cache->mutable_fileindex(i);
-				break;
-			}
-		}
+	if (!mapFile->mapped.map(fileDescriptor)) {
+		error = "File could not be mapped";
+		delete mapFile;
+		return NULL;
 	}
+	struct stat st;
+	fstat(fileDescriptor, &st);
+	mapFile->fileSize = st.st_size;
+	mapFile->dateModified = st.st_mtime * 1000ll;
+
+	SHARED_PTR<OsmAndStoredIndex const> stored = currentCache();
+	FileIndex const * fo = findCachedFile(stored.get(), inputName, *mapFile);
 	if (fo != NULL)
 	{  // Previously cached
-		mapFile->version = fo->version();
-		mapFile->dateCreated = fo->datemodified();
-		for (int i = 0; i < fo->mapindex_size(); i++) {
-			MapIndex mi;
-			MapPart const & mp = fo->mapindex(i);
-			////mi.filePointer = mp.offset();
-			////mi.length = mp.size();
-			mi.name = mp.name();
-			for (int j = 0; j < mp.levels_size(); j++) {
-				MapLevel const & ml = mp.levels(j);
-				MapRoot mr;
-				mr.bottom = ml.bottom();
-				mr.left = ml.left();
-				mr.right = ml.right();
-				mr.top = ml.top();
-				mr.maxZoom = ml.maxzoom();
-				mr.minZoom = ml.minzoom();
-				mr.filePointer = ml.offset();
-				mr.length = ml.size();
-				mi.levels.push_back(mr);
-			}
-			mapFile->basemap = mapFile->basemap || mi.name.find("basemap") != std::string::npos;
-			mapFile->mapIndexes.push_back(mi);
-		}
-
-		for (int i = 0; i < fo->routingindex_size(); i++) {
-			RoutingIndex *mi = new RoutingIndex();
-			RoutingPart const & mp = fo->routingindex(i);
-			////mi->filePointer = mp.offset();
-			////mi->length = mp.size();
-			mi->name = mp.name();
-			for (int j = 0; j < mp.subregions_size(); j++) {
-				RoutingSubregion const & ml = mp.subregions(j);
-				RouteSubregion mr(mi);
-				mr.bottom = ml.bottom();
-				mr.left = ml.left();
-				mr.right = ml.right();
-				mr.top = ml.top();
-				////mr.mapDataBlock = ml.shiftodata();
-				mr.filePointer = ml.offset();
-				////mr.length = ml.size();
-				if (ml.basemap()) {
-					mi->basesubregions.push_back(mr);
-				} else {
-					mi->subregions.push_back(mr);
-				}
-			}
-			mapFile->routingIndexes.push_back(mi);
-		}
+		initMapStructureFromCache(*fo, *mapFile);
+		CodedInputStream cis(mapFile->mapped.Data(), mapFile->mapped.StreamSize());
+		cis.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+		initSearchStructure(cis, *mapFile);
 		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug, "Native file initialized from cache %s", inputName.c_str());
-	} else { ***/
-		FileInputStream input(fileDescriptor);
-		input.SetCloseOnDelete(false);
-		CodedInputStream cis(&input);
+	}
+	else
+	{
+		CodedInputStream cis(mapFile->mapped.Data(), mapFile->mapped.StreamSize());
 		cis.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
 
 		if (!initMapStructure(cis, *mapFile)) {
-			OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "File not initialised : %s", inputName.c_str());
+			error = "File not initialised";
 			delete mapFile;
 			return NULL;
 		}
-	/***}***/
+	}
 	mapFile->inputName = inputName;
-	openFiles.insert(std::pair<std::string, BinaryMapFile*>(inputName, mapFile));
 	return mapFile;
 }
 
+// A file with the same name is replaced. Queries using it keep it until they end.
+static void registerBinaryMapFile(MapFilesSnapshot & next, BinaryMapFile* mapFile) {
+	next.files[mapFile->inputName] = SHARED_PTR<BinaryMapFile>(mapFile);
+}
+
+BinaryMapFile* initBinaryMapFile(std::string const & inputName) {
+	GOOGLE_PROTOBUF_VERIFY_VERSION;
+	std::string error;
+	BinaryMapFile* mapFile = openBinaryMapFile(inputName, error);
+	if (mapFile == NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "%s : %s", error.c_str(), inputName.c_str());
+		return NULL;
+	}
+	std::lock_guard<std::mutex> writing(mapFilesWriting);
+	SHARED_PTR<MapFilesSnapshot> next = nextMapFiles();
+	registerBinaryMapFile(*next, mapFile);
+	publishMapFiles(next);
+	return mapFile;
+}
+
+std::vector<MapFileInitResult> initBinaryMapFiles(std::vector<std::string> const & inputNames, unsigned int threads) {
+	GOOGLE_PROTOBUF_VERIFY_VERSION;
+	std::vector<MapFileInitResult> results(inputNames.size());
+	std::vector<BinaryMapFile*> files(inputNames.size(), (BinaryMapFile*) NULL);
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threads = std::min(threads, (unsigned int) inputNames.size());
+
+	OsmAnd::ElapsedTimer total;
+	total.Start();
+	// Workers take next file from a shared counter. Each one writes only its own slots.
+	std::atomic<size_t> next(0);
+	auto worker = [&inputNames, &results, &files, &next]()
+			{
+		size_t i;
+		while ((i = next++) < inputNames.size()) {
+			OsmAnd::ElapsedTimer timer;
+			timer.Start();
+			MapFileInitResult & r = results[i];
+			r.inputName = inputNames[i];
+			files[i] = openBinaryMapFile(inputNames[i], r.error);
+			r.ok = files[i] != NULL;
+			r.elapsedMs = timer.GetElapsedMs();
+		}
+			};
+	std::vector<std::thread> pool;
+	for (unsigned int t = 1; t < threads; t++) {
+		pool.push_back(std::thread(worker));
+	}
+	worker();
+	for (size_t t = 0; t < pool.size(); t++) {
+		pool[t].join();
+	}
+
+	// All of them become visible at once.
+	int opened = 0;
+	{
+		std::lock_guard<std::mutex> writing(mapFilesWriting);
+		SHARED_PTR<MapFilesSnapshot> next = nextMapFiles();
+		for (size_t i = 0; i < files.size(); i++) {
+			if (files[i] != NULL) {
+				registerBinaryMapFile(*next, files[i]);
+				opened++;
+			}
+		}
+		publishMapFiles(next);
+	}
+	for (size_t i = 0; i < results.size(); i++) {
+		MapFileInitResult const & r = results[i];
+		if (r.ok) {
+			OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug, "Native file %s initialized in %d ms", r.inputName.c_str(), r.elapsedMs);
+		} else {
+			OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "%s : %s", r.error.c_str(), r.inputName.c_str());
+		}
+	}
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Native files initialized %d of %d in %d ms with %d threads",
+			opened, (int) inputNames.size(), total.GetElapsedMs(), threads);
+	return results;
+}
+
+bool initDeltaMapFile(std::string const & baseName, std::string const & deltaName) {
+	GOOGLE_PROTOBUF_VERIFY_VERSION;
+	std::string error;
+	BinaryMapFile* delta = openBinaryMapFile(deltaName, error);
+	if (delta == NULL) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "%s : %s", error.c_str(), deltaName.c_str());
+		return false;
+	}
+	// Not registered yet, nobody else reads it
+	readDeltaIds(*delta, delta->deltaMapIds, delta->deltaRouteIds);
+
+	std::lock_guard<std::mutex> writing(mapFilesWriting);
+	SHARED_PTR<MapFilesSnapshot> next = nextMapFiles();
+	if (next->files.find(baseName) == next->files.end() || baseName == deltaName) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Base file is not open : %s", baseName.c_str());
+		delete delta;
+		return false;
+	}
+	// A delta has one base, and is not also open as a file of its own
+	if (next->files.find(deltaName) != next->files.end()) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Delta file is already open : %s", deltaName.c_str());
+		delete delta;
+		return false;
+	}
+	next->deltas[baseName].push_back(deltaName);
+	registerBinaryMapFile(*next, delta);
+	publishMapFiles(next);
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Delta %s over %s: %d map and %d route objects",
+			deltaName.c_str(), baseName.c_str(), (int) delta->deltaMapIds.size(), (int) delta->deltaRouteIds.size());
+	return true;
+}
+
 ///////////////
 //// Global access
 void MapQuery(SearchQuery & q/*, MapDataObjects_t & output*/)
 {
+	MapFilesSnapshot_pointer mapFiles = currentMapFiles();
+	nodeCacheTick();
 	using boost::range::for_each;
-	for_each(openFiles, [&q/*, &output*/](std::pair<std::string, BinaryMapFile *> const & fp)
+	bbox_t b(point_t(q.left, q.top), point_t(q.right, q.bottom));
+	std::vector<BinaryMapFile*> files;
+	mapFiles->directory.queryMapFiles(b, files);
+	for_each(files, [&q, &mapFiles/*, &output*/](BinaryMapFile const * file)
 			{
-		BinaryMapFile const * file = fp.second;
-		for_each(file->mapIndexes, [&q/*, &output*/](MapIndex const * index){index->query(q);});
+		FileOverlay const * overlay = mapFiles->overlay(file);
+		for_each(file->mapIndexes, [&q, overlay/*, &output*/](MapIndex const * index){index->query(q, overlay);});
 			});
 }
 
-void RoutingQuery(bbox_t & b, RouteDataObjects_t & output)
+void searchPoi(PoiQuery & q)
+{
+	MapFilesSnapshot_pointer mapFiles = currentMapFiles();
+	if (q.publisher != NULL) {
+		q.publisher->pin(mapFiles);
+	}
+	nodeCacheTick();
+	MapFilesSnapshot::Files_t::const_iterator it = mapFiles->files.begin();
+	for (; it != mapFiles->files.end() && !q.cancelled(); it++) {
+		BinaryMapFile const * file = it->second.get();
+		for (size_t i = 0; i < file->poiIndexes.size(); i++) {
+			file->poiIndexes[i]->query(q);
+		}
+	}
+	if (nodeCacheOverLimit()) {
+		trimNodeCache();
+	}
+}
+
+void searchAddress(AddressQuery & q)
+{
+	std::string prefix = normalizeName(q.prefix);
+	if (prefix.empty()) {
+		return;
+	}
+	MapFilesSnapshot_pointer mapFiles = currentMapFiles();
+	if (q.publisher != NULL) {
+		q.publisher->pin(mapFiles);
+	}
+	size_t found = 0;
+	std::vector<uint32_t> objects;
+	MapFilesSnapshot::Files_t::const_iterator it = mapFiles->files.begin();
+	for (; it != mapFiles->files.end() && found < q.limit && !q.cancelled(); it++) {
+		BinaryMapFile const * file = it->second.get();
+		for (size_t i = 0; i < file->addressIndexes.size() && found < q.limit; i++) {
+			AddressIndex const * index = file->addressIndexes[i];
+			AddressNames_pointer names = index->names();
+			objects.clear();
+			names->find(prefix, q.limit - found, objects);
+			for (size_t o = 0; o < objects.size(); o++) {
+				AddressMatch m = { index, names.get(), NULL, NULL };
+				if (objects[o] < names->cities.size()) {
+					m.city = &names->cities[objects[o]];
+				} else {
+					m.street = &names->streets[objects[o] - names->cities.size()];
+					m.city = &names->cities[m.street->city];
+				}
+				if (q.publisher != NULL) {
+					q.publisher->publish(m);
+				}
+			}
+			found += objects.size();
+		}
+	}
+}
+
+void RoutingQuery(MapFilesSnapshot const & mapFiles, bbox_t & b, RouteDataObjects_t & output)
 {
 	// FIXME To avoid typical errors between subRegion read coordinates and what would really be.
 	// Expand 30 unit around real box.
@@ -539,29 +974,194 @@ void RoutingQuery(bbox_t & b, RouteDataObjects_t & output)
 	b = boost::geometry::make<bbox_t>(b.min_corner().x()-30, b.min_corner().y()-30,
 			b.max_corner().x()+30, b.max_corner().y()+30);
 
-	using boost::range::for_each;
-	for_each(openFiles, [&b, &output](std::pair<std::string, BinaryMapFile *> const & fp)
-			{
-		BinaryMapFile const * file = fp.second;
-		// NO basemap
-		for_each(file->routingIndexes, [&b, &output](RoutingIndex const * index){index->query(b, false, output);});
-			});
+	nodeCacheTick();
+	// NO basemap
+	std::vector<SpatialDirectory::Entry const *> entries;
+	mapFiles.directory.queryRouting(b, false, entries);
+	for (size_t i = 0; i < entries.size(); i++) {
+		size_t from = output.size();
+		entries[i]->subregion->query(b, output);
+		applyRouteOverlay(mapFiles.overlay(entries[i]->file), output, from);
+	}
+	if (nodeCacheOverLimit()) {
+		trimNodeCache();
+	}
 //std::cerr << "RoutingQuery #RDO " << output.size() << std::endl;
 }
 
+void RoutingQuery(bbox_t & b, RouteDataObjects_t & output)
+{
+	RoutingQuery(*currentMapFiles(), b, output);
+}
+
 void RoutingQuery(SearchQuery & q, RouteDataObjects_t & output)
 {
 	bbox_t b(point_t(q.left, q.top), point_t(q.right, q.bottom));
 	RoutingQuery(b, output);
 }
 
+///////////////
+//// Node cache trimming
+
+static MapTreeBounds::Bounds_t const & children(MapTreeBounds::Content const & c)
+{
+	return c.bounds;
+}
+static RouteSubregion::SubRegions_t const & children(RouteSubregion::Content const & c)
+{
+	return c.subregions;
+}
+static PoiTreeBounds::Bounds_t const & children(PoiTreeBounds::Content const & c)
+{
+	return c.bounds;
+}
+
+struct EvictionCandidate
+{
+	uint32_t lastUsed;
+	MapTreeBounds const * map;
+	RouteSubregion const * route;
+	PoiTreeBounds const * poi;
+
+	bool operator<(EvictionCandidate const & o) const
+	{
+		return lastUsed < o.lastUsed;
+	}
+	bool drop() const
+	{
+		if (map != NULL)
+			return map->dropContent();
+		return route != NULL ? route->dropContent() : poi->dropContent();
+	}
+};
+
+static EvictionCandidate candidate(MapTreeBounds const & node)
+{
+	EvictionCandidate c = { node.LastUsed(), &node, NULL, NULL };
+	return c;
+}
+static EvictionCandidate candidate(RouteSubregion const & node)
+{
+	EvictionCandidate c = { node.LastUsed(), NULL, &node, NULL };
+	return c;
+}
+static EvictionCandidate candidate(PoiTreeBounds const & node)
+{
+	EvictionCandidate c = { node.LastUsed(), NULL, NULL, &node };
+	return c;
+}
+
+// Only loaded nodes without loaded children are candidates.
+// None of them is an ancestor of another one, so dropping a candidate never destroys another one.
+template<typename Node>
+bool collectCandidates(Node const & node, std::vector<EvictionCandidate> & output)
+{
+	typename Node::Content_pointer content = node.loadedContent();
+	if (!content)
+		return false;
+	bool loadedChildren = false;
+	typename std::vector<Node>::const_iterator it = children(*content).begin();
+	for (; it != children(*content).end(); it++) {
+		loadedChildren = collectCandidates(*it, output) || loadedChildren;
+	}
+	if (!loadedChildren)
+		output.push_back(candidate(node));
+	return true;
+}
+
+size_t trimNodeCache()
+{
+	// One trimming at a time is enough.
+	static std::mutex trimming;
+	std::unique_lock<std::mutex> lock(trimming, std::try_to_lock);
+	size_t limit = nodeCacheLimit();
+	if (!lock.owns_lock() || limit == 0)
+		return 0;
+	// Leave some room to not trim on every query.
+	size_t target = limit - limit / 4;
+	size_t before = nodeCacheUsed();
+	MapFilesSnapshot_pointer mapFiles = currentMapFiles();
+	bool dropped = true;
+	while (dropped && nodeCacheUsed() > target)
+	{
+		std::vector<EvictionCandidate> candidates;
+		MapFilesSnapshot::Files_t::const_iterator i = mapFiles->files.begin();
+		for (; i != mapFiles->files.end(); i++) {
+			BinaryMapFile const * file = i->second.get();
+			for (size_t m = 0; m < file->mapIndexes.size(); m++) {
+				std::vector<MapRoot> const & levels = file->mapIndexes[m]->levels;
+				for (size_t l = 0; l < levels.size(); l++)
+					collectCandidates<MapTreeBounds>(levels[l], candidates);
+			}
+			for (size_t r = 0; r < file->routingIndexes.size(); r++) {
+				RoutingIndex const * index = file->routingIndexes[r];
+				for (size_t s = 0; s < index->subregions.size(); s++)
+					collectCandidates(index->subregions[s], candidates);
+				for (size_t s = 0; s < index->basesubregions.size(); s++)
+					collectCandidates(index->basesubregions[s], candidates);
+			}
+			for (size_t p = 0; p < file->poiIndexes.size(); p++)
+				collectCandidates(file->poiIndexes[p]->root, candidates);
+		}
+		std::sort(candidates.begin(), candidates.end());
+		dropped = false;
+		for (size_t c = 0; c < candidates.size() && nodeCacheUsed() > target; c++) {
+			dropped = candidates[c].drop() || dropped;
+		}
+	}
+	size_t after = nodeCacheUsed();
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug, "Node cache trimmed from %d Kb to %d Kb (limit %d Kb)",
+			before / 1024, after / 1024, limit / 1024);
+	return before > after ? before - after : 0;
+}
+
+template<typename Node>
+size_t publishedBytes(Node const & node)
+{
+	typename Node::Content_pointer content = node.loadedContent();
+	if (!content)
+		return 0;
+	size_t bytes = content->bytes;
+	typename std::vector<Node>::const_iterator it = children(*content).begin();
+	for (; it != children(*content).end(); it++) {
+		bytes += publishedBytes(*it);
+	}
+	return bytes;
+}
+
+size_t nodeCachePublished()
+{
+	size_t bytes = 0;
+	MapFilesSnapshot_pointer mapFiles = currentMapFiles();
+	MapFilesSnapshot::Files_t::const_iterator i = mapFiles->files.begin();
+	for (; i != mapFiles->files.end(); i++) {
+		BinaryMapFile const * file = i->second.get();
+		for (size_t m = 0; m < file->mapIndexes.size(); m++) {
+			std::vector<MapRoot> const & levels = file->mapIndexes[m]->levels;
+			for (size_t l = 0; l < levels.size(); l++)
+				bytes += publishedBytes<MapTreeBounds>(levels[l]);
+		}
+		for (size_t r = 0; r < file->routingIndexes.size(); r++) {
+			RoutingIndex const * index = file->routingIndexes[r];
+			for (size_t s = 0; s < index->subregions.size(); s++)
+				bytes += publishedBytes(index->subregions[s]);
+			for (size_t s = 0; s < index->basesubregions.size(); s++)
+				bytes += publishedBytes(index->basesubregions[s]);
+		}
+		for (size_t p = 0; p < file->poiIndexes.size(); p++)
+			bytes += publishedBytes(file->poiIndexes[p]->root);
+	}
+	return bytes;
+}
+
 size_t RoutingMemorySize()
 {
 	size_t sz = 0;
+	MapFilesSnapshot_pointer mapFiles = currentMapFiles();
 	using boost::range::for_each;
-	for_each(openFiles, [&sz](std::pair<std::string, BinaryMapFile *> const & fp)
+	for_each(mapFiles->files, [&sz](MapFilesSnapshot::Files_t::value_type const & fp)
 			{
-		BinaryMapFile const * file = fp.second;
+		BinaryMapFile const * file = fp.second.get();
 		for_each(file->routingIndexes, [&sz](RoutingIndex const * index){sz += index->memorySize();});
 			});
 	return sz;
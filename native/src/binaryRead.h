@@ -17,6 +17,12 @@ static const uint MAP_VERSION = 2;
 
 #include "MapIndex.hpp"
 #include "RoutingIndex.hpp"
+#include "PoiIndex.hpp"
+#include "AddressIndex.hpp"
+#include "TransportIndex.hpp"
+#include "MappedFile.hpp"
+#include "SpatialDirectory.hpp"
+#include "DeltaOverlay.hpp"
 
 struct BinaryMapFile {
 	std::string inputName;
@@ -28,9 +34,19 @@ struct BinaryMapFile {
 	// They are needed (basically) to access to index rules when reading types. Can we change this behavior??
 	std::vector<MapIndex *> mapIndexes;
 	std::vector<RoutingIndex*> routingIndexes;
+	std::vector<PoiIndex*> poiIndexes;
+	std::vector<AddressIndex*> addressIndexes;
+	std::vector<TransportIndex*> transportIndexes;
+	uint64_t fileSize;
+	uint64_t dateModified; // ms, as the cache stores it
 	int fd;
 	int routefd;
+	// Whole file mapped in memory. Lazy readers of both kinds of indexes work over it.
+	MappedFile mapped;
 	bool basemap;
+	// Only for delta files: ids of all their objects
+	SortedIdSet deltaMapIds;
+	SortedIdSet deltaRouteIds;
 
 	bool isBasemap() const {
 		return basemap;
@@ -42,17 +58,69 @@ struct BinaryMapFile {
 		using boost::range::for_each;
 		for_each(mapIndexes, [](MapIndex * p){ delete p; });
 		for_each(routingIndexes, [](RoutingIndex * p){ delete p; });
+		for_each(poiIndexes, [](PoiIndex * p){ delete p; });
+		for_each(addressIndexes, [](AddressIndex * p){ delete p; });
+		for_each(transportIndexes, [](TransportIndex * p){ delete p; });
 	}
 };
 
+// Open files as queries see them. A snapshot never changes: opening or
+// closing files publishes a new one. Queries keep the snapshot they started
+// with, so a file is really closed when the last query using it ends.
+struct MapFilesSnapshot {
+	typedef std::map<std::string, SHARED_PTR<BinaryMapFile> > Files_t;
+	Files_t files;
+	SpatialDirectory directory;
+	// Names of the delta files over each base file, oldest first.
+	// Deltas are in files too, so they are queried as any other file.
+	std::map<std::string, std::vector<std::string> > deltas;
+	// Made from deltas. Only files with deltas, or deltas themselves, are here.
+	std::map<BinaryMapFile const *, FileOverlay> overlays;
+
+	FileOverlay const * overlay(BinaryMapFile const * file) const {
+		std::map<BinaryMapFile const *, FileOverlay>::const_iterator it = overlays.find(file);
+		return it == overlays.end() ? NULL : &it->second;
+	}
+};
+typedef SHARED_PTR<MapFilesSnapshot const> MapFilesSnapshot_pointer;
+MapFilesSnapshot_pointer currentMapFiles();
+
 // Public interface to file maps.
 void searchRouteSubregions(SearchQuery const * q, std::vector<RouteSubregion>& tempResult, bool basemap);
 
+// Results go to q.publisher, which keeps the files they come from open.
+void searchPoi(PoiQuery & q);
+// Cities and streets with a word starting as q.prefix, up to q.limit.
+// The first search in a file reads all its cities and streets.
+void searchAddress(AddressQuery & q);
+
 ResultPublisher* searchObjectsForRendering(SearchQuery* q, bool skipDuplicates, int renderRouteDataFile, std::string const & msgNothingFound, int& renderedState);
 
+// Opening a file again replaces the old one without stopping queries.
 BinaryMapFile* initBinaryMapFile(std::string const & inputName);
+
+struct MapFileInitResult {
+	std::string inputName;
+	bool ok;
+	int elapsedMs;
+	std::string error;
+
+	MapFileInitResult() : ok(false), elapsedMs(0) {}
+};
+// Opens several files in parallel (threads == 0 means one per core).
+// Files are registered all together once every one is read.
+std::vector<MapFileInitResult> initBinaryMapFiles(std::vector<std::string> const & inputNames, unsigned int threads = 0);
 bool initMapFilesFromCache(std::string const & inputName) ;
+// Writes the cache of all open files. Next start can use it with initMapFilesFromCache.
+bool saveMapFilesCache(std::string const & outputName);
+// Queries running on the file go on with it. New ones do not see it.
+// Closing a base file closes its deltas too.
 bool closeBinaryMapFile(std::string const & inputName);
+// Layers a delta file (see DeltaOverlay.hpp) over an open base file. The
+// delta must not be open already, as a file or over another base.
+// Later deltas of the same base win over earlier ones. Reopening the base
+// keeps its deltas: close them if the new base already has their changes.
+bool initDeltaMapFile(std::string const & baseName, std::string const & deltaName);
 
 size_t RoutingMemorySize();
 
@@ -2,8 +2,16 @@
 #include "RoutingContext.hpp"
 #include "RouteSegment.hpp"
 #include "RouteCalculationProgress.hpp"
+#include "NodeCache.hpp"
+#include "RouteSegmentQueue.hpp"
+#include "TransportPlanner.hpp"
+#include "ContractionHierarchy.hpp"
+#include "RouteLandmarks.hpp"
+#include "binaryRead.h"
 
 #include <queue>
+#include <mutex>
+#include <limits>
 #include <iostream>
 #include "Logging.h"
 
@@ -17,13 +25,14 @@ static const short RESTRICTION_ONLY_LEFT_TURN = 6;
 static const short RESTRICTION_ONLY_STRAIGHT_ON = 7;
 static const bool TRACE_ROUTING = false;
 
-void printRoad(const char* prefix, SHARED_PTR<RouteSegment> const & segment) {
+void printRoad(const char* prefix, RoutingContext* ctx, RouteSegmentIndex i) {
+       RouteSegment const & segment = ctx->segments[i];
        OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug, "%s Road id=%lld ind=%d ds=%f es=%f pend=%d parent=%lld",
-               prefix, segment->road->id, 
-               segment->getSegmentStart(),
-               segment->distanceFromStart, segment->distanceToEnd, 
-               segment->parentRoute != NULL? segment->parentSegmentEnd : 0,
-               segment->parentRoute != NULL? segment->parentRoute->road->id : 0);
+               prefix, ctx->segments.road(segment)->id, 
+               segment.getSegmentStart(),
+               segment.distanceFromStart, segment.distanceToEnd, 
+               segment.parentRoute != NO_SEGMENT? segment.parentSegmentEnd : 0,
+               segment.parentRoute != NO_SEGMENT? ctx->segments.road(segment.parentRoute)->id : 0);
 }
 
 void print(SHARED_PTR<RouteDataObject> const & rdo)
@@ -41,36 +50,39 @@ static double h(RoutingContext* ctx, int targetEndX, int targetEndY, int startX,
 	return distance / ctx->config.router.getMaxDefaultSpeed();
 }
 
-struct SegmentsComparator
-		: public std::binary_function<SHARED_PTR<RouteSegment>, SHARED_PTR<RouteSegment>, bool>
-{
-public:
-	SegmentsComparator()
-	{}
-	inline bool operator()(const SHARED_PTR<RouteSegment> & n1, const SHARED_PTR<RouteSegment> & n2) const
-	{
-		// f(x) = g(x) + h(x)  --- g(x) - distanceFromStart, h(x) - distanceToEnd (a guess)
-		// We want the shortest cost to be choosen fron priority_queue, so we need to use > operator.
-		float f1 = n1->distanceFromStart + n1->distanceToEnd;
-		float f2 = n2->distanceFromStart + n2->distanceToEnd;
-		if (f1 == f2) {
-			return n1->distanceFromStart > n2->distanceFromStart;
-		}
-		return f1 > f2;
+// From x, y to the end of the search, or from its start in reverse; the
+// better bound when there are landmarks
+static double h(RoutingContext* ctx, bool reverseWaySearch, int x, int y, int targetEndX, int targetEndY) {
+	double estimate = h(ctx, targetEndX, targetEndY, x, y);
+	if (ctx->landmarkBounds.active()) {
+		estimate = std::max(estimate, ctx->landmarkBounds.bound(x, y, reverseWaySearch));
 	}
-};
+	return estimate;
+}
 
-typedef UNORDERED(map)<int64_t, SHARED_PTR<RouteSegment> > VISITED_MAP;
-typedef std::priority_queue<SHARED_PTR<RouteSegment>, std::vector<SHARED_PTR<RouteSegment> >, SegmentsComparator > SEGMENTS_QUEUE;
+// Half the bound to the end of the search less half the bound from its
+// start, plus half the straight line between them: the searches from both
+// ends then order points alike, and can stop once no meeting is better
+// than the one they have (see searchRouteInternal).
+static double balancedH(RoutingContext* ctx, bool reverseWaySearch, int x, int y, int targetEndX, int targetEndY) {
+	int startX = reverseWaySearch ? ctx->targetX : ctx->startX;
+	int startY = reverseWaySearch ? ctx->targetY : ctx->startY;
+	double toEnd = h(ctx, reverseWaySearch, x, y, targetEndX, targetEndY);
+	double fromStart = h(ctx, !reverseWaySearch, x, y, startX, startY);
+	return (toEnd - fromStart + h(ctx, targetEndX, targetEndY, startX, startY)) / 2;
+}
+
+typedef UNORDERED(map)<int64_t, RouteSegmentIndex> VISITED_MAP;
 
-size_t calculateSizeOfSearchMaps(SEGMENTS_QUEUE const & graphDirectSegments,
-		SEGMENTS_QUEUE const & graphReverseSegments,
+template <typename QUEUE>
+size_t calculateSizeOfSearchMaps(QUEUE const & graphDirectSegments,
+		QUEUE const & graphReverseSegments,
 		VISITED_MAP const & visitedDirectSegments, VISITED_MAP const & visitedOppositeSegments)
 {
-	size_t sz = visitedDirectSegments.size() * sizeof(std::pair<int64_t, SHARED_PTR<RouteSegment> > );
-	sz += visitedOppositeSegments.size()*sizeof(std::pair<int64_t, SHARED_PTR<RouteSegment> >);
-	sz += graphDirectSegments.size()*sizeof(SHARED_PTR<RouteSegment>);
-	sz += graphReverseSegments.size()*sizeof(SHARED_PTR<RouteSegment>);
+	size_t sz = visitedDirectSegments.size() * sizeof(std::pair<int64_t, RouteSegmentIndex> );
+	sz += visitedOppositeSegments.size()*sizeof(std::pair<int64_t, RouteSegmentIndex>);
+	sz += graphDirectSegments.memorySize();
+	sz += graphReverseSegments.memorySize();
 	return sz;
 }
 
@@ -78,51 +90,66 @@ size_t calculateSizeOfSearchMaps(SEGMENTS_QUEUE const & graphDirectSegments,
  * Calculate route between start.segmentEnd and end.segmentStart (using A* algorithm)
  */
 bool checkSolution(RoutingContext* ctx,
-		SHARED_PTR<RouteSegment> const & segment, int segmentEnd, SHARED_PTR<RouteSegment> const & next,
-		VISITED_MAP const & oppositeSegments, bool reverseWay)
+		RouteSegmentIndex segment, int segmentEnd, RouteSegmentIndex next,
+		VISITED_MAP const & oppositeSegments, bool reverseWay, double distFromStart)
 {
+	RouteSegmentPool & pool = ctx->segments;
 	// 1. Check if opposite segment found so we can stop calculations
-	int64_t nts = (next->road->id << ROUTE_POINTS) + next->segmentStart;
+	int64_t nts = (pool.road(next)->id << ROUTE_POINTS) + pool[next].segmentStart;
 	VISITED_MAP::const_iterator oS = oppositeSegments.find(nts);
 	if (oS != oppositeSegments.end()) {
 		// restrictions checked
-		SHARED_PTR<RouteSegment> const & opposite = oS->second;
-		if (opposite != NULL)
+		RouteSegmentIndex opposite = oS->second;
+		if (opposite != NO_SEGMENT)
 		{
+			// With landmarks the search goes on while a better meeting may come
+			double distance = pool[opposite].distanceFromStart + distFromStart;
+			if (ctx->landmarkBounds.active() && ctx->finalRouteSegment
+					&& ctx->finalRouteSegment->distanceFromStart <= distance)
+				return false;
 			SHARED_PTR<FinalRouteSegment> frs = SHARED_PTR<FinalRouteSegment>(new FinalRouteSegment);
 			frs->direct = segment;
 			frs->reverseWaySearch = reverseWay;
-			SHARED_PTR<RouteSegment> op = SHARED_PTR<RouteSegment>(new RouteSegment(segment->road, segmentEnd));
-			op->parentRoute = opposite;
-			op->parentSegmentEnd = next->getSegmentStart();
-			frs->opposite = op;
-			frs->distanceFromStart = opposite->distanceFromStart + segment->distanceFromStart;
+			RouteSegment op(pool[segment].road, segmentEnd);
+			op.parentRoute = opposite;
+			op.parentSegmentEnd = pool[next].getSegmentStart();
+			frs->opposite = pool.addSearch(op);
+			frs->distanceFromStart = distance;
 			ctx->finalRouteSegment = frs;
-			return true;
+			return !ctx->landmarkBounds.active();
 		}
 	}
 	return false;
 }
 
-bool processIntersections(RoutingContext* ctx, SEGMENTS_QUEUE& graphSegments, VISITED_MAP const & visitedSegments,
+template <typename QUEUE>
+bool processIntersections(RoutingContext* ctx, QUEUE& graphSegments, VISITED_MAP const & visitedSegments,
 		VISITED_MAP const & oppositeSegments, double distFromStart, double distToFinalPoint,
-		SHARED_PTR<RouteSegment> const & segment, int segmentEnd, SHARED_PTR<RouteSegment> const & inputNext,
+		RouteSegmentIndex segment, int segmentEnd, RouteSegmentIndex inputNext,
 		bool reverseWay) {
+	RouteSegmentPool & pool = ctx->segments;
 	// Calculate possible ways to put into priority queue
-	SHARED_PTR<RouteSegment> next = inputNext;
-	while (next != NULL)
+	RouteSegmentIndex nextIndex = inputNext;
+	while (nextIndex != NO_SEGMENT)
 	{
-		if (checkSolution(ctx, segment, segmentEnd, next,
-				oppositeSegments, reverseWay)) return true;
-
-		int64_t nts = (next->road->id << ROUTE_POINTS) + next->segmentStart;  // TODO refactor
+		if (checkSolution(ctx, segment, segmentEnd, nextIndex,
+				oppositeSegments, reverseWay, distFromStart)) return true;
+
+		RouteSegment * next = &pool[nextIndex];
+		// The road after this one at the junction, even if this one is copied
+		RouteSegmentIndex following = next->next;
+		SHARED_PTR<RouteDataObject> const & road = pool.road(*next);
+		int64_t nts = (road->id << ROUTE_POINTS) + next->segmentStart;  // TODO refactor
 		if (visitedSegments.count(nts) == 0) {
-			if (next->parentRoute == NULL
+			if (next->parentRoute == NO_SEGMENT
 					|| next->distanceFromStart > distFromStart) {
-				if (next->parentRoute != NULL) {
+				// Open sets that lower keys take it where it is
+				bool queued = next->parentRoute != NO_SEGMENT && graphSegments.contains(nextIndex);
+				if (next->parentRoute != NO_SEGMENT && !queued) {
 					// already in queue remove it (we can not remove it)
-OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Nuevo next.parent %d -> %d", next->parentRoute->road->id, segment->road->id);///
-					next = SHARED_PTR<RouteSegment>(new RouteSegment(next->road, next->segmentStart));
+OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Nuevo next.parent %d -> %d", pool.road(next->parentRoute)->id, pool.road(segment)->id);///
+					nextIndex = pool.addSearch(RouteSegment(next->road, next->segmentStart));
+					next = &pool[nextIndex];
 				}
 				next->distanceFromStart = distFromStart;
 				next->distanceToEnd = distToFinalPoint;
@@ -134,26 +161,31 @@ OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Nuevo next.parent %d -> %d",
 					OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug,
 							" >>  >> next (%d{%d}, %d) name=%s"
 							"\n\t\tf{g+h}=%f{%f+%f}",
-							next->road->id, next->road->pointsX.size(), next->segmentStart,
-							next->road->getName().c_str(),
+							road->id, road->pointsX.size(), next->segmentStart,
+							road->getName().c_str(),
 							next->distanceFromStart+next->distanceToEnd, next->distanceFromStart, next->distanceToEnd);
 				}
-				graphSegments.push(next);
+				if (queued)
+					graphSegments.update(nextIndex);
+				else
+					graphSegments.push(nextIndex);
 			}
 		} else {
-			if (distFromStart < next->distanceFromStart && next->road->id != segment->road->id) {
+			if (distFromStart < next->distanceFromStart && road->id != pool.road(segment)->id) {
 			// the segment was already visited! We need to follow better route if it exists
 			// that is very strange situation and almost exception (it can happen when we underestimate distnceToEnd)
 OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "YA visitado next (%d, %d) segment (%d, %d)",
-		next->road->id, next->segmentStart, segment->road->id, segment->segmentStart);///
+		road->id, next->segmentStart, pool.road(segment)->id, pool[segment].segmentStart);///
 				next->distanceFromStart = distFromStart;
 				next->parentRoute = segment;
 				next->parentSegmentEnd = segmentEnd;
+				if (graphSegments.contains(nextIndex))
+					graphSegments.update(nextIndex);
 			}
 		}
 
 		// iterate to next road
-		next = next->next;
+		nextIndex = following;
 	}
 	return false;
 }
@@ -173,8 +205,8 @@ inline bool obliged(int resType)
 			|| resType == RESTRICTION_ONLY_STRAIGHT_ON);
 }
 
-bool goTo(SHARED_PTR<RouteDataObject> const & roadFrom, SHARED_PTR<RouteDataObject> const & roadTo,
-		SHARED_PTR<RouteSegment> const & junctionInfo)
+bool goTo(RouteSegmentPool const & pool, SHARED_PTR<RouteDataObject> const & roadFrom,
+		SHARED_PTR<RouteDataObject> const & roadTo, RouteSegmentIndex junctionInfo)
 {
 	/*
 	 * By default we can go from first road to second.
@@ -195,15 +227,15 @@ bool goTo(SHARED_PTR<RouteDataObject> const & roadFrom, SHARED_PTR<RouteDataObje
 		if (!anotherObligation && obliged(rt))
 		{
 			// check if that restriction applies to considered junction
-			SHARED_PTR<RouteSegment> ji = junctionInfo;
-			while (ji != NULL)
+			RouteSegmentIndex ji = junctionInfo;
+			while (ji != NO_SEGMENT)
 			{
-				if (ji->road->id == restrictedTo)
+				if (pool.road(ji)->id == restrictedTo)
 				{
 					anotherObligation = true;
 					break;
 				}
-				ji = ji->next;
+				ji = pool[ji].next;
 			}
 		}
 	}
@@ -213,8 +245,8 @@ bool goTo(SHARED_PTR<RouteDataObject> const & roadFrom, SHARED_PTR<RouteDataObje
 
 //const static int RESTRICTION_SHIFT = 3;
 //const static int RESTRICTION_MASK = 7;
-SHARED_PTR<RouteSegment> proccessRestrictions(RoutingContext* ctx, SHARED_PTR<RouteDataObject> const & road,
-		SHARED_PTR<RouteSegment> const & inputNext, bool reverseWay)
+RouteSegmentIndex proccessRestrictions(RoutingContext* ctx, SHARED_PTR<RouteDataObject> const & road,
+		RouteSegmentIndex inputNext, bool reverseWay)
 {
 	// Configurable
 	if(!ctx->config.router.restrictionsAware()) {
@@ -226,41 +258,50 @@ SHARED_PTR<RouteSegment> proccessRestrictions(RoutingContext* ctx, SHARED_PTR<Ro
 		return inputNext;
 	}
 
-	SHARED_PTR<RouteSegment> next = inputNext;
-	SHARED_PTR<RouteSegment> res = NULL;
-	while (next != NULL)
+	RouteSegmentPool & pool = ctx->segments;
+	RouteSegmentIndex next = inputNext;
+	RouteSegmentIndex res = NO_SEGMENT;
+	while (next != NO_SEGMENT)
 	{
+		SHARED_PTR<RouteDataObject> const & nextRoad = pool.road(next);
 		bool valid = (!reverseWay)?
-			goTo(road, next->road, inputNext):
-			goTo(next->road, road, inputNext);
+			goTo(pool, road, nextRoad, inputNext):
+			goTo(pool, nextRoad, road, inputNext);
 		if (valid)
 		{
-			// TODO by now we must deep copy to avoid to break inputNext.
-			// Think about using container instead of next-linked list
-			SHARED_PTR<RouteSegment> add = SHARED_PTR<RouteSegment>(new RouteSegment(*next));
-			add->next = res;
-			res = add;
+			// Copy not to break inputNext, it goes until the next search.
+			RouteSegment add = pool[next];
+			add.next = res;
+			res = pool.addSearch(add);
 		}
 		else
 		{
 			if (TRACE_ROUTING)
 			{
 				OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "%d%s%d banned",
-						road->id, reverseWay?"<-":"->", next->road->id);
+						road->id, reverseWay?"<-":"->", nextRoad->id);
 			}
 		}
-		next = next->next;
+		next = pool[next].next;
 	}
 	return res;
 }
 
-bool visitRouteSegment(RoutingContext* ctx, bool reverseWaySearch, SEGMENTS_QUEUE & graphSegments,
+template <typename QUEUE>
+bool visitRouteSegment(RoutingContext* ctx, bool reverseWaySearch, QUEUE & graphSegments,
 		VISITED_MAP & visitedSegments, int targetEndX, int targetEndY,
-		SHARED_PTR<RouteSegment> const & segment,
+		RouteSegmentIndex segmentIndex,
 		VISITED_MAP const & oppositeSegments, int delta, double obstacleTime)
 {
-	SHARED_PTR<RouteDataObject> const & road = segment->road;
-	int start = segment->segmentStart + delta;
+	// Pool references do not move while segments are added
+	RouteSegment const & segment = ctx->segments[segmentIndex];
+	SHARED_PTR<RouteDataObject> const & road = ctx->segments.road(segment);
+	RoadAttributes const attributes = ctx->attributes.road(segment.road, road);
+	double speed = attributes.speed * attributes.priority;
+	if (speed == 0) {
+		speed = ctx->config.router.getMinDefaultSpeed() * attributes.priority;
+	}
+	int start = segment.segmentStart + delta;
 	int end = (delta == 1)?road->pointsX.size():-1;
 	double distOnRoadToPass = 0;
 	while (start != end)
@@ -273,7 +314,7 @@ bool visitRouteSegment(RoutingContext* ctx, bool reverseWaySearch, SEGMENTS_QUEU
 			continue;
 		}
 		// Only visited
-		visitedSegments[nts] = NULL;
+		visitedSegments[nts] = NO_SEGMENT;
 
 		// 2. calculate point and try to load neighbor ways if they are not loaded
 		int x = road->pointsX[start];
@@ -282,30 +323,27 @@ bool visitRouteSegment(RoutingContext* ctx, bool reverseWaySearch, SEGMENTS_QUEU
 				road->pointsX[start-delta], road->pointsY[start-delta]);
 
 		// 2.1 check possible obstacle plus time
-		double obstacle = ctx->config.router.defineRoutingObstacle(road, start);
+		double obstacle = ctx->attributes.routingObstacle(*road, start);
 		if (obstacle < 0) continue;
 		obstacleTime += obstacle;
 
 		// could be expensive calculation
-		SHARED_PTR<RouteSegment> next = ctx->loadRouteSegment(x, y);
+		RouteSegmentIndex next = ctx->loadRouteSegment(x, y);
 		// Be aware of restrictions
-		next = proccessRestrictions(ctx, segment->road, next, reverseWaySearch);
+		next = proccessRestrictions(ctx, road, next, reverseWaySearch);
 		// 3. get intersected ways
-		if (next != NULL)
+		if (next != NO_SEGMENT)
 		{
 			// Using A* routing algorithm
 			// g(x) - calculate distance to that point and calculate time
-			double priority = ctx->config.router.defineSpeedPriority(road);
-			double speed = ctx->config.router.defineRoutingSpeed(road) * priority;
-			if (speed == 0) {
-				speed = ctx->config.router.getMinDefaultSpeed() * priority;
-			}
-			double distStartObstacles = segment->distanceFromStart + obstacleTime + distOnRoadToPass / speed;
+			double distStartObstacles = segment.distanceFromStart + obstacleTime + distOnRoadToPass / speed;
 			// I'm not sure
 			if (!ctx->precalcRoute.empty && ctx->precalcRoute.followNext)
 				distStartObstacles = ctx->precalcRoute.getDeviationDistance(x, y) / ctx->precalcRoute.maxSpeed;
 			////
-			double distToFinalPoint = h(ctx, x, y, targetEndX, targetEndY);
+			double distToFinalPoint = ctx->landmarkBounds.active() ?
+					balancedH(ctx, reverseWaySearch, x, y, targetEndX, targetEndY) :
+					h(ctx, targetEndX, targetEndY, x, y);
 
 			if (TRACE_ROUTING)
 			{
@@ -315,22 +353,24 @@ bool visitRouteSegment(RoutingContext* ctx, bool reverseWaySearch, SEGMENTS_QUEU
 			}
 
 			if (processIntersections(ctx, graphSegments, visitedSegments, oppositeSegments,
-					distStartObstacles, distToFinalPoint, segment, start, next, reverseWaySearch) ) return true;
-		}  // end of next != NULL
+					distStartObstacles, distToFinalPoint, segmentIndex, start, next, reverseWaySearch) ) return true;
+		}  // end of next != NO_SEGMENT
 	// next
 		start += delta;
 	}
 	return false;
 }
 
-bool processRouteSegment(RoutingContext* ctx, bool reverseWaySearch, SEGMENTS_QUEUE& graphSegments,
-		VISITED_MAP& visitedSegments, int targetEndX, int targetEndY, SHARED_PTR<RouteSegment> const & segment,
+template <typename QUEUE>
+bool processRouteSegment(RoutingContext* ctx, bool reverseWaySearch, QUEUE& graphSegments,
+		VISITED_MAP& visitedSegments, int targetEndX, int targetEndY, RouteSegmentIndex segmentIndex,
 		VISITED_MAP& oppositeSegments)
 {
 	// 0. Skip previously visited points
-	// TODO Maybe const
-	SHARED_PTR<RouteDataObject> const & road = segment->road;
-	int start = segment->segmentStart;
+	RouteSegmentPool const & pool = ctx->segments;
+	RouteSegment const & segment = pool[segmentIndex];
+	SHARED_PTR<RouteDataObject> const & road = pool.road(segment);
+	int start = segment.segmentStart;
 	int64_t nt = (road->id << ROUTE_POINTS) + start;
 	if (visitedSegments.count(nt) != 0)
 	{
@@ -340,9 +380,10 @@ bool processRouteSegment(RoutingContext* ctx, bool reverseWaySearch, SEGMENTS_QU
 	// 1. mark route segment as visited
 	ctx->visitedSegments++;
 	// Route thru segment
-	visitedSegments[nt] = segment;
+	visitedSegments[nt] = segmentIndex;
 
-	int roadDirection = ctx->config.router.isOneWay(road);
+	RoadAttributes const attributes = ctx->attributes.road(segment.road, road);
+	int roadDirection = attributes.oneway;
 
 	if (TRACE_ROUTING)
 	{
@@ -351,8 +392,8 @@ bool processRouteSegment(RoutingContext* ctx, bool reverseWaySearch, SEGMENTS_QU
 				"\n\t\tspeed=%f prio=%f roadDirection=%d"
 				"\n\t\tf{g+h}=%f{%f+%f}",
 				road->id, road->pointsX.size(), start, road->getName().c_str(),
-				ctx->config.router.defineRoutingSpeed(road), ctx->config.router.defineSpeedPriority(road), roadDirection,
-				segment->distanceFromStart+segment->distanceToEnd, segment->distanceFromStart, segment->distanceToEnd);
+				attributes.speed, attributes.priority, roadDirection,
+				segment.distanceFromStart+segment.distanceToEnd, segment.distanceFromStart, segment.distanceToEnd);
 	}
 
 	if ( ((!reverseWaySearch && roadDirection >= 0)	|| (reverseWaySearch && roadDirection <= 0))
@@ -361,43 +402,48 @@ bool processRouteSegment(RoutingContext* ctx, bool reverseWaySearch, SEGMENTS_QU
 		// We have bigger indexes to visit.
 		// We penalize if trying the reverse direction.
 		double obstacleTime = 0;////(ctx->firstRoadId == nt && ctx->firstRoadDirection < 0)?500:0;
-		if (segment->parentRoute != NULL)
+		if (segment.parentRoute != NO_SEGMENT)
 		{
-			obstacleTime = ctx->config.router.calculateTurnTime(segment, road->pointsX.size()-1,
-					segment->parentRoute, segment->parentSegmentEnd);
+			RouteSegment const & parent = pool[segment.parentRoute];
+			obstacleTime = ctx->config.router.calculateTurnTime(road, start, road->pointsX.size()-1, attributes.penaltyTransition,
+					pool.road(parent), parent.segmentStart, segment.parentSegmentEnd,
+					ctx->attributes.road(parent.road, pool.road(parent)).penaltyTransition);
 		}
 		if (visitRouteSegment(ctx, reverseWaySearch,
 				graphSegments, visitedSegments, targetEndX, targetEndY,
-				segment, oppositeSegments, 1, obstacleTime) ) return true;
+				segmentIndex, oppositeSegments, 1, obstacleTime) ) return true;
 	}
 	if ( ((!reverseWaySearch && roadDirection <= 0)	|| (reverseWaySearch && roadDirection >= 0))
 				&& start > 0 )
 	{
 		// We have smaller indexes to visit
 		double obstacleTime = 0;
-		if (segment->parentRoute != NULL)
+		if (segment.parentRoute != NO_SEGMENT)
 		{
-			obstacleTime = ctx->config.router.calculateTurnTime(segment, 0,
-					segment->parentRoute, segment->parentSegmentEnd);
+			RouteSegment const & parent = pool[segment.parentRoute];
+			obstacleTime = ctx->config.router.calculateTurnTime(road, start, 0, attributes.penaltyTransition,
+					pool.road(parent), parent.segmentStart, segment.parentSegmentEnd,
+					ctx->attributes.road(parent.road, pool.road(parent)).penaltyTransition);
 		}
 		if (visitRouteSegment(ctx, reverseWaySearch,
 						graphSegments, visitedSegments, targetEndX, targetEndY,
-						segment, oppositeSegments, -1, obstacleTime) ) return true;
+						segmentIndex, oppositeSegments, -1, obstacleTime) ) return true;
 	}
 	return false;
 }
 
+template <typename QUEUE>
 void searchRouteInternal(RoutingContext* ctx,
-		SHARED_PTR<RouteSegment> const & start, SHARED_PTR<RouteSegment> const & end,
+		RouteSegmentIndex start, RouteSegmentIndex end,
 		bool leftSideNavigation) {
 	// FIXME intermediate points
 	// measure time
 	ctx->visitedSegments = 0;
 	int iterationsToUpdate = 0;
 	ctx->timeToCalculate.Start();
-	SegmentsComparator sgmCmp;
-	SEGMENTS_QUEUE graphDirectSegments(sgmCmp);
-	SEGMENTS_QUEUE graphReverseSegments(sgmCmp);
+	RouteSegmentPool & pool = ctx->segments;
+	QUEUE graphDirectSegments(pool);
+	QUEUE graphReverseSegments(pool);
 
 	// Set to not visit one segment twice (stores road.id << X + segmentStart)
 	VISITED_MAP visitedDirectSegments;
@@ -407,23 +453,23 @@ void searchRouteInternal(RoutingContext* ctx,
 	bool runRecalculation = false;
 
 	// for start : f(start) = g(start) + h(start) = 0 + h(start) = h(start)
-	int targetEndX = end->road->pointsX[end->segmentStart];
-	int targetEndY = end->road->pointsY[end->segmentStart];
-	int startX = start->road->pointsX[start->segmentStart];
-	int startY = start->road->pointsY[start->segmentStart];
+	int targetEndX = pool.road(end)->pointsX[pool[end].segmentStart];
+	int targetEndY = pool.road(end)->pointsY[pool[end].segmentStart];
+	int startX = pool.road(start)->pointsX[pool[start].segmentStart];
+	int startY = pool.road(start)->pointsY[pool[start].segmentStart];
 	float estimatedDistance = (float) h(ctx, targetEndX, targetEndY, startX, startY);
-	end->distanceToEnd = start->distanceToEnd = estimatedDistance;
+	pool[end].distanceToEnd = pool[start].distanceToEnd = estimatedDistance;
 
 	graphDirectSegments.push(start);
 	graphReverseSegments.push(end);
 
 	// Search from end or from start
 	bool inverse = false;
-	SEGMENTS_QUEUE * graphSegments = inverse?&graphReverseSegments:&graphDirectSegments;
+	QUEUE * graphSegments = inverse?&graphReverseSegments:&graphDirectSegments;
 
 	while (!graphSegments->empty())
 	{
-		SHARED_PTR<RouteSegment> segment = graphSegments->top();
+		RouteSegmentIndex segment = graphSegments->top();
 		graphSegments->pop();
 		if (!inverse) {
 			if (processRouteSegment(ctx, false, graphDirectSegments, visitedDirectSegments,
@@ -438,9 +484,9 @@ void searchRouteInternal(RoutingContext* ctx,
 		}
 		if (ctx->progress != NULL && iterationsToUpdate-- < 0) {
 			iterationsToUpdate = 100;
-			ctx->progress->updateStatus(graphDirectSegments.empty()? 0 :graphDirectSegments.top()->distanceFromStart,
+			ctx->progress->updateStatus(graphDirectSegments.empty()? 0 :pool[graphDirectSegments.top()].distanceFromStart,
 					graphDirectSegments.size(),
-					graphReverseSegments.empty()? 0 :graphReverseSegments.top()->distanceFromStart,
+					graphReverseSegments.empty()? 0 :pool[graphReverseSegments.top()].distanceFromStart,
 					graphReverseSegments.size());
 			if(ctx->progress->isCancelled()) {
 				break;
@@ -461,7 +507,7 @@ void searchRouteInternal(RoutingContext* ctx,
 			else
 			{
 				//inverse = !inverse;  // Change direction
-				inverse = graphReverseSegments.top()->f() < graphDirectSegments.top()->f();
+				inverse = pool[graphReverseSegments.top()].f() < pool[graphDirectSegments.top()].f();
 				// Choose smaller cost but with equilibrated search spaces
 				if (graphDirectSegments.size() * 1.3 > graphReverseSegments.size())
 				{
@@ -475,6 +521,14 @@ void searchRouteInternal(RoutingContext* ctx,
 		}
 		graphSegments = inverse?&graphReverseSegments:&graphDirectSegments;
 
+		// Meetings through the points still queued cost at least the sum of
+		// the least keys of both sides, less the straight line between the ends
+		if (ctx->landmarkBounds.active() && ctx->finalRouteSegment && (graphDirectSegments.empty()
+				|| graphReverseSegments.empty()
+				|| pool[graphDirectSegments.top()].f() + pool[graphReverseSegments.top()].f()
+						>= ctx->finalRouteSegment->distanceFromStart + estimatedDistance))
+			break;
+
 		// check if interrupted
 		if(ctx->isInterrupted()) {
 			return;
@@ -486,23 +540,30 @@ void searchRouteInternal(RoutingContext* ctx,
 			graphDirectSegments.size(),graphReverseSegments.size());
 	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "[Native] Result timing (time to load %d, time to calc %d, loaded tiles %d) ",
 			ctx->timeToLoad.GetElapsedMs(), ctx->timeToCalculate.GetElapsedMs(), ctx->loadedMapChunks());
+	ctx->queuedSegments = graphDirectSegments.pushed() + graphReverseSegments.pushed();
+	ctx->maxQueueSize = graphDirectSegments.maxSize() + graphReverseSegments.maxSize();
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "[Native] Result queues (queued segments %d, max queue size %d) ",
+			(int) ctx->queuedSegments, (int) ctx->maxQueueSize);
 	int sz = calculateSizeOfSearchMaps(graphDirectSegments, graphReverseSegments, visitedDirectSegments, visitedReverseSegments);
 	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "[Native] Memory occupied (Routing context %d Kb, search %d Kb)", ctx->memorySize()/1024, sz/1024);
 }
 
 #ifdef UNI_REF_ALGO
+typedef SegmentsPriorityQueue SEGMENTS_QUEUE;
+
 bool _checkSolution(RoutingContext* ctx,
-		SHARED_PTR<RouteSegment> const & segment, int segmentEnd, int endX, int endY)
+		RouteSegmentIndex segment, int segmentEnd, int endX, int endY)
 {
-	if (segment->road->pointsX[segmentEnd] == endX
-			&& segment->road->pointsY[segmentEnd] == endY)
+	RouteSegmentPool & pool = ctx->segments;
+	SHARED_PTR<RouteDataObject> const & road = pool.road(segment);
+	if (road->pointsX[segmentEnd] == endX
+			&& road->pointsY[segmentEnd] == endY)
 	{
 		SHARED_PTR<FinalRouteSegment> frs = SHARED_PTR<FinalRouteSegment>(new FinalRouteSegment);
 		frs->direct = segment;
 		frs->reverseWaySearch = false;
-		SHARED_PTR<RouteSegment> op = SHARED_PTR<RouteSegment>(new RouteSegment(segment->road, segmentEnd));
-		frs->opposite = op;
-		frs->distanceFromStart = segment->distanceFromStart;
+		frs->opposite = pool.addSearch(RouteSegment(pool[segment].road, segmentEnd));
+		frs->distanceFromStart = pool[segment].distanceFromStart;
 
 		ctx->finalRouteSegment = frs;
 		return true;
@@ -512,22 +573,27 @@ bool _checkSolution(RoutingContext* ctx,
 
 void _processIntersections(RoutingContext* ctx, SEGMENTS_QUEUE& graphSegments, VISITED_MAP const & visitedSegments,
 		double distFromStart, double distToFinalPoint,
-		SHARED_PTR<RouteSegment> const & segment, int segmentEnd, SHARED_PTR<RouteSegment> next)
+		RouteSegmentIndex segment, int segmentEnd, RouteSegmentIndex nextIndex)
 {
+	RouteSegmentPool & pool = ctx->segments;
 	// For each neighbor
-	while (next != NULL)
+	while (nextIndex != NO_SEGMENT)
 	{
-		int64_t nts = (next->road->id << ROUTE_POINTS) + next->segmentStart;  // TODO refactor
+		RouteSegment * next = &pool[nextIndex];
+		RouteSegmentIndex following = next->next;
+		SHARED_PTR<RouteDataObject> const & road = pool.road(*next);
+		int64_t nts = (road->id << ROUTE_POINTS) + next->segmentStart;  // TODO refactor
 		if (visitedSegments.count(nts) == 0)
 		{ // NOT in closed set
-			if (next->parentRoute == NULL // NOT in open set (If h(x) is monotone then will always occur)
+			if (next->parentRoute == NO_SEGMENT // NOT in open set (If h(x) is monotone then will always occur)
 				|| next->distanceFromStart > distFromStart) // Thru segment we have a less costly path
 			{
-				if (next->parentRoute != NULL)
+				if (next->parentRoute != NO_SEGMENT)
 				{
 					// already in queue remove it (we can not remove it)
-OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Nuevo next.parent %d -> %d", next->parentRoute->road->id, segment->road->id);///
-					next = SHARED_PTR<RouteSegment>(new RouteSegment(next->road, next->segmentStart));
+OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Nuevo next.parent %d -> %d", pool.road(next->parentRoute)->id, pool.road(segment)->id);///
+					nextIndex = pool.addSearch(RouteSegment(next->road, next->segmentStart));
+					next = &pool[nextIndex];
 				}
 				next->distanceFromStart = distFromStart;
 				next->distanceToEnd = distToFinalPoint;
@@ -539,21 +605,21 @@ OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Nuevo next.parent %d -> %d",
 					OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug,
 							" >>  >> next (%d{%d}, %d) name=%s"
 							"\n\t\tf{g+h}=%f{%f+%f}",
-							next->road->id, next->road->pointsX.size(), next->segmentStart,
-							next->road->getName().c_str(),
+							road->id, road->pointsX.size(), next->segmentStart,
+							road->getName().c_str(),
 							next->distanceFromStart+next->distanceToEnd, next->distanceFromStart, next->distanceToEnd);
 				}
 				// Add to open set
-				graphSegments.push(next);
+				graphSegments.push(nextIndex);
 			}
 		}
 		// iterate to next
-		next = next->next;
+		nextIndex = following;
 	}
 }
 
-SHARED_PTR<RouteSegment> _proccessRestrictions(RoutingContext* ctx, SHARED_PTR<RouteDataObject> const & road,
-		SHARED_PTR<RouteSegment> const & inputNext)
+RouteSegmentIndex _proccessRestrictions(RoutingContext* ctx, SHARED_PTR<RouteDataObject> const & road,
+		RouteSegmentIndex inputNext)
 {
 	// Configurable
 	if(!ctx->config.router.restrictionsAware()) {
@@ -565,39 +631,45 @@ SHARED_PTR<RouteSegment> _proccessRestrictions(RoutingContext* ctx, SHARED_PTR<R
 		return inputNext;
 	}
 
-	SHARED_PTR<RouteSegment> next = inputNext;
-	SHARED_PTR<RouteSegment> res = NULL;
-	while (next != NULL)
+	RouteSegmentPool & pool = ctx->segments;
+	RouteSegmentIndex next = inputNext;
+	RouteSegmentIndex res = NO_SEGMENT;
+	while (next != NO_SEGMENT)
 	{
-		bool valid = goTo(road, next->road, inputNext);
+		bool valid = goTo(pool, road, pool.road(next), inputNext);
 		if (valid)
 		{
-			// TODO by now we must deep copy to avoid to break inputNext.
-			// Think about using container instead of next-linked list
-			SHARED_PTR<RouteSegment> add = SHARED_PTR<RouteSegment>(new RouteSegment(*next));
-			add->next = res;
-			res = add;
+			// Copy not to break inputNext, it goes until the next search.
+			RouteSegment add = pool[next];
+			add.next = res;
+			res = pool.addSearch(add);
 		}
 		else
 		{
 			if (TRACE_ROUTING)
 			{
 				OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "%d->%d banned",
-						road->id, next->road->id);
+						road->id, pool.road(next)->id);
 			}
 		}
-		next = next->next;
+		next = pool[next].next;
 	}
 	return res;
 }
 
 bool _visitRouteSegment(RoutingContext* ctx, SEGMENTS_QUEUE & graphSegments,	VISITED_MAP & visitedSegments,
 		int targetEndX, int targetEndY,
-		SHARED_PTR<RouteSegment> const & segment, int delta,
+		RouteSegmentIndex segmentIndex, int delta,
 		double obstacleTime)
 {
-	SHARED_PTR<RouteDataObject> const & road = segment->road;
-	int start = segment->segmentStart + delta;
+	RouteSegment const & segment = ctx->segments[segmentIndex];
+	SHARED_PTR<RouteDataObject> const & road = ctx->segments.road(segment);
+	RoadAttributes const attributes = ctx->attributes.road(segment.road, road);
+	double speed = attributes.speed * attributes.priority;
+	if (speed == 0) {
+		speed = ctx->config.router.getMinDefaultSpeed() * attributes.priority;
+	}
+	int start = segment.segmentStart + delta;
 	int end = (delta == 1)?road->pointsX.size():-1;
 	double distOnRoadToPass = 0;
 	// algorithm should visit all reacheable points on the road
@@ -610,10 +682,10 @@ bool _visitRouteSegment(RoutingContext* ctx, SEGMENTS_QUEUE & graphSegments,	VIS
 			start += delta;
 			continue;
 		}
-		visitedSegments[nts] = NULL;
+		visitedSegments[nts] = NO_SEGMENT;
 
 		// and we check for end
-		if (_checkSolution(ctx, segment, start, targetEndX, targetEndY)) return true;
+		if (_checkSolution(ctx, segmentIndex, start, targetEndX, targetEndY)) return true;
 
 		// 2. calculate point and try to load neighbor ways if they are not loaded
 		int x = road->pointsX[start];
@@ -622,26 +694,21 @@ bool _visitRouteSegment(RoutingContext* ctx, SEGMENTS_QUEUE & graphSegments,	VIS
 				road->pointsX[start-delta], road->pointsY[start-delta]);
 
 		// 2.1 check possible obstacle plus time
-		double obstacle = ctx->config.router.defineRoutingObstacle(road, start);
+		double obstacle = ctx->attributes.routingObstacle(*road, start);
 		if (obstacle < 0)
 		{
 			continue;
 		}
 		obstacle += obstacleTime;
 		// all the possible intersections. A* nodes can have many different RouteSegments representing it
-		SHARED_PTR<RouteSegment> next = ctx->loadRouteSegment(x, y);
+		RouteSegmentIndex next = ctx->loadRouteSegment(x, y);
 		// Be aware of restrictions
-		next = _proccessRestrictions(ctx, segment->road, next);
-		if (next != NULL) {
+		next = _proccessRestrictions(ctx, road, next);
+		if (next != NO_SEGMENT) {
 			// Using A* routing algorithm
 			// g(x) - calculate distance to that point and calculate time
-			double priority = ctx->config.router.defineSpeedPriority(road);
-			double speed = ctx->config.router.defineRoutingSpeed(road) * priority;
-			if (speed == 0) {
-				speed = ctx->config.router.getMinDefaultSpeed() * priority;
-			}
-			double distStartObstacles = segment->distanceFromStart + obstacle + distOnRoadToPass / speed;
-			double distToFinalPoint = h(ctx, x, y, targetEndX, targetEndY);
+			double distStartObstacles = segment.distanceFromStart + obstacle + distOnRoadToPass / speed;
+			double distToFinalPoint = h(ctx, false, x, y, targetEndX, targetEndY);
 
 			if (TRACE_ROUTING)
 			{
@@ -652,19 +719,22 @@ bool _visitRouteSegment(RoutingContext* ctx, SEGMENTS_QUEUE & graphSegments,	VIS
 
 			// For each interesting neighbor
 			_processIntersections(ctx, graphSegments, visitedSegments,
-					distStartObstacles, distToFinalPoint, segment, start, next);
-		}  // end of next != NULL
+					distStartObstacles, distToFinalPoint, segmentIndex, start, next);
+		}  // end of next != NO_SEGMENT
 		start += delta;
 	}
 	return false;
 }
 
 bool _processRouteSegment(RoutingContext* ctx, SEGMENTS_QUEUE& graphSegments,
-		VISITED_MAP& visitedSegments, int targetEndX, int targetEndY, SHARED_PTR<RouteSegment> const & segment)
+		VISITED_MAP& visitedSegments, int targetEndX, int targetEndY, RouteSegmentIndex segmentIndex)
 {
-	SHARED_PTR<RouteDataObject> const & road = segment->road;
-	int start = segment->segmentStart;
-	int roadDirection = ctx->config.router.isOneWay(road);
+	RouteSegmentPool const & pool = ctx->segments;
+	RouteSegment const & segment = pool[segmentIndex];
+	SHARED_PTR<RouteDataObject> const & road = pool.road(segment);
+	int start = segment.segmentStart;
+	RoadAttributes const attributes = ctx->attributes.road(segment.road, road);
+	int roadDirection = attributes.oneway;
 	if (TRACE_ROUTING)
 	{
 		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Debug,
@@ -672,59 +742,63 @@ bool _processRouteSegment(RoutingContext* ctx, SEGMENTS_QUEUE& graphSegments,
 				"\n\t\tspeed=%f prio=%f roadDirection=%d"
 				"\n\t\tf{g+h}=%f{%f+%f}",
 				road->id, road->pointsX.size(), start, road->getName().c_str(),
-				ctx->config.router.defineRoutingSpeed(road), ctx->config.router.defineSpeedPriority(road), roadDirection,
-				segment->distanceFromStart+segment->distanceToEnd, segment->distanceFromStart, segment->distanceToEnd);
+				attributes.speed, attributes.priority, roadDirection,
+				segment.distanceFromStart+segment.distanceToEnd, segment.distanceFromStart, segment.distanceToEnd);
 	}
 
 	if ( (roadDirection >= 0) && start < (road->pointsX.size()-1) )
 	{
 		// We have bigger indexes to visit.
 		double obstacleTime = 0;
-		if (segment->parentRoute != NULL)
+		if (segment.parentRoute != NO_SEGMENT)
 		{
-			obstacleTime = ctx->config.router.calculateTurnTime(segment, road->pointsX.size()-1,
-					segment->parentRoute, segment->parentSegmentEnd);
+			RouteSegment const & parent = pool[segment.parentRoute];
+			obstacleTime = ctx->config.router.calculateTurnTime(road, start, road->pointsX.size()-1, attributes.penaltyTransition,
+					pool.road(parent), parent.segmentStart, segment.parentSegmentEnd,
+					ctx->attributes.road(parent.road, pool.road(parent)).penaltyTransition);
 		}
-		if (_visitRouteSegment(ctx, graphSegments, visitedSegments, targetEndX, targetEndY,	segment, 1, obstacleTime))
+		if (_visitRouteSegment(ctx, graphSegments, visitedSegments, targetEndX, targetEndY,	segmentIndex, 1, obstacleTime))
 			return true;
 	}
 	if ( (roadDirection <= 0) && start > 0 )
 	{
 		// We have smaller indexes to visit
 		double obstacleTime = 0;
-		if (segment->parentRoute != NULL)
+		if (segment.parentRoute != NO_SEGMENT)
 		{
-			obstacleTime = ctx->config.router.calculateTurnTime(segment, 0,
-					segment->parentRoute, segment->parentSegmentEnd);
+			RouteSegment const & parent = pool[segment.parentRoute];
+			obstacleTime = ctx->config.router.calculateTurnTime(road, start, 0, attributes.penaltyTransition,
+					pool.road(parent), parent.segmentStart, segment.parentSegmentEnd,
+					ctx->attributes.road(parent.road, pool.road(parent)).penaltyTransition);
 		}
-		if (_visitRouteSegment(ctx, graphSegments, visitedSegments, targetEndX, targetEndY,	segment, -1, obstacleTime))
+		if (_visitRouteSegment(ctx, graphSegments, visitedSegments, targetEndX, targetEndY,	segmentIndex, -1, obstacleTime))
 			return true;
 	}
 	return false;
 }
 
 void _searchRouteInternal(RoutingContext* ctx,
-		SHARED_PTR<RouteSegment> const & start, SHARED_PTR<RouteSegment> const & end)
+		RouteSegmentIndex start, RouteSegmentIndex end)
 {
 	// FIXME intermediate points
 	// measure time
 	ctx->visitedSegments = 0;
 	ctx->timeToCalculate.Start();
 
-	SegmentsComparator sgmCmp;
-	SEGMENTS_QUEUE graphSegments(sgmCmp);
+	RouteSegmentPool & pool = ctx->segments;
+	SEGMENTS_QUEUE graphSegments(pool);
 
 	// Set to not visit one segment twice (stores road.id << X + segmentStart)
 	// Closedset empty
 	VISITED_MAP visitedSegments;
 
 	// for start : f(start) = g(start) + h(start) = 0 + h(start) = h(start)
-	int targetEndX = end->road->pointsX[end->segmentStart];
-	int targetEndY = end->road->pointsY[end->segmentStart];
-	int startX = start->road->pointsX[start->segmentStart];
-	int startY = start->road->pointsY[start->segmentStart];
+	int targetEndX = pool.road(end)->pointsX[pool[end].segmentStart];
+	int targetEndY = pool.road(end)->pointsY[pool[end].segmentStart];
+	int startX = pool.road(start)->pointsX[pool[start].segmentStart];
+	int startY = pool.road(start)->pointsY[pool[start].segmentStart];
 	// f(start) = g(start) + h(start) = 0 + h(start)   g(x) -> x.distanceFromStart h(x) -> x.distanceToEnd
-	start->distanceToEnd = h(ctx, targetEndX, targetEndY, startX, startY);
+	pool[start].distanceToEnd = h(ctx, targetEndX, targetEndY, startX, startY);
 	// add start to openset
 	graphSegments.push(start);
 	// Path from is empty. path(x) -> x.parentRoute
@@ -732,14 +806,14 @@ void _searchRouteInternal(RoutingContext* ctx,
 	while (!graphSegments.empty())
 	{
 		// Select node with minimal f(x)
-		SHARED_PTR<RouteSegment> segment = graphSegments.top();
+		RouteSegmentIndex segment = graphSegments.top();
 
-		if (_checkSolution(ctx, segment, segment->segmentStart, targetEndX, targetEndY)) break; // Solution found
+		if (_checkSolution(ctx, segment, pool[segment].segmentStart, targetEndX, targetEndY)) break; // Solution found
 
 		// Remove from openset
 		graphSegments.pop();
 		// Add to closed
-		int64_t nt = (segment->road->id << ROUTE_POINTS) + segment->segmentStart;
+		int64_t nt = (pool.road(segment)->id << ROUTE_POINTS) + pool[segment].segmentStart;
 		visitedSegments[nt] = segment;
 		ctx->visitedSegments++;
 
@@ -749,7 +823,7 @@ void _searchRouteInternal(RoutingContext* ctx,
 
 		if (ctx->progress != NULL && (visitedSegments.size()%100) == 0)
 		{
-			ctx->progress->updateStatus(graphSegments.empty()? 0 :graphSegments.top()->distanceFromStart,
+			ctx->progress->updateStatus(graphSegments.empty()? 0 :pool[graphSegments.top()].distanceFromStart,
 					graphSegments.size(),
 					0,
 					0);
@@ -764,7 +838,7 @@ void _searchRouteInternal(RoutingContext* ctx,
 			graphSegments.size(),0);
 	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "[Native] Result timing (time to load %d, time to calc %d, loaded tiles %d) ",
 			ctx->timeToLoad.GetElapsedMs(), ctx->timeToCalculate.GetElapsedMs(), ctx->loadedMapChunks());
-	int sz = calculateSizeOfSearchMaps(graphSegments, SEGMENTS_QUEUE(sgmCmp), visitedSegments, VISITED_MAP());
+	int sz = calculateSizeOfSearchMaps(graphSegments, SEGMENTS_QUEUE(pool), visitedSegments, VISITED_MAP());
 	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "[Native] Memory occupied (Routing context %d Kb, search %d Kb)", ctx->memorySize()/1024, sz/1024);
 }
 #endif
@@ -807,12 +881,13 @@ void attachConnectedRoads(RoutingContext* ctx, std::vector<RouteSegmentResult>&
 		int advance = (it->startPointIndex < it->endPointIndex)?1:-1;
 		int j = it->startPointIndex;
 		do {
-			SHARED_PTR<RouteSegment> s = ctx->loadRouteSegment(it->object->pointsX[j], it->object->pointsY[j]);
+			RouteSegmentIndex s = ctx->loadRouteSegment(it->object->pointsX[j], it->object->pointsY[j]);
 			std::vector<RouteSegmentResult> r;
-			while(s != NULL)
+			while(s != NO_SEGMENT)
 			{
-				r.push_back(RouteSegmentResult(s->road, s->getSegmentStart(), s->getSegmentStart()));
-				s = s->next;
+				RouteSegment const & segment = ctx->segments[s];
+				r.push_back(RouteSegmentResult(ctx->segments.road(segment), segment.getSegmentStart(), segment.getSegmentStart()));
+				s = segment.next;
 			}
 			it->attachedRoutes.push_back(std::move(r));
 			j += advance;
@@ -825,29 +900,31 @@ std::vector<RouteSegmentResult> convertFinalSegmentToResults(RoutingContext* ctx
 	if (ctx->finalRouteSegment != NULL) {
 		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Routing calculated time distance %f", ctx->finalRouteSegment->distanceFromStart);
 		FinalRouteSegment * const finalSegment = ctx->finalRouteSegment.get();
+		RouteSegmentPool const & pool = ctx->segments;
+		RouteSegment const & opposite = pool[finalSegment->opposite];
 
 		// Get results from direct direction roads
-		SHARED_PTR<RouteSegment> segment = finalSegment->reverseWaySearch ? finalSegment->opposite->parentRoute : finalSegment->direct;
+		RouteSegmentIndex segment = finalSegment->reverseWaySearch ? opposite.parentRoute : finalSegment->direct;
 		int parentSegmentEnd =
 				finalSegment->reverseWaySearch ?
-						finalSegment->opposite->parentSegmentEnd : finalSegment->opposite->getSegmentStart();
-		while (segment != NULL) {
-			RouteSegmentResult res(segment->road, segment->getSegmentStart(), parentSegmentEnd);
-			parentSegmentEnd = segment->parentSegmentEnd;
-			segment = segment->parentRoute;
+						opposite.parentSegmentEnd : opposite.getSegmentStart();
+		while (segment != NO_SEGMENT) {
+			RouteSegmentResult res(pool.road(segment), pool[segment].getSegmentStart(), parentSegmentEnd);
+			parentSegmentEnd = pool[segment].parentSegmentEnd;
+			segment = pool[segment].parentRoute;
 			addRouteSegmentToResult(result, res);
 		}
 		std::reverse(result.begin(), result.end());
 
 		// Get results from opposite direction roads
-		segment = finalSegment->reverseWaySearch ? finalSegment->direct : finalSegment->opposite->parentRoute;
+		segment = finalSegment->reverseWaySearch ? finalSegment->direct : opposite.parentRoute;
 		int parentSegmentStart =
 				finalSegment->reverseWaySearch ?
-						finalSegment->opposite->getSegmentStart() : finalSegment->opposite->parentSegmentEnd;
-		while (segment != NULL) {
-			RouteSegmentResult res(segment->road, parentSegmentStart, segment->getSegmentStart());
-			parentSegmentStart = segment->parentSegmentEnd;
-			segment = segment->parentRoute;
+						opposite.getSegmentStart() : opposite.parentSegmentEnd;
+		while (segment != NO_SEGMENT) {
+			RouteSegmentResult res(pool.road(segment), parentSegmentStart, pool[segment].getSegmentStart());
+			parentSegmentStart = pool[segment].parentSegmentEnd;
+			segment = pool[segment].parentRoute;
 			addRouteSegmentToResult(result, res);
 		}
 	}
@@ -855,36 +932,299 @@ std::vector<RouteSegmentResult> convertFinalSegmentToResults(RoutingContext* ctx
 	return result;
 }
 
+// Nodes of graph reached along the road of segment i from its point, or
+// arriving at it, in each direction the road allows; and the point of the
+// road at each node.
+template <typename GRAPH>
+static void nodesAccess(RoutingContext* ctx, GRAPH const & graph, RouteSegmentIndex i, bool arriving,
+		std::vector<HierarchyAccess> & access, std::vector<int> & points)
+{
+	SHARED_PTR<RouteDataObject> const & road = ctx->segments.road(i);
+	int point = ctx->segments[i].segmentStart;
+	int oneway = ctx->attributes.road(ctx->segments[i].road, road).oneway;
+	for (int delta = -1; delta <= 1; delta += 2) {
+		bool forward = (delta > 0) != arriving;
+		if (forward ? oneway < 0 : oneway > 0)
+			continue;
+		for (int p = point; p >= 0 && p < (int) road->pointsX.size(); p += delta) {
+			uint32_t n = graph.node(road->pointsX[p], road->pointsY[p]);
+			if (n == ContractionHierarchy::NONE)
+				continue;
+			HierarchyAccess a = { n, (float) (arriving ?
+					roadStretchTime(ctx->attributes, ctx->config.router, *road, p, point) :
+					roadStretchTime(ctx->attributes, ctx->config.router, *road, point, p)) };
+			access.push_back(a);
+			points.push_back(p);
+			break;
+		}
+	}
+}
+
+// Point of the road closest to near that is at x, y
+static int roadPoint(RouteDataObject const & road, int near, uint32_t x31, uint32_t y31)
+{
+	// Points of projected roads are moved by the points put in
+	for (int d = 0; d <= 2; d++) {
+		for (int p = near - d; p <= near + d; p += 2 * d) {
+			if (p >= 0 && p < (int) road.pointsX.size() && road.pointsX[p] == x31 && road.pointsY[p] == y31)
+				return p;
+			if (d == 0)
+				break;
+		}
+	}
+	return -1;
+}
+
+struct HierarchyLeg {
+	uint32_t road; // in the pool
+	int from;
+	int to;
+};
+
+// Original edge e on the roads of the pool
+static bool hierarchyLeg(RoutingContext* ctx, uint32_t e, HierarchyLeg & leg)
+{
+	ContractionHierarchy const & ch = *ctx->config.hierarchy;
+	ContractionHierarchy::Edge const & edge = ch.edges[e];
+	ContractionHierarchy::Piece const & piece = ch.pieces[edge.first];
+	RouteSegmentPool const & pool = ctx->segments;
+	RouteSegmentIndex s = ctx->loadRouteSegment(ch.nodeX[edge.from], ch.nodeY[edge.from]);
+	for (; s != NO_SEGMENT; s = pool[s].next) {
+		if (pool.road(s)->id != piece.road)
+			continue;
+		int from = roadPoint(*pool.road(s), piece.from, ch.nodeX[edge.from], ch.nodeY[edge.from]);
+		if (from < 0)
+			continue;
+		leg.road = pool[s].road;
+		leg.from = from;
+		leg.to = roadPoint(*pool.road(s), piece.to + from - piece.from, ch.nodeX[edge.to], ch.nodeY[edge.to]);
+		return leg.to >= 0;
+	}
+	return false;
+}
+
+// Route over the contraction hierarchy of the configuration: along the
+// start road to its nodes, up the hierarchy from them and from the nodes
+// of the end road, then down. The route is left in the pool as the road
+// search leaves it, as one chain from start to end.
+void searchHierarchyRoute(RoutingContext* ctx, RouteSegmentIndex start, RouteSegmentIndex end)
+{
+	ctx->timeToCalculate.Start();
+	RouteSegmentPool & pool = ctx->segments;
+	std::vector<HierarchyAccess> sources;
+	std::vector<HierarchyAccess> targets;
+	std::vector<int> sourcePoints;
+	std::vector<int> targetPoints;
+	nodesAccess(ctx, *ctx->config.hierarchy, start, false, sources, sourcePoints);
+	nodesAccess(ctx, *ctx->config.hierarchy, end, true, targets, targetPoints);
+
+	// Both ends on one road: the route may not reach any node
+	SHARED_PTR<RouteDataObject> const & endRoad = pool.road(end);
+	float direct = std::numeric_limits<float>::infinity();
+	int directFrom = -1;
+	if (pool.road(start)->id == endRoad->id) {
+		directFrom = roadPoint(*endRoad, pool[start].segmentStart,
+				pool.road(start)->pointsX[pool[start].segmentStart], pool.road(start)->pointsY[pool[start].segmentStart]);
+		int oneway = ctx->attributes.road(pool[end].road, endRoad).oneway;
+		if (directFrom >= 0 && (directFrom <= pool[end].segmentStart ? oneway >= 0 : oneway <= 0)) {
+			direct = roadStretchTime(ctx->attributes, ctx->config.router, *endRoad, directFrom, pool[end].segmentStart);
+		}
+	}
+
+	HierarchyPlanner planner(*ctx->config.hierarchy);
+	HierarchyPath path;
+	std::vector<HierarchyLeg> legs;
+	float time = direct;
+	if (planner.plan(sources, targets, direct, path)) {
+		time = path.time;
+		size_t s = 0;
+		while (sources[s].node != path.source)
+			s++;
+		HierarchyLeg first = { pool[start].road, pool[start].segmentStart, sourcePoints[s] };
+		legs.push_back(first);
+		for (size_t i = 0; i < path.edges.size(); i++) {
+			HierarchyLeg leg;
+			if (!hierarchyLeg(ctx, path.edges[i], leg)) {
+				OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Road %lld of the contraction hierarchy is not in the map",
+						ctx->config.hierarchy->pieces[ctx->config.hierarchy->edges[path.edges[i]].first].road);
+				ctx->timeToCalculate.Pause();
+				return;
+			}
+			legs.push_back(leg);
+		}
+		size_t t = 0;
+		while (targets[t].node != path.target)
+			t++;
+		HierarchyLeg last = { pool[end].road, targetPoints[t], pool[end].segmentStart };
+		legs.push_back(last);
+	} else if (directFrom >= 0 && direct < std::numeric_limits<float>::infinity()) {
+		HierarchyLeg leg = { pool[end].road, directFrom, pool[end].segmentStart };
+		legs.push_back(leg);
+	}
+	ctx->visitedSegments = planner.settledNodes();
+	ctx->timeToCalculate.Pause();
+	if (legs.empty())
+		return;
+
+	RouteSegmentIndex segment = NO_SEGMENT;
+	for (size_t i = 0; i < legs.size(); i++) {
+		RouteSegment s(legs[i].road, legs[i].from);
+		s.parentRoute = segment;
+		s.parentSegmentEnd = i == 0 ? 0 : legs[i - 1].to;
+		segment = pool.addSearch(s);
+	}
+	SHARED_PTR<FinalRouteSegment> frs = SHARED_PTR<FinalRouteSegment>(new FinalRouteSegment);
+	frs->direct = segment;
+	frs->reverseWaySearch = false;
+	frs->opposite = pool.addSearch(RouteSegment(legs.back().road, legs.back().to));
+	frs->distanceFromStart = time;
+	ctx->finalRouteSegment = frs;
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "[Native] Result over the contraction hierarchy (%d nodes settled, %d roads, time to calc %d)",
+			(int) planner.settledNodes(), (int) legs.size(), ctx->timeToCalculate.GetElapsedMs());
+}
+
 std::vector<RouteSegmentResult> searchRouteInternal(RoutingContext* ctx, bool leftSideNavigation) {
-	SHARED_PTR<RouteSegment> start = ctx->findRouteSegment(ctx->startX, ctx->startY);
-	if (start == NULL) {
+	// Decoded map nodes are dropped beyond this limit, unless the process set its own
+	setDefaultNodeCacheLimit(ctx->config.memoryLimitation > 0 ? (size_t) ctx->config.memoryLimitation * 1024 * 1024 : 0);
+	if (!ctx->config.hierarchy && !ctx->config.hierarchyFile.empty()) {
+		// NULL unless it goes with the files and profile, the road search is then used
+		ctx->config.hierarchy = loadContractionHierarchy(ctx->config.hierarchyFile, ctx->routingFiles(), ctx->config.router);
+	}
+	if (ctx->config.hierarchy && ctx->config.hierarchy->turns != 0) {
+		// Its routes could take turns the road search forbids or costs more
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "The hierarchy ignores turns of the roads, the road search is used");
+		ctx->config.hierarchy.reset();
+	}
+	if (!ctx->config.hierarchy && !ctx->config.landmarks && !ctx->config.landmarksFile.empty()) {
+		ctx->config.landmarks = loadRouteLandmarks(ctx->config.landmarksFile, ctx->routingFiles(), ctx->config.router);
+	}
+	// Connections loaded by an earlier search are kept, not what it reached
+	ctx->segments.resetSearch();
+	ctx->finalRouteSegment.reset();
+	RouteSegmentIndex start = ctx->findRouteSegment(ctx->startX, ctx->startY);
+	if (start == NO_SEGMENT) {
 		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "Start point was not found [Native]");
 		if (ctx->progress != NULL) {
 			ctx->progress->setSegmentNotFound(0);
 		}
 		return std::vector<RouteSegmentResult>();
 	} else {
-		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "Start point was found %lld [Native]", start->road->id);
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "Start point was found %lld [Native]", ctx->segments.road(start)->id);
 	}
-	SHARED_PTR<RouteSegment> end = ctx->findRouteSegment(ctx->targetX, ctx->targetY);
-	if (end == NULL) {
+	RouteSegmentIndex end = ctx->findRouteSegment(ctx->targetX, ctx->targetY);
+	if (end == NO_SEGMENT) {
 		if(ctx->progress != NULL) {
 			ctx->progress->setSegmentNotFound(1);
 		}
 		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "End point was not found [Native]");
 		return std::vector<RouteSegmentResult>();
 	} else {
-		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "End point was found %lld [Native]", end->road->id);
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "End point was found %lld [Native]", ctx->segments.road(end)->id);
 	}
 
+	if (ctx->config.hierarchy) {
+		searchHierarchyRoute(ctx, start, end);
+	} else {
+		if (ctx->config.landmarks) {
+			std::vector<HierarchyAccess> sources;
+			std::vector<HierarchyAccess> targets;
+			std::vector<int> points;
+			nodesAccess(ctx, *ctx->config.landmarks, start, false, sources, points);
+			nodesAccess(ctx, *ctx->config.landmarks, end, true, targets, points);
+			ctx->landmarkBounds.reset(ctx->config.landmarks.get(), sources, targets);
+		}
 #ifndef UNI_REF_ALGO
-	// Bidirectional search
-	searchRouteInternal(ctx, start, end, leftSideNavigation);
+		// Bidirectional search
+		if (ctx->config.openSet == RoutingOpenSet::PRIORITY_QUEUE) {
+			searchRouteInternal<SegmentsPriorityQueue>(ctx, start, end, leftSideNavigation);
+		} else {
+			searchRouteInternal<SegmentsHeap>(ctx, start, end, leftSideNavigation);
+		}
 #else
-	// Unidirectional search
-	_searchRouteInternal(ctx, start, end);
+		// Unidirectional search
+		_searchRouteInternal(ctx, start, end);
 #endif // UNI_REF_ALGO
+	}
 	std::vector<RouteSegmentResult> res = convertFinalSegmentToResults(ctx);
 	attachConnectedRoads(ctx, res);
 	return res;
 }
+
+// Planners left by searches, for the next ones on the same network: a
+// planner allocates arrays as large as its network. Each is used by one
+// search at a time, as planners are not thread safe.
+static std::vector<SHARED_PTR<TransitPlanner> > idlePlanners;
+static std::mutex idlePlannersLock;
+
+static SHARED_PTR<TransitPlanner> takePlanner(TransportNetwork_pointer const & network) {
+	{
+		std::lock_guard<std::mutex> lock(idlePlannersLock);
+		for (size_t i = 0; i < idlePlanners.size(); i++) {
+			if (idlePlanners[i]->plannedNetwork() == network) {
+				SHARED_PTR<TransitPlanner> planner = idlePlanners[i];
+				idlePlanners[i] = idlePlanners.back();
+				idlePlanners.pop_back();
+				return planner;
+			}
+		}
+	}
+	return SHARED_PTR<TransitPlanner>(new TransitPlanner(network));
+}
+
+static void giveBackPlanner(SHARED_PTR<TransitPlanner> const & planner) {
+	std::lock_guard<std::mutex> lock(idlePlannersLock);
+	// Networks only idle planners hold are gone from their index (file
+	// closed or schedule changed): no search will ask for them again
+	std::vector<SHARED_PTR<TransitPlanner> > kept;
+	for (size_t i = 0; i < idlePlanners.size(); i++) {
+		TransportNetwork_pointer const & network = idlePlanners[i]->plannedNetwork();
+		long idle = std::count_if(idlePlanners.begin(), idlePlanners.end(),
+				[&network](SHARED_PTR<TransitPlanner> const & p) { return p->plannedNetwork() == network; });
+		if (network.use_count() > idle) {
+			kept.push_back(idlePlanners[i]);
+		}
+	}
+	kept.push_back(planner);
+	idlePlanners.swap(kept);
+}
+
+bool searchTransitRoute(TransitQuery const & q, TransitJourney & journey) {
+	using boost::geometry::intersects;
+
+	MapFilesSnapshot_pointer mapFiles = currentMapFiles();
+	bool found = false;
+	// Stops of an index can be walked to from a bit outside of it
+	uint32_t walk = TransportNetwork::xWindow(q.walkRadius);
+	bbox_t from(point_t(q.fromX - std::min(walk, q.fromX), q.fromY - std::min(walk, q.fromY)),
+			point_t(q.fromX + walk, q.fromY + walk));
+	bbox_t to(point_t(q.toX - std::min(walk, q.toX), q.toY - std::min(walk, q.toY)),
+			point_t(q.toX + walk, q.toY + walk));
+	MapFilesSnapshot::Files_t::const_iterator it = mapFiles->files.begin();
+	for (; it != mapFiles->files.end(); it++) {
+		BinaryMapFile const * file = it->second.get();
+		for (size_t i = 0; i < file->transportIndexes.size(); i++) {
+			TransportIndex const * index = file->transportIndexes[i];
+			// Journeys do not go from one index to another
+			if (!intersects(from, index->Box()) || !intersects(to, index->Box())) {
+				continue;
+			}
+			TransportNetwork_pointer network = index->network();
+			if (!network || network->stopsCount() == 0) {
+				continue;
+			}
+			// plan() resets what the last query on the planner changed
+			SHARED_PTR<TransitPlanner> planner = takePlanner(network);
+			TransitJourney j;
+			if (planner->plan(q, j) && (!found || j.arrival < journey.arrival
+					|| (j.arrival == journey.arrival && j.rides() < journey.rides()))) {
+				journey = j;
+				found = true;
+			}
+			giveBackPlanner(planner);
+		}
+	}
+	if (!found) {
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Warning, "No transit journey was found [Native]");
+	}
+	return found;
+}
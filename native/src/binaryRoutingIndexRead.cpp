@@ -9,12 +9,12 @@
 #include "binaryRead.h"
 
 #include "proto/osmand_odb.pb.h"
+#include "proto/osmand_index.pb.h"
 #include "proto/utils.hpp"
+#include "MappedFile.hpp"
 
 ////
 // EXTERNAL
-extern std::map< std::string, BinaryMapFile* > openFiles;
-typedef std::vector<std::string> StringTable_t;
 bool readStringTable(CodedInputStream & input, StringTable_t & list);
 
 //////////////////////////
@@ -25,19 +25,20 @@ const static int RESTRICTION_MASK = 7;
 static const int ROUTE_SHIFT_COORDINATES = 4;
 
 using google::protobuf::io::CodedInputStream;
-using google::protobuf::io::FileInputStream;
 using google::protobuf::internal::WireFormatLite;
 
 void searchRouteDataForSubRegion(SearchQuery const * q, RouteDataObjects_t & list,
 		RouteSubregion const & sub)
 {
-	std::map<std::string, BinaryMapFile*>::const_iterator i = openFiles.begin();
+	MapFilesSnapshot_pointer mapFiles = currentMapFiles();
+	nodeCacheTick();
+	MapFilesSnapshot::Files_t::const_iterator i = mapFiles->files.begin();
 	RoutingIndex const * rs = sub.routingIndex;
-	for (; i != openFiles.end() && !q->publisher->isCancelled(); i++) {
-		BinaryMapFile* file = i->second;
+	for (; i != mapFiles->files.end() && !q->cancelled(); i++) {
+		BinaryMapFile* file = i->second.get();
 		for (std::vector<RoutingIndex*>::iterator routingIndex = file->routingIndexes.begin();
 				routingIndex != file->routingIndexes.end(); routingIndex++) {
-			if (q->publisher->isCancelled()) {
+			if (q->cancelled()) {
 				break;
 			}
 			if (rs != NULL && (rs->name != (*routingIndex)->name)){
@@ -46,8 +47,11 @@ void searchRouteDataForSubRegion(SearchQuery const * q, RouteDataObjects_t & lis
 			////searchRouteSubRegion(file->routefd, list, (*routingIndex), sub);
 			// TODO I don't know if base map is requested.
 			//routingIndex->query(sub->Box(), true, list);
-			(*routingIndex)->querySub(sub.Box(), false, list);
+			(*routingIndex)->querySub(sub.Box(), false, list, mapFiles->overlay(file));
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "dataObject #list %d", list.size());
+			if (nodeCacheOverLimit()) {
+				trimNodeCache();
+			}
 			return;
 		}
 	}
@@ -85,6 +89,30 @@ bool readRouteEncodingRule(CodedInputStream & input, RoutingIndex & index, uint3
 }
 
 ////
+// One object as it is read. Reused for every object of a block so
+// reading does not allocate per object once it has warmed up.
+struct RouteDataDraft
+{
+	int64_t id;
+	bbox_t box;
+	std::vector<uint32_t> types;
+	std::vector<uint32_t> pointsX;
+	std::vector<uint32_t> pointsY;
+	std::vector<std::vector<uint32_t> > pointTypes;
+	std::vector<std::pair<uint32_t, uint32_t> > namesIds;
+
+	void clear()
+	{
+		id = 0;
+		box = bbox_t(point_t(INT_MAX, INT_MAX), point_t(-1, -1));
+		types.clear();
+		pointsX.clear();
+		pointsY.clear();
+		pointTypes.clear();
+		namesIds.clear();
+	}
+};
+
 void updatePointTypes(std::vector<std::vector<uint32_t> > & pointTypes, std::vector<size_t> const & skipped)
 {
 	for (size_t i = 0; i < skipped.size(); ++i)
@@ -115,72 +143,66 @@ bool readRouteTypes(CodedInputStream & input, SEQ & output)
 	return true;
 }
 
-bool readRoutePoints(CodedInputStream & input, RouteDataObject * output,
+bool readRoutePoints(CodedInputStream & input, RouteDataDraft & output,
 		RouteSubregion const & context, std::vector<size_t> & skipped)
 {
 	LDMessage<> inputManager(input);
 	int px = context.Box().min_corner().x() >> ROUTE_SHIFT_COORDINATES;
 	int py = context.Box().min_corner().y() >> ROUTE_SHIFT_COORDINATES;
-	bbox_t box = output->Box();
-	output->pointsX.reserve(5);
-	output->pointsY.reserve(5);
-	while (input.BytesUntilLimit() > 0)
-	{
-		int deltaX, deltaY;
-		readSint32(input, deltaX);
-		readSint32(input, deltaY);
-		if (deltaX == 0 && deltaY == 0 && !output->pointsX.empty())
+	bbox_t box = output.box;
+	bool ok = readSint32Pairs(input, [&output, &skipped, &box, &px, &py](int deltaX, int deltaY)
+			{
+		if (deltaX == 0 && deltaY == 0 && !output.pointsX.empty())
 		{
-			skipped.push_back(output->pointsX.size());
-			continue;
+			skipped.push_back(output.pointsX.size());
+			return;
 		}
 
 		uint32_t x = deltaX + px;
 		uint32_t y = deltaY + py;
-		output->pointsX.push_back(x << ROUTE_SHIFT_COORDINATES);
-		output->pointsY.push_back(y << ROUTE_SHIFT_COORDINATES);
+		output.pointsX.push_back(x << ROUTE_SHIFT_COORDINATES);
+		output.pointsY.push_back(y << ROUTE_SHIFT_COORDINATES);
 		boost::geometry::expand(box, point_t(x << ROUTE_SHIFT_COORDINATES, y << ROUTE_SHIFT_COORDINATES));
 		px = x;
 		py = y;
-	}
-	output->Box(box);
-	return true;
+			});
+	output.box = box;
+	return ok;
 }
 
-bool readRouteNames(CodedInputStream & input, RouteDataObject * output)
+bool readRouteNames(CodedInputStream & input, RouteDataDraft & output)
 {
 	LDMessage<> inputManager(input);
-	output->namesIds.reserve(3);
 	uint32_t s;
 	uint32_t t;
 	while (input.BytesUntilLimit() > 0)
 	{
 		readUInt32(input, s);
 		readUInt32(input, t);
-		output->namesIds.push_back(std::make_pair(s, t));
+		output.namesIds.push_back(std::make_pair(s, t));
 	}
 	return true;
 }
 
-bool readRoutePTypes(CodedInputStream & input, RouteDataObject * output)
+bool readRoutePTypes(CodedInputStream & input, RouteDataDraft & output)
 {
 	LDMessage<> inputManager(input);
 	while (input.BytesUntilLimit() > 0)
 	{
 		uint32_t pointInd;
 		readUInt32(input, pointInd);
-		if (output->pointTypes.size() <= pointInd) {
-			output->pointTypes.resize(pointInd + 1, std::vector<uint32_t>());
+		if (output.pointTypes.size() <= pointInd) {
+			output.pointTypes.resize(pointInd + 1, std::vector<uint32_t>());
 		}
-		readRouteTypes(input, output->pointTypes[pointInd]);
+		readRouteTypes(input, output.pointTypes[pointInd]);
 	}
 	return true;
 }
 
-bool readRouteDataObject(CodedInputStream & input, RouteDataObject * output,
+bool readRouteDataObject(CodedInputStream & input, RouteDataDraft & output,
 		RouteSubregion const & context)
 {
-//std::cerr << "BEGIN readRDO pos " << input.TotalBytesRead() << " RDO dir " << output << std::endl;
+//std::cerr << "BEGIN readRDO pos " << input.TotalBytesRead() << std::endl;
 	LDMessage<> inputManager(input);
 	std::vector<size_t> skipped;
 	int tag;
@@ -189,10 +211,10 @@ bool readRouteDataObject(CodedInputStream & input, RouteDataObject * output,
 		switch (WireFormatLite::GetTagFieldNumber(tag))
 		{
 		case RouteData::kTypesFieldNumber:
-			readRouteTypes(input, output->types);
+			readRouteTypes(input, output.types);
 			break;
 		case RouteData::kRouteIdFieldNumber:
-			readInt64(input, output->id);
+			readInt64(input, output.id);
 			break;
 		case RouteData::kPointsFieldNumber:
 			readRoutePoints(input, output, context, skipped);
@@ -210,13 +232,11 @@ bool readRouteDataObject(CodedInputStream & input, RouteDataObject * output,
 			break;
 		}
 	} // end while
-	updatePointTypes(output->pointTypes, skipped);
-//std::cerr << "readRDO types #" << output->types.size() << std::endl;
-//std::cerr << "readRDO id " << output->id << std::endl;
-//std::cerr << "readRDO points #" << output->pointsX.size() << std::endl;
-//std::cerr << "readRDO namesIds #" << output->namesIds.size() << std::endl;
-//if (output->pointTypes.size() > 0)
-//	std::cerr << "readRDO Ptypes #" << output->pointTypes.size() << " when read #points " << output->pointsX.size() << std::endl;
+	updatePointTypes(output.pointTypes, skipped);
+//std::cerr << "readRDO types #" << output.types.size() << std::endl;
+//std::cerr << "readRDO id " << output.id << std::endl;
+//std::cerr << "readRDO points #" << output.pointsX.size() << std::endl;
+//std::cerr << "readRDO namesIds #" << output.namesIds.size() << std::endl;
 	return true;
 }
 
@@ -291,10 +311,11 @@ bool readIdTable(CodedInputStream & input, IdTable_t & output)
 }
 
 bool readRouteTreeBase(CodedInputStream & input, RouteSubregion & output,
-		RouteSubregion const * parentTree,	RoutingIndex * ind, int fd);
+		RouteSubregion const * parentTree,	RoutingIndex * ind, MappedFile const & file);
 
 // Reads children
-bool readRouteTreeNodes(CodedInputStream & input, RouteSubregion & output, RoutingIndex * ind, int fd)
+bool readRouteTreeNodes(CodedInputStream & input, RouteSubregion const & parent,
+		RouteSubregion::Content & output, RoutingIndex * ind, MappedFile const & file)
 {
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "readRouteTreeNodes from %d", input.TotalBytesRead());
 	LDMessage<OSMAND_FIXED32> inputManager(input);
@@ -307,7 +328,7 @@ bool readRouteTreeNodes(CodedInputStream & input, RouteSubregion & output, Routi
 		case OsmAndRoutingIndex_RouteDataBox::kBoxesFieldNumber:
 				{
 				RouteSubregion subregion(ind);
-				readRouteTreeBase(input, subregion, &output, ind, fd);
+				readRouteTreeBase(input, subregion, &parent, ind, file);
 				output.subregions.push_back(std::move(subregion));
 				}
 			break;
@@ -321,36 +342,83 @@ bool readRouteTreeNodes(CodedInputStream & input, RouteSubregion & output, Routi
 	return true;
 }
 
+// Where the data of one object went while its block is read.
+// Ranges index the arena, except names that wait for the string table.
+struct RouteDataRecord
+{
+	int64_t id; // inside the block
+	bbox_t box;
+	size_t types, typesEnd;
+	size_t points, pointsEnd;
+	size_t pointTypes, pointTypesEnd; // in pointTypeRanges
+	size_t names, namesEnd;
+};
+
+struct RouteDataBlock
+{
+	std::vector<RouteDataRecord> records;
+	std::vector<std::pair<size_t, size_t> > pointTypeRanges;
+	std::vector<std::pair<uint32_t, uint32_t> > namesIds;
+};
+
+template <typename T>
+static ArenaSpan<T> arenaSpan(std::vector<T> const & v, size_t begin, size_t end)
+{
+	return begin == end ? ArenaSpan<T>() : ArenaSpan<T>(&v[begin], end - begin);
+}
+
+static void appendRouteData(RouteDataDraft const & draft, RouteDataArena & arena, RouteDataBlock & block)
+{
+	RouteDataRecord r;
+	r.id = draft.id;
+	r.box = draft.box;
+	r.types = arena.types.size();
+	arena.types.insert(arena.types.end(), draft.types.begin(), draft.types.end());
+	r.typesEnd = arena.types.size();
+	r.points = arena.pointsX.size();
+	arena.pointsX.insert(arena.pointsX.end(), draft.pointsX.begin(), draft.pointsX.end());
+	arena.pointsY.insert(arena.pointsY.end(), draft.pointsY.begin(), draft.pointsY.end());
+	r.pointsEnd = arena.pointsX.size();
+	r.pointTypes = block.pointTypeRanges.size();
+	for (size_t p = 0; p < draft.pointTypes.size(); p++) {
+		std::vector<uint32_t> const & pt = draft.pointTypes[p];
+		size_t begin = arena.types.size();
+		arena.types.insert(arena.types.end(), pt.begin(), pt.end());
+		block.pointTypeRanges.push_back(std::make_pair(begin, arena.types.size()));
+	}
+	r.pointTypesEnd = block.pointTypeRanges.size();
+	r.names = block.namesIds.size();
+	block.namesIds.insert(block.namesIds.end(), draft.namesIds.begin(), draft.namesIds.end());
+	r.namesEnd = block.namesIds.size();
+	block.records.push_back(r);
+}
+
 // Reads DataObjects for this leaf node.
-bool readRouteTreeData(CodedInputStream & input, RouteSubregion & output, RoutingIndex* routingIndex)
+bool readRouteTreeData(CodedInputStream & input, RouteSubregion const & node,
+		RouteSubregion::Content & output, RoutingIndex* routingIndex)
 {
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "readRouteTreeData from %d", input.TotalBytesRead());
 	LDMessage<> inputManager(input);
-	RouteDataObjects_t dataObjects;
-	dataObjects.reserve(NODE_CAPACITY);
+	routingIndex->loadRules();
+	SHARED_PTR<RouteDataArena> arena(new RouteDataArena);
+	RouteDataBlock block;
+	block.records.reserve(NODE_CAPACITY);
+	RouteDataDraft draft;
 	IdTable_t idTables;
 	Restrictions_t restrictions;
-	std::vector<std::string> stringTable;
+	SHARED_PTR<StringTable_t> stringTable(new StringTable_t);
 	int tag;
 	while ((tag = input.ReadTag()) != 0)
 	{
 		switch (WireFormatLite::GetTagFieldNumber(tag))
 		{
 		case OsmAndRoutingIndex_RouteDataBlock::kDataObjectsFieldNumber:
-		{
-			RouteDataObject_pointer obj = RouteDataObject_pointer(new RouteDataObject);
-			// map reading routines will do a safe use of base pointer.
-			readRouteDataObject(input, obj.get(), output);
-			if (dataObjects.size() <= obj->id ) {
-				dataObjects.resize(obj->id + 1, NULL);//normally dataobject come ordered resize???
-//OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "id %d cap %d", obj->id, dataObjects.capacity());
-			}
-			obj->region = routingIndex;
-			dataObjects[obj->id] = obj;
-			}
+			draft.clear();
+			readRouteDataObject(input, draft, node);
+			appendRouteData(draft, *arena, block);
 			break;
 		case OsmAndRoutingIndex_RouteDataBlock::kStringTableFieldNumber:
-			readStringTable(input, stringTable);
+			readStringTable(input, *stringTable);
 			break;
 		case OsmAndRoutingIndex_RouteDataBlock::kRestrictionsFieldNumber:
 			readRestrictions(input, restrictions);
@@ -365,50 +433,94 @@ bool readRouteTreeData(CodedInputStream & input, RouteSubregion & output, Routin
 			break;
 		}
 	}  // end of while
-	// Moving restrictions to DataObjects
-	Restrictions_t::const_iterator itRestrictions = restrictions.begin();
-	for (; itRestrictions != restrictions.end(); itRestrictions++) {
-		RouteDataObject_pointer & fromr = dataObjects[itRestrictions->first]; // avoid using []
-		if (fromr != NULL) {
-			fromr->restrictions = itRestrictions->second;
-			for (size_t i = 0; i < fromr->restrictions.size(); i++) {
-				uint32_t to = fromr->restrictions[i] >> RESTRICTION_SHIFT;
-				uint64_t valto = (idTables[to] << RESTRICTION_SHIFT) | ((long) fromr->restrictions[i] & RESTRICTION_MASK);
-				fromr->restrictions[i] = valto;
+
+	// Restrictions and names need tables that can come after the objects.
+	// Arena only grows up to here. Views are taken once it is complete.
+	std::vector<RouteDataRecord> & records = block.records;
+	std::vector<std::pair<size_t, size_t> > restrictionRanges(records.size());
+	std::vector<std::pair<size_t, size_t> > namesRanges(records.size());
+	for (size_t i = 0; i < records.size(); i++) {
+		RouteDataRecord const & r = records[i];
+		restrictionRanges[i].first = arena->restrictions.size();
+		Restrictions_t::const_iterator itRestrictions = restrictions.find(r.id);
+		if (itRestrictions != restrictions.end()) {
+			std::vector<uint64_t> const & rs = itRestrictions->second;
+			for (size_t k = 0; k < rs.size(); k++) {
+				uint32_t to = rs[k] >> RESTRICTION_SHIFT;
+				int64_t toId = to < idTables.size() ? idTables[to] : to;
+				arena->restrictions.push_back((toId << RESTRICTION_SHIFT) | ((long) rs[k] & RESTRICTION_MASK));
 			}
 		}
-	}
-	RouteDataObjects_t::const_iterator dobj = dataObjects.begin();
-	for (; dobj != dataObjects.end(); dobj++) {
-		if (*dobj != NULL) {
-			if ((*dobj)->id < idTables.size()) {
-				(*dobj)->id = idTables[(*dobj)->id];
+		restrictionRanges[i].second = arena->restrictions.size();
+
+		// One name per tag. Last one wins.
+		size_t first = arena->namesIds.size();
+		for (size_t n = r.names; n < r.namesEnd; n++) {
+			std::pair<uint32_t, uint32_t> const & nameId = block.namesIds[n];
+			if (nameId.second >= stringTable->size()) {
+				OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "ERROR VALUE string table %d", nameId.second);
+				continue;
 			}
-			std::vector<std::pair<uint32_t, uint32_t> >::const_iterator itnames = (*dobj)->namesIds.begin();
-			for(; itnames != (*dobj)->namesIds.end(); itnames++) {
-				if((*itnames).second >= stringTable.size()) {
-					OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "ERROR VALUE string table %d", (*itnames).second );
-				} else {
-					(*dobj)->names[(int) (*itnames).first] = stringTable[(*itnames).second];
-				}
+			size_t k = first;
+			while (k < arena->namesIds.size() && arena->namesIds[k].first != nameId.first) {
+				k++;
+			}
+			if (k < arena->namesIds.size()) {
+				arena->namesIds[k] = nameId;
+			} else {
+				arena->namesIds.push_back(nameId);
 			}
 		}
+		namesRanges[i] = std::make_pair(first, arena->namesIds.size());
+	}
+	arena->stringTable = stringTable;
+
+	arena->pointTypes.reserve(block.pointTypeRanges.size());
+	for (size_t p = 0; p < block.pointTypeRanges.size(); p++) {
+		arena->pointTypes.push_back(arenaSpan(arena->types, block.pointTypeRanges[p].first, block.pointTypeRanges[p].second));
+	}
+
+	RouteDataObjects_t dataObjects;
+	dataObjects.reserve(NODE_CAPACITY);
+	arena->objects.resize(records.size());
+	for (size_t i = 0; i < records.size(); i++) {
+		RouteDataRecord const & r = records[i];
+		RouteDataObject & obj = arena->objects[i];
+		obj.region = routingIndex;
+		obj.id = r.id < (int64_t) idTables.size() ? idTables[r.id] : r.id;
+		obj.Box(r.box);
+		obj.types = arenaSpan(arena->types, r.types, r.typesEnd);
+		obj.pointsX = arenaSpan(arena->pointsX, r.points, r.pointsEnd);
+		obj.pointsY = arenaSpan(arena->pointsY, r.points, r.pointsEnd);
+		obj.pointTypes = arenaSpan(arena->pointTypes, r.pointTypes, r.pointTypesEnd);
+		obj.restrictions = arenaSpan(arena->restrictions, restrictionRanges[i].first, restrictionRanges[i].second);
+		obj.namesIds = arenaSpan(arena->namesIds, namesRanges[i].first, namesRanges[i].second);
+		obj.stringTable = stringTable;
+		if ((int64_t) dataObjects.size() <= r.id) {
+			dataObjects.resize(r.id + 1, NULL);//normally dataobject come ordered resize???
+		}
+		// Shares ownership of the whole arena. No allocation per object.
+		dataObjects[r.id] = RouteDataObject_pointer(arena, &obj);
 	}
 
-	output.DataObjects(std::move(dataObjects));
+	output.arena = arena;
+	output.dataObjects = std::move(dataObjects);
 
 	return true;
 }
 
+void installRouteTreeReader(RouteSubregion & output, RoutingIndex * ind, MappedFile const & file);
+
 // Reads the minimal data for a RTree node and prepare to read the rest.
 bool readRouteTreeBase(CodedInputStream & input, RouteSubregion & output,
-		RouteSubregion const * parentTree,	RoutingIndex * ind, int fd)
+		RouteSubregion const * parentTree,	RoutingIndex * ind, MappedFile const & file)
 {
-	uint32_t lPos = input.TotalBytesRead();
 	LDMessage<OSMAND_FIXED32> inputManager(input);
 	uint32_t mPos = input.TotalBytesRead();
 	uint32_t objectsOffset = 0; // Will be an intermediate node but if has ShiftToData
-//OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "New RouteSubregion filepos %d", lPos);
+	output.filePointer = mPos;
+	output.length = input.BytesUntilLimit();
+//OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "New RouteSubregion filepos %d", mPos);
 
 	// Start reading message fields
 	uint32_t tag;
@@ -450,40 +562,42 @@ bool readRouteTreeBase(CodedInputStream & input, RouteSubregion & output,
 	}  // End of while
 
 	output.Box(bbox_t(point_t(output.left, output.top), point_t(output.right, output.bottom)));
+	output.shiftToData = objectsOffset;
 //std::cerr << "Box read " << output.Box() << std::endl;
+	installRouteTreeReader(output, ind, file);
+	return true;
+}
+
+void installRouteTreeReader(RouteSubregion & output, RoutingIndex * ind, MappedFile const & file)
+{
+	uint32_t objectsOffset = output.shiftToData;
+	// Reader positions are the start of the length.
+	uint32_t lPos = output.filePointer - 4;
+	uint32_t mPos = output.filePointer;
 	if (objectsOffset == 0)
 	{  // An intermediate node.
-		output.ContentReader([lPos, ind, fd](RouteSubregion & output)
+		output.ContentReader([lPos, ind, &file](RouteSubregion const & node, RouteSubregion::Content & content)
 				{
-			int filed = dup(fd); // Duplicated fd to permit parallel access.
-			lseek(filed, 0, SEEK_SET); // need to start from begining
-			FileInputStream is(filed);
-			is.SetCloseOnDelete(true);
-			CodedInputStream input(&is);
+			CodedInputStream input(file.Data(), file.StreamSize());
 			input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
-			input.Seek(lPos); // Needed to correctelly set TotalBytesRead
-			readRouteTreeNodes(input, output, ind, fd);
+			input.Seek(lPos); // Positions are absolute inside the mapped file
+			readRouteTreeNodes(input, node, content, ind, file);
 				});
 	}
 	else
 	{  // A leaf node.
 		uint32_t pos = mPos+objectsOffset;
-		output.ContentReader([pos, ind, fd](RouteSubregion & output)
+		output.ContentReader([pos, ind, &file](RouteSubregion const & node, RouteSubregion::Content & content)
 				{
-			int filed = dup(fd); // Duplicated fd to permit parallel access.
-			lseek(filed, 0, SEEK_SET); // need to start from begining
-			FileInputStream is(filed);
-			is.SetCloseOnDelete(true);
-			CodedInputStream input(&is);
+			CodedInputStream input(file.Data(), file.StreamSize());
 			input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
-			input.Seek(pos); // Needed to correctelly set TotalBytesRead
-			readRouteTreeData(input, output, ind);
+			input.Seek(pos); // Positions are absolute inside the mapped file
+			readRouteTreeData(input, node, content, ind);
 				});
 	}
-	return true;
 }
 
-bool readRoutingIndex(CodedInputStream & input, RoutingIndex & output, int fd)
+bool readRoutingIndex(CodedInputStream & input, RoutingIndex & output, MappedFile const & file)
 {
 //OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "new RoutingIndex pos %d", input.TotalBytesRead());
     // TODO Remove filePointer and length ASAP
@@ -509,7 +623,7 @@ bool readRoutingIndex(CodedInputStream & input, RoutingIndex & output, int fd)
 		{
 			bool basemap = WireFormatLite::GetTagFieldNumber(tag) == OsmAndRoutingIndex::kBasemapBoxesFieldNumber;
 			RouteSubregion subregion(&output);
-			readRouteTreeBase(input, subregion, NULL, &output, fd);
+			readRouteTreeBase(input, subregion, NULL, &output, file);
 			if(basemap) {
 //std::cerr << "RSR is basemap" << std::endl;
 				output.basesubregions.push_back(std::move(subregion));
@@ -543,6 +657,76 @@ bool readRoutingIndex(CodedInputStream & input, RoutingIndex & output, int fd)
 	return true;
 }
 
+// Only encoding rules. Used by indexes opened from cache.
+bool readRoutingIndexRules(CodedInputStream & input, RoutingIndex & output)
+{
+	LDMessage<OSMAND_FIXED32> inputManager(input);
+	uint32_t defaultId = 1;
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndRoutingIndex::kRulesFieldNumber:
+			readRouteEncodingRule(input, output, defaultId++);
+			break ;
+		case OsmAndRoutingIndex::kBlocksFieldNumber:
+			// Finish reading
+			input.Skip(input.BytesUntilLimit());
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // end of while
+	return true;
+}
+
+// Builds the index from the cache without touching the file.
+// Rules and subregion nodes are read lazily.
+void initRoutingIndexFromCache(RoutingPart const & part, RoutingIndex & output,
+		MappedFile const & file)
+{
+	output.name = part.name();
+	output.filePointer = part.offset();
+	output.length = part.size();
+	// Cache offsets are just after the length.
+	uint32_t indexPos = part.offset() - 4;
+	RoutingIndex * index = &output;
+	output.RulesReader([indexPos, index, &file]()
+			{
+		CodedInputStream input(file.Data(), file.StreamSize());
+		input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+		input.Seek(indexPos);
+		readRoutingIndexRules(input, *index);
+			});
+
+	bbox_t box(output.Box());
+	for (int j = 0; j < part.subregions_size(); j++)
+	{
+		RoutingSubregion const & rs = part.subregions(j);
+		RouteSubregion subregion(&output);
+		subregion.left = rs.left();
+		subregion.right = rs.right();
+		subregion.top = rs.top();
+		subregion.bottom = rs.bottom();
+		subregion.filePointer = rs.offset();
+		subregion.length = rs.size();
+		subregion.shiftToData = rs.shiftodata();
+		subregion.Box(bbox_t(point_t(subregion.left, subregion.top), point_t(subregion.right, subregion.bottom)));
+		installRouteTreeReader(subregion, &output, file);
+		boost::geometry::expand(box, subregion.Box());
+		if (rs.basemap()) {
+			output.basesubregions.push_back(std::move(subregion));
+		} else {
+			output.subregions.push_back(std::move(subregion));
+		}
+	}
+	output.Box(box);
+}
+
 //// Fin RoutingIndex
 ////////////////////////
 
@@ -0,0 +1,293 @@
+/*
+ * binaryTransportIndexRead.cpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#include "TransportIndex.hpp"
+
+#include "proto/osmand_odb.pb.h"
+#include "proto/utils.hpp"
+#include "MappedFile.hpp"
+#include "Logging.h"
+
+///////////////////////////////
+// Stops are at zoom 24. Ids and coordinates of the stops of a route are
+// relative to the stop before, the first one to 0.
+static const int TRANSPORT_STOP_ZOOM = 24;
+
+// Transport messages come with either length codification, the tag tells.
+static CodedInputStream::Limit pushMessage(CodedInputStream & input, uint32_t tag)
+{
+	uint32_t length = 0;
+	if (WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_FIXED32_LENGTH_DELIMITED) {
+		readInt(input, length);
+	} else {
+		input.ReadVarint32(&length);
+	}
+	return input.PushLimit(length);
+}
+
+bool readTransportRouteStop(CodedInputStream & input, uint32_t stopTag, TransportLineStop & output,
+		int64_t & id, int32_t & x24, int32_t & y24)
+{
+	CodedInputStream::Limit old = pushMessage(input, stopTag);
+	int64_t sl;
+	int32_t si;
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case TransportRouteStop::kIdFieldNumber:
+			readSint64(input, sl);
+			id += sl;
+			break;
+		case TransportRouteStop::kDxFieldNumber:
+			readSint32(input, si);
+			x24 += si;
+			break;
+		case TransportRouteStop::kDyFieldNumber:
+			readSint32(input, si);
+			y24 += si;
+			break;
+		case TransportRouteStop::kNameFieldNumber:
+			readUInt32(input, output.name);
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	input.PopLimit(old);
+	output.id = id;
+	output.x = (uint32_t) x24 << (31 - TRANSPORT_STOP_ZOOM);
+	output.y = (uint32_t) y24 << (31 - TRANSPORT_STOP_ZOOM);
+	return true;
+}
+
+bool readTransportRoute(CodedInputStream & input, uint32_t routeTag, TransportLine & output)
+{
+	CodedInputStream::Limit old = pushMessage(input, routeTag);
+	// Each direction from 0
+	int64_t directId = 0, reverseId = 0;
+	int32_t directX = 0, directY = 0, reverseX = 0, reverseY = 0;
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case TransportRoute::kIdFieldNumber:
+			readUInt64(input, output.id);
+			break;
+		case TransportRoute::kTypeFieldNumber:
+			readUInt32(input, output.type);
+			break;
+		case TransportRoute::kOperatorFieldNumber:
+			readUInt32(input, output.operatorName);
+			break;
+		case TransportRoute::kRefFieldNumber:
+			WireFormatLite::ReadString(&input, &output.ref);
+			break;
+		case TransportRoute::kNameFieldNumber:
+			readUInt32(input, output.name);
+			break;
+		case TransportRoute::kDistanceFieldNumber:
+			readUInt32(input, output.distance);
+			break;
+		case TransportRoute::kDirectStopsFieldNumber:
+		{
+			TransportLineStop stop = { 0, 0, 0, 0 };
+			if (!readTransportRouteStop(input, tag, stop, directId, directX, directY)) {
+				return false;
+			}
+			output.directStops.push_back(stop);
+			break;
+		}
+		case TransportRoute::kReverseStopsFieldNumber:
+		{
+			TransportLineStop stop = { 0, 0, 0, 0 };
+			if (!readTransportRouteStop(input, tag, stop, reverseId, reverseX, reverseY)) {
+				return false;
+			}
+			output.reverseStops.push_back(stop);
+			break;
+		}
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	input.PopLimit(old);
+	return true;
+}
+
+bool readTransportRoutes(CodedInputStream & input, uint32_t routesTag, TransportLines & output)
+{
+	CodedInputStream::Limit old = pushMessage(input, routesTag);
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case TransportRoutes::kRoutesFieldNumber:
+			output.lines.push_back(TransportLine());
+			if (!readTransportRoute(input, tag, output.lines.back())) {
+				return false;
+			}
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	input.PopLimit(old);
+	return true;
+}
+
+bool readTransportStringTable(CodedInputStream & input, uint32_t tableTag, std::vector<std::string> & output)
+{
+	CodedInputStream::Limit old = pushMessage(input, tableTag);
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case StringTable::kSFieldNumber:
+			output.push_back(std::string());
+			WireFormatLite::ReadString(&input, &output.back());
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	input.PopLimit(old);
+	return true;
+}
+
+// Routes and names of the index. Stops are taken from the routes: the
+// stops tree is only for searching stops by area.
+bool readTransportLines(CodedInputStream & input, TransportIndex const & index, TransportLines & output)
+{
+	input.Seek(index.filePointer);
+	CodedInputStream::Limit old = input.PushLimit(index.length);
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndTransportIndex::kRoutesFieldNumber:
+			if (!readTransportRoutes(input, tag, output)) {
+				return false;
+			}
+			break;
+		case OsmAndTransportIndex::kStringTableFieldNumber:
+			if (!readTransportStringTable(input, tag, output.strings)) {
+				return false;
+			}
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	input.PopLimit(old);
+	return true;
+}
+
+// Only the bounds of the root of the stops tree
+bool readTransportStopsBounds(CodedInputStream & input, uint32_t treeTag, bbox_t & output)
+{
+	CodedInputStream::Limit old = pushMessage(input, treeTag);
+	int32_t left = 0, right = 0, top = 0, bottom = 0;
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case TransportStopsTree::kLeftFieldNumber:
+			readSint32(input, left);
+			break;
+		case TransportStopsTree::kRightFieldNumber:
+			readSint32(input, right);
+			break;
+		case TransportStopsTree::kTopFieldNumber:
+			readSint32(input, top);
+			break;
+		case TransportStopsTree::kBottomFieldNumber:
+			readSint32(input, bottom);
+			break;
+		case TransportStopsTree::kSubtreesFieldNumber:
+		case TransportStopsTree::kLeafsFieldNumber:
+			// Fast end
+			input.Skip(input.BytesUntilLimit());
+			break;
+		default:
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // End of while
+	input.PopLimit(old);
+	int const shift = 31 - TRANSPORT_STOP_ZOOM;
+	output = bbox_t(point_t((uint32_t) left << shift, (uint32_t) top << shift),
+			point_t(((uint32_t) right + 1) << shift, ((uint32_t) bottom + 1) << shift));
+	return true;
+}
+
+bool readTransportIndex(CodedInputStream & input, TransportIndex & output,
+		MappedFile const & file)
+{
+	LDMessage<OSMAND_FIXED32> inputManager(input);
+	output.filePointer = input.TotalBytesRead();
+	output.length = input.BytesUntilLimit();
+	uint32_t tag;
+	while ((tag = input.ReadTag()) != 0)
+	{
+		switch (WireFormatLite::GetTagFieldNumber(tag))
+		{
+		case OsmAndTransportIndex::kNameFieldNumber:
+			WireFormatLite::ReadString(&input, &output.name);
+			break;
+		case OsmAndTransportIndex::kStopsFieldNumber:
+		{
+			bbox_t box;
+			if (!readTransportStopsBounds(input, tag, box)) {
+				return false;
+			}
+			output.Box(box);
+			break;
+		}
+		default:
+			// Routes and names are read with the network
+			if (!skipUnknownFields(input, tag)) {
+				return false;
+			}
+			break;
+		}
+	}  // end of while
+
+	TransportIndex const & index = output;
+	output.LinesReader([&index, &file](TransportLines & lines)
+			{
+		CodedInputStream input(file.Data(), file.StreamSize());
+		input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+		if (!readTransportLines(input, index, lines)) {
+			OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Transport index %s could not be read",
+					index.name.c_str());
+		}
+			});
+	return true;
+}
@@ -2,9 +2,14 @@
 #define _OSMAND_GENERAL_ROUTER_CPP
 
 #include "generalRouter.h"
+#include <algorithm>
+#include <random>
+#include <map>
+#include <sstream>
 
 const int RouteAttributeExpression::LESS_EXPRESSION = 1;
 const int RouteAttributeExpression::GREAT_EXPRESSION = 1;
+uint32_t const RouteAttributeTable::NONE;
 
 float parseFloat(MAP_STR_STR & attributes, std::string const & key, float def) {
 	if(attributes.find(key) != attributes.end() && attributes[key] != "") {
@@ -210,11 +215,17 @@ double GeneralRouter::parseValueFromTag(uint id, std::string const & type, Gener
 	return res;
 }
 
-double GeneralRouter::calculateTurnTime(SHARED_PTR<RouteSegment> const & segment, int segmentEnd,
-		SHARED_PTR<RouteSegment> const & prev, int prevSegmentEnd) {
-	if(prev->road->pointTypes.size() > (uint)prevSegmentEnd && prev->road->pointTypes[prevSegmentEnd].size() > 0){
-		RoutingIndex* reg = prev->getRoad()->region;
-		std::vector<uint32_t> const & pt = prev->road->pointTypes[prevSegmentEnd];
+double GeneralRouter::calculateTurnTime(SHARED_PTR<RouteDataObject> const & road, int segmentStart, int segmentEnd,
+		SHARED_PTR<RouteDataObject> const & prev, int prevSegmentStart, int prevSegmentEnd) {
+	return calculateTurnTime(road, segmentStart, segmentEnd, definePenaltyTransition(road),
+			prev, prevSegmentStart, prevSegmentEnd, definePenaltyTransition(prev));
+}
+
+double GeneralRouter::calculateTurnTime(SHARED_PTR<RouteDataObject> const & road, int segmentStart, int segmentEnd, double ts,
+		SHARED_PTR<RouteDataObject> const & prev, int prevSegmentStart, int prevSegmentEnd, double prevTs) {
+	if(prev->pointTypes.size() > (uint)prevSegmentEnd && prev->pointTypes[prevSegmentEnd].size() > 0){
+		RoutingIndex* reg = prev->region;
+		RouteTypes_t const & pt = prev->pointTypes[prevSegmentEnd];
 		for (uint i = 0; i < pt.size(); i++) {
 			tag_value const & r = reg->decodingRules[pt[i]];
 			if ("highway" == r.first && "traffic_signals" == r.second) {
@@ -223,19 +234,17 @@ double GeneralRouter::calculateTurnTime(SHARED_PTR<RouteSegment> const & segment
 			}
 		}
 	}
-	double ts = definePenaltyTransition(segment->getRoad());
-	double prevTs = definePenaltyTransition(prev->getRoad());
 	if(ts > prevTs) return (ts - prevTs);
 
-	if(segment->getRoad()->roundabout() && !prev->getRoad()->roundabout()) {
+	if(road->roundabout() && !prev->roundabout()) {
 		double rt = roundaboutTurn;
 		if(rt > 0) {
 			return rt;
 		}
 	}
 	if (leftTurn > 0 || rightTurn > 0) {
-		double a1 = segment->getRoad()->directionRoute(segment->getSegmentStart(), segment->getSegmentStart() < segmentEnd);
-		double a2 = prev->getRoad()->directionRoute(prevSegmentEnd, prevSegmentEnd < prev->getSegmentStart());
+		double a1 = road->directionRoute(segmentStart, segmentStart < segmentEnd);
+		double a2 = prev->directionRoute(prevSegmentEnd, prevSegmentEnd < prevSegmentStart);
 		double diff = std::abs(alignAngleDifference(a1 - a2 - M_PI));
 		if (diff > 2 * M_PI / 3) {
 			return leftTurn;
@@ -261,17 +270,274 @@ uint GeneralRouter::registerTagValueAttribute(const tag_value& r) {
 	return id;
 }
 
-dynbitset RouteAttributeContext::convert(RoutingIndex* reg, std::vector<uint32_t>& types) const {
-	dynbitset b(router->universalRules.size());
+RoadAttributes GeneralRouter::defineRoadAttributes(std::vector<uint32_t> const & rules) {
+	RoadAttributes a;
+	double vehicleSpeed = getObjContext(RouteDataObjectAttribute::ROAD_SPEED).evaluateDouble(rules, getMinDefaultSpeed() * 3.6) / 3.6;
+	a.speed = std::min(vehicleSpeed, maxDefaultSpeed);
+	a.priority = getObjContext(RouteDataObjectAttribute::ROAD_PRIORITIES).evaluateDouble(rules, 1.);
+	a.penaltyTransition = getObjContext(RouteDataObjectAttribute::PENALTY_TRANSITION).evaluateDouble(rules, 0);
+	a.oneway = getObjContext(RouteDataObjectAttribute::ONEWAY).evaluateInt(rules, 0);
+	a.accepted = getObjContext(RouteDataObjectAttribute::ACCESS).evaluateInt(rules, 0) >= 0;
+	return a;
+}
+
+double GeneralRouter::defineRoutingObstacle(std::vector<uint32_t> const & rules) {
+	return getObjContext(RouteDataObjectAttribute::ROUTING_OBSTACLES).evaluateDouble(rules, 0);
+}
+
+void GeneralRouter::ruleIds(RoutingIndex* reg, RouteTypes_t const & types, std::vector<uint32_t> & rules) {
+	rules.clear();
 	for(uint k = 0; k < types.size(); k++) {
-		int vl;
-		tag_value const & r = reg->decodingRules[types[k]];
-		vl = router->registerTagValueAttribute(r);
-		increaseSize(b, router->universalRules.size()).set(vl);
+		rules.push_back(universalRule(reg, types[k]));
+	}
+	std::sort(rules.begin(), rules.end());
+}
+
+dynbitset GeneralRouter::ruleTypes(std::vector<uint32_t> const & rules) const {
+	dynbitset b(universalRules.size());
+	for(uint k = 0; k < rules.size(); k++) {
+		b.set(rules[k]);
 	}
 	return b;
 }
 
+void RouteAttributeContext::compile() {
+	RouteAttributeTable & t = table;
+	t = RouteAttributeTable();
+	dynbitset none(router->universalRules.size());
+	for(uint k = 0; k < rules.size(); k++) {
+		RouteAttributeEvalRule & r = rules[k];
+		bool residual = false;
+		bool matches = true;
+		for(uint i = 0; i < r.expressions.size(); i++) {
+			if(r.expressions[i].dependsOnRoad()) {
+				residual = true;
+			} else if(!r.expressions[i].matches(none, paramContext, router)) {
+				matches = false;
+			}
+		}
+		double value = DOUBLE_MISSING;
+		uint32_t selectTag = RouteAttributeTable::NONE;
+		if(r.selectValueDef.length() > 0 && r.selectValueDef[0] == '$') {
+			std::string tag = r.selectValueDef.substr(1);
+			selectTag = std::find(t.tags.begin(), t.tags.end(), tag) - t.tags.begin();
+			if(selectTag == t.tags.size()) {
+				t.tags.push_back(tag);
+			}
+		} else {
+			// parameters are known by now
+			value = r.calcSelectValue(none, paramContext, router);
+		}
+		if(!matches || (value == DOUBLE_MISSING && selectTag == RouteAttributeTable::NONE)) {
+			// never selects a value
+			continue;
+		}
+		t.rules.push_back(k);
+		t.values.push_back(value);
+		t.selectTags.push_back(selectTag);
+		t.residual.push_back(residual);
+		t.requirements.push_back(t.requiredTypes.size());
+		for(size_t b = r.filterTypes.find_first(); b != dynbitset::npos; b = r.filterTypes.find_next(b)) {
+			t.requiredTypes.push_back(b);
+			t.requiredTags.push_back(std::string());
+		}
+		for(UNORDERED(set)<std::string>::const_iterator it = r.onlyTags.begin(); it != r.onlyTags.end(); it++) {
+			t.requiredTypes.push_back(RouteAttributeTable::NONE);
+			t.requiredTags.push_back(*it);
+		}
+	}
+	t.requirements.push_back(t.requiredTypes.size());
+	t.ruleWords = (t.rules.size() + 63) / 64;
+	t.requirementWords = (t.requiredTypes.size() + 63) / 64;
+	t.met.resize(t.requirementWords);
+	t.excluded.resize(t.ruleWords);
+	t.valid = true;
+}
+
+uint64_t const * RouteAttributeContext::row(uint32_t type) {
+	RouteAttributeTable & t = table;
+	size_t n = t.rowSize();
+	if(n == 0) {
+		// no rules, nothing to fill
+		return NULL;
+	}
+	if(type >= t.filled.size()) {
+		t.filled.resize(type + 1, false);
+		t.rows.resize((type + 1) * n, 0);
+		t.tagOf.resize(type + 1, RouteAttributeTable::NONE);
+	}
+	uint64_t * r = &t.rows[type * n];
+	if(!t.filled[type]) {
+		tag_value const & tv = router->universalRulesById[type];
+		for(uint32_t j = 0; j < t.requiredTypes.size(); j++) {
+			if(t.requiredTypes[j] == RouteAttributeTable::NONE ? t.requiredTags[j] == tv.first : t.requiredTypes[j] == type) {
+				RouteAttributeTable::set(r, j);
+			}
+		}
+		for(uint32_t k = 0; k < t.rules.size(); k++) {
+			RouteAttributeEvalRule const & rule = rules[t.rules[k]];
+			if((type < rule.filterNotTypes.size() && rule.filterNotTypes.test(type)) || rule.onlyNotTags.count(tv.first) > 0) {
+				RouteAttributeTable::set(r + t.requirementWords, k);
+			}
+		}
+		std::vector<std::string>::const_iterator tag = std::find(t.tags.begin(), t.tags.end(), tv.first);
+		if(tag != t.tags.end()) {
+			t.tagOf[type] = tag - t.tags.begin();
+		}
+		t.filled[type] = true;
+	}
+	return r;
+}
+
+double RouteAttributeContext::evaluate(std::vector<uint32_t> const & types) {
+	if(!table.valid) {
+		compile();
+	}
+	RouteAttributeTable & t = table;
+	if(t.rules.empty()) {
+		return DOUBLE_MISSING;
+	}
+	std::fill(t.met.begin(), t.met.end(), 0);
+	std::fill(t.excluded.begin(), t.excluded.end(), 0);
+	for(uint i = 0; i < types.size(); i++) {
+		uint64_t const * r = row(types[i]);
+		for(uint32_t w = 0; w < t.requirementWords; w++) {
+			t.met[w] |= r[w];
+		}
+		for(uint32_t w = 0; w < t.ruleWords; w++) {
+			t.excluded[w] |= r[t.requirementWords + w];
+		}
+	}
+	for(uint32_t k = 0; k < t.rules.size(); k++) {
+		if(RouteAttributeTable::test(t.excluded, k)) {
+			continue;
+		}
+		uint32_t j = t.requirements[k];
+		while(j < t.requirements[k + 1] && RouteAttributeTable::test(t.met, j)) {
+			j++;
+		}
+		if(j < t.requirements[k + 1]) {
+			continue;
+		}
+		RouteAttributeEvalRule const & rule = rules[t.rules[k]];
+		if(t.residual[k] && !rule.checkExpressions(router->ruleTypes(types), paramContext, router)) {
+			continue;
+		}
+		double o = t.values[k];
+		if(t.selectTags[k] != RouteAttributeTable::NONE) {
+			// the value of the first type with the tag
+			for(uint i = 0; i < types.size(); i++) {
+				if(t.tagOf[types[i]] == t.selectTags[k]) {
+					o = router->parseValueFromTag(types[i], rule.selectType, router);
+					break;
+				}
+			}
+		}
+		if(o != DOUBLE_MISSING) {
+			return o;
+		}
+	}
+	return DOUBLE_MISSING;
+}
+
+double RouteAttributeContext::evaluateRules(std::vector<uint32_t> const & types) {
+	dynbitset b = router->ruleTypes(types);
+	for(uint k = 0; k < rules.size(); k++) {
+		double o = rules[k].eval(b, paramContext, router);
+		if(o != DOUBLE_MISSING) {
+			return o;
+		}
+	}
+	return DOUBLE_MISSING;
+}
+
+static void describeTags(std::ostream & s, char const * kind, UNORDERED(set)<std::string> const & tags) {
+	std::vector<std::string> sorted(tags.begin(), tags.end());
+	std::sort(sorted.begin(), sorted.end());
+	for(uint i = 0; i < sorted.size(); i++) {
+		s << kind << ' ' << sorted[i] << '\n';
+	}
+}
+
+static void describeTypes(std::ostream & s, char const * kind, dynbitset const & types,
+		std::vector<tag_value> const & universalRulesById) {
+	for(size_t b = types.find_first(); b != dynbitset::npos; b = types.find_next(b)) {
+		s << kind << ' ' << universalRulesById[b].first << '=' << universalRulesById[b].second << '\n';
+	}
+}
+
+void RouteAttributeContext::describe(std::ostream & s) const {
+	std::map<std::string, std::string> vars(paramContext.vars.begin(), paramContext.vars.end());
+	for(std::map<std::string, std::string>::const_iterator it = vars.begin(); it != vars.end(); it++) {
+		s << "param " << it->first << '=' << it->second << '\n';
+	}
+	for(uint k = 0; k < rules.size(); k++) {
+		RouteAttributeEvalRule const & r = rules[k];
+		s << "rule " << r.selectValueDef << ' ' << r.selectType << '\n';
+		describeTypes(s, "type", r.filterTypes, router->universalRulesById);
+		describeTypes(s, "not type", r.filterNotTypes, router->universalRulesById);
+		describeTags(s, "tag", r.onlyTags);
+		describeTags(s, "not tag", r.onlyNotTags);
+		for(uint i = 0; i < r.expressions.size(); i++) {
+			RouteAttributeExpression const & e = r.expressions[i];
+			s << "expression " << e.expressionType << ' ' << e.valueType;
+			for(uint j = 0; j < e.values.size(); j++) {
+				s << ' ' << e.values[j];
+			}
+			s << '\n';
+		}
+	}
+}
+
+uint64_t GeneralRouter::profileHash() const {
+	std::ostringstream s;
+	s.precision(17);
+	s << leftTurn << ' ' << rightTurn << ' ' << roundaboutTurn << ' '
+			<< minDefaultSpeed << ' ' << maxDefaultSpeed << '\n';
+	for(uint k = 0; k < objectAttributes.size(); k++) {
+		s << "context " << k << '\n';
+		objectAttributes[k].describe(s);
+	}
+	// FNV-1a
+	std::string const text = s.str();
+	uint64_t h = 14695981039346656037ULL;
+	for(size_t i = 0; i < text.size(); i++) {
+		h = (h ^ (unsigned char) text[i]) * 1099511628211ULL;
+	}
+	return h;
+}
+
+bool GeneralRouter::checkCompiledRules(int sets, unsigned int seed) {
+	std::minstd_rand random(seed);
+	std::vector<uint32_t> types;
+	bool ok = true;
+	for(int n = 0; n < sets && !universalRulesById.empty(); n++) {
+		types.clear();
+		int size = random() % 6;
+		for(int i = 0; i < size; i++) {
+			types.push_back(random() % universalRulesById.size());
+		}
+		std::sort(types.begin(), types.end());
+		types.erase(std::unique(types.begin(), types.end()), types.end());
+		for(uint k = 0; k < objectAttributes.size(); k++) {
+			double compiled = objectAttributes[k].evaluate(types);
+			double expected = objectAttributes[k].evaluateRules(types);
+			if(compiled != expected) {
+				OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "Context %d selects %f for %d types, rule by rule %f",
+						k + 1, compiled, (int) types.size(), expected);
+				ok = false;
+			}
+		}
+	}
+	return ok;
+}
+
+double RouteAttributeContext::evaluate(RoutingIndex* reg, RouteTypes_t const & types) {
+	std::vector<uint32_t> ids;
+	router->ruleIds(reg, types, ids);
+	return evaluate(ids);
+}
+
 double RouteAttributeEvalRule::eval(dynbitset const & types, ParameterContext const & paramContext, GeneralRouter* router) {
 	if (matches(types, paramContext, router)) {
 		return calcSelectValue(types, paramContext, router);
@@ -305,6 +571,16 @@ double RouteAttributeEvalRule::calcSelectValue(dynbitset const & types, Paramete
 	return selectValue;
 }
 
+bool RouteAttributeExpression::dependsOnRoad() const {
+	// values of tags are not in cacheValues
+	for(uint i = 0; i < values.size(); i++) {
+		if(values[i].length() > 0 && values[i][0] == '$' && cacheValues[i] == DOUBLE_MISSING) {
+			return true;
+		}
+	}
+	return false;
+}
+
 bool RouteAttributeExpression::matches(dynbitset const & types, ParameterContext const & paramContext, GeneralRouter* router) const {
 	double f1 = calculateExprValue(0, types, paramContext, router);
 	double f2 = calculateExprValue(1, types, paramContext, router);
@@ -2,6 +2,7 @@
 #define _OSMAND_GENERAL_ROUTER_H
 
 #include "Common.h"
+#include <climits>
 #include "boost/dynamic_bitset.hpp"
 #include "RoutingIndex.hpp"
 #include "RouteSegment.hpp"
@@ -28,6 +29,15 @@ enum class RouteDataObjectAttribute : unsigned int {
 	PENALTY_TRANSITION = 6 // 
 };
 
+// Attributes of a road the search asks for, evaluated at once for its types
+struct RoadAttributes {
+	double speed;    // defineRoutingSpeed
+	double priority; // defineSpeedPriority
+	double penaltyTransition;
+	int oneway;
+	bool accepted;
+};
+
 enum class GeneralRouterProfile {
 	CAR,
 	PEDESTRIAN,
@@ -65,6 +75,8 @@ struct RouteAttributeExpression {
 
 	RouteAttributeExpression(std::vector<std::string> const & vls, int type, std::string const & vType);
 	bool matches(dynbitset const & types, ParameterContext const & paramContext, GeneralRouter * router) const;
+	// whether matches() can change from a road to another
+	bool dependsOnRoad() const;
 	double calculateExprValue(int id, dynbitset const & types, ParameterContext const & paramContext, GeneralRouter * router) const;
 };
 
@@ -108,6 +120,48 @@ public:
 	}
 };
 
+// Rules of a context compiled for evaluation. Rules that can never
+// select a value are left out, the others keep their order. A rule
+// matches when the road meets all its requirements (types it must have,
+// tags it must have one value of) and has no type excluding it. Rows of
+// universal ids say which requirements they meet and which rules they
+// exclude; they are filled the first time an id is seen.
+struct RouteAttributeTable {
+	static uint32_t const NONE = UINT_MAX;
+
+	bool valid;
+	std::vector<uint32_t> rules;        // in RouteAttributeContext::rules
+	std::vector<double> values;         // selected, DOUBLE_MISSING for tag values
+	std::vector<uint32_t> selectTags;   // in tags, NONE for constant values
+	std::vector<bool> residual;         // expressions to check road by road
+	std::vector<uint32_t> requirements; // of rule k: [requirements[k], requirements[k + 1])
+	std::vector<uint32_t> requiredTypes; // universal id, NONE for a tag
+	std::vector<std::string> requiredTags;
+	std::vector<std::string> tags;      // of tag values selected
+	uint32_t ruleWords;
+	uint32_t requirementWords;
+
+	// Per universal id: requirement words then rule words
+	std::vector<uint64_t> rows;
+	std::vector<uint32_t> tagOf;        // in tags, NONE if not selected
+	std::vector<bool> filled;
+	// Of the evaluation
+	std::vector<uint64_t> met;
+	std::vector<uint64_t> excluded;
+
+	RouteAttributeTable() : valid(false), ruleWords(0), requirementWords(0) {}
+
+	size_t rowSize() const {
+		return requirementWords + ruleWords;
+	}
+	static inline bool test(std::vector<uint64_t> const & bits, uint32_t i) {
+		return (bits[i >> 6] >> (i & 63)) & 1;
+	}
+	static inline void set(uint64_t * bits, uint32_t i) {
+		bits[i >> 6] |= (uint64_t) 1 << (i & 63);
+	}
+};
+
 class RouteAttributeContext {
 	friend class GeneralRouter;
 
@@ -115,6 +169,7 @@ private:
 	std::vector<RouteAttributeEvalRule> rules;
 	ParameterContext paramContext ;
 	GeneralRouter* router;
+	RouteAttributeTable table;
 
 public: 
 	RouteAttributeContext(GeneralRouter* r) : router(r) {
@@ -124,14 +179,21 @@ public:
 		for(uint i = 0; i < keys.size(); i++) {
 			paramContext.vars[keys[i]] = vls[i];
 		}
+		table.valid = false;
 	}
 
 	RouteAttributeEvalRule* newEvaluationRule() {
 		RouteAttributeEvalRule c;
 		rules.push_back(c);
+		table.valid = false;
 		return &rules[rules.size() - 1];
 	}
 
+	/**
+	 * builds the table evaluations use, once all rules are registered
+	 */
+	void compile();
+
 	void printRules() const {
 		for (uint k = 0; k < rules.size(); k++) {
 			RouteAttributeEvalRule const & r = rules[k];
@@ -139,21 +201,20 @@ public:
 		}
 	}
 
+	// everything its evaluations depend on, in the same text for the same profile
+	void describe(std::ostream & s) const;
+
 private:
-	double evaluate(dynbitset const & types) {
-		for (uint k = 0; k < rules.size(); k++) {
-			double o = rules[k].eval(types, paramContext, router);
-			if (o != DOUBLE_MISSING) {
-				return o;
-			}
-		}
-		return DOUBLE_MISSING;
-	}
+	// types are sorted universal ids
+	double evaluate(std::vector<uint32_t> const & types);
+	uint64_t const * row(uint32_t type);
+	// rule by rule, without the table: what evaluate must select
+	double evaluateRules(std::vector<uint32_t> const & types);
 
-	dynbitset convert(RoutingIndex* reg, std::vector<uint32_t>& types) const;
+	double evaluate(RoutingIndex* reg, RouteTypes_t const & types);
 
 	double evaluate(SHARED_PTR<RouteDataObject> const & ro) {
-		return evaluate(convert(ro->region, ro->types));
+		return evaluate(ro->region, ro->types);
 	}
 
 	int evaluateInt(SHARED_PTR<RouteDataObject> const & ro, int defValue) {
@@ -164,8 +225,24 @@ private:
 		return (int)d;
 	}
 
-	double evaluateDouble(RoutingIndex* reg, std::vector<uint32_t>& types, double defValue) {
-		double d = evaluate(convert(reg, types));
+	int evaluateInt(std::vector<uint32_t> const & types, int defValue) {
+		double d = evaluate(types);
+		if(d == DOUBLE_MISSING) {
+			return defValue;
+		}
+		return (int)d;
+	}
+
+	double evaluateDouble(std::vector<uint32_t> const & types, double defValue) {
+		double d = evaluate(types);
+		if(d == DOUBLE_MISSING) {
+			return defValue;
+		}
+		return d;
+	}
+
+	double evaluateDouble(RoutingIndex* reg, RouteTypes_t const & types, double defValue) {
+		double d = evaluate(reg, types);
 		if(d == DOUBLE_MISSING) {
 			return defValue;
 		}
@@ -208,7 +285,7 @@ public:
 	double minDefaultSpeed ;
 	double maxDefaultSpeed ;
 
-	GeneralRouter() : _restrictionsAware(true), minDefaultSpeed(10), maxDefaultSpeed(10) {
+	GeneralRouter() : _restrictionsAware(true), leftTurn(0), roundaboutTurn(0), rightTurn(0), minDefaultSpeed(10), maxDefaultSpeed(10) {
 
 	}
 
@@ -295,6 +372,24 @@ public:
 		return getObjContext(RouteDataObjectAttribute::ROAD_PRIORITIES).evaluateDouble(road, 1.);
 	}
 
+	/**
+	 * universal id of a type of the region, as rules test it
+	 */
+	uint universalRule(RoutingIndex* reg, uint32_t type)
+	{
+		return registerTagValueAttribute(reg->decodingRules[type]);
+	}
+
+	/**
+	 * all attributes above of roads with these universal types
+	 */
+	RoadAttributes defineRoadAttributes(std::vector<uint32_t> const & rules);
+
+	/**
+	 * defineRoutingObstacle of points with these universal types
+	 */
+	double defineRoutingObstacle(std::vector<uint32_t> const & rules);
+
 	/**
 	 * Used for A* routing to calculate g(x)
 	 * 
@@ -326,8 +421,35 @@ public:
 	/**
 	 * Calculate turn time 
 	 */
-	double calculateTurnTime(SHARED_PTR<RouteSegment> const & segment, int segmentEnd,
-		SHARED_PTR<RouteSegment> const & prev, int prevSegmentEnd);
+	double calculateTurnTime(SHARED_PTR<RouteDataObject> const & road, int segmentStart, int segmentEnd,
+		SHARED_PTR<RouteDataObject> const & prev, int prevSegmentStart, int prevSegmentEnd);
+
+	/**
+	 * Calculate turn time with the penalty transitions of both roads known
+	 */
+	double calculateTurnTime(SHARED_PTR<RouteDataObject> const & road, int segmentStart, int segmentEnd, double penalty,
+		SHARED_PTR<RouteDataObject> const & prev, int prevSegmentStart, int prevSegmentEnd, double prevPenalty);
+
+	/**
+	 * compiles the rules of all contexts, after the configuration is read
+	 */
+	void compile() {
+		for (uint k = 0; k < objectAttributes.size(); k++) {
+			objectAttributes[k].compile();
+		}
+	}
+
+	/**
+	 * hash of the rules, speeds and turn costs, the same on every machine.
+	 * Data made for a profile keeps it, see RoutingDataFile.hpp.
+	 */
+	uint64_t profileHash() const;
+
+	/**
+	 * evaluates random sets of registered types with the compiled tables and
+	 * rule by rule, in every context. True if they always select the same value.
+	 */
+	bool checkCompiledRules(int sets, unsigned int seed);
 
 	void printRules() const {
 		for (uint k = 0; k < objectAttributes.size(); k++) {
@@ -339,6 +461,8 @@ public:
 private :
 	double parseValueFromTag(uint id, std::string const & type, GeneralRouter const * router);
 	uint registerTagValueAttribute(const tag_value& r);
+	dynbitset ruleTypes(std::vector<uint32_t> const & rules) const;
+	void ruleIds(RoutingIndex* reg, RouteTypes_t const & types, std::vector<uint32_t> & rules);
 	RouteAttributeContext & getObjContext(RouteDataObjectAttribute a) {
 		return objectAttributes[(unsigned int)a];
 	}
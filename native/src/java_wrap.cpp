@@ -13,6 +13,7 @@
 #include "java_renderRules.h"
 #include "Common.h"
 #include "binaryRead.h"
+#include "NodeCache.hpp"
 #include "rendering.h"
 #include "Logging.h"
 
@@ -65,6 +66,13 @@ extern "C" JNIEXPORT jboolean JNICALL Java_net_osmand_NativeLibrary_initCacheMap
 	return initMapFilesFromCache(inputName);
 }
 
+// Memory of decoded map, routing and POI tree nodes for the whole process.
+// 0 means no limit. Without it the first route search sets it.
+extern "C" JNIEXPORT void JNICALL Java_net_osmand_NativeLibrary_setNodeCacheLimit(JNIEnv* ienv,
+		jobject obj, jint megabytes) {
+	setNodeCacheLimit(megabytes > 0 ? (size_t) megabytes * 1024 * 1024 : 0);
+}
+
 extern "C" JNIEXPORT jboolean JNICALL Java_net_osmand_NativeLibrary_initBinaryMapFile(JNIEnv* ienv,
 		jobject obj, jobject path) {
 	// Verify that the version of the library that we linked against is
@@ -405,6 +413,7 @@ jfieldID jfield_GeneralRouter_rightTurn = NULL;
 jfieldID jfield_GeneralRouter_minDefaultSpeed = NULL;
 jfieldID jfield_GeneralRouter_maxDefaultSpeed = NULL;
 jfieldID jfield_GeneralRouter_objectAttributes = NULL;
+jmethodID jmethod_GeneralRouter_getAttribute = NULL;
 
 jclass jclass_RouteAttributeContext = NULL;
 jmethodID jmethod_RouteAttributeContext_getRules = NULL;
@@ -532,6 +541,8 @@ void loadJniRenderingContext(JNIEnv* env)
 	jfield_GeneralRouter_maxDefaultSpeed = getFid(env, jclass_GeneralRouter, "maxDefaultSpeed", "F");
 	jfield_GeneralRouter_objectAttributes = getFid(env, jclass_GeneralRouter, "objectAttributes", 
 		"[Lnet/osmand/router/GeneralRouter$RouteAttributeContext;");
+	jmethod_GeneralRouter_getAttribute = env->GetMethodID(jclass_GeneralRouter,
+				"getAttribute", "(Ljava/lang/String;)Ljava/lang/String;");
 
 	jclass_RouteAttributeContext = findClass(env, "net/osmand/router/GeneralRouter$RouteAttributeContext");	
 	jmethod_RouteAttributeContext_getRules = env->GetMethodID(jclass_RouteAttributeContext,
@@ -649,19 +660,17 @@ void pullFromJavaRenderingContext(JNIEnv* env, jobject jrc, JNIRenderingContext
 }
 
 jobject convertRouteDataObjectToJava(JNIEnv* ienv, RouteDataObject const * route, jobject reg) {
-	jintArray nameInts = ienv->NewIntArray(route->names.size());
-	jobjectArray nameStrings = ienv->NewObjectArray(route->names.size(), jclassString, NULL);
-	jint* ar = new jint[route->names.size()];
-	UNORDERED(map)<int, std::string >::const_iterator itNames = route->names.begin();
-	jsize sz = 0;
-	for (; itNames != route->names.end(); itNames++, sz++) {
-		ar[sz] = itNames->first;
-		std::string name = itNames->second;
-		jstring js = ienv->NewStringUTF(name.c_str());
+	jsize namesCount = route->namesCount();
+	jintArray nameInts = ienv->NewIntArray(namesCount);
+	jobjectArray nameStrings = ienv->NewObjectArray(namesCount, jclassString, NULL);
+	jint* ar = new jint[namesCount];
+	for (jsize sz = 0; sz < namesCount; sz++) {
+		ar[sz] = route->nameTag(sz);
+		jstring js = ienv->NewStringUTF(route->name(sz).c_str());
 		ienv->SetObjectArrayElement(nameStrings, sz, js);
 		ienv->DeleteLocalRef(js);
 	}
-	ienv->SetIntArrayRegion(nameInts, 0, route->names.size(), ar);
+	ienv->SetIntArrayRegion(nameInts, 0, namesCount, ar);
 	delete [] ar;
 	jobject robj = ienv->NewObject(jclass_RouteDataObject, jmethod_RouteDataObject_init, reg, nameInts, nameStrings);
 	ienv->DeleteLocalRef(nameInts);
@@ -699,7 +708,7 @@ jobject convertRouteDataObjectToJava(JNIEnv* ienv, RouteDataObject const * route
 
 	jobjectArray pointTypes = ienv->NewObjectArray(route->pointTypes.size(), jclassIntArray, NULL);
 	for (uint k = 0; k < route->pointTypes.size(); k++) {
-		std::vector<uint32_t> ts = route->pointTypes[k];
+		RouteTypes_t const & ts = route->pointTypes[k];
 		if (ts.size() > 0) {
 			jintArray tos = ienv->NewIntArray(ts.size());
 			ienv->SetIntArrayRegion(tos, 0, ts.size(), (jint*) &ts[0]);
@@ -946,7 +955,21 @@ void parseRouteConfiguration(JNIEnv* ienv, RoutingConfiguration& rConfig, jobjec
 
 		ienv->DeleteLocalRef(ctx);
 	}
-
+	rConfig.router.compile();
+
+	// Attributes of the profile only the native search reads
+	const char* nativeKeys[] = { "nativeOpenSet", "nativeHierarchy", "nativeLandmarks" };
+	RoutingConfiguration::MAP_STR_STR nativeAttributes;
+	for (size_t k = 0; k < sizeof(nativeKeys) / sizeof(nativeKeys[0]); k++) {
+		jstring key = ienv->NewStringUTF(nativeKeys[k]);
+		jstring value = (jstring) ienv->CallObjectMethod(router, jmethod_GeneralRouter_getAttribute, key);
+		if (value != NULL) {
+			nativeAttributes[nativeKeys[k]] = getString(ienv, value);
+			ienv->DeleteLocalRef(value);
+		}
+		ienv->DeleteLocalRef(key);
+	}
+	rConfig.initNativeParams(nativeAttributes);
 
 	ienv->DeleteLocalRef(objectAttributes);
 	ienv->DeleteLocalRef(router);
@@ -16,7 +16,7 @@ struct ResultJNIPublisher : ResultPublisher {
 		env(env), o(o), interruptedField(interruptedField){
 	}
 
-	bool isCancelled() {
+	virtual bool isCancelled() const {
 		if (env != NULL && o != NULL) {
 			return env->GetBooleanField(o, interruptedField);
 		}
@@ -6,6 +6,7 @@
 
 #include <Common.h>
 #include <Map.hpp>
+#include "TagDictionary.hpp"
 
 typedef std::pair<int, int> int_pair;
 typedef std::vector< std::pair<int, int> > coordinates;
@@ -14,67 +15,114 @@ typedef std::vector< std::pair<int, int> > coordinates;
 class MapDataObject
 {
 public:
-	std::vector<tag_value>  types;
-	std::vector<tag_value>  additionalTypes;
+	TagValueIds  types;
+	TagValueIds  additionalTypes;
 	coordinates points;
 	std::vector < coordinates > polygonInnerCoordinates;
 
-	// TODO Maybe auxiliar. Remove it.
-	UNORDERED(map)< std::string, unsigned int> stringIds;
-
-	UNORDERED(map)< std::string, std::string > objectNames;
+	// (tag value id, string table index) pairs, one per name tag.
+	// Objects of a data block share its string table, names are not copied.
+	std::vector< std::pair<uint32_t, uint32_t> > namesIds;
+	StringTable_pointer stringTable;
 	bool area;
 	long long id;
 
 	MapDataObject() : box(point_t(INT_MAX, INT_MAX), point_t(-1, -1))
 	{}
 
+	size_t namesCount() const {
+		return namesIds.size();
+	}
+	std::string const & nameTag(size_t i) const {
+		return tagValue(namesIds[i].first).first;
+	}
+	std::string const & name(size_t i) const {
+		return (*stringTable)[namesIds[i].second];
+	}
+	// NULL if the object has no name with that tag
+	std::string const * findName(std::string const & tag) const {
+		for (size_t i = 0; i < namesIds.size(); i++) {
+			if (nameTag(i) == tag) {
+				return &name(i);
+			}
+		}
+		return NULL;
+	}
+	// For objects made by a search. The table is copied: it may be shared.
+	// tagId is the id of the name tag with no value.
+	void setName(uint32_t tagId, std::string const & value) {
+		SHARED_PTR<StringTable_t> table(stringTable ? new StringTable_t(*stringTable) : new StringTable_t);
+		table->push_back(value);
+		std::pair<uint32_t, uint32_t> nameId(tagId, table->size() - 1);
+		stringTable = table;
+		for (size_t i = 0; i < namesIds.size(); i++) {
+			if (namesIds[i].first == tagId) {
+				namesIds[i] = nameId;
+				return;
+			}
+		}
+		namesIds.push_back(nameId);
+	}
+
 	bool cycle() const {
 		return points[0] == points[points.size() -1];
 	}
+	// Strings are looked up, never added: take ids once where checks repeat
 	bool containsAdditional(std::string const & key, std::string const & val) const {
-		std::vector<tag_value>::const_iterator it = additionalTypes.begin();
-		while (it != additionalTypes.end()) {
-			if (it->first == key && it->second == val) {
+		uint32_t id = findTagValue(key, val);
+		return id != NO_TAG_VALUE && containsAdditional(id);
+	}
+	bool containsAdditional(uint32_t tagValueId) const {
+		for (size_t i = 0; i < additionalTypes.size(); i++) {
+			if (additionalTypes.id(i) == tagValueId) {
 				return true;
 			}
-			it++;
 		}
 		return false;
 	}
 
 	bool contains(std::string const & key, std::string const & val) const {
-		std::vector<tag_value>::const_iterator it = types.begin();
-		while (it != types.end()) {
-			if (it->first == key) {
-				return it->second == val;
+		uint32_t id = findTagValue(key, val);
+		return id != NO_TAG_VALUE && contains(id);
+	}
+	// First type with the same tag decides.
+	bool contains(uint32_t tagValueId) const {
+		uint32_t tag = tagOf(tagValueId);
+		for (size_t i = 0; i < types.size(); i++) {
+			if (tagOf(types.id(i)) == tag) {
+				return types.id(i) == tagValueId;
 			}
-			it++;
 		}
 		return false;
 	}
 
 	int getSimpleLayer() const {
-		std::vector<tag_value>::const_iterator it = additionalTypes.begin();
+		static uint32_t const layerTag = internTag("layer");
+		static uint32_t const tunnelTag = internTag("tunnel");
+		static uint32_t const bridgeTag = internTag("bridge");
+		static uint32_t const tunnelYes = internTagValue("tunnel", "yes");
+		static uint32_t const bridgeYes = internTagValue("bridge", "yes");
 		bool tunnel = false;
 		bool bridge = false;
-		while (it != additionalTypes.end()) {
-			if (it->first == "layer") {
-				if(it->second.length() > 0) {
-					if(it->second[0] == '-'){
+		for (size_t i = 0; i < additionalTypes.size(); i++) {
+			uint32_t id = additionalTypes.id(i);
+			uint32_t tag = tagOf(id);
+			if (tag == layerTag) {
+				std::string const & value = additionalTypes[i].second;
+				if(value.length() > 0) {
+					if(value[0] == '-'){
 						return -1;
-					} else if (it->second[0] == '0'){
+					} else if (value[0] == '0'){
 						return 0;
 					} else {
 						return 1;
 					}
 				}
-			} else if (it->first == "tunnel") {
-				tunnel = "yes" == it->second;
-			} else if (it->first == "bridge") {
-				bridge = "yes" == it->second;
+			} else if (tag == tunnelTag) {
+				tunnel = id == tunnelYes;
+			} else if (tag == bridgeTag) {
+				bridge = id == bridgeYes;
 			}
-			it++;
 		}
 		if (tunnel) {
 			return -1;
@@ -84,6 +132,20 @@ public:
 		return 0;
 	}
 
+	size_t memorySize() const
+	{
+		size_t s = sizeof(MapDataObject);
+		s += (types.capacity() + additionalTypes.capacity()) * sizeof(uint32_t);
+		s += points.capacity() * sizeof(int_pair);
+		std::vector<coordinates>::const_iterator inner = polygonInnerCoordinates.begin();
+		for (; inner != polygonInnerCoordinates.end(); inner++) {
+			s += inner->capacity() * sizeof(int_pair);
+		}
+		// The string table is accounted once, by the block (see readMapDataBlocks)
+		s += namesIds.capacity() * sizeof(std::pair<uint32_t, uint32_t>);
+		return s;
+	}
+
 	bbox_t const & Box() const
 	{
 		return box;
@@ -9,7 +9,7 @@
 
 // returns true if coastlines were added!
 bool processCoastlines(std::vector<MapDataObject*>&  coastLines, int leftX, int rightX, int bottomY, int topY, int zoom,
-		bool showIfThereIncompleted, bool addDebugIncompleted, std::vector<MapDataObject*>& res) {
+		bool showIfThereIncompleted, bool addDebugIncompleted, std::vector<MapDataObject*>& res, MapObjectArena& arena) {
 	// try out (quite dirty fix to align boundaries to grid)
 	leftX = (leftX >> 5) << 5;
 	rightX = (rightX >> 5) << 5;
@@ -27,30 +27,30 @@ bool processCoastlines(std::vector<MapDataObject*>&  coastLines, int leftX, int
 			continue;
 		}
 		dbId = o->id >> 1;
-		coordinates* cs = new coordinates();
+		coordinates cs;
 		int px = o->points.at(0).first;
 		int py = o->points.at(0).second;
 		int x = px;
 		int y = py;
 		bool pinside = leftX <= x && x <= rightX && y >= topY && y <= bottomY;
 		if (pinside) {
-			cs->push_back(int_pair(x, y));
+			cs.push_back(int_pair(x, y));
 		}
 		for (int i = 1; i < len; i++) {
 			x = o->points.at(i).first;
 			y = o->points.at(i).second;
 			bool inside = leftX <= x && x <= rightX && y >= topY && y <= bottomY;
-			bool lineEnded = calculateLineCoordinates(inside, x, y, pinside, px, py, leftX, rightX, bottomY, topY, *cs);
+			bool lineEnded = calculateLineCoordinates(inside, x, y, pinside, px, py, leftX, rightX, bottomY, topY, cs);
 			if (lineEnded) {
-				combineMultipolygonLine(completedRings, uncompletedRings, *cs);
+				combineMultipolygonLine(completedRings, uncompletedRings, cs);
 				// create new line if it goes outside
-				cs = new coordinates();
+				cs.clear();
 			}
 			px = x;
 			py = y;
 			pinside = inside;
 		}
-		combineMultipolygonLine(completedRings, uncompletedRings, *cs);
+		combineMultipolygonLine(completedRings, uncompletedRings, cs);
 	}
 	if (completedRings.size() == 0 && uncompletedRings.size() == 0) {
 		return false;
@@ -62,14 +62,14 @@ bool processCoastlines(std::vector<MapDataObject*>&  coastLines, int leftX, int
 	if (addDebugIncompleted) {
 		// draw uncompleted for debug purpose
 		for (uint i = 0; i < uncompletedRings.size(); i++) {
-			MapDataObject* o = new MapDataObject();
+			MapDataObject* o = arena.create();
 			o->points = uncompletedRings[i];
 			o->types.push_back(tag_value("natural", "coastline_broken"));
 			res.push_back(o);
 		}
 		// draw completed for debug purpose
 		for (uint i = 0; i < completedRings.size(); i++) {
-			MapDataObject* o = new MapDataObject();
+			MapDataObject* o = arena.create();
 			o->points = completedRings[i];
 			o->types.push_back(tag_value("natural", "coastline_line"));
 			res.push_back(o);
@@ -82,8 +82,8 @@ bool processCoastlines(std::vector<MapDataObject*>&  coastLines, int leftX, int
 	int waterFound = 0;
 	for (uint i = 0; i < completedRings.size(); i++) {
 		bool clockwise = isClockwiseWay(completedRings[i]);
-		MapDataObject* o = new MapDataObject();
-		o->points = completedRings[i];
+		MapDataObject* o = arena.create();
+		o->points.swap(completedRings[i]);
 		if (clockwise) {
 			waterFound ++;
 			o->types.push_back(tag_value("natural", "coastline"));
@@ -99,7 +99,7 @@ bool processCoastlines(std::vector<MapDataObject*>&  coastLines, int leftX, int
 			landFound, waterFound, coastlineCrossScreen);
 	if (!waterFound && !coastlineCrossScreen) {
 		// add complete water tile
-		MapDataObject* o = new MapDataObject();
+		MapDataObject* o = arena.create();
 		o->points.push_back(int_pair(leftX, topY));
 		o->points.push_back(int_pair(rightX, topY));
 		o->points.push_back(int_pair(rightX, bottomY));
@@ -5,6 +5,7 @@
 
 #include "common2.h"
 #include "mapObjects.h"
+#include "MapObjectArena.hpp"
 
 /// !!! Fuly copied from MapRenderRepositories.java, should be carefully synchroinized
 bool isClockwiseWay(std::vector<int_pair>& c) ;
@@ -19,7 +20,8 @@ void unifyIncompletedRings(std::vector<std::vector<int_pair> >& incompletedRings
 			int leftX, int rightX, int bottomY, int topY, long dbId, int zoom);
 
 
+// New objects are made in arena.
 bool processCoastlines(std::vector<MapDataObject*>&  coastLines, int leftX, int rightX, int bottomY, int topY, int zoom,
-		bool showIfThereIncompleted, bool addDebugIncompleted, std::vector<MapDataObject*>& res);
+		bool showIfThereIncompleted, bool addDebugIncompleted, std::vector<MapDataObject*>& res, MapObjectArena& arena);
 
 #endif
@@ -5,6 +5,20 @@
 #include <SkGraphics.h>
 #include <stdio.h>
 #include <time.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "proto/osmand_odb.pb.h"
+#include "proto/utils.hpp"
+#include "ElapsedTimer.h"
+#include "ObfRelayout.hpp"
+#include "TransportPlanner.hpp"
+#include "RoutingContext.hpp"
+#include "ContractionHierarchy.hpp"
+#include "RouteLandmarks.hpp"
+#include "NodeCache.hpp"
+#include <queue>
+#include <thread>
+#include <atomic>
 
 void println(const char * msg) {
 	printf("%s\n", msg);
@@ -20,6 +34,1528 @@ void printUsage(std::string info) {
 	println("  Prints information about [file] binary index of OsmAnd.");
 	println("  -v.. more verbouse output (like all cities and their streets or all map objects with tags/values and coordinates)");
 	println("  -renderingOutputFile= renders for specified zoom, bbox into a file");
+	println("\nBenchmarks check their results too: they print WRONG and exit with 1 when a check fails.");
+	println("\nUsage for decoding benchmark : inspector -bcoordinates [-count=Values]");
+	println("  Times protobuf and bulk decoding of delta coded coordinates.");
+	println("\nUsage for POI benchmark : inspector -bpoi [-count=Values] [-queries=Values]");
+	println("  Writes a synthetic POI index and times box, radius and category searches on it.");
+	println("\nUsage for transport benchmark : inspector -btransport [-grid=Stops] [-queries=Values]");
+	println("  Writes a synthetic city network of Stops x Stops and times journey planning on it.");
+	println("\nUsage for route benchmark : inspector -broute [-grid=Lines] [-queries=Values]");
+	println("  Writes a synthetic road grid of Lines x Lines streets and times car routes on it with each open set.");
+	println("\nUsage for node decoding check : inspector -bnodes [-grid=Lines] [-threads=Count] [-rounds=Values]");
+	println("  Decodes the routing nodes of the same grid from several threads at once and checks the node cache counts them once.");
+	println("\nUsage for routing rules check : inspector -brules [-contexts=Count] [-sets=Values]");
+	println("  Compiles random routing rules and checks their tables select as the rules one by one.");
+	println("\nUsage for contraction hierarchy benchmark : inspector -bch [-grid=Lines] [-queries=Values]");
+	println("  Builds a contraction hierarchy of the same grid and checks and times its routes against A* ones.");
+	println("\nUsage for landmarks benchmark : inspector -balt [-grid=Lines] [-queries=Values] [-landmarks=Count]");
+	println("  Times routes of the same grid with and without landmark bounds, and checks the bounds.");
+	println("\nUsage for landmarks : inspector -landmarks [-count=Landmarks] [file]");
+	println("  Writes next to [file] the landmark times of its roads for the car profile of the benchmarks.");
+	println("\nUsage for contraction hierarchy : inspector -chbuild [output] [file...]");
+	println("  Writes to [output] the contraction hierarchy of the roads of [file...] for the car profile of the benchmarks.");
+	println("\nUsage for address search : inspector -address=Prefix [file]");
+	println("  Prints cities and streets of [file] with a word starting as Prefix, and how long it took.");
+	println("\nUsage for re-layout : inspector -relayout [input] [output]");
+	println("  Writes [input] to [output] with map and routing data blocks in Hilbert order of their boxes.");
+}
+
+// Deltas look like map ones: mostly one or two bytes, a few long jumps.
+bool benchmarkCoordinates(int argc, char **params) {
+	int count = 4000000;
+	for (int i = 1; i != argc; ++i) {
+		sscanf(params[i], "-count=%d", &count);
+	}
+	std::vector<int32_t> expected;
+	std::string bytes;
+	srand(1);
+	for (int i = 0; i < count; i++) {
+		int k = rand() % 20;
+		int32_t v = k < 12 ? rand() % 128 - 64 : (k < 19 ? rand() % 16000 - 8000 : rand() % 2000000 - 1000000);
+		expected.push_back(v);
+		uint32_t n = WireFormatLite::ZigZagEncode32(v);
+		while (n >= 0x80) {
+			bytes.push_back((char) (n | 0x80));
+			n >>= 7;
+		}
+		bytes.push_back((char) n);
+	}
+	uint8_t const * data = reinterpret_cast<uint8_t const *>(bytes.data());
+	int size = bytes.size();
+	std::vector<int32_t> values(count);
+
+	OsmAnd::ElapsedTimer timer;
+	timer.Start();
+	CodedInputStream input(data, size);
+	input.SetTotalBytesLimit(INT_MAX, INT_MAX >> 1);
+	int n = 0;
+	while (input.BytesUntilLimit() > 0 && n < count) {
+		readSint32(input, values[n++]);
+	}
+	int protobufMs = timer.GetElapsedMs();
+	bool protobufOk = values == expected;
+
+	int bulkMs[2];
+	bool bulkOk[2];
+	for (int scalar = 0; scalar < 2; scalar++) {
+		std::fill(values.begin(), values.end(), 0);
+		OsmAnd::ElapsedTimer bulkTimer;
+		bulkTimer.Start();
+		uint8_t const * p = data;
+		n = 0;
+		while (p < data + size && n >= 0) {
+			int r = scalar ? varint::decodeSint32sScalar(p, data + size, &values[n], 64)
+					: varint::decodeSint32s(p, data + size, &values[n], 64);
+			n = r < 0 ? -1 : n + r;
+		}
+		bulkMs[scalar] = bulkTimer.GetElapsedMs();
+		bulkOk[scalar] = n == count && values == expected;
+	}
+	printf("%d values in %d bytes\n", count, size);
+	printf("protobuf readSint32 : %d ms %s\n", protobufMs, protobufOk ? "ok" : "WRONG");
+	printf("bulk                : %d ms %s\n", bulkMs[0], bulkOk[0] ? "ok" : "WRONG");
+	printf("bulk checked scalar : %d ms %s\n", bulkMs[1], bulkOk[1] ? "ok" : "WRONG");
+	return protobufOk && bulkOk[0] && bulkOk[1];
+}
+
+// Minimal OBF writing, only what the benchmarks need.
+static void putVarint(std::string & out, uint64_t v) {
+	while (v >= 0x80) {
+		out.push_back((char) (v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((char) v);
+}
+static void putTag(std::string & out, int field, WireFormatLite::WireType type) {
+	putVarint(out, WireFormatLite::MakeTag(field, type));
+}
+static void putFixed32(std::string & out, uint32_t v) {
+	for (int shift = 24; shift >= 0; shift -= 8) {
+		out.push_back((char) (v >> shift));
+	}
+}
+static void putUInt(std::string & out, int field, uint64_t v) {
+	putTag(out, field, WireFormatLite::WIRETYPE_VARINT);
+	putVarint(out, v);
+}
+static void putSint(std::string & out, int field, int32_t v) {
+	putUInt(out, field, WireFormatLite::ZigZagEncode32(v));
+}
+static void putBytes(std::string & out, int field, std::string const & v) {
+	putTag(out, field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+	putVarint(out, v.size());
+	out += v;
+}
+static void putFixed32Message(std::string & out, int field, std::string const & v) {
+	putTag(out, field, WireFormatLite::WIRETYPE_FIXED32_LENGTH_DELIMITED);
+	putFixed32(out, v.size());
+	out += v;
+}
+
+struct SyntheticPoi {
+	uint32_t x24;
+	uint32_t y24;
+	uint32_t category;
+};
+
+// Root boxes at zoom 10 with leaves at zoom 14, as the map creator writes them.
+static std::string syntheticPoiFile(std::vector<SyntheticPoi> const & pois,
+		std::vector<std::vector<std::string> > const & subtypes, std::vector<std::string> const & categories) {
+	typedef std::map<uint32_t, std::vector<size_t> > Tiles_t; // (x14 << 16 | y14) -> pois
+	Tiles_t leaves;
+	uint32_t left = UINT_MAX, right = 0, top = UINT_MAX, bottom = 0;
+	for (size_t i = 0; i < pois.size(); i++) {
+		leaves[(pois[i].x24 >> 10) << 16 | (pois[i].y24 >> 10)].push_back(i);
+		left = std::min(left, pois[i].x24 << 7);
+		right = std::max(right, pois[i].x24 << 7);
+		top = std::min(top, pois[i].y24 << 7);
+		bottom = std::max(bottom, pois[i].y24 << 7);
+	}
+	std::string header;
+	putBytes(header, OsmAndPoiIndex::kNameFieldNumber, "benchmark");
+	std::string box;
+	putUInt(box, OsmAndTileBox::kLeftFieldNumber, left);
+	putUInt(box, OsmAndTileBox::kRightFieldNumber, right);
+	putUInt(box, OsmAndTileBox::kTopFieldNumber, top);
+	putUInt(box, OsmAndTileBox::kBottomFieldNumber, bottom);
+	putBytes(header, OsmAndPoiIndex::kBoundariesFieldNumber, box);
+	for (size_t c = 0; c < categories.size(); c++) {
+		std::string table;
+		putBytes(table, OsmAndCategoryTable::kCategoryFieldNumber, categories[c]);
+		for (size_t s = 0; s < subtypes[c].size(); s++) {
+			putBytes(table, OsmAndCategoryTable::kSubcategoriesFieldNumber, subtypes[c][s]);
+		}
+		putBytes(header, OsmAndPoiIndex::kCategoriesTableFieldNumber, table);
+	}
+
+	// Data blocks first, boxes need their offsets. Offsets are fixed32 so
+	// boxes have the same size whatever they are.
+	std::vector<std::string> blocks;
+	for (Tiles_t::const_iterator t = leaves.begin(); t != leaves.end(); t++) {
+		uint32_t x14 = t->first >> 16;
+		uint32_t y14 = t->first & 0xFFFF;
+		std::string block;
+		putUInt(block, OsmAndPoiBoxData::kZoomFieldNumber, 14);
+		putUInt(block, OsmAndPoiBoxData::kXFieldNumber, x14);
+		putUInt(block, OsmAndPoiBoxData::kYFieldNumber, y14);
+		for (size_t k = 0; k < t->second.size(); k++) {
+			SyntheticPoi const & p = pois[t->second[k]];
+			std::string atom;
+			putSint(atom, OsmAndPoiBoxDataAtom::kDxFieldNumber, p.x24 - (x14 << 10));
+			putSint(atom, OsmAndPoiBoxDataAtom::kDyFieldNumber, p.y24 - (y14 << 10));
+			putUInt(atom, OsmAndPoiBoxDataAtom::kCategoriesFieldNumber, p.category);
+			putBytes(atom, OsmAndPoiBoxDataAtom::kNameFieldNumber, "Poi");
+			putUInt(atom, OsmAndPoiBoxDataAtom::kIdFieldNumber, t->second[k] + 1);
+			putBytes(block, OsmAndPoiBoxData::kPoiDataFieldNumber, atom);
+		}
+		blocks.push_back(block);
+	}
+	std::string boxes;
+	for (int pass = 0; pass < 2; pass++) {
+		uint32_t dataPos = header.size() + boxes.size() + 1; // after the tag
+		boxes.clear();
+		Tiles_t::const_iterator t = leaves.begin();
+		size_t b = 0;
+		while (t != leaves.end()) {
+			uint32_t x10 = (t->first >> 16) >> 4;
+			uint32_t y10 = (t->first & 0xFFFF) >> 4;
+			std::string root;
+			putUInt(root, OsmAndPoiBox::kZoomFieldNumber, 10);
+			putSint(root, OsmAndPoiBox::kLeftFieldNumber, x10);
+			putSint(root, OsmAndPoiBox::kTopFieldNumber, y10);
+			for (; t != leaves.end() && ((t->first >> 16) >> 4) == x10 && ((t->first & 0xFFFF) >> 4) == y10; t++, b++) {
+				std::set<uint32_t> codes;
+				for (size_t k = 0; k < t->second.size(); k++) {
+					codes.insert(pois[t->second[k]].category);
+				}
+				std::string cats;
+				for (std::set<uint32_t>::const_iterator c = codes.begin(); c != codes.end(); c++) {
+					putUInt(cats, OsmAndPoiCategories::kCategoriesFieldNumber, *c);
+				}
+				std::string leaf;
+				putUInt(leaf, OsmAndPoiBox::kZoomFieldNumber, 4);
+				putSint(leaf, OsmAndPoiBox::kLeftFieldNumber, (t->first >> 16) - (x10 << 4));
+				putSint(leaf, OsmAndPoiBox::kTopFieldNumber, (t->first & 0xFFFF) - (y10 << 4));
+				putBytes(leaf, OsmAndPoiBox::kCategoriesFieldNumber, cats);
+				putTag(leaf, OsmAndPoiBox::kShiftToDataFieldNumber, WireFormatLite::WIRETYPE_FIXED32);
+				putFixed32(leaf, dataPos);
+				putFixed32Message(root, OsmAndPoiBox::kSubBoxesFieldNumber, leaf);
+				dataPos += 1 + 4 + blocks[b].size();
+			}
+			putFixed32Message(boxes, OsmAndPoiIndex::kBoxesFieldNumber, root);
+		}
+	}
+	std::string index = header + boxes;
+	for (size_t b = 0; b < blocks.size(); b++) {
+		putFixed32Message(index, OsmAndPoiIndex::kPoiDataFieldNumber, blocks[b]);
+	}
+	std::string file;
+	putUInt(file, OsmAndStructure::kVersionFieldNumber, MAP_VERSION);
+	putFixed32Message(file, OsmAndStructure::kPoiIndexFieldNumber, index);
+	putUInt(file, OsmAndStructure::kVersionConfirmFieldNumber, MAP_VERSION);
+	return file;
+}
+
+// Searches are checked against a scan of the generated amenities.
+bool benchmarkPoi(int argc, char **params) {
+	int count = 500000;
+	int queries = 2000;
+	for (int i = 1; i != argc; ++i) {
+		sscanf(params[i], "-count=%d", &count);
+		sscanf(params[i], "-queries=%d", &queries);
+	}
+	std::vector<std::string> categories;
+	std::vector<std::vector<std::string> > subtypes(3);
+	categories.push_back("amenity");
+	categories.push_back("shop");
+	categories.push_back("tourism");
+	char const * amenity[] = { "fuel", "restaurant", "cafe", "fast_food", "bank", "pharmacy" };
+	char const * shop[] = { "bakery", "supermarket", "convenience", "clothes" };
+	char const * tourism[] = { "hotel", "museum", "viewpoint" };
+	subtypes[0].assign(amenity, amenity + 6);
+	subtypes[1].assign(shop, shop + 4);
+	subtypes[2].assign(tourism, tourism + 3);
+
+	// About 160 km around Madrid
+	uint32_t x0 = get31TileNumberX(-4.5) >> 7;
+	uint32_t y0 = get31TileNumberY(41.0) >> 7;
+	uint32_t span = 1 << 16;
+	srand(1);
+	std::vector<SyntheticPoi> pois(count);
+	for (int i = 0; i < count; i++) {
+		pois[i].x24 = x0 + (uint32_t) (((uint64_t) rand() * span) / ((uint64_t) RAND_MAX + 1));
+		pois[i].y24 = y0 + (uint32_t) (((uint64_t) rand() * span) / ((uint64_t) RAND_MAX + 1));
+		uint32_t c = rand() % 3;
+		pois[i].category = c | ((rand() % subtypes[c].size()) << POI_CATEGORY_BITS);
+	}
+	std::string name = "poi-benchmark.obf";
+	std::string bytes = syntheticPoiFile(pois, subtypes, categories);
+	FILE * f = fopen(name.c_str(), "wb");
+	if (f == NULL || fwrite(bytes.data(), 1, bytes.size(), f) != bytes.size()) {
+		printf("Can not write %s\n", name.c_str());
+		if (f != NULL) fclose(f);
+		return false;
+	}
+	fclose(f);
+	if (initBinaryMapFile(name) == NULL) {
+		remove(name.c_str());
+		return false;
+	}
+	printf("%d amenities in %d bytes\n", count, (int) bytes.size());
+
+	PoiCategoryFilter_t food;
+	food["amenity"].insert("fuel");
+	food["amenity"].insert("restaurant");
+	food["amenity"].insert("fast_food");
+	char const * names[] = { "box", "radius 1 km", "radius 2 km, fuel/food" };
+	bool ok = true;
+	for (int kind = 0; kind < 3; kind++) {
+		std::vector<PoiQuery> qs;
+		srand(2);
+		for (int n = 0; n < queries; n++) {
+			uint32_t x = (x0 + rand() % span) << 7;
+			uint32_t y = (y0 + rand() % span) << 7;
+			qs.push_back(kind == 0 ? PoiQuery(x, x + (1 << 16), y, y + (1 << 16), NULL)
+					: PoiQuery(x, y, kind == 1 ? 1000 : 2000, NULL));
+			if (kind == 2) {
+				qs.back().categories = food;
+			}
+		}
+		// First pass reads the boxes from file
+		int ms[2];
+		std::vector<size_t> found(queries);
+		for (int pass = 0; pass < 2; pass++) {
+			OsmAnd::ElapsedTimer timer;
+			timer.Start();
+			for (int n = 0; n < queries; n++) {
+				PoiPublisher publisher;
+				qs[n].publisher = &publisher;
+				searchPoi(qs[n]);
+				found[n] = publisher.result.size();
+				qs[n].publisher = NULL;
+			}
+			ms[pass] = timer.GetElapsedMs();
+		}
+		bool kindOk = true;
+		for (int n = 0; n < queries; n += 20) {
+			size_t expected = 0;
+			for (size_t i = 0; i < pois.size(); i++) {
+				uint32_t c = pois[i].category;
+				std::string const & sub = subtypes[c & POI_CATEGORY_MASK][c >> POI_CATEGORY_BITS];
+				bool category = kind < 2 || ((c & POI_CATEGORY_MASK) == 0 && food["amenity"].count(sub));
+				expected += category && qs[n].accept(pois[i].x24 << 7, pois[i].y24 << 7);
+			}
+			kindOk = kindOk && expected == found[n];
+		}
+		size_t total = 0;
+		for (int n = 0; n < queries; n++) {
+			total += found[n];
+		}
+		printf("%-24s: %d queries %d ms cold, %d ms warm, %d found %s\n", names[kind], queries,
+				ms[0], ms[1], (int) total, kindOk ? "ok" : "WRONG");
+		ok = ok && kindOk;
+	}
+	closeBinaryMapFile(name);
+	remove(name.c_str());
+	return ok;
+}
+
+struct SyntheticLine {
+	std::string type;
+	std::string name;
+	std::vector<TransportLineStop> stops; // names are not set
+};
+
+// A city grid: buses along every row and column, trams along diagonals
+// with their own stops a little aside, and two subway lines crossing in
+// the middle. Coordinates at zoom 24 as the file has them, shifted to 31.
+static std::vector<SyntheticLine> syntheticTransportLines(int grid, uint32_t x24, uint32_t y24, uint32_t spacing) {
+	std::vector<SyntheticLine> lines;
+	char name[64];
+	for (int along = 0; along < 2; along++) {
+		for (int l = 0; l < grid; l++) {
+			SyntheticLine line;
+			line.type = "bus";
+			sprintf(name, "%s %d", along ? "Column" : "Row", l);
+			line.name = name;
+			for (int i = 0; i < grid; i++) {
+				int r = along ? i : l;
+				int c = along ? l : i;
+				TransportLineStop s = { (uint64_t) (r * grid + c + 1), (x24 + c * spacing) << 7, (y24 + r * spacing) << 7, 0 };
+				line.stops.push_back(s);
+			}
+			lines.push_back(line);
+		}
+	}
+	for (int d = -grid + 2; d < grid - 1; d += 5) {
+		SyntheticLine line;
+		line.type = "tram";
+		sprintf(name, "Diagonal %d", d);
+		line.name = name;
+		for (int r = std::max(0, -d); r < grid && r + d < grid; r++) {
+			int c = r + d;
+			TransportLineStop s = { (uint64_t) (grid * grid + r * grid + c + 1),
+					(x24 + c * spacing + spacing / 7) << 7, (y24 + r * spacing) << 7, 0 };
+			line.stops.push_back(s);
+		}
+		lines.push_back(line);
+	}
+	for (int along = 0; along < 2; along++) {
+		SyntheticLine line;
+		line.type = "subway";
+		line.name = along ? "U2" : "U1";
+		for (int i = 0; i < grid; i += 4) {
+			int r = along ? i : grid / 2;
+			int c = along ? grid / 2 : i;
+			TransportLineStop s = { (uint64_t) (r * grid + c + 1), (x24 + c * spacing) << 7, (y24 + r * spacing) << 7, 0 };
+			line.stops.push_back(s);
+		}
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+// Time dependent Dijkstra with as many rides and as much walking as wanted,
+// and no time to change. The planner must find the same arrival.
+static uint32_t referenceTransitArrival(TransportNetwork const & n, TransitQuery const & q) {
+	uint32_t const NONE = TransportNetwork::NONE;
+	typedef std::pair<uint32_t, uint32_t> Item; // time, stop
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item> > open;
+	std::vector<uint32_t> at(n.stopsCount(), NONE);
+	uint32_t best = NONE;
+	double direct = distance31TileMetric(q.fromX, q.fromY, q.toX, q.toY);
+	if (direct <= q.walkRadius) {
+		best = q.departure + (uint32_t) ceil(direct / q.walkSpeed);
+	}
+	for (uint32_t s = 0; s < n.stopsCount(); s++) {
+		double d = distance31TileMetric(n.stopX[s], n.stopY[s], q.fromX, q.fromY);
+		if (d <= q.walkRadius) {
+			at[s] = q.departure + (uint32_t) ceil(d / q.walkSpeed);
+			open.push(Item(at[s], s));
+		}
+	}
+	while (!open.empty()) {
+		Item it = open.top();
+		open.pop();
+		uint32_t t = it.first;
+		uint32_t s = it.second;
+		if (t != at[s]) {
+			continue;
+		}
+		double e = distance31TileMetric(n.stopX[s], n.stopY[s], q.toX, q.toY);
+		if (e <= q.walkRadius) {
+			best = std::min(best, t + (uint32_t) ceil(e / q.walkSpeed));
+		}
+		for (uint32_t i = n.stopRoutesBegin[s]; i < n.stopRoutesBegin[s + 1]; i++) {
+			TransportNetwork::Route const & r = n.routes[n.stopRoutes[i].route];
+			uint32_t position = n.stopRoutes[i].position;
+			uint32_t trip = n.earliestTrip(r, position, t);
+			for (uint32_t p = position + 1; trip != NONE && p < r.stops; p++) {
+				uint32_t next = n.stop(r, p);
+				if (n.time(r, trip, p) < at[next]) {
+					at[next] = n.time(r, trip, p);
+					open.push(Item(at[next], next));
+				}
+			}
+		}
+		for (uint32_t i = n.transfersBegin[s]; i < n.transfersBegin[s + 1]; i++) {
+			TransportNetwork::Transfer const & tr = n.transfers[i];
+			if (t + tr.seconds < at[tr.stop]) {
+				at[tr.stop] = t + tr.seconds;
+				open.push(Item(at[tr.stop], tr.stop));
+			}
+		}
+	}
+	return best;
+}
+
+// Legs follow each other, rides are trips of the timetable and walks are not too fast.
+static bool validJourney(TransportNetwork const & n, TransitQuery const & q, TransitJourney const & j) {
+	uint32_t const NONE = TransportNetwork::NONE;
+	uint32_t time = q.departure;
+	uint32_t x = q.fromX;
+	uint32_t y = q.fromY;
+	for (size_t l = 0; l < j.legs.size(); l++) {
+		TransitLeg const & leg = j.legs[l];
+		uint32_t fromX = leg.fromStop == NONE ? q.fromX : n.stopX[leg.fromStop];
+		uint32_t fromY = leg.fromStop == NONE ? q.fromY : n.stopY[leg.fromStop];
+		uint32_t toX = leg.toStop == NONE ? q.toX : n.stopX[leg.toStop];
+		uint32_t toY = leg.toStop == NONE ? q.toY : n.stopY[leg.toStop];
+		if (leg.departure < time || fromX != x || fromY != y || leg.arrival < leg.departure) {
+			return false;
+		}
+		if (leg.kind == TransitLeg::RIDE) {
+			TransportNetwork::Route const & r = n.routes[leg.route];
+			uint32_t board = NONE;
+			bool alighted = false;
+			for (uint32_t p = 0; p < r.stops && !alighted; p++) {
+				if (board == NONE && n.stop(r, p) == leg.fromStop && n.time(r, leg.trip, p) == leg.departure) {
+					board = p;
+				} else if (board != NONE && n.stop(r, p) == leg.toStop && n.time(r, leg.trip, p) == leg.arrival) {
+					alighted = true;
+				}
+			}
+			if (!alighted) {
+				return false;
+			}
+		} else if (leg.arrival - leg.departure + 1 < distance31TileMetric(fromX, fromY, toX, toY) / q.walkSpeed) {
+			return false;
+		}
+		time = leg.arrival;
+		x = toX;
+		y = toY;
+	}
+	return time == j.arrival && x == q.toX && y == q.toY;
+}
+
+// Routes in both directions, stops relative to the one before.
+static std::string syntheticTransportFile(std::vector<SyntheticLine> const & lines) {
+	std::vector<std::string> strings;
+	std::map<std::string, uint32_t> indexes;
+	struct Strings {
+		std::vector<std::string> & strings;
+		std::map<std::string, uint32_t> & indexes;
+		uint32_t operator()(std::string const & s) {
+			std::map<std::string, uint32_t>::iterator it = indexes.find(s);
+			if (it != indexes.end()) {
+				return it->second;
+			}
+			indexes[s] = strings.size();
+			strings.push_back(s);
+			return strings.size() - 1;
+		}
+	} stringIndex = { strings, indexes };
+
+	std::string routes;
+	int32_t left = INT_MAX, right = 0, top = INT_MAX, bottom = 0;
+	char name[32];
+	for (size_t l = 0; l < lines.size(); l++) {
+		std::string route;
+		putUInt(route, TransportRoute::kIdFieldNumber, l + 1);
+		putUInt(route, TransportRoute::kTypeFieldNumber, stringIndex(lines[l].type));
+		putBytes(route, TransportRoute::kRefFieldNumber, lines[l].name);
+		putUInt(route, TransportRoute::kNameFieldNumber, stringIndex(lines[l].name));
+		for (int reverse = 0; reverse < 2; reverse++) {
+			int64_t id = 0;
+			int32_t x = 0, y = 0;
+			for (size_t i = 0; i < lines[l].stops.size(); i++) {
+				TransportLineStop const & s = lines[l].stops[reverse ? lines[l].stops.size() - 1 - i : i];
+				int32_t x24 = s.x >> 7;
+				int32_t y24 = s.y >> 7;
+				std::string stop;
+				// Ids are small, their zigzag is the same in 32 and 64 bits
+				putSint(stop, TransportRouteStop::kIdFieldNumber, s.id - id);
+				putSint(stop, TransportRouteStop::kDxFieldNumber, x24 - x);
+				putSint(stop, TransportRouteStop::kDyFieldNumber, y24 - y);
+				sprintf(name, "Stop %d", (int) s.id);
+				putUInt(stop, TransportRouteStop::kNameFieldNumber, stringIndex(name));
+				putBytes(route, reverse ? TransportRoute::kReverseStopsFieldNumber : TransportRoute::kDirectStopsFieldNumber, stop);
+				id = s.id;
+				x = x24;
+				y = y24;
+				left = std::min(left, x24);
+				right = std::max(right, x24);
+				top = std::min(top, y24);
+				bottom = std::max(bottom, y24);
+			}
+		}
+		putBytes(routes, TransportRoutes::kRoutesFieldNumber, route);
+	}
+	std::string stops;
+	putSint(stops, TransportStopsTree::kLeftFieldNumber, left);
+	putSint(stops, TransportStopsTree::kRightFieldNumber, right);
+	putSint(stops, TransportStopsTree::kTopFieldNumber, top);
+	putSint(stops, TransportStopsTree::kBottomFieldNumber, bottom);
+	std::string table;
+	for (size_t i = 0; i < strings.size(); i++) {
+		putBytes(table, StringTable::kSFieldNumber, strings[i]);
+	}
+
+	std::string index;
+	putBytes(index, OsmAndTransportIndex::kNameFieldNumber, "benchmark");
+	putFixed32Message(index, OsmAndTransportIndex::kRoutesFieldNumber, routes);
+	putFixed32Message(index, OsmAndTransportIndex::kStopsFieldNumber, stops);
+	putBytes(index, OsmAndTransportIndex::kStringTableFieldNumber, table);
+	std::string file;
+	putUInt(file, OsmAndStructure::kVersionFieldNumber, MAP_VERSION);
+	putFixed32Message(file, OsmAndStructure::kTransportIndexFieldNumber, index);
+	putUInt(file, OsmAndStructure::kVersionConfirmFieldNumber, MAP_VERSION);
+	return file;
+}
+
+// Journeys are checked against a Dijkstra over the same timetable.
+bool benchmarkTransport(int argc, char **params) {
+	int grid = 60;
+	int queries = 1000;
+	for (int i = 1; i != argc; ++i) {
+		sscanf(params[i], "-grid=%d", &grid);
+		sscanf(params[i], "-queries=%d", &queries);
+	}
+	// Stops every 400 m over Berlin
+	uint32_t x0 = get31TileNumberX(13.3) >> 7;
+	uint32_t y0 = get31TileNumberY(52.55) >> 7;
+	uint32_t spacing = 275;
+	std::vector<SyntheticLine> lines = syntheticTransportLines(grid, x0, y0, spacing);
+	std::string name = "transport-benchmark.obf";
+	std::string bytes = syntheticTransportFile(lines);
+	FILE * f = fopen(name.c_str(), "wb");
+	if (f == NULL || fwrite(bytes.data(), 1, bytes.size(), f) != bytes.size()) {
+		printf("Can not write %s\n", name.c_str());
+		if (f != NULL) fclose(f);
+		return false;
+	}
+	fclose(f);
+	BinaryMapFile * file = initBinaryMapFile(name);
+	if (file == NULL || file->transportIndexes.empty()) {
+		remove(name.c_str());
+		return false;
+	}
+
+	OsmAnd::ElapsedTimer timer;
+	timer.Start();
+	TransportNetwork_pointer network = file->transportIndexes[0]->network();
+	int buildMs = timer.GetElapsedMs();
+	printf("%d lines in %d bytes read in %d ms: %d stops, %d routes, %d stop times, %d footpaths, %d KB\n",
+			(int) lines.size(), (int) bytes.size(), buildMs, (int) network->stopsCount(), (int) network->routes.size(),
+			(int) network->times.size(), (int) network->transfers.size() / 2, (int) (network->memorySize() >> 10));
+
+	uint32_t span = grid * spacing;
+	srand(3);
+	std::vector<TransitQuery> qs;
+	for (int n = 0; n < queries; n++) {
+		uint32_t fx = (x0 + rand() % span) << 7;
+		uint32_t fy = (y0 + rand() % span) << 7;
+		uint32_t tx = (x0 + rand() % span) << 7;
+		uint32_t ty = (y0 + rand() % span) << 7;
+		qs.push_back(TransitQuery(fx, fy, tx, ty, 6 * 3600 + rand() % (16 * 3600)));
+	}
+	// As the application asks, and with one planner for all queries
+	std::vector<TransitJourney> journeys(queries);
+	OsmAnd::ElapsedTimer searchTimer;
+	searchTimer.Start();
+	for (int n = 0; n < queries; n++) {
+		searchTransitRoute(qs[n], journeys[n]);
+	}
+	int searchMs = searchTimer.GetElapsedMs();
+	std::vector<uint32_t> searched(queries);
+	for (int n = 0; n < queries; n++) {
+		searched[n] = journeys[n].arrival;
+	}
+	TransitPlanner planner(network);
+	uint64_t scanned = 0;
+	OsmAnd::ElapsedTimer planTimer;
+	planTimer.Start();
+	for (int n = 0; n < queries; n++) {
+		planner.plan(qs[n], journeys[n]);
+		scanned += planner.scannedRoutes();
+	}
+	int planMs = planTimer.GetElapsedMs();
+
+	int found = 0;
+	int rides = 0;
+	bool ok = true;
+	for (int n = 0; n < queries; n++) {
+		if (journeys[n].found()) {
+			found++;
+			rides += journeys[n].rides();
+			ok = ok && validJourney(*network, qs[n], journeys[n]);
+		}
+		// searches reuse planners of earlier ones, which must not change them
+		ok = ok && journeys[n].arrival == searched[n];
+	}
+	for (int n = 0; n < queries; n += 10) {
+		TransitQuery q = qs[n];
+		q.transferSlack = 0;
+		q.maxTransfers = 50;
+		TransitJourney j;
+		planner.plan(q, j);
+		ok = ok && j.arrival == referenceTransitArrival(*network, q);
+	}
+	printf("%d queries: %d ms searching files, %d ms with one planner, %d routes scanned a query\n",
+			queries, searchMs, planMs, (int) (scanned / std::max(queries, 1)));
+	printf("%d journeys found, %.2f rides each %s\n", found, found ? rides / (double) found : 0.0, ok ? "ok" : "WRONG");
+	closeBinaryMapFile(name);
+	remove(name.c_str());
+	return ok;
+}
+
+// Routing points are stored without their lowest bits, as the reader expects.
+static int const ROUTE_SHIFT_COORDINATES = 4;
+
+// Encoding rules of the synthetic road network, ids in file order.
+enum SyntheticRoadRule {
+	ROAD_PRIMARY = 1, ROAD_SECONDARY, ROAD_RESIDENTIAL, ROAD_ONEWAY, ROAD_ONEWAY_REVERSE, ROAD_SIGNALS
+};
+
+struct SyntheticRoad {
+	std::vector<uint32_t> types;
+	std::vector<uint32_t> x; // 31, multiples of 1 << ROUTE_SHIFT_COORDINATES
+	std::vector<uint32_t> y;
+	std::vector<uint32_t> signals; // points with traffic lights
+};
+
+// Grid of streets with a shape point in every block: every tenth line a
+// primary road, every fifth a secondary one, residential ones between,
+// some of them oneway and a few blocks missing. Traffic lights where main
+// roads cross a primary one.
+static std::vector<SyntheticRoad> syntheticRoads(int grid, uint32_t x0, uint32_t y0,
+		uint32_t spacingX, uint32_t spacingY, std::vector<uint32_t> & nodesX, std::vector<uint32_t> & nodesY) {
+	uint32_t const mask = ~((1u << ROUTE_SHIFT_COORDINATES) - 1);
+	srand(5);
+	nodesX.clear();
+	nodesY.clear();
+	for (int r = 0; r < grid; r++) {
+		for (int c = 0; c < grid; c++) {
+			nodesX.push_back((x0 + c * spacingX + rand() % (spacingX / 4) - spacingX / 8) & mask);
+			nodesY.push_back((y0 + r * spacingY + rand() % (spacingY / 4) - spacingY / 8) & mask);
+		}
+	}
+	struct Line {
+		static uint32_t type(int l) {
+			return l % 10 == 0 ? ROAD_PRIMARY : (l % 5 == 0 ? ROAD_SECONDARY : ROAD_RESIDENTIAL);
+		}
+	};
+	int const blocks = 5; // a way
+	std::vector<SyntheticRoad> roads;
+	for (int along = 0; along < 2; along++) {
+		for (int l = 0; l < grid; l++) {
+			uint32_t type = Line::type(l);
+			for (int start = 0; start < grid - 1; start += blocks) {
+				if (type == ROAD_RESIDENTIAL && rand() % 20 == 0) {
+					continue;
+				}
+				SyntheticRoad road;
+				road.types.push_back(type);
+				if (type == ROAD_RESIDENTIAL && l % 6 == 1) {
+					road.types.push_back(ROAD_ONEWAY);
+				} else if (type == ROAD_RESIDENTIAL && l % 6 == 4) {
+					road.types.push_back(ROAD_ONEWAY_REVERSE);
+				}
+				int end = std::min(start + blocks, grid - 1);
+				for (int i = start; i <= end; i++) {
+					size_t node = along ? i * grid + l : l * grid + i;
+					uint32_t crossing = Line::type(i);
+					if (type != ROAD_RESIDENTIAL && crossing != ROAD_RESIDENTIAL
+							&& (type == ROAD_PRIMARY || crossing == ROAD_PRIMARY)) {
+						road.signals.push_back(road.x.size());
+					}
+					road.x.push_back(nodesX[node]);
+					road.y.push_back(nodesY[node]);
+					if (i < end) {
+						size_t next = along ? (i + 1) * grid + l : l * grid + i + 1;
+						int32_t bend = (int32_t) ((i % 3) - 1) * (int32_t) (spacingX / 20);
+						road.x.push_back(((nodesX[node] + nodesX[next]) / 2 + (along ? bend : 0)) & mask);
+						road.y.push_back(((nodesY[node] + nodesY[next]) / 2 + (along ? 0 : bend)) & mask);
+					}
+				}
+				roads.push_back(road);
+			}
+		}
+	}
+	return roads;
+}
+
+// One level of boxes: a leaf with the roads starting in each zoom 14 tile.
+static std::string syntheticRoutingFile(std::vector<SyntheticRoad> const & roads) {
+	typedef std::map<uint64_t, std::vector<size_t> > Tiles_t; // (x14 << 32 | y14) -> roads
+	Tiles_t leaves;
+	for (size_t i = 0; i < roads.size(); i++) {
+		leaves[(uint64_t) (roads[i].x[0] >> 17) << 32 | (roads[i].y[0] >> 17)].push_back(i);
+	}
+	char const * rules[][2] = { { "highway", "primary" }, { "highway", "secondary" }, { "highway", "residential" },
+			{ "oneway", "yes" }, { "oneway", "-1" }, { "highway", "traffic_signals" } };
+	std::string header;
+	putBytes(header, OsmAndRoutingIndex::kNameFieldNumber, "benchmark");
+	for (size_t r = 0; r < sizeof(rules) / sizeof(rules[0]); r++) {
+		std::string rule;
+		putBytes(rule, OsmAndRoutingIndex_RouteEncodingRule::kTagFieldNumber, rules[r][0]);
+		putBytes(rule, OsmAndRoutingIndex_RouteEncodingRule::kValueFieldNumber, rules[r][1]);
+		putBytes(header, OsmAndRoutingIndex::kRulesFieldNumber, rule);
+	}
+
+	std::vector<std::string> blocks;
+	std::vector<std::string> boxes; // without shiftToData
+	for (Tiles_t::const_iterator t = leaves.begin(); t != leaves.end(); t++) {
+		uint32_t left = UINT_MAX, right = 0, top = UINT_MAX, bottom = 0;
+		for (size_t k = 0; k < t->second.size(); k++) {
+			SyntheticRoad const & road = roads[t->second[k]];
+			left = std::min(left, *std::min_element(road.x.begin(), road.x.end()));
+			right = std::max(right, *std::max_element(road.x.begin(), road.x.end()));
+			top = std::min(top, *std::min_element(road.y.begin(), road.y.end()));
+			bottom = std::max(bottom, *std::max_element(road.y.begin(), road.y.end()));
+		}
+		std::string box;
+		putSint(box, OsmAndRoutingIndex_RouteDataBox::kLeftFieldNumber, left);
+		putSint(box, OsmAndRoutingIndex_RouteDataBox::kRightFieldNumber, right);
+		putSint(box, OsmAndRoutingIndex_RouteDataBox::kTopFieldNumber, top);
+		putSint(box, OsmAndRoutingIndex_RouteDataBox::kBottomFieldNumber, bottom);
+		boxes.push_back(box);
+
+		std::string ids;
+		std::string block;
+		int64_t id = 0;
+		for (size_t k = 0; k < t->second.size(); k++) {
+			SyntheticRoad const & road = roads[t->second[k]];
+			putUInt(ids, IdTable::kRouteIdFieldNumber, WireFormatLite::ZigZagEncode64(t->second[k] + 1 - id));
+			id = t->second[k] + 1;
+			std::string object;
+			std::string types;
+			for (size_t i = 0; i < road.types.size(); i++) {
+				putVarint(types, road.types[i]);
+			}
+			putBytes(object, RouteData::kTypesFieldNumber, types);
+			putUInt(object, RouteData::kRouteIdFieldNumber, k);
+			std::string points;
+			int32_t px = left >> ROUTE_SHIFT_COORDINATES;
+			int32_t py = top >> ROUTE_SHIFT_COORDINATES;
+			for (size_t i = 0; i < road.x.size(); i++) {
+				int32_t x = road.x[i] >> ROUTE_SHIFT_COORDINATES;
+				int32_t y = road.y[i] >> ROUTE_SHIFT_COORDINATES;
+				putVarint(points, WireFormatLite::ZigZagEncode32(x - px));
+				putVarint(points, WireFormatLite::ZigZagEncode32(y - py));
+				px = x;
+				py = y;
+			}
+			putBytes(object, RouteData::kPointsFieldNumber, points);
+			if (!road.signals.empty()) {
+				std::string pointTypes;
+				std::string signal;
+				putVarint(signal, ROAD_SIGNALS);
+				for (size_t i = 0; i < road.signals.size(); i++) {
+					putVarint(pointTypes, road.signals[i]);
+					putVarint(pointTypes, signal.size());
+					pointTypes += signal;
+				}
+				putBytes(object, RouteData::kPointTypesFieldNumber, pointTypes);
+			}
+			putBytes(block, OsmAndRoutingIndex_RouteDataBlock::kDataObjectsFieldNumber, object);
+		}
+		std::string data;
+		putBytes(data, OsmAndRoutingIndex_RouteDataBlock::kIdTableFieldNumber, ids);
+		blocks.push_back(data + block);
+	}
+
+	// Boxes have the same size whatever their offsets, which are from the
+	// end of the box length to the length of the block.
+	uint32_t boxesSize = 0;
+	for (size_t b = 0; b < boxes.size(); b++) {
+		boxesSize += 1 + 4 + boxes[b].size() + 1 + 4;
+	}
+	std::string index = header;
+	uint32_t blockPos = header.size() + boxesSize;
+	for (size_t b = 0; b < boxes.size(); b++) {
+		uint32_t boxPos = index.size() + 1 + 4;
+		std::string box = boxes[b];
+		putTag(box, OsmAndRoutingIndex_RouteDataBox::kShiftToDataFieldNumber, WireFormatLite::WIRETYPE_FIXED32);
+		putFixed32(box, blockPos + 1 - boxPos);
+		putFixed32Message(index, OsmAndRoutingIndex::kRootBoxesFieldNumber, box);
+		std::string length;
+		putVarint(length, blocks[b].size());
+		blockPos += 1 + length.size() + blocks[b].size();
+	}
+	for (size_t b = 0; b < blocks.size(); b++) {
+		putBytes(index, OsmAndRoutingIndex::kBlocksFieldNumber, blocks[b]);
+	}
+	std::string file;
+	putUInt(file, OsmAndStructure::kVersionFieldNumber, MAP_VERSION);
+	putFixed32Message(file, OsmAndStructure::kRoutingIndexFieldNumber, index);
+	putUInt(file, OsmAndStructure::kVersionConfirmFieldNumber, MAP_VERSION);
+	return file;
+}
+
+// Car profile for the synthetic roads, as routing.xml would give it.
+static void syntheticCarRouter(GeneralRouter & router) {
+	char const * highways[] = { "primary", "secondary", "residential" };
+	char const * speeds[] = { "65", "50", "30" };
+	char const * priorities[] = { "1.1", "1.05", "0.8" };
+	RouteAttributeContext * speed = router.newRouteAttributeContext();
+	for (int i = 0; i < 3; i++) {
+		RouteAttributeEvalRule * rule = speed->newEvaluationRule();
+		rule->registerAndTagValueCondition(&router, "highway", highways[i], false);
+		rule->registerSelectValue(speeds[i], "speed");
+	}
+	RouteAttributeContext * priority = router.newRouteAttributeContext();
+	for (int i = 0; i < 3; i++) {
+		RouteAttributeEvalRule * rule = priority->newEvaluationRule();
+		rule->registerAndTagValueCondition(&router, "highway", highways[i], false);
+		rule->registerSelectValue(priorities[i], "");
+	}
+	// Every road is accessible
+	router.newRouteAttributeContext();
+	for (int routing = 0; routing < 2; routing++) {
+		RouteAttributeContext * obstacles = router.newRouteAttributeContext();
+		RouteAttributeEvalRule * rule = obstacles->newEvaluationRule();
+		rule->registerAndTagValueCondition(&router, "highway", "traffic_signals", false);
+		rule->registerSelectValue("25", "");
+	}
+	RouteAttributeContext * oneway = router.newRouteAttributeContext();
+	RouteAttributeEvalRule * rule = oneway->newEvaluationRule();
+	rule->registerAndTagValueCondition(&router, "oneway", "yes", false);
+	rule->registerSelectValue("1", "");
+	rule = oneway->newEvaluationRule();
+	rule->registerAndTagValueCondition(&router, "oneway", "-1", false);
+	rule->registerSelectValue("-1", "");
+	// No transition penalties
+	router.newRouteAttributeContext();
+	router.leftTurn = 0;
+	router.rightTurn = 0;
+	router.roundaboutTurn = 0;
+	router.minDefaultSpeed = 30 / 3.6;
+	router.maxDefaultSpeed = 70 / 3.6;
+	router.compile();
+}
+
+std::vector<RouteSegmentResult> searchRouteInternal(RoutingContext* ctx, bool leftSideNavigation);
+
+// Road grid of the route benchmarks, opened as name. Blocks of about 200 m
+// over Berlin; queries between nodes at least half the grid apart.
+static bool openSyntheticRoutes(std::string const & name, int grid, int queries,
+		std::vector<uint32_t> & nodesX, std::vector<uint32_t> & nodesY, std::vector<std::pair<size_t, size_t> > & qs) {
+	uint32_t x0 = get31TileNumberX(13.3);
+	uint32_t y0 = get31TileNumberY(52.55);
+	std::vector<SyntheticRoad> roads = syntheticRoads(grid, x0, y0, 17600, 10720, nodesX, nodesY);
+	std::string bytes = syntheticRoutingFile(roads);
+	FILE * f = fopen(name.c_str(), "wb");
+	if (f == NULL || fwrite(bytes.data(), 1, bytes.size(), f) != bytes.size()) {
+		printf("Can not write %s\n", name.c_str());
+		if (f != NULL) fclose(f);
+		return false;
+	}
+	fclose(f);
+	BinaryMapFile * file = initBinaryMapFile(name);
+	if (file == NULL || file->routingIndexes.empty()) {
+		remove(name.c_str());
+		return false;
+	}
+	printf("%d roads in %d bytes\n", (int) roads.size(), (int) bytes.size());
+
+	srand(7);
+	qs.clear();
+	while ((int) qs.size() < queries) {
+		int r1 = rand() % grid, c1 = rand() % grid, r2 = rand() % grid, c2 = rand() % grid;
+		if (abs(r1 - r2) + abs(c1 - c2) >= grid / 2) {
+			qs.push_back(std::make_pair(r1 * grid + c1, r2 * grid + c2));
+		}
+	}
+	return true;
+}
+
+// Same queries with each open set, every one in a new context as the
+// application does it. Tiles are decoded by the first one only.
+bool benchmarkRoute(int argc, char **params) {
+	int grid = 100;
+	int queries = 50;
+	for (int i = 1; i != argc; ++i) {
+		sscanf(params[i], "-grid=%d", &grid);
+		sscanf(params[i], "-queries=%d", &queries);
+	}
+	grid = std::max(grid, 6);
+	std::string name = "route-benchmark.obf";
+	std::vector<uint32_t> nodesX, nodesY;
+	std::vector<std::pair<size_t, size_t> > qs;
+	if (!openSyntheticRoutes(name, grid, queries, nodesX, nodesY, qs)) {
+		return false;
+	}
+	char const * openSets[] = { "priority queue", "indexed heap" };
+	std::vector<float> costs[2];
+	for (int set = 0; set < 2; set++) {
+		RoutingConfiguration config;
+		MAP_STR_STR attributes;
+		config.initParams(attributes);
+		config.openSet = set ? RoutingOpenSet::INDEXED_HEAP : RoutingOpenSet::PRIORITY_QUEUE;
+		syntheticCarRouter(config.router);
+		int found = 0;
+		int searchMs = 0;
+		int loadMs = 0;
+		uint64_t visited = 0, queued = 0, peak = 0;
+		for (int n = 0; n < queries; n++) {
+			RoutingContext ctx(config);
+			ctx.startX = nodesX[qs[n].first];
+			ctx.startY = nodesY[qs[n].first];
+			ctx.targetX = nodesX[qs[n].second];
+			ctx.targetY = nodesY[qs[n].second];
+			OsmAnd::ElapsedTimer timer;
+			timer.Start();
+			searchRouteInternal(&ctx, false);
+			searchMs += timer.GetElapsedMs();
+			loadMs += ctx.timeToLoad.GetElapsedMs();
+			costs[set].push_back(ctx.finalRouteSegment ? ctx.finalRouteSegment->distanceFromStart : -1);
+			if (ctx.finalRouteSegment) {
+				found++;
+				visited += ctx.visitedSegments;
+				queued += ctx.queuedSegments;
+				peak += ctx.maxQueueSize;
+			}
+		}
+		found = std::max(found, 1);
+		printf("%s : %d routes in %d ms, %d ms loading; %d visited, %d queued, %d at most queued a route\n",
+				openSets[set], (int) (costs[set].size() - std::count(costs[set].begin(), costs[set].end(), -1.f)),
+				searchMs, loadMs, (int) (visited / found), (int) (queued / found), (int) (peak / found));
+	}
+	int same = 0;
+	bool ok = true;
+	for (int n = 0; n < queries; n++) {
+		same += fabs(costs[0][n] - costs[1][n]) <= 1e-3 * std::max(costs[0][n], 1.f);
+		ok = ok && (costs[0][n] < 0) == (costs[1][n] < 0);
+	}
+	// Ties are broken in another order, so routes may differ but not be found by one only
+	printf("%d of %d routes cost the same with both open sets %s\n", same, queries, ok ? "ok" : "WRONG");
+	closeBinaryMapFile(name);
+	remove(name.c_str());
+	return ok;
+}
+
+void RoutingQuery(MapFilesSnapshot const & mapFiles, bbox_t & b, RouteDataObjects_t & output);
+
+// Threads query the whole grid at once, all of them decoding the same
+// nodes. Only the published contents must be counted by the node cache,
+// and nothing must be left counted once the file is closed.
+bool benchmarkNodes(int argc, char **params) {
+	int grid = 100;
+	int threads = 8;
+	int rounds = 20;
+	for (int i = 1; i != argc; ++i) {
+		sscanf(params[i], "-grid=%d", &grid);
+		sscanf(params[i], "-threads=%d", &threads);
+		sscanf(params[i], "-rounds=%d", &rounds);
+	}
+	grid = std::max(grid, 6);
+	threads = std::max(threads, 2);
+	size_t usedBefore = nodeCacheUsed();
+	std::string name = "nodes-benchmark.obf";
+	std::vector<uint32_t> nodesX, nodesY;
+	std::vector<std::pair<size_t, size_t> > qs;
+	if (!openSyntheticRoutes(name, grid, 0, nodesX, nodesY, qs)) {
+		return false;
+	}
+	int counted = 0;
+	size_t roads = 0;
+	OsmAnd::ElapsedTimer timer;
+	timer.Start();
+	for (int r = 0; r < rounds; r++) {
+		std::atomic<bool> go(false);
+		std::vector<size_t> found(threads, 0);
+		std::vector<std::thread> pool;
+		for (int t = 0; t < threads; t++) {
+			pool.push_back(std::thread([&go, &found, t]() {
+				while (!go) {
+					std::this_thread::yield();
+				}
+				bbox_t b = boost::geometry::make<bbox_t>(0, 0, INT_MAX, INT_MAX);
+				RouteDataObjects_t objects;
+				RoutingQuery(*currentMapFiles(), b, objects);
+				found[t] = objects.size();
+			}));
+		}
+		go = true;
+		for (int t = 0; t < threads; t++) {
+			pool[t].join();
+		}
+		roads = found[0];
+		counted += nodeCacheUsed() - usedBefore == nodeCachePublished() && std::count(found.begin(), found.end(), roads) == threads;
+		// Back to nothing decoded for the next round
+		setNodeCacheLimit(1);
+		trimNodeCache();
+		setNodeCacheLimit(0);
+	}
+	int ms = timer.GetElapsedMs();
+	closeBinaryMapFile(name);
+	remove(name.c_str());
+	bool ok = counted == rounds && nodeCacheUsed() == usedBefore;
+	printf("%d threads decoding %d roads, %d rounds in %d ms\n", threads, (int) roads, rounds, ms);
+	printf("%d of %d rounds counted as published, %d bytes left counted after closing %s\n", counted, rounds,
+			(int) (nodeCacheUsed() - usedBefore), ok ? "ok" : "WRONG");
+	return ok;
+}
+
+// Random profiles mixing every kind of condition and select value, checked
+// against the rule by rule evaluation of the same rules
+bool benchmarkRules(int argc, char **params) {
+	int contexts = 6;
+	int sets = 200000;
+	for (int i = 1; i != argc; ++i) {
+		sscanf(params[i], "-contexts=%d", &contexts);
+		sscanf(params[i], "-sets=%d", &sets);
+	}
+	char const * tags[] = { "highway", "surface", "access", "oneway", "maxspeed", "motorcar" };
+	char const * values[] = { "primary", "residential", "yes", "no", "-1", "30", "50", "70 mph" };
+	char const * selects[] = { "1", "0.5", "-1", "40", "$maxspeed", ":weight", ":missing", "none" };
+	std::vector<std::string> keys(1, "weight");
+	std::vector<std::string> vls(1, "3.5");
+	srand(1);
+	GeneralRouter router;
+	for (int c = 0; c < contexts; c++) {
+		RouteAttributeContext * context = router.newRouteAttributeContext();
+		context->registerParams(keys, vls);
+		// the first one has no rules, as contexts a profile leaves empty
+		int rules = c == 0 ? 0 : 1 + rand() % 125;
+		for (int r = 0; r < rules; r++) {
+			RouteAttributeEvalRule * rule = context->newEvaluationRule();
+			int conditions = rand() % 4;
+			for (int k = 0; k < conditions; k++) {
+				// a quarter of them on any value of the tag
+				std::string value = rand() % 4 == 0 ? "" : values[rand() % 8];
+				rule->registerAndTagValueCondition(&router, tags[rand() % 6], value, rand() % 3 == 0);
+			}
+			std::string select = selects[rand() % 8];
+			rule->registerSelectValue(select, select == "$maxspeed" ? "speed" : "");
+		}
+	}
+	router.compile();
+	OsmAnd::ElapsedTimer timer;
+	timer.Start();
+	bool ok = router.checkCompiledRules(sets, 1);
+	printf("%d contexts, %d sets of types evaluated with tables and rule by rule in %d ms %s\n",
+			contexts, sets, timer.GetElapsedMs(), ok ? "ok" : "WRONG");
+	return ok;
+}
+
+// Dijkstra over the original edges of the hierarchy
+static double referenceRouteTime(ContractionHierarchy const & ch, uint32_t from, uint32_t to) {
+	std::vector<std::vector<uint32_t> > out(ch.nodesCount());
+	for (size_t e = 0; e < ch.edges.size(); e++) {
+		if (ch.edges[e].second == ContractionHierarchy::NONE) {
+			out[ch.edges[e].from].push_back(e);
+		}
+	}
+	typedef std::pair<double, uint32_t> Item;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item> > open;
+	std::vector<double> at(ch.nodesCount(), -1);
+	at[from] = 0;
+	open.push(Item(0, from));
+	while (!open.empty()) {
+		Item it = open.top();
+		open.pop();
+		if (it.first != at[it.second]) {
+			continue;
+		}
+		if (it.second == to) {
+			return it.first;
+		}
+		for (size_t i = 0; i < out[it.second].size(); i++) {
+			ContractionHierarchy::Edge const & e = ch.edges[out[it.second][i]];
+			if (at[e.to] < 0 || it.first + e.time < at[e.to]) {
+				at[e.to] = it.first + e.time;
+				open.push(Item(at[e.to], e.to));
+			}
+		}
+	}
+	return -1;
+}
+
+// True if data (ContractionHierarchy, RouteLandmarks) written to fileName,
+// less its last truncate bytes, is not read back
+template <typename T>
+static bool rejectedData(T const & data, std::string const & fileName, long truncate = 0) {
+	T back;
+	bool ok = data.write(fileName);
+	if (ok && truncate > 0) {
+		FILE * f = fopen(fileName.c_str(), "rb");
+		std::vector<char> bytes;
+		fseek(f, 0, SEEK_END);
+		bytes.resize(std::max(ftell(f) - truncate, 0L));
+		fseek(f, 0, SEEK_SET);
+		ok = fread(&bytes[0], 1, bytes.size(), f) == bytes.size();
+		fclose(f);
+		f = fopen(fileName.c_str(), "wb");
+		ok = ok && fwrite(&bytes[0], 1, bytes.size(), f) == bytes.size();
+		fclose(f);
+	}
+	ok = ok && !back.read(fileName);
+	remove(fileName.c_str());
+	return ok;
+}
+
+// True if data (ContractionHierarchy, RouteLandmarks) is loaded for the
+// search once fileName is written, not before, and is not once the file is
+// rewritten with the data of other files
+template <typename T>
+static bool reloadedData(T const & data, std::string const & fileName, GeneralRouter const & router) {
+	T otherFiles = data;
+	// a longer name, the file changes size as well
+	otherFiles.identity.files[0].name += ".other";
+	remove(fileName.c_str());
+	bool ok = !loadRoutingData<T>(fileName, *currentMapFiles(), router)
+			&& data.write(fileName) && loadRoutingData<T>(fileName, *currentMapFiles(), router)
+			&& otherFiles.write(fileName) && !loadRoutingData<T>(fileName, *currentMapFiles(), router);
+	remove(fileName.c_str());
+	return ok;
+}
+
+// Hierarchies of other files or profiles, of roads with turns, or broken
+// ones, are not used
+static bool checkHierarchyRejections(ContractionHierarchy const & built, std::string const & chName,
+		GeneralRouter const & router) {
+	std::string brokenName = chName + ".broken";
+	GeneralRouter slower = router;
+	slower.minDefaultSpeed /= 2;
+	ContractionHierarchy otherFiles = built;
+	if (otherFiles.identity.files.empty()) {
+		return false;
+	}
+	otherFiles.identity.files[0].dateModified++;
+	bool ok = loadContractionHierarchy(chName, *currentMapFiles(), router)
+			&& !loadContractionHierarchy(chName, *currentMapFiles(), slower)
+			&& otherFiles.write(brokenName) && !loadContractionHierarchy(brokenName, *currentMapFiles(), router);
+	remove(brokenName.c_str());
+	ok = ok && reloadedData(built, brokenName, router);
+	// The grid has no turns, a hierarchy that ignores some is not loaded
+	ContractionHierarchy turning = built;
+	turning.turns = ContractionHierarchy::TURN_RESTRICTIONS;
+	ok = ok && built.turns == 0 && turning.write(brokenName) && !loadContractionHierarchy(brokenName, *currentMapFiles(), router);
+	remove(brokenName.c_str());
+
+	ok = ok && rejectedData(built, brokenName, 1) && rejectedData(built, brokenName, sizeof(ContractionHierarchy::Edge));
+	ContractionHierarchy broken = built;
+	broken.rank[0] = broken.rank[1];
+	ok = ok && rejectedData(broken, brokenName);
+	broken = built;
+	broken.turns = 4;
+	ok = ok && rejectedData(broken, brokenName);
+	bool original = false, shortcut = false;
+	for (size_t e = 0; e < built.edges.size(); e++) {
+		broken = built;
+		if (!original && built.edges[e].second == ContractionHierarchy::NONE) {
+			original = true;
+			broken.edges[e].to = built.nodesCount();
+			ok = ok && rejectedData(broken, brokenName);
+			broken = built;
+			broken.edges[e].first = built.pieces.size();
+			ok = ok && rejectedData(broken, brokenName);
+		} else if (!shortcut && built.edges[e].second != ContractionHierarchy::NONE) {
+			// a shortcut through itself would unpack forever
+			shortcut = true;
+			broken.edges[e].first = e;
+			ok = ok && rejectedData(broken, brokenName);
+		}
+	}
+	return ok && original && shortcut;
+}
+
+// Queries of -broute over a contraction hierarchy of the grid, written and
+// loaded back by the search. Costs are checked against a Dijkstra over the
+// original edges, and against the A* routes costed as the hierarchy costs
+// roads; hierarchies of other files or profiles and broken ones must not
+// be read, and files written or rewritten later must be.
+bool benchmarkHierarchy(int argc, char **params) {
+	int grid = 100;
+	int queries = 50;
+	for (int i = 1; i != argc; ++i) {
+		sscanf(params[i], "-grid=%d", &grid);
+		sscanf(params[i], "-queries=%d", &queries);
+	}
+	grid = std::max(grid, 6);
+	std::string name = "route-benchmark.obf";
+	std::vector<uint32_t> nodesX, nodesY;
+	std::vector<std::pair<size_t, size_t> > qs;
+	if (!openSyntheticRoutes(name, grid, queries, nodesX, nodesY, qs)) {
+		return false;
+	}
+	RoutingConfiguration config;
+	MAP_STR_STR attributes;
+	config.initParams(attributes);
+	syntheticCarRouter(config.router);
+	RoutingConfiguration hierarchyConfig;
+	hierarchyConfig.initParams(attributes);
+	syntheticCarRouter(hierarchyConfig.router);
+
+	std::string chName = "route-benchmark.ch";
+	ContractionHierarchy built;
+	OsmAnd::ElapsedTimer buildTimer;
+	buildTimer.Start();
+	bool ok = buildContractionHierarchy(*currentMapFiles(), config.router, built) && built.write(chName);
+	int buildMs = buildTimer.GetElapsedMs();
+	bool rejections = ok && checkHierarchyRejections(built, chName, hierarchyConfig.router);
+	ContractionHierarchy_pointer ch = ok ? loadContractionHierarchy(chName, *currentMapFiles(), hierarchyConfig.router) :
+			ContractionHierarchy_pointer();
+	if (!ch) {
+		closeBinaryMapFile(name);
+		remove(name.c_str());
+		remove(chName.c_str());
+		return false;
+	}
+	// The first search loads it
+	hierarchyConfig.hierarchyFile = chName;
+	size_t originals = std::count_if(ch->edges.begin(), ch->edges.end(),
+			[](ContractionHierarchy::Edge const & e) { return e.second == ContractionHierarchy::NONE; });
+	FILE * f = fopen(chName.c_str(), "rb");
+	fseek(f, 0, SEEK_END);
+	long chBytes = ftell(f);
+	fclose(f);
+	printf("%d nodes, %d edges and %d shortcuts built in %d ms, %d bytes, %d KB read\n",
+			(int) ch->nodesCount(), (int) originals, (int) (ch->edges.size() - originals), buildMs,
+			(int) chBytes, (int) (ch->memorySize() >> 10));
+
+	int routes[2] = { 0, 0 };
+	int64_t searchUs[2] = { 0, 0 };
+	int64_t hierarchyUs = 0;
+	uint64_t settled = 0;
+	int referenced = 0, asReference = 0, noLonger = 0, sameRoads = 0;
+	for (int n = 0; n < queries; n++) {
+		RoutingContext ctx(config);
+		RoutingContext hierarchyCtx(hierarchyConfig);
+		RoutingContext * contexts[2] = { &ctx, &hierarchyCtx };
+		std::vector<RouteSegmentResult> results[2];
+		for (int c = 0; c < 2; c++) {
+			contexts[c]->startX = nodesX[qs[n].first];
+			contexts[c]->startY = nodesY[qs[n].first];
+			contexts[c]->targetX = nodesX[qs[n].second];
+			contexts[c]->targetY = nodesY[qs[n].second];
+			OsmAnd::ElapsedTimer timer;
+			timer.Start();
+			results[c] = searchRouteInternal(contexts[c], false);
+			searchUs[c] += duration_cast<microseconds>(timer.GetElapsed()).count();
+			routes[c] += contexts[c]->finalRouteSegment ? 1 : 0;
+		}
+		hierarchyUs += duration_cast<microseconds>(hierarchyCtx.timeToCalculate.GetElapsed()).count();
+		settled += hierarchyCtx.visitedSegments;
+		if (!ctx.finalRouteSegment || !hierarchyCtx.finalRouteSegment) {
+			ok = ok && !ctx.finalRouteSegment && !hierarchyCtx.finalRouteSegment;
+			continue;
+		}
+		float cost = hierarchyCtx.finalRouteSegment->distanceFromStart;
+		uint32_t from = ch->node(nodesX[qs[n].first], nodesY[qs[n].first]);
+		uint32_t to = ch->node(nodesX[qs[n].second], nodesY[qs[n].second]);
+		if (from != ContractionHierarchy::NONE && to != ContractionHierarchy::NONE) {
+			double reference = referenceRouteTime(*ch, from, to);
+			referenced++;
+			asReference += fabs(cost - reference) <= 1e-3 * std::max(reference, 1.);
+		}
+		// Ends are on projected copies of the roads, with a point that has
+		// no obstacle: both routes are costed there the same way.
+		double costs[2] = { 0, 0 };
+		for (int c = 0; c < 2; c++) {
+			for (size_t i = 0; i < results[c].size(); i++) {
+				RouteSegmentResult const & r = results[c][i];
+				costs[c] += roadStretchTime(ctx.attributes, config.router, *r.object, r.startPointIndex, r.endPointIndex);
+			}
+		}
+		noLonger += costs[1] <= costs[0] + 1e-3 * std::max(costs[0], 1.);
+		bool same = results[0].size() == results[1].size();
+		for (size_t i = 0; same && i < results[0].size(); i++) {
+			same = results[0][i].object->id == results[1][i].object->id
+					&& results[0][i].startPointIndex == results[1][i].startPointIndex
+					&& results[0][i].endPointIndex == results[1][i].endPointIndex;
+		}
+		sameRoads += same;
+	}
+	int found = std::max(routes[1], 1);
+	ok = ok && hierarchyConfig.hierarchy == ch && rejections
+			&& routes[0] == routes[1] && asReference == referenced && noLonger == routes[1];
+	printf("A* : %d routes in %d ms\n", routes[0], (int) (searchUs[0] / 1000));
+	printf("hierarchy : %d routes in %d ms, %d us a route searching, %d nodes settled a route\n",
+			routes[1], (int) (searchUs[1] / 1000), (int) (hierarchyUs / found), (int) (settled / found));
+	printf("%d of %d routes cost as a Dijkstra over the roads, %d of %d no more than A* ones, %d along the same roads %s\n",
+			asReference, referenced, noLonger, routes[1], sameRoads, ok ? "ok" : "WRONG");
+	printf("other files, other profiles and broken files %s\n", rejections ? "rejected" : "WRONG");
+	closeBinaryMapFile(name);
+	remove(name.c_str());
+	remove(chName.c_str());
+	return ok;
+}
+
+// Hierarchy of the roads of files for the car profile of the route benchmarks
+static bool writeContractionHierarchy(std::string const & output, int count, char **files) {
+	for (int i = 0; i < count; i++) {
+		if (initBinaryMapFile(files[i]) == NULL) {
+			printf("Can not open %s\n", files[i]);
+			return false;
+		}
+	}
+	RoutingConfiguration config;
+	syntheticCarRouter(config.router);
+	ContractionHierarchy ch;
+	OsmAnd::ElapsedTimer timer;
+	timer.Start();
+	if (!buildContractionHierarchy(*currentMapFiles(), config.router, ch) || !ch.write(output)) {
+		return false;
+	}
+	printf("%d nodes and %d edges written to %s in %d ms\n", (int) ch.nodesCount(), (int) ch.edges.size(),
+			output.c_str(), timer.GetElapsedMs());
+	if (ch.turns != 0) {
+		printf("The roads have turn restrictions or costs, searches will not use it\n");
+	}
+	return true;
+}
+
+// Landmarks of other files or profiles, or broken ones, are not used
+static bool checkLandmarksRejections(RouteLandmarks const & built, std::string const & landmarksName,
+		GeneralRouter const & router) {
+	std::string brokenName = landmarksName + ".broken";
+	GeneralRouter slower = router;
+	slower.minDefaultSpeed /= 2;
+	RouteLandmarks otherFiles = built;
+	if (otherFiles.identity.files.empty() || built.nodeX.size() < 2 || built.landmarks.empty()) {
+		return false;
+	}
+	otherFiles.identity.files[0].size++;
+	bool ok = loadRouteLandmarks(landmarksName, *currentMapFiles(), router)
+			&& !loadRouteLandmarks(landmarksName, *currentMapFiles(), slower)
+			&& otherFiles.write(brokenName) && !loadRouteLandmarks(brokenName, *currentMapFiles(), router);
+	remove(brokenName.c_str());
+	ok = ok && reloadedData(built, brokenName, router);
+
+	ok = ok && rejectedData(built, brokenName, 1) && rejectedData(built, brokenName, sizeof(float));
+	RouteLandmarks broken = built;
+	broken.landmarks[0] = built.nodeX.size();
+	ok = ok && rejectedData(broken, brokenName);
+	broken = built;
+	broken.nodeX[1] = broken.nodeX[0];
+	broken.nodeY[1] = broken.nodeY[0];
+	ok = ok && rejectedData(broken, brokenName);
+	broken = built;
+	broken.to[0] = -1;
+	ok = ok && rejectedData(broken, brokenName);
+	return ok;
+}
+
+// Queries of -broute without and with landmarks of the grid, written next
+// to it and loaded back by the search. Bounds are checked against a
+// Dijkstra over the road graph; landmarks of other files or profiles and
+// broken ones must not be read, and files written or rewritten later must be.
+bool benchmarkLandmarks(int argc, char **params) {
+	int grid = 100;
+	int queries = 50;
+	int count = 16;
+	for (int i = 1; i != argc; ++i) {
+		sscanf(params[i], "-grid=%d", &grid);
+		sscanf(params[i], "-queries=%d", &queries);
+		sscanf(params[i], "-landmarks=%d", &count);
+	}
+	grid = std::max(grid, 6);
+	std::string name = "route-benchmark.obf";
+	std::vector<uint32_t> nodesX, nodesY;
+	std::vector<std::pair<size_t, size_t> > qs;
+	if (!openSyntheticRoutes(name, grid, queries, nodesX, nodesY, qs)) {
+		return false;
+	}
+	RoutingConfiguration configs[2];
+	MAP_STR_STR attributes;
+	for (int c = 0; c < 2; c++) {
+		configs[c].initParams(attributes);
+		syntheticCarRouter(configs[c].router);
+	}
+
+	std::string landmarksName = name + ".landmarks";
+	RouteLandmarks built;
+	OsmAnd::ElapsedTimer buildTimer;
+	buildTimer.Start();
+	bool ok = buildRouteLandmarks(*currentMapFiles(), configs[0].router, count, built) && built.write(landmarksName);
+	int buildMs = buildTimer.GetElapsedMs();
+	bool rejections = ok && checkLandmarksRejections(built, landmarksName, configs[1].router);
+	RouteLandmarks_pointer landmarks = ok ? loadRouteLandmarks(landmarksName, *currentMapFiles(), configs[1].router) :
+			RouteLandmarks_pointer();
+	ContractionHierarchy graph;
+	if (!landmarks || !buildRoadGraph(*currentMapFiles(), configs[0].router, graph)) {
+		closeBinaryMapFile(name);
+		remove(name.c_str());
+		remove(landmarksName.c_str());
+		return false;
+	}
+	// The first search loads them
+	configs[1].landmarksFile = landmarksName;
+	printf("%d landmarks of %d nodes in %d ms, %d KB\n", (int) landmarks->landmarks.size(),
+			(int) landmarks->nodeX.size(), buildMs, (int) (landmarks->memorySize() >> 10));
+
+	char const * heuristics[] = { "straight line", "landmarks" };
+	std::vector<float> costs[2];
+	uint64_t visited[2] = { 0, 0 };
+	for (int c = 0; c < 2; c++) {
+		int searchMs = 0;
+		uint64_t queued = 0;
+		for (int n = 0; n < queries; n++) {
+			RoutingContext ctx(configs[c]);
+			ctx.startX = nodesX[qs[n].first];
+			ctx.startY = nodesY[qs[n].first];
+			ctx.targetX = nodesX[qs[n].second];
+			ctx.targetY = nodesY[qs[n].second];
+			OsmAnd::ElapsedTimer timer;
+			timer.Start();
+			searchRouteInternal(&ctx, false);
+			searchMs += timer.GetElapsedMs();
+			costs[c].push_back(ctx.finalRouteSegment ? ctx.finalRouteSegment->distanceFromStart : -1);
+			visited[c] += ctx.visitedSegments;
+			queued += ctx.queuedSegments;
+		}
+		printf("%s : %d routes in %d ms; %d visited, %d queued a route\n", heuristics[c],
+				(int) (costs[c].size() - std::count(costs[c].begin(), costs[c].end(), -1.f)), searchMs,
+				(int) (visited[c] / std::max(queries, 1)), (int) (queued / std::max(queries, 1)));
+	}
+
+	int bounded = 0, admissible = 0;
+	double totals[2] = { 0, 0 };
+	for (int n = 0; n < queries; n++) {
+		ok = ok && (costs[0][n] < 0) == (costs[1][n] < 0);
+		if (costs[0][n] >= 0 && costs[1][n] >= 0) {
+			totals[0] += costs[0][n];
+			totals[1] += costs[1][n];
+		}
+		uint32_t from = landmarks->node(nodesX[qs[n].first], nodesY[qs[n].first]);
+		uint32_t to = landmarks->node(nodesX[qs[n].second], nodesY[qs[n].second]);
+		double reference = from == ContractionHierarchy::NONE || to == ContractionHierarchy::NONE ? -1
+				: referenceRouteTime(graph, from, to);
+		if (reference >= 0) {
+			bounded++;
+			admissible += landmarks->lowerBound(from, to) <= reference + 1e-3 * std::max(reference, 1.);
+		}
+	}
+	ok = ok && configs[1].landmarks == landmarks && rejections && admissible == bounded;
+	// Neither search is exact: each road is walked to its end at once
+	printf("%d of %d bounds no more than a Dijkstra over the roads, %.0f%% fewer segments visited, routes %+.1f%% in time %s\n",
+			admissible, bounded, 100. - 100. * visited[1] / std::max<uint64_t>(visited[0], 1),
+			100. * totals[1] / std::max(totals[0], 1.) - 100., ok ? "ok" : "WRONG");
+	printf("other files, other profiles and broken files %s\n", rejections ? "rejected" : "WRONG");
+	closeBinaryMapFile(name);
+	remove(name.c_str());
+	remove(landmarksName.c_str());
+	return ok;
+}
+
+// Landmarks of the roads of file for the car profile of the route
+// benchmarks, next to it
+static bool writeRouteLandmarks(std::string const & file, int count) {
+	if (initBinaryMapFile(file) == NULL) {
+		printf("Can not open %s\n", file.c_str());
+		return false;
+	}
+	RoutingConfiguration config;
+	syntheticCarRouter(config.router);
+	RouteLandmarks landmarks;
+	OsmAnd::ElapsedTimer timer;
+	timer.Start();
+	std::string output = file + ".landmarks";
+	if (!buildRouteLandmarks(*currentMapFiles(), config.router, count, landmarks) || !landmarks.write(output)) {
+		return false;
+	}
+	printf("%d landmarks of %d nodes written to %s in %d ms\n", (int) landmarks.landmarks.size(),
+			(int) landmarks.nodeX.size(), output.c_str(), timer.GetElapsedMs());
+	return true;
+}
+
+// The first search builds the names of the file, the second one only uses them.
+void searchAddressPrefix(std::string const & prefix, std::string const & fileName) {
+	if (initBinaryMapFile(fileName) == NULL) {
+		return;
+	}
+	for (int pass = 0; pass < 2; pass++) {
+		AddressPublisher publisher;
+		AddressQuery q(prefix, 20, &publisher);
+		OsmAnd::ElapsedTimer timer;
+		timer.Start();
+		searchAddress(q);
+		int ms = timer.GetElapsedMs();
+		printf("%s search : %d found in %d ms\n", pass == 0 ? "First" : "Next", (int) publisher.result.size(), ms);
+		for (size_t i = 0; pass == 1 && i < publisher.result.size(); i++) {
+			AddressMatch const & m = publisher.result[i];
+			if (m.street != NULL) {
+				printf("  street %s, %s\n", m.names->text(m.street->name), m.names->text(m.city->name));
+			} else {
+				printf("  city %s\n", m.names->text(m.city->name));
+			}
+		}
+	}
+	closeBinaryMapFile(fileName);
 }
 
 class RenderingInfo {
@@ -127,77 +1663,77 @@ const char* formatBounds(int left, int right, int top, int bottom){
 }
 
 
+static void printPartInformation(int i, const char* partname, BinaryPartIndex const * it) {
+	printf("%d. %s data %s - %d bytes\n", i, partname, it->name.c_str(), it->length);
+}
+
 void printFileInformation(const char* fileName, VerboseInfo* verbose) {
 	BinaryMapFile* file = initBinaryMapFile(fileName);
-	std::vector<BinaryPartIndex*>::iterator its = file->indexes.begin();
+	if (file == NULL) {
+		printf("File %s could not be read\n", fileName);
+		return;
+	}
 	time_t date = file->dateCreated/1000;
 	printf("Obf file.\n Version %d, basemap %d, date %s \n", file->version,
 			file->basemap, ctime(&date));
 
 	int i = 1;
-	for (; its != file->indexes.end(); its++, i++) {
-		BinaryPartIndex* it = *its;
-		std::string partname = "";
-		if (it->type == MAP_INDEX) {
-			partname = "Map";
-		} else if (it->type == TRANSPORT_INDEX) {
-			partname = "Transport";
-		} else if (it->type == ROUTING_INDEX) {
-			partname = "Routing";
-		} else if (it->type == POI_INDEX) {
-			partname = "Poi";
-		} else if (it->type == ADDRESS_INDEX) {
-			partname = "Address";
-		}
-		printf("%d. %s data %s - %d bytes\n", i, partname.c_str(), it->name.c_str(), it->length);
-		if (it->type == MAP_INDEX) {
-			MapIndex* m = ((MapIndex*) it);
-			int j = 1;
-			std::vector<MapRoot>::iterator rt = m->levels.begin();
-			for (; rt != m->levels.end(); rt++) {
-				const char* ch = formatBounds(rt->left, rt->right, rt->top, rt->bottom);
-				printf("\t%d.%d Map level minZoom = %d, maxZoom = %d, size = %d bytes \n\t\t Bounds %s \n",
-						i, j++, rt->minZoom, rt->maxZoom, rt->length, ch);
-			}
-			if ((verbose != NULL && verbose->vmap)) {
-				//printMapDetailInfo(verbose, index);
-			}
-		} else if (it->type == TRANSPORT_INDEX) {
-//			TransportIndex ti = ((TransportIndex) p);
-//			int sh = (31 - BinaryMapIndexReader.TRANSPORT_STOP_ZOOM);
-//			println(
-//					"\t Bounds "
-//							+ formatBounds(ti.getLeft() << sh, ti.getRight() << sh, ti.getTop() << sh,
-//									ti.getBottom() << sh));
-		} else if (it->type == POI_INDEX && (verbose != NULL && verbose->vpoi)) {
+	for (std::vector<MapIndex*>::iterator its = file->mapIndexes.begin(); its != file->mapIndexes.end(); its++, i++) {
+		MapIndex* m = *its;
+		printPartInformation(i, "Map", m);
+		int j = 1;
+		std::vector<MapRoot>::iterator rt = m->levels.begin();
+		for (; rt != m->levels.end(); rt++) {
+			const char* ch = formatBounds(rt->left, rt->right, rt->top, rt->bottom);
+			printf("\t%d.%d Map level minZoom = %d, maxZoom = %d, size = %d bytes \n\t\t Bounds %s \n",
+					i, j++, rt->minZoom, rt->maxZoom, rt->length, ch);
+			delete[] ch;
+		}
+		if ((verbose != NULL && verbose->vmap)) {
+			//printMapDetailInfo(verbose, index);
+		}
+	}
+	for (std::vector<TransportIndex*>::iterator its = file->transportIndexes.begin(); its != file->transportIndexes.end(); its++, i++) {
+		printPartInformation(i, "Transport", *its);
+	}
+	for (std::vector<RoutingIndex*>::iterator its = file->routingIndexes.begin(); its != file->routingIndexes.end(); its++, i++) {
+		printPartInformation(i, "Routing", *its);
+	}
+	for (std::vector<PoiIndex*>::iterator its = file->poiIndexes.begin(); its != file->poiIndexes.end(); its++, i++) {
+		printPartInformation(i, "Poi", *its);
+		if (verbose != NULL && verbose->vpoi) {
 			//printPOIDetailInfo(verbose, index, (PoiRegion) p);
-		} else if (it->type == ADDRESS_INDEX && (verbose != NULL && verbose->vaddress)) {
+		}
+	}
+	for (std::vector<AddressIndex*>::iterator its = file->addressIndexes.begin(); its != file->addressIndexes.end(); its++, i++) {
+		printPartInformation(i, "Address", *its);
+		if (verbose != NULL && verbose->vaddress) {
 //			printAddressDetailedInfo(verbose, index);
 		}
-
 	}
 }
 
 
-void runSimpleRendering( string renderingFileName, string resourceDir, RenderingInfo* info) {
+void runSimpleRendering(std::string const & renderingFileName, std::string const & resourceDir, RenderingInfo* info) {
 	SkColor defaultMapColor = SK_ColorLTGRAY;
 
 	if (info->width > 10000 || info->height > 10000) {
-		osmand_log_print(LOG_ERROR, "We don't rendering images more than 10000x10000 ");
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "We don't rendering images more than 10000x10000 ");
 		return;
 	}
 
-	osmand_log_print(LOG_INFO, "Rendering info bounds(%d, %d, %d, %d) zoom(%d), width/height(%d/%d) tilewidth/tileheight(%d/%d) fileName(%s)",
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Rendering info bounds(%d, %d, %d, %d) zoom(%d), width/height(%d/%d) tilewidth/tileheight(%d/%d) fileName(%s)",
 			info->left, info->top, info->right, info->bottom, info->zoom, info->width, info->height, info->tileWX, info->tileHY, info->tileFileName.c_str());
-	RenderingRulesStorage* st = new RenderingRulesStorage(renderingFileName.c_str());
+	RenderingRulesStorage* st = new RenderingRulesStorage();
 	st->parseRulesFromXmlInputStream(renderingFileName.c_str(), NULL);
 	RenderingRuleSearchRequest* searchRequest = new RenderingRuleSearchRequest(st);
 	ResultPublisher* publisher = new ResultPublisher();
 	SearchQuery q(floor(info->left), floor(info->right), ceil(info->top), ceil(info->bottom), searchRequest, publisher);
 	q.zoom = info->zoom;
 
-	ResultPublisher* res = searchObjectsForRendering(&q, true, "Nothing found");
-	osmand_log_print(LOG_INFO, "Found %d objects", res->result.size());
+	int renderedState = 0;
+	ResultPublisher* res = searchObjectsForRendering(&q, true, 0, "Nothing found", renderedState);
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Found %d objects", (int) res->result.size());
 
 	SkBitmap* bitmap = new SkBitmap();
 	bitmap->setConfig(SkBitmap::kRGB_565_Config, info->width, info->height);
@@ -206,9 +1742,9 @@ void runSimpleRendering( string renderingFileName, string resourceDir, Rendering
 	void* bitmapData = malloc(bitmapDataSize);
 	bitmap->setPixels(bitmapData);
 
-	osmand_log_print(LOG_INFO, "Initializing rendering style and rendering context");
-	ElapsedTimer initObjects;
-	initObjects.start();
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Initializing rendering style and rendering context");
+	OsmAnd::ElapsedTimer initObjects;
+	initObjects.Start();
 
 	RenderingContext rc;
 	rc.setDefaultIconsDir(resourceDir);
@@ -231,19 +1767,21 @@ void runSimpleRendering( string renderingFileName, string resourceDir, Rendering
 	rc.setZoom(info->zoom);
 	rc.setRotate(0);
 	rc.setDensityScale(1);
-	osmand_log_print(LOG_INFO, "Rendering image");
-	initObjects.pause();
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Rendering image");
+	initObjects.Pause();
+	rc.nativeOperations.Start();
 	SkCanvas* canvas = new SkCanvas(*bitmap);
 	canvas->drawColor(defaultMapColor);
-	doRendering(res->result, canvas, searchRequest, &rc);
-	osmand_log_print(LOG_INFO, "End Rendering image");
-	osmand_log_print(LOG_INFO, "Native ok (init %d, rendering %d) ", initObjects.getElapsedTime(),
-			rc.nativeOperations.getElapsedTime());
+	doRendering(res->result, *canvas, searchRequest, rc);
+	rc.nativeOperations.Pause();
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "End Rendering image");
+	OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Native ok (init %d, rendering %d) ", initObjects.GetElapsedMs(),
+			rc.nativeOperations.GetElapsedMs());
 	SkImageEncoder* enc = SkImageEncoder::Create(SkImageEncoder::kPNG_Type);
 	if (enc != NULL && !enc->encodeFile(info->tileFileName.c_str(), *bitmap, 100)) {
-		osmand_log_print(LOG_ERROR, "FAIL to save tile to %s", info->tileFileName.c_str());
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Error, "FAIL to save tile to %s", info->tileFileName.c_str());
 	} else {
-		osmand_log_print(LOG_INFO, "Tile successfully saved to %s", info->tileFileName.c_str());
+		OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Tile successfully saved to %s", info->tileFileName.c_str());
 	}
 	delete enc;
 	delete publisher;
@@ -258,10 +1796,10 @@ void runSimpleRendering( string renderingFileName, string resourceDir, Rendering
 
 
 void testRenderingRuleStorage(const char* basePath, const char* name) {
-	string filePath = string(basePath) + string(name);
-	RenderingRulesStorage* st = new RenderingRulesStorage(filePath.c_str());
-	st->parseRulesFromXmlInputStream(filePath.c_str(),
-			new BasePathRenderingRulesStorageResolver(string(basePath)));
+	std::string filePath = std::string(basePath) + std::string(name);
+	RenderingRulesStorage* st = new RenderingRulesStorage();
+	BasePathRenderingRulesStorageResolver resolver(basePath);
+	st->parseRulesFromXmlInputStream(filePath.c_str(), &resolver);
 	st->printDebug(RenderingRulesStorage::TEXT_RULES);
 	RenderingRuleSearchRequest* searchRequest = new RenderingRuleSearchRequest(st);
 	searchRequest->setStringFilter(st->PROPS.R_TAG, "highway");
@@ -274,7 +1812,8 @@ void testRenderingRuleStorage(const char* basePath, const char* name) {
 
 	bool res = searchRequest->search(RenderingRulesStorage::LINE_RULES, true);
 	printf("Result %d\n", res);
-	searchRequest->printDebugResult();
+	delete searchRequest;
+	delete st;
 }
 
 
@@ -300,6 +1839,12 @@ int main(int argc, char **argv) {
 				VerboseInfo* vinfo = new VerboseInfo(argc, argv);
 				printFileInformation(argv[argc -1], vinfo);
 			}
+		} else if (strcmp(f, "-relayout") == 0) {
+			if (argc < 4) {
+				printUsage("Missing file parameter");
+			} else if (!relayoutObf(argv[2], argv[3])) {
+				return 1;
+			}
 		} else if (f[1]=='r') {
 			if (argc < 2) {
 				printUsage("Missing file parameter");
@@ -309,8 +1854,10 @@ int main(int argc, char **argv) {
 				for (int i = 1; i != argc; ++i) {
 					if (sscanf(argv[i], "-renderingInputFile=%s", s)) {
 						BinaryMapFile* mf = initBinaryMapFile(s);
-						osmand_log_print(LOG_INFO, "Init %d (success) binary map file %s.", mf->version,
-								mf->inputName.c_str());
+						if (mf != NULL) {
+							OsmAnd::LogPrintf(OsmAnd::LogSeverityLevel::Info, "Init %d (success) binary map file %s.", mf->version,
+									mf->inputName.c_str());
+						}
 					}
 				}
 				runSimpleRendering(info->renderingFileName, info->imagesFileName, info);
@@ -321,6 +1868,60 @@ int main(int argc, char **argv) {
 				}
 				delete info;
 			}
+		} else if (strcmp(f, "-bcoordinates") == 0) {
+			if (!benchmarkCoordinates(argc, argv)) {
+				return 1;
+			}
+		} else if (strcmp(f, "-bpoi") == 0) {
+			if (!benchmarkPoi(argc, argv)) {
+				return 1;
+			}
+		} else if (strcmp(f, "-btransport") == 0) {
+			if (!benchmarkTransport(argc, argv)) {
+				return 1;
+			}
+		} else if (strcmp(f, "-broute") == 0) {
+			if (!benchmarkRoute(argc, argv)) {
+				return 1;
+			}
+		} else if (strcmp(f, "-bnodes") == 0) {
+			if (!benchmarkNodes(argc, argv)) {
+				return 1;
+			}
+		} else if (strcmp(f, "-brules") == 0) {
+			if (!benchmarkRules(argc, argv)) {
+				return 1;
+			}
+		} else if (strcmp(f, "-bch") == 0) {
+			if (!benchmarkHierarchy(argc, argv)) {
+				return 1;
+			}
+		} else if (strcmp(f, "-balt") == 0) {
+			if (!benchmarkLandmarks(argc, argv)) {
+				return 1;
+			}
+		} else if (strcmp(f, "-landmarks") == 0) {
+			int count = 16;
+			for (int i = 2; i < argc; i++) {
+				sscanf(argv[i], "-count=%d", &count);
+			}
+			if (argc < 3) {
+				printUsage("Missing file parameter");
+			} else if (!writeRouteLandmarks(argv[argc - 1], count)) {
+				return 1;
+			}
+		} else if (strcmp(f, "-chbuild") == 0) {
+			if (argc < 4) {
+				printUsage("Missing file parameter");
+			} else if (!writeContractionHierarchy(argv[2], argc - 3, argv + 3)) {
+				return 1;
+			}
+		} else if (strncmp(f, "-address=", 9) == 0) {
+			if (argc < 3) {
+				printUsage("Missing file parameter");
+			} else {
+				searchAddressPrefix(f + 9, argv[argc - 1]);
+			}
 		} else {
 			printUsage("Unknown command");
 		}
@@ -330,4 +1931,5 @@ int main(int argc, char **argv) {
 
 	SkGraphics::PurgeFontCache();
 	purgeCachedBitmaps();
+	return 0;
 }
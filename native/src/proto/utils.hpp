@@ -12,6 +12,8 @@
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
+#include "varint.hpp"
+
 using google::protobuf::io::CodedInputStream;
 using google::protobuf::io::FileInputStream;
 using google::protobuf::internal::WireFormatLite;
@@ -86,6 +88,45 @@ inline bool readSint32(CodedInputStream & input, int32_t & output)
 	return WireFormatLite::ReadPrimitive<int32_t, WireFormatLite::TYPE_SINT32>(&input, &output);
 }
 
+// Reads (x, y) sint32 pairs up to the current limit and gives them to f.
+// Over an in memory stream they are decoded in bulk, without protobuf
+// checks for every byte. Either way it fails on a broken value or an x
+// with no y.
+template <typename F>
+bool readSint32Pairs(CodedInputStream & input, F f)
+{
+	int remaining = input.BytesUntilLimit();
+	void const * data;
+	int size;
+	if (remaining > 0 && input.GetDirectBufferPointer(&data, &size) && size >= remaining)
+	{
+		uint8_t const * p = static_cast<uint8_t const *>(data);
+		uint8_t const * end = p + remaining;
+		int32_t values[64];
+		while (p < end)
+		{
+			int n = varint::decodeSint32s(p, end, values, 64);
+			// Chunks are even, only the last one can end half a pair
+			if (n < 0 || n % 2 != 0) {
+				return false;
+			}
+			for (int i = 0; i < n; i += 2) {
+				f(values[i], values[i + 1]);
+			}
+		}
+		return input.Skip(remaining);
+	}
+	while (input.BytesUntilLimit() > 0)
+	{
+		int32_t x, y;
+		if (!readSint32(input, x) || !readSint32(input, y)) {
+			return false;
+		}
+		f(x, y);
+	}
+	return true;
+}
+
 inline bool readSint64(CodedInputStream & input, int64_t & output)
 {
 	return WireFormatLite::ReadPrimitive<int64_t, WireFormatLite::TYPE_SINT64>(&input, &output);
@@ -0,0 +1,93 @@
+/*
+ * varint.hpp
+ *
+ *  Created on: 18/10/2026
+ */
+
+#ifndef VARINT_HPP_
+#define VARINT_HPP_
+
+#include <stdint.h>
+
+// Bulk decoding of packed sint32 runs (coordinate deltas) straight from memory.
+// Most deltas take one or two bytes, so those are decoded inline without
+// bounds checks while at least 10 bytes (the longest varint) remain.
+// A 16 byte SSE2 test for runs of one byte values was measured too: with
+// the usual mix of one and two byte deltas it was not faster than this.
+namespace varint
+{
+
+inline int32_t zigZagDecode32(uint32_t n)
+{
+	return (int32_t) ((n >> 1) ^ (0 - (n & 1)));
+}
+
+// As protobuf: up to 10 bytes, only low 32 bits kept.
+inline bool readVarint32(uint8_t const * & p, uint8_t const * end, uint32_t & value)
+{
+	uint32_t result = 0;
+	for (int i = 0; i < 10 && p < end; i++) {
+		uint8_t b = *p++;
+		if (i < 5) {
+			result |= (uint32_t) (b & 0x7F) << (7 * i);
+		}
+		if ((b & 0x80) == 0) {
+			value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Decodes up to max sint32 values from [p, end) into out. p moves past them.
+// Returns how many were decoded, or -1 if a value is broken.
+inline int decodeSint32s(uint8_t const * & p, uint8_t const * end, int32_t * out, int max)
+{
+	int n = 0;
+	while (n < max && end - p >= 10) {
+		uint32_t b0 = p[0];
+		if (b0 < 0x80) {
+			out[n++] = zigZagDecode32(b0);
+			p += 1;
+			continue;
+		}
+		uint32_t b1 = p[1];
+		if (b1 < 0x80) {
+			out[n++] = zigZagDecode32((b0 & 0x7F) | (b1 << 7));
+			p += 2;
+			continue;
+		}
+		uint32_t v;
+		if (!readVarint32(p, end, v)) {
+			return -1;
+		}
+		out[n++] = zigZagDecode32(v);
+	}
+	// Tail, checked
+	while (n < max && p < end) {
+		uint32_t v;
+		if (!readVarint32(p, end, v)) {
+			return -1;
+		}
+		out[n++] = zigZagDecode32(v);
+	}
+	return n;
+}
+
+// Same result, one value at a time. Reference for decodeSint32s.
+inline int decodeSint32sScalar(uint8_t const * & p, uint8_t const * end, int32_t * out, int max)
+{
+	int n = 0;
+	while (n < max && p < end) {
+		uint32_t v;
+		if (!readVarint32(p, end, v)) {
+			return -1;
+		}
+		out[n++] = zigZagDecode32(v);
+	}
+	return n;
+}
+
+} // namespace varint
+
+#endif /* VARINT_HPP_ */
@@ -48,6 +48,7 @@ std::string colorToString(int color) {
 RenderingRule::RenderingRule(Attributes const & attrs, bool isGroup, RenderingRulesStorage* storage) {
 	storage->childRules.push_back(this);
 	this->isGroup = isGroup;
+	additionalId = NO_TAG_VALUE;
 	properties.reserve(attrs.size());
 	intProperties.assign(attrs.size(), -1);
 	Attributes::const_iterator it = attrs.begin();
@@ -62,6 +63,10 @@ RenderingRule::RenderingRule(Attributes const & attrs, bool isGroup, RenderingRu
 
 		if (property->isString()) {
 			intProperties[i] = storage->getDictionaryValue(it->second);
+			size_t eq = it->second.find('=');
+			if (property == storage->PROPS.R_ADDITIONAL && eq != std::string::npos) {
+				additionalId = internTagValue(it->second.substr(0, eq), it->second.substr(eq + 1));
+			}
 		} else if (property->isFloat()) {
 			if (floatProperties.size() == 0) {
 				// lazy creates
@@ -541,13 +546,7 @@ bool RenderingRuleSearchRequest::checkInputProperties(RenderingRule const * rule
 				if (obj == NULL) {
 					match = true;
 				} else {
-					std::string const & val = storage->getDictionaryValue(rule->intProperties[i]);
-					int i = val.find('=');
-					if (i >= 0) {
-						match = obj->containsAdditional(val.substr(0, i), val.substr(i + 1));
-					} else {
-						match = false;
-					}
+					match = rule->additionalId != NO_TAG_VALUE && obj->containsAdditional(rule->additionalId);
 				}
 			} else {
 				match = rule->intProperties[i] == values[rp->id];
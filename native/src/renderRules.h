@@ -165,6 +165,8 @@ public:
 	std::vector<RenderingRule*> ifElseChildren;
 	std::vector<RenderingRule*> ifChildren;
 	bool isGroup;
+	// Pair of the "additional" property (tag=value), NO_TAG_VALUE if none
+	uint32_t additionalId;
 
 	RenderingRule(Attributes const & attrs, bool isGroup, RenderingRulesStorage* storage);
 	void printDebugRenderingRule(std::string & indent, RenderingRulesStorage const * st) const;
@@ -567,7 +569,7 @@ class BasePathRenderingRulesStorageResolver : public RenderingRulesStorageResolv
 public:
 	std::string const path;
 	BasePathRenderingRulesStorageResolver(std::string const & path) : path(path) {	}
-	virtual RenderingRulesStorage* resolve(std::string const & name) {
+	virtual RenderingRulesStorage* resolve(std::string const & name) const {
 		std::string file = path;
 		file += name;
 		file+=".render.xml";
@@ -227,14 +227,11 @@ int updatePaint(RenderingRuleSearchRequest const * req, SkPaint & paint, int ind
 
 void renderText(MapDataObject* obj, RenderingRuleSearchRequest* req, RenderingContext & rc, std::string const & tag,
 		std::string const & value, float xText, float yText, SkPath const * path) {
-	UNORDERED(map)<std::string, std::string>::const_iterator it, next = obj->objectNames.begin();
-	while (next != obj->objectNames.end()) {
-		it = next++;
-		if (it->second.length() > 0) {
-			std::string name = it->second;
-			std::string tagName = it->first == "name" ? "" : it->first;
-			if (tagName == "" && rc.isUsingEnglishNames() && obj->objectNames.find("name:en") !=
-					obj->objectNames.end()) {
+	for (size_t n = 0; n < obj->namesCount(); n++) {
+		if (obj->name(n).length() > 0) {
+			std::string name = obj->name(n);
+			std::string tagName = obj->nameTag(n) == "name" ? "" : obj->nameTag(n);
+			if (tagName == "" && rc.isUsingEnglishNames() && obj->findName("name:en") != NULL) {
 				continue;
 			} 
 			if (tagName == "name:en" && !rc.isUsingEnglishNames()) {
@@ -250,9 +247,9 @@ void renderText(MapDataObject* obj, RenderingRuleSearchRequest* req, RenderingCo
 				TextDrawInfo* info = new TextDrawInfo(name);
 				std::string tagName2 = req->getStringPropertyValue(req->props()->R_NAME_TAG2);
 				if(tagName2 != "") {
-					std::string tv = obj->objectNames[tagName2];
-					if(tv != "") {
-						info->text = name + " " + tv;
+					std::string const * tv = obj->findName(tagName2);
+					if(tv != NULL && *tv != "") {
+						info->text = name + " " + *tv;
 					}
 				}
 				info->drawOnPath = (path != NULL) && (req->getIntPropertyValue(req->props()->R_TEXT_ON_PATH, 0) > 0);
@@ -410,9 +407,11 @@ void drawPolyline(MapDataObject* mObj, RenderingRuleSearchRequest* req, SkCanvas
 	}
 	int oneway = 0;
 	if (rc.getZoom() >= 16 && pair.first == "highway") {
-		if (mObj->containsAdditional("oneway", "yes")) {
+		static uint32_t const onewayYes = internTagValue("oneway", "yes");
+		static uint32_t const onewayReverse = internTagValue("oneway", "-1");
+		if (mObj->containsAdditional(onewayYes)) {
 			oneway = 1;
-		} else if (mObj->containsAdditional("oneway", "-1")) {
+		} else if (mObj->containsAdditional(onewayReverse)) {
 			oneway = -1;
 		}
 	}
@@ -21,9 +21,24 @@ LOCAL_SRC_FILES := \
 	$(OSMAND_CORE_RELATIVE)/src/multipolygons.cpp \
 	$(OSMAND_CORE_RELATIVE)/src/renderRules.cpp \
 	$(OSMAND_CORE_RELATIVE)/src/rendering.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/MappedFile.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/NodeCache.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/SpatialDirectory.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/DeltaOverlay.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/ObfRelayout.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/AddressIndex.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/TransportIndex.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/TransportPlanner.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/ContractionHierarchy.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/RouteLandmarks.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/RoutingDataFile.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/TagDictionary.cpp \
 	$(OSMAND_CORE_RELATIVE)/src/binaryRead.cpp \
 	$(OSMAND_CORE_RELATIVE)/src/binaryRoutingIndexRead.cpp \
 	$(OSMAND_CORE_RELATIVE)/src/binaryMapIndexRead.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/binaryPoiIndexRead.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/binaryAddressIndexRead.cpp \
+	$(OSMAND_CORE_RELATIVE)/src/binaryTransportIndexRead.cpp \
         $(OSMAND_CORE_RELATIVE)/src/generalRouter.cpp \
 	$(OSMAND_CORE_RELATIVE)/src/binaryRoutePlanner.cpp \
 	$(OSMAND_CORE_RELATIVE)/src/RoutingContext.cpp \